@@ -0,0 +1,159 @@
+/**
+ * @file bench_distance_baseline.c
+ * @brief Per-pulse distance against the former per-stroke distance
+ *
+ * Usage: bench_distance_baseline [options]
+ *
+ * Distance used to advance once per stroke by ∛(W/2.80), W being the work of
+ * the stroke, clamped to 2-20 m. It now advances on every flywheel pulse by
+ * ∛(k/2.80) × angle, so totals (and the pace derived from them) differ from
+ * what older firmware reported for the same rowing: the former formula is
+ * ∛(E×t²/2.80) without the t² of a stroke lasting t seconds, so it fell
+ * short by about t^(2/3), most at low stroke rates. This bench rows a set of
+ * workouts through the flywheel model (flywheel_sim.c) and the firmware
+ * pipeline (replay_pipeline.c), rebuilds the former total from the work of
+ * each stroke, and prints both.
+ *
+ * The change is pinned: the run fails (exit 1) if, for any workout, the new
+ * total is off the expected offset from the former total by more than the
+ * tolerance, so a later change to either definition shows up here.
+ */
+
+#include "replay_pipeline.h"
+#include "app_config.h"
+#include "config_manager.h"
+#include "esp_log.h"
+#include "flywheel_sim.h"
+#include "rowing_physics.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    double spm;
+    double torque;
+    double expected_offset_pct;         // (new - former) / former, measured at 4 magnets
+} workout_t;
+
+// The same workouts as bench_physics_accuracy
+static const workout_t s_workouts[] = {
+    { 18.0, 6.0, 121.0 },
+    { 24.0, 8.0, 82.7 },
+    { 30.0, 7.0, 58.2 },
+};
+
+#define NUM_WORKOUTS    (sizeof(s_workouts) / sizeof(s_workouts[0]))
+
+/**
+ * Former per-stroke distance, rebuilt from the work between strokes
+ */
+typedef struct {
+    double last_work_joules;
+    double distance_m;
+} baseline_t;
+
+/** Distance the firmware used to add for a stroke of the given work */
+static double baseline_stroke_distance(double work_joules) {
+    if (work_joules <= 0.1) {
+        return 0.0;
+    }
+    double distance = cbrt(work_joules / 2.80);
+    if (distance < 2.0) {
+        distance = 2.0;
+    }
+    if (distance > 20.0) {
+        distance = 20.0;
+    }
+    return distance;
+}
+
+static void on_stroke(void *ctx, const rowing_metrics_t *metrics) {
+    baseline_t *baseline = ctx;
+    double work = metrics->total_work_joules;
+    baseline->distance_m += baseline_stroke_distance(work - baseline->last_work_joules);
+    baseline->last_work_joules = work;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  --minutes <m>     rowing time per workout (default 5)\n"
+            "  --jitter <us>     max pulse time jitter (default 20)\n"
+            "  --tolerance <%%>   allowed drift of the offset, percentage points (default 1)\n",
+            prog);
+}
+
+int main(int argc, char **argv) {
+    double minutes = 5.0;
+    int jitter_us = 20;
+    double tolerance_pct = 1.0;
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 < argc && strcmp(argv[i], "--minutes") == 0) {
+            minutes = atof(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "--jitter") == 0) {
+            jitter_us = atoi(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "--tolerance") == 0) {
+            tolerance_pct = atof(argv[++i]);
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (minutes <= 0 || jitter_us < 0 || tolerance_pct <= 0) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    esp_log_level_set("*", ESP_LOG_ERROR);
+
+    static replay_pipeline_t pipeline;
+    int failures = 0;
+    printf("# spm torque strokes  distance_m  former_m  offset%%  expected%%\n");
+
+    for (size_t w = 0; w < NUM_WORKOUTS; w++) {
+        flywheel_sim_params_t params;
+        flywheel_sim_default_params(&params);
+        params.spm = s_workouts[w].spm;
+        params.torque = s_workouts[w].torque;
+        params.magnets = DEFAULT_MAGNETS_PER_REV;
+        params.jitter_us = jitter_us;
+
+        config_t config;
+        config_manager_get_defaults(&config);
+        config.moment_of_inertia = (float)params.inertia;
+        config.initial_drag_coefficient = (float)params.drag;
+        rowing_physics_set_magnets_per_rev(DEFAULT_MAGNETS_PER_REV);
+        replay_pipeline_init(&pipeline, &config, FLYWHEEL_SIM_START_TIME_US);
+
+        baseline_t baseline = {0};
+        pipeline.on_stroke = on_stroke;
+        pipeline.ctx = &baseline;
+
+        flywheel_sim_t sim;
+        flywheel_sim_init(&sim, &params);
+        flywheel_sim_event_t event;
+        int64_t last_us = FLYWHEEL_SIM_START_TIME_US;
+        while (flywheel_sim_next(&sim, minutes * 60.0, &event)) {
+            replay_pipeline_event(&pipeline, event.channel, event.timestamp_us);
+            last_us = event.timestamp_us;
+        }
+        replay_pipeline_finish(&pipeline, last_us);
+
+        double distance = pipeline.metrics.total_distance_meters;
+        double offset_pct = 100.0 * (distance - baseline.distance_m) / baseline.distance_m;
+        bool ok = fabs(offset_pct - s_workouts[w].expected_offset_pct) <= tolerance_pct;
+        printf("%5.0f %6.1f %7lu %11.1f %9.1f %8.1f %10.1f %s\n",
+               s_workouts[w].spm, s_workouts[w].torque, (unsigned long)pipeline.metrics.stroke_count,
+               distance, baseline.distance_m, offset_pct, s_workouts[w].expected_offset_pct,
+               ok ? "ok" : "FAIL");
+        if (!ok) {
+            failures++;
+        }
+    }
+
+    printf("# %s\n", failures == 0 ? "PASS" : "FAIL");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,274 @@
+/**
+ * @file bench_drag_estimator.c
+ * @brief Convergence and stability of the drag factor on synthetic rows
+ *
+ * Usage: bench_drag_estimator [options]
+ *
+ * Rows the flywheel model (flywheel_sim.c) through the firmware pipeline
+ * (replay_pipeline.c) with a drag different from the firmware's initial
+ * value, in two scenarios:
+ *   - "start": constant damper for the whole row
+ *   - "step":  the damper is moved half way through
+ * and reads the drag factor after every stroke. Two methods are compared:
+ *   - "ema":  the previous firmware method (k = -I*α/ω² per recovery pulse,
+ *             5% exponential moving average), run on the pipeline's ω/α
+ *   - "rls":  the firmware's drag_estimator (recovery line fits combined
+ *             with a forgetting factor)
+ * For each it prints how many strokes the drag factor needs to settle
+ * within the tolerance of the model's (and stay there), the RMS error over
+ * the settled half of each segment, and the firmware's final confidence.
+ */
+
+#include "replay_pipeline.h"
+#include "app_config.h"
+#include "config_manager.h"
+#include "esp_log.h"
+#include "flywheel_sim.h"
+#include "rowing_physics.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_STROKES         4096
+
+typedef enum {
+    METHOD_EMA = 0,
+    METHOD_RLS,
+    NUM_METHODS
+} method_t;
+
+static const char *s_method_names[NUM_METHODS] = { "ema", "rls" };
+
+typedef struct {
+    double drag_factor[NUM_METHODS][MAX_STROKES];
+    double confidence[MAX_STROKES];
+    double model_drag_factor[MAX_STROKES];
+    uint32_t strokes;
+
+    // Previous firmware method, fed from the pipeline after every pulse
+    double ema_k;
+    uint32_t ema_samples;
+} drag_run_t;
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  --minutes <m>        rowing time per scenario (default 6)\n"
+            "  --spm <r>            stroke rate (default 24)\n"
+            "  --magnets <n>        magnets per revolution (default %d)\n"
+            "  --jitter <us>        max pulse time jitter (default 20)\n"
+            "  --drag <df>          model drag factor (default 130)\n"
+            "  --step-drag <df>     drag factor after the step (default 90)\n"
+            "  --forgetting <l>     drag forgetting factor (default %.2f)\n"
+            "  --tolerance <%%>      settled band around the model (default 2)\n"
+            "  --csv                print the drag factor after every stroke\n",
+            prog, DEFAULT_MAGNETS_PER_REV, DRAG_FORGETTING_FACTOR);
+}
+
+static void update_ema(drag_run_t *run, const rowing_metrics_t *m) {
+    float omega = m->angular_velocity_rad_s;
+    float alpha = m->angular_acceleration_rad_s2;
+    if (m->current_phase != STROKE_PHASE_RECOVERY || alpha >= 0 || fabsf(omega) < 1.0f) {
+        return;
+    }
+    double measured_k = -m->moment_of_inertia * alpha / (omega * omega);
+    if (measured_k < 0 || measured_k > 0.01) {
+        return;
+    }
+    run->ema_k = run->ema_samples == 0 ? measured_k : 0.95 * run->ema_k + 0.05 * measured_k;
+    run->ema_samples++;
+}
+
+static void on_stroke(void *ctx, const rowing_metrics_t *m) {
+    drag_run_t *run = ctx;
+    if (run->strokes >= MAX_STROKES) {
+        return;
+    }
+    run->drag_factor[METHOD_EMA][run->strokes] = run->ema_k * 1e6;
+    run->drag_factor[METHOD_RLS][run->strokes] = m->drag_coefficient * 1e6;
+    run->confidence[run->strokes] = m->drag_confidence;
+    run->strokes++;
+}
+
+static void row(drag_run_t *run, double minutes, double spm, int magnets, int jitter_us,
+                double drag_factor, double step_drag_factor, float forgetting) {
+    static replay_pipeline_t pipeline;
+    memset(run, 0, sizeof(*run));
+
+    flywheel_sim_params_t params;
+    flywheel_sim_default_params(&params);
+    params.spm = spm;
+    params.magnets = magnets;
+    params.jitter_us = jitter_us;
+    params.drag = drag_factor * 1e-6;
+
+    config_t config;
+    config_manager_get_defaults(&config);
+    config.moment_of_inertia = (float)params.inertia;
+    config.drag_forgetting_factor = forgetting;
+
+    rowing_physics_set_magnets_per_rev((uint8_t)magnets);
+    replay_pipeline_init(&pipeline, &config, FLYWHEEL_SIM_START_TIME_US);
+    pipeline.on_stroke = on_stroke;
+    pipeline.ctx = run;
+    run->ema_k = config.initial_drag_coefficient;
+
+    flywheel_sim_t sim;
+    flywheel_sim_init(&sim, &params);
+    flywheel_sim_event_t event;
+    int64_t step_us = FLYWHEEL_SIM_START_TIME_US + (int64_t)(minutes * 30e6);
+    int64_t last_us = FLYWHEEL_SIM_START_TIME_US;
+    while (flywheel_sim_next(&sim, minutes * 60.0, &event)) {
+        if (event.timestamp_us >= step_us) {
+            sim.params.drag = step_drag_factor * 1e-6;
+        }
+        uint32_t before = run->strokes;
+        replay_pipeline_event(&pipeline, event.channel, event.timestamp_us);
+        if (event.channel == TRACE_CHANNEL_FLYWHEEL) {
+            update_ema(run, &pipeline.metrics);
+        }
+        if (run->strokes != before) {
+            run->model_drag_factor[before] = sim.params.drag * 1e6;
+        }
+        last_us = event.timestamp_us;
+    }
+    replay_pipeline_finish(&pipeline, last_us);
+}
+
+/**
+ * Strokes from the segment start until the drag factor enters the band for
+ * good (-1 if it never does), and RMS error over the second half
+ */
+static void segment_stats(const drag_run_t *run, method_t method, uint32_t first, uint32_t end,
+                          double tolerance_pct, int *settle, double *rms_pct) {
+    *settle = -1;
+    for (uint32_t i = end; i > first; i--) {
+        double model = run->model_drag_factor[i - 1];
+        double err = 100.0 * fabs(run->drag_factor[method][i - 1] - model) / model;
+        if (err > tolerance_pct) {
+            *settle = i < end ? (int)(i - first) : -1;
+            break;
+        }
+        if (i - 1 == first) {
+            *settle = 0;
+        }
+    }
+
+    double sum = 0;
+    uint32_t n = 0;
+    for (uint32_t i = first + (end - first) / 2; i < end; i++) {
+        double model = run->model_drag_factor[i];
+        double err = 100.0 * (run->drag_factor[method][i] - model) / model;
+        sum += err * err;
+        n++;
+    }
+    *rms_pct = n > 0 ? sqrt(sum / n) : 0;
+}
+
+int main(int argc, char **argv) {
+    double minutes = 6.0;
+    double spm = 24.0;
+    int magnets = DEFAULT_MAGNETS_PER_REV;
+    int jitter_us = 20;
+    double drag_factor = 130.0;
+    double step_drag_factor = 90.0;
+    float forgetting = DRAG_FORGETTING_FACTOR;
+    double tolerance_pct = 2.0;
+    bool csv = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 < argc && strcmp(argv[i], "--minutes") == 0) {
+            minutes = atof(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "--spm") == 0) {
+            spm = atof(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "--magnets") == 0) {
+            magnets = atoi(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "--jitter") == 0) {
+            jitter_us = atoi(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "--drag") == 0) {
+            drag_factor = atof(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "--step-drag") == 0) {
+            step_drag_factor = atof(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "--forgetting") == 0) {
+            forgetting = (float)atof(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "--tolerance") == 0) {
+            tolerance_pct = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--csv") == 0) {
+            csv = true;
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (minutes <= 0 || spm <= 0 || magnets < 1 || magnets > 255 || jitter_us < 0 ||
+        drag_factor <= 0 || step_drag_factor <= 0 || forgetting <= 0 || forgetting > 1 ||
+        tolerance_pct <= 0) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    esp_log_level_set("*", ESP_LOG_ERROR);
+
+    static drag_run_t run;
+    const char *scenarios[] = { "start", "step" };
+
+    printf("# %.0f spm, %d magnets, jitter %d us, forgetting %.2f, initial DF %.0f\n",
+           spm, magnets, jitter_us, forgetting, DEFAULT_DRAG_COEFFICIENT * 1e6);
+    printf("# scenario  segment  method  settle_strokes  rms_err%%  final_df  model_df  confidence\n");
+
+    for (int s = 0; s < 2; s++) {
+        bool step = s == 1;
+        row(&run, minutes, spm, magnets, jitter_us, drag_factor,
+            step ? step_drag_factor : drag_factor, forgetting);
+
+        if (csv) {
+            printf("# stroke,scenario,model_df,ema_df,rls_df,confidence\n");
+            for (uint32_t i = 0; i < run.strokes; i++) {
+                printf("stroke,%s,%.1f,%.1f,%.1f,%.2f\n", scenarios[s], run.model_drag_factor[i],
+                       run.drag_factor[METHOD_EMA][i], run.drag_factor[METHOD_RLS][i],
+                       run.confidence[i]);
+            }
+        }
+
+        // Split at the first stroke rowed against the new damper
+        uint32_t split = run.strokes;
+        if (step) {
+            for (uint32_t i = 0; i < run.strokes; i++) {
+                if (run.model_drag_factor[i] != run.model_drag_factor[0]) {
+                    split = i;
+                    break;
+                }
+            }
+        }
+
+        for (int seg = 0; seg < (step ? 2 : 1); seg++) {
+            uint32_t first = seg == 0 ? 0 : split;
+            uint32_t end = seg == 0 ? split : run.strokes;
+            if (end <= first) {
+                continue;
+            }
+            for (int m = 0; m < NUM_METHODS; m++) {
+                int settle;
+                double rms_pct;
+                segment_stats(&run, (method_t)m, first, end, tolerance_pct, &settle, &rms_pct);
+                char settle_str[16];
+                if (settle >= 0) {
+                    snprintf(settle_str, sizeof(settle_str), "%d", settle);
+                } else {
+                    snprintf(settle_str, sizeof(settle_str), "never");
+                }
+                printf("%10s %8d %7s %15s %9.2f %9.1f %9.1f",
+                       scenarios[s], seg + 1, s_method_names[m], settle_str, rms_pct,
+                       run.drag_factor[m][end - 1], run.model_drag_factor[end - 1]);
+                if (m == METHOD_RLS) {
+                    printf(" %11.2f\n", run.confidence[end - 1]);
+                } else {
+                    printf(" %11s\n", "-");
+                }
+            }
+        }
+    }
+    return 0;
+}
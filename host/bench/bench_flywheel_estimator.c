@@ -0,0 +1,261 @@
+/**
+ * @file bench_flywheel_estimator.c
+ * @brief Cost and accuracy of the flywheel ω/α estimators
+ *
+ * Usage: bench_flywheel_estimator [options]
+ *
+ * Runs the flywheel model of trace_synth (flywheel_sim.c), records the true
+ * ω and α at every magnet pulse and then compares, on the jittered and
+ * µs-quantized pulse times:
+ *   - "diff":  the previous firmware method (ω from the last interval,
+ *              α from the last two ω values)
+ *   - "fit N": flywheel_estimator with an N-pulse window
+ * For each method it prints the RMS error of ω and α against the model and
+ * the cost per pulse (ns, plus TSC cycles on x86).
+ */
+
+#include "app_config.h"
+#include "flywheel_estimator.h"
+#include "flywheel_sim.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#else
+#define HAVE_TSC 0
+#endif
+
+#define WARMUP_PULSES       64          // Skip start-up transient in error stats
+#define TIMING_PULSES       20000000L   // Pulses processed per timing run
+
+typedef struct {
+    int64_t *time_us;       // Measured (jittered, quantized) pulse times
+    double *omega;          // Model ω at the true pulse time
+    double *alpha;          // Model α at the true pulse time
+    long count;
+    long debounced;         // Pulses lost to the ISR debounce
+} pulse_set_t;
+
+typedef struct {
+    double omega_rms;
+    double alpha_rms;
+    double ns_per_pulse;
+    double cycles_per_pulse;
+} bench_result_t;
+
+static volatile float s_sink;
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  --minutes <m>     simulated rowing time (default 5)\n"
+            "  --spm <r>         stroke rate (default 24)\n"
+            "  --torque <N*m>    peak drive torque (default 8)\n"
+            "  --magnets <n>     magnets per revolution (default %d)\n"
+            "  --jitter <us>     max pulse time jitter (default 100)\n"
+            "  --seed <n>        jitter seed (default 1)\n",
+            prog, DEFAULT_MAGNETS_PER_REV);
+}
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static uint64_t now_cycles(void) {
+#if HAVE_TSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+/**
+ * Run the flywheel model and collect one entry per magnet pulse
+ */
+static pulse_set_t simulate(double minutes, const flywheel_sim_params_t *params) {
+    long capacity = 1024;
+    pulse_set_t set = {
+        .time_us = malloc(capacity * sizeof(int64_t)),
+        .omega = malloc(capacity * sizeof(double)),
+        .alpha = malloc(capacity * sizeof(double)),
+    };
+
+    flywheel_sim_t sim;
+    flywheel_sim_init(&sim, params);
+    flywheel_sim_event_t event;
+
+    while (flywheel_sim_next(&sim, minutes * 60.0, &event)) {
+        if (event.channel != TRACE_CHANNEL_FLYWHEEL) {
+            continue;
+        }
+        if (set.count == capacity) {
+            capacity *= 2;
+            set.time_us = realloc(set.time_us, capacity * sizeof(int64_t));
+            set.omega = realloc(set.omega, capacity * sizeof(double));
+            set.alpha = realloc(set.alpha, capacity * sizeof(double));
+        }
+        set.time_us[set.count] = event.timestamp_us;
+        set.omega[set.count] = event.omega;
+        set.alpha[set.count] = event.alpha;
+        set.count++;
+    }
+    set.debounced = sim.debounced;
+    return set;
+}
+
+/**
+ * Previous firmware estimate: ω from one interval, α from two
+ */
+static void finite_difference(const int64_t *t, long i, float radians_per_pulse,
+                              float *prev_omega, float *omega, float *alpha) {
+    float dt = (float)(t[i] - t[i - 1]) / 1000000.0f;
+    float w = radians_per_pulse / dt;
+    *alpha = *prev_omega > 0 ? (w - *prev_omega) / dt : 0.0f;
+    *omega = w;
+    *prev_omega = w;
+}
+
+/**
+ * @param window 0 for finite differences, otherwise the estimator window
+ */
+static bench_result_t run_method(const pulse_set_t *set, int window, float radians_per_pulse) {
+    bench_result_t result = {0};
+    flywheel_estimator_t est;
+    flywheel_estimator_init(&est, window > 0 ? window : 3, radians_per_pulse);
+
+    // Accuracy
+    double omega_sq = 0, alpha_sq = 0;
+    long n = 0;
+    float prev_omega = 0, omega = 0, alpha = 0;
+    for (long i = 0; i < set->count; i++) {
+        bool valid;
+        if (window > 0) {
+            flywheel_estimator_push(&est, set->time_us[i]);
+            valid = flywheel_estimator_get(&est, &omega, &alpha);
+        } else {
+            valid = i > 0;
+            if (valid) {
+                finite_difference(set->time_us, i, radians_per_pulse, &prev_omega, &omega, &alpha);
+            }
+        }
+        if (valid && i >= WARMUP_PULSES) {
+            omega_sq += (omega - set->omega[i]) * (omega - set->omega[i]);
+            alpha_sq += (alpha - set->alpha[i]) * (alpha - set->alpha[i]);
+            n++;
+        }
+    }
+    result.omega_rms = n > 0 ? sqrt(omega_sq / n) : 0;
+    result.alpha_rms = n > 0 ? sqrt(alpha_sq / n) : 0;
+
+    // Cost: the same pulse sequence, looped (shifted forward in time each pass)
+    long passes = TIMING_PULSES / set->count + 1;
+    int64_t span = set->time_us[set->count - 1] - set->time_us[0] + 100000;
+    flywheel_estimator_reset(&est);
+    prev_omega = 0;
+    float acc = 0;
+
+    double start_ns = now_ns();
+    uint64_t start_cycles = now_cycles();
+    for (long p = 0; p < passes; p++) {
+        int64_t offset = p * span;
+        for (long i = 1; i < set->count; i++) {
+            if (window > 0) {
+                flywheel_estimator_push(&est, set->time_us[i] + offset);
+                flywheel_estimator_get(&est, &omega, &alpha);
+            } else {
+                finite_difference(set->time_us, i, radians_per_pulse, &prev_omega, &omega, &alpha);
+            }
+            acc += omega + alpha;
+        }
+    }
+    uint64_t cycles = now_cycles() - start_cycles;
+    double elapsed_ns = now_ns() - start_ns;
+    s_sink = acc;
+
+    double pulses = (double)passes * (double)(set->count - 1);
+    result.ns_per_pulse = elapsed_ns / pulses;
+    result.cycles_per_pulse = (double)cycles / pulses;
+    return result;
+}
+
+int main(int argc, char **argv) {
+    double minutes = 5.0;
+    flywheel_sim_params_t params;
+    flywheel_sim_default_params(&params);
+    params.jitter_us = 100;
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 < argc && strcmp(argv[i], "--minutes") == 0) {
+            minutes = atof(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "--spm") == 0) {
+            params.spm = atof(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "--torque") == 0) {
+            params.torque = atof(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "--magnets") == 0) {
+            params.magnets = atoi(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "--jitter") == 0) {
+            params.jitter_us = atoi(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "--seed") == 0) {
+            params.seed = (uint32_t)strtoul(argv[++i], NULL, 0);
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (minutes <= 0 || params.spm <= 0 || 60.0 / params.spm <= params.drive_s ||
+        params.magnets < 1 || params.jitter_us < 0) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    pulse_set_t set = simulate(minutes, &params);
+    if (set.count <= WARMUP_PULSES) {
+        fprintf(stderr, "too few pulses (%ld)\n", set.count);
+        return 1;
+    }
+    if (set.debounced > 0) {
+        fprintf(stderr, "warning: %ld pulses fell inside the %d us debounce, errors include missed magnets\n",
+                set.debounced, FLYWHEEL_DEBOUNCE_US);
+    }
+
+    float radians_per_pulse = (float)(2.0 * M_PI / params.magnets);
+    printf("# %ld pulses, %d magnets, %.0f spm, jitter +/-%d us\n",
+           set.count, params.magnets, params.spm, params.jitter_us);
+    printf("# method   omega_rms  alpha_rms   ns/pulse  cycles/pulse\n");
+
+    bench_result_t diff = run_method(&set, 0, radians_per_pulse);
+    printf("diff       %9.3f  %9.2f  %9.1f  %12.0f\n",
+           diff.omega_rms, diff.alpha_rms, diff.ns_per_pulse, diff.cycles_per_pulse);
+
+    static const int windows[] = { 3, 4, FLYWHEEL_REGRESSION_WINDOW, 8, 12, 16, 32 };
+    int last_window = 0;
+    for (size_t w = 0; w < sizeof(windows) / sizeof(windows[0]); w++) {
+        if (windows[w] <= last_window) {
+            continue;   // FLYWHEEL_REGRESSION_WINDOW may duplicate a neighbour
+        }
+        last_window = windows[w];
+        bench_result_t fit = run_method(&set, windows[w], radians_per_pulse);
+        printf("fit %-3d%s  %9.3f  %9.2f  %9.1f  %12.0f   (omega x%.1f, alpha x%.1f less noise)\n",
+               windows[w], windows[w] == FLYWHEEL_REGRESSION_WINDOW ? "*" : " ",
+               fit.omega_rms, fit.alpha_rms, fit.ns_per_pulse, fit.cycles_per_pulse,
+               fit.omega_rms > 0 ? diff.omega_rms / fit.omega_rms : 0.0,
+               fit.alpha_rms > 0 ? diff.alpha_rms / fit.alpha_rms : 0.0);
+    }
+    if (!HAVE_TSC) {
+        printf("# cycles/pulse not available on this architecture\n");
+    }
+    printf("# * = FLYWHEEL_REGRESSION_WINDOW\n");
+
+    free(set.time_us);
+    free(set.omega);
+    free(set.alpha);
+    return 0;
+}
@@ -0,0 +1,373 @@
+/**
+ * @file bench_hr_stats.c
+ * @brief Cost and correctness of the heart rate statistics query
+ *
+ * Usage: bench_hr_stats [options]
+ *
+ * The metrics JSON asks for the HR statistics on every 200 ms broadcast and
+ * every /api/metrics poll. They used to be computed by scanning the HR
+ * receiver's own sample buffer (up to 7200 entries) under its mutex; the
+ * session series now keeps running sums and zone times of its heart rate
+ * column and publishes them with a sequence counter.
+ *
+ *  1. Records a two hour session at 1 Hz through session_series_append()
+ *     and checks the average, maximum and time in zones against a
+ *     recomputation from session_series_read(). Prints the memory the series
+ *     holds against the two buffers it replaced.
+ *  2. Times one query at several recording lengths: "rescan" is the previous
+ *     implementation (mutex + loop over 16-byte timestamped HR samples),
+ *     "running" is session_series_get_stats().
+ *  3. Runs a writer thread appending rows against reader threads querying
+ *     session_series_get_stats(), and checks every result is from a single
+ *     append (zone seconds match the row count, avg within min..max).
+ *
+ * Exits 1 if any check fails.
+ */
+
+#include "session_series.h"
+#include "esp_log.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define MAX_SAMPLES     SESSION_SERIES_CAPACITY
+#define MAX_HR          190
+#define MAX_THREADS     16
+
+// Concurrent check: bpm cycles through 100..199, all of it zone 1 or above
+#define CYCLE_MIN_BPM   100
+#define CYCLE_BPM       100
+
+/**
+ * Entry of the former HR receiver buffer
+ */
+typedef struct {
+    int64_t timestamp_ms;
+    uint8_t bpm;
+} legacy_hr_sample_t;
+
+static legacy_hr_sample_t s_legacy[MAX_SAMPLES];
+static sample_data_t s_rows[MAX_SAMPLES];
+static pthread_mutex_t s_rescan_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static atomic_bool s_stop;
+
+typedef struct {
+    pthread_t thread;
+    uint64_t queries;
+    uint64_t bad;
+    uint64_t updates;
+} worker_t;
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  --seconds <s>        concurrent check run time (default 1)\n"
+            "  --readers <n>        reader threads (default 3)\n",
+            prog);
+}
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/**
+ * Workout heart rate: warm-up ramp, intervals, cool-down, in 60..200 bpm
+ */
+static uint8_t workout_bpm(int second) {
+    double t = second / 60.0;
+    double bpm;
+    if (t < 10) {
+        bpm = 90 + 6 * t;
+    } else if (t < 110) {
+        bpm = ((int)t / 4) % 2 ? 175 + (second % 7) : 145 + (second % 5);
+    } else {
+        bpm = 160 - 9 * (t - 110);
+    }
+    return (uint8_t)(bpm < 60 ? 60 : bpm);
+}
+
+/**
+ * Previous implementation of hr_receiver_get_stats()
+ */
+static void rescan_stats(const legacy_hr_sample_t *samples, int count, uint8_t *avg_hr, uint8_t *max_hr) {
+    uint32_t sum = 0;
+    uint8_t max = 0;
+
+    pthread_mutex_lock(&s_rescan_mutex);
+    for (int i = 0; i < count; i++) {
+        sum += samples[i].bpm;
+        if (samples[i].bpm > max) {
+            max = samples[i].bpm;
+        }
+    }
+    pthread_mutex_unlock(&s_rescan_mutex);
+
+    *avg_hr = count > 0 ? (uint8_t)(sum / count) : 0;
+    *max_hr = max;
+}
+
+/**
+ * Zone of a heart rate for MAX_HR, -1 below zone 1
+ */
+static int reference_zone(uint8_t bpm) {
+    for (int zone = HR_ZONE_COUNT - 1; zone >= 0; zone--) {
+        int floor_bpm = (MAX_HR * (50 + 10 * zone) + 50) / 100;
+        if (bpm >= floor_bpm) {
+            return zone;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Append a row per second; heart rate 0 while the strap is out
+ */
+static void append_second(int second, uint8_t bpm) {
+    sample_data_t row = {
+        .power_watts = (uint16_t)(150 + second % 90),
+        .velocity_cm_s = (uint16_t)(380 + second % 40),
+        .heart_rate = bpm,
+        .distance_dm = (uint16_t)(38 + second % 5),
+    };
+    session_series_append(&row);
+}
+
+/**
+ * Record a session of the given length into the series and the legacy buffer
+ */
+static void record(int seconds) {
+    session_series_reset();
+    for (int i = 0; i < seconds; i++) {
+        append_second(i, workout_bpm(i));
+        s_legacy[i].timestamp_ms = (int64_t)i * 1000;
+        s_legacy[i].bpm = workout_bpm(i);
+    }
+}
+
+static int check_accuracy(void) {
+    // The strap drops out for 20 s in the middle
+    session_series_reset();
+    for (int i = 0; i < MAX_SAMPLES; i++) {
+        bool dropout = i >= MAX_SAMPLES / 2 && i < MAX_SAMPLES / 2 + 20;
+        append_second(i, dropout ? 0 : workout_bpm(i));
+    }
+
+    uint32_t count = session_series_read(0, s_rows, MAX_SAMPLES);
+    uint32_t ref_sum = 0;
+    uint32_t ref_hr_samples = 0;
+    uint8_t ref_max = 0;
+    uint32_t ref_zone_seconds[HR_ZONE_COUNT] = { 0 };
+    for (uint32_t i = 0; i < count; i++) {
+        uint8_t bpm = s_rows[i].heart_rate;
+        if (bpm == 0) {
+            continue;
+        }
+        ref_hr_samples++;
+        ref_sum += bpm;
+        if (bpm > ref_max) {
+            ref_max = bpm;
+        }
+        int zone = reference_zone(bpm);
+        if (zone >= 0) {
+            ref_zone_seconds[zone]++;
+        }
+    }
+    uint8_t ref_avg = ref_hr_samples > 0 ? (uint8_t)(ref_sum / ref_hr_samples) : 0;
+
+    session_series_stats_t stats;
+    session_series_get_stats(&stats);
+
+    printf("# accuracy: %lu rows, %lu with HR, avg %u, max %u, zones (s)", (unsigned long)stats.samples,
+           (unsigned long)stats.hr_samples, stats.avg_hr, stats.max_hr);
+    for (int zone = 0; zone < HR_ZONE_COUNT; zone++) {
+        printf(" %lu", (unsigned long)stats.zone_seconds[zone]);
+    }
+    printf("\n");
+
+    session_series_memory_t memory;
+    session_series_get_memory(&memory);
+    printf("# memory: %lu bytes (%lu per row) for %lu rows, replacing %lu bytes (saves %lu)\n",
+           (unsigned long)memory.bytes, (unsigned long)memory.row_bytes, (unsigned long)memory.capacity,
+           (unsigned long)memory.replaced_bytes, (unsigned long)(memory.replaced_bytes - memory.bytes));
+
+    int failures = 0;
+    if (count != MAX_SAMPLES || stats.samples != count || stats.hr_samples != ref_hr_samples ||
+        stats.avg_hr != ref_avg || stats.max_hr != ref_max) {
+        printf("FAIL: stats %lu/%lu/%u/%u, recomputed %lu/%lu/%u/%u\n", (unsigned long)stats.samples,
+               (unsigned long)stats.hr_samples, stats.avg_hr, stats.max_hr, (unsigned long)count,
+               (unsigned long)ref_hr_samples, ref_avg, ref_max);
+        failures++;
+    }
+    if (memcmp(stats.zone_seconds, ref_zone_seconds, sizeof(ref_zone_seconds)) != 0) {
+        printf("FAIL: zone times differ from recomputation\n");
+        failures++;
+    }
+    if (s_rows[100].power_watts != 160 || s_rows[100].distance_dm != 38 || s_rows[100].reserved != 0) {
+        printf("FAIL: rows do not read back\n");
+        failures++;
+    }
+
+    session_series_reset();
+    session_series_get_stats(&stats);
+    if (stats.samples != 0 || stats.max_hr != 0 || stats.zone_seconds[2] != 0 || session_series_count() != 0) {
+        printf("FAIL: reset did not clear the series\n");
+        failures++;
+    }
+    return failures;
+}
+
+static void bench_queries(void) {
+    static const int lengths[] = { 0, 900, 3600, MAX_SAMPLES };
+    const int queries = 20000;
+
+    printf("\n# query cost\n");
+    printf("%-8s %14s %14s\n", "samples", "rescan ns", "running ns");
+
+    for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++) {
+        record(lengths[l]);
+        int count = lengths[l];
+
+        uint8_t avg, max;
+        volatile uint32_t sink = 0;
+        double start = now_s();
+        for (int q = 0; q < queries; q++) {
+            rescan_stats(s_legacy, count, &avg, &max);
+            sink += avg + max;
+        }
+        double rescan_ns = (now_s() - start) / queries * 1e9;
+
+        session_series_stats_t stats;
+        start = now_s();
+        for (int q = 0; q < queries; q++) {
+            session_series_get_stats(&stats);
+            sink += stats.avg_hr + stats.max_hr + stats.hr_samples;
+        }
+        double running_ns = (now_s() - start) / queries * 1e9;
+
+        printf("%-8d %14.1f %14.1f\n", lengths[l], rescan_ns, running_ns);
+    }
+}
+
+static void *writer_main(void *arg) {
+    worker_t *worker = arg;
+    uint32_t n = 0;
+
+    while (!atomic_load_explicit(&s_stop, memory_order_relaxed)) {
+        if (n % MAX_SAMPLES == 0) {
+            session_series_reset();
+        }
+        append_second((int)n, (uint8_t)(CYCLE_MIN_BPM + (n * 7) % CYCLE_BPM));
+        n++;
+        worker->updates++;
+    }
+    return NULL;
+}
+
+static void *reader_main(void *arg) {
+    worker_t *worker = arg;
+    session_series_stats_t stats;
+
+    while (!atomic_load_explicit(&s_stop, memory_order_relaxed)) {
+        session_series_get_stats(&stats);
+
+        uint32_t zone_seconds = 0;
+        for (int zone = 0; zone < HR_ZONE_COUNT; zone++) {
+            zone_seconds += stats.zone_seconds[zone];
+        }
+        bool ok = zone_seconds == stats.samples && stats.hr_samples == stats.samples;
+        if (stats.samples > 0) {
+            ok = ok && stats.avg_hr >= CYCLE_MIN_BPM && stats.avg_hr <= stats.max_hr &&
+                 stats.max_hr < CYCLE_MIN_BPM + CYCLE_BPM;
+        } else {
+            ok = ok && stats.avg_hr == 0 && stats.max_hr == 0;
+        }
+        if (!ok) {
+            worker->bad++;
+        }
+        worker->queries++;
+    }
+    return NULL;
+}
+
+static int check_concurrent(double seconds, int readers) {
+    static worker_t workers[MAX_THREADS];
+    int threads = readers + 1;
+    atomic_store(&s_stop, false);
+
+    for (int i = 0; i < threads; i++) {
+        void *(*entry)(void *) = i == 0 ? writer_main : reader_main;
+        if (pthread_create(&workers[i].thread, NULL, entry, &workers[i]) != 0) {
+            fprintf(stderr, "pthread_create failed\n");
+            return 1;
+        }
+    }
+
+    struct timespec pause = {
+        .tv_sec = (time_t)seconds,
+        .tv_nsec = (long)((seconds - (double)(time_t)seconds) * 1e9),
+    };
+    nanosleep(&pause, NULL);
+    atomic_store(&s_stop, true);
+
+    uint64_t updates = 0;
+    uint64_t queries = 0;
+    uint64_t bad = 0;
+    for (int i = 0; i < threads; i++) {
+        pthread_join(workers[i].thread, NULL);
+        updates += workers[i].updates;
+        queries += workers[i].queries;
+        bad += workers[i].bad;
+    }
+
+    printf("\n# concurrent: 1 writer, %d readers, %.1f s\n", readers, seconds);
+    printf("appends    %12llu\n", (unsigned long long)updates);
+    printf("queries    %12llu\n", (unsigned long long)queries);
+    printf("torn       %12llu\n", (unsigned long long)bad);
+
+    if (bad > 0) {
+        printf("FAIL: inconsistent statistics\n");
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    double seconds = 1.0;
+    int readers = 3;
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 < argc && strcmp(argv[i], "--seconds") == 0) {
+            seconds = atof(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "--readers") == 0) {
+            readers = atoi(argv[++i]);
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (seconds <= 0 || readers < 1 || readers + 1 > MAX_THREADS) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    esp_log_level_set("*", ESP_LOG_ERROR);
+
+    if (session_series_init() != ESP_OK) {
+        fprintf(stderr, "session_series_init failed\n");
+        return 2;
+    }
+    session_series_set_max_heart_rate(MAX_HR);
+
+    int failures = check_accuracy();
+    bench_queries();
+    failures += check_concurrent(seconds, readers);
+
+    return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,197 @@
+/**
+ * @file bench_metrics_delta.c
+ * @brief Streaming bytes per client: full frames vs changed-field deltas
+ *
+ * Usage: bench_metrics_delta [options]
+ *
+ * Replays the broadcast of the web server for one streaming client: every
+ * tick (WS_BROADCAST_INTERVAL_MS) the metrics are published, encoded into
+ * the shared frame and sent to the client either in full or as a delta
+ * against the previous broadcast, with a keyframe every
+ * METRICS_KEYFRAME_INTERVAL broadcasts, as web_server_broadcast_metrics()
+ * does. The first segment is an active row (distance, pace, power change
+ * every tick), the second an idle session (nothing changes).
+ *
+ * The client side applies every binary delta to its last keyframe and the
+ * result is compared with the server's frame; the bench exits with 1 on a
+ * mismatch.
+ */
+
+#include "metrics_calculator.h"
+#include "metrics_delta.h"
+#include "metrics_frame.h"
+#include "app_config.h"
+#include "config_manager.h"
+#include "esp_log.h"
+#include "hr_receiver.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Bytes sent to the client over one segment
+ */
+typedef struct {
+    uint32_t json_full;
+    uint32_t json_delta;
+    uint32_t binary_full;
+    uint32_t binary_delta;
+    uint32_t deltas_sent;
+    uint32_t mismatches;
+} segment_bytes_t;
+
+// Previous broadcast (what the client has), as kept by the web server
+static char s_prev_json[JSON_BUFFER_SIZE];
+static size_t s_prev_json_len;
+static uint8_t s_prev_binary[METRICS_BINARY_SIZE];
+static bool s_prev_valid;
+static int s_frames_since_key;
+
+// Client side binary state
+static uint8_t s_client_binary[METRICS_BINARY_SIZE];
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  --active <s>         seconds of rowing (default 120)\n"
+            "  --idle <s>           idle seconds after the row (default 60)\n",
+            prog);
+}
+
+static void publish(rowing_metrics_t *metrics, int tick, bool active) {
+    metrics_calculator_begin_update();
+    metrics->is_active = active;
+    if (active) {
+        metrics->elapsed_time_ms = (uint32_t)tick * WS_BROADCAST_INTERVAL_MS;
+        metrics->total_distance_meters += 0.9f + 0.1f * (float)(tick % 3);
+        metrics->stroke_count = (uint32_t)tick / 12;
+        metrics->instantaneous_pace_sec_500m = 110.0f + (float)(tick % 20) * 0.5f;
+        metrics->display_power_watts = 180.0f + (float)(tick % 12) * 4.0f;
+        metrics->stroke_rate_spm = 24.0f + (float)(tick % 5) * 0.1f;
+        metrics->total_calories = (uint32_t)tick / 40;
+    } else {
+        metrics->instantaneous_pace_sec_500m = 0.0f;
+        metrics->display_power_watts = 0.0f;
+        metrics->stroke_rate_spm = 0.0f;
+    }
+    metrics_calculator_end_update(metrics);
+}
+
+static void broadcast(segment_bytes_t *bytes) {
+    static char json_delta[JSON_BUFFER_SIZE];
+    static uint8_t binary_delta[METRICS_BINARY_DELTA_MAX];
+
+    metrics_frame_t *frame = metrics_frame_acquire();
+    if (frame == NULL) {
+        bytes->mismatches++;
+        return;
+    }
+    const char *json = metrics_frame_json(frame);
+
+    bytes->json_full += frame->json_len;
+    bytes->binary_full += METRICS_BINARY_SIZE;
+
+    bool keyframe = !s_prev_valid || ++s_frames_since_key >= METRICS_KEYFRAME_INTERVAL;
+    int json_len = keyframe ? -1 : metrics_delta_json(s_prev_json, s_prev_json_len, json,
+                                                      frame->json_len, json_delta, sizeof(json_delta));
+    if (json_len < 0) {
+        keyframe = true;
+    }
+
+    if (keyframe) {
+        s_frames_since_key = 0;
+        bytes->json_delta += frame->json_len;
+        bytes->binary_delta += METRICS_BINARY_SIZE;
+        memcpy(s_client_binary, frame->binary, METRICS_BINARY_SIZE);
+    } else {
+        size_t binary_len = metrics_delta_binary(s_prev_binary, frame->binary, binary_delta);
+        bytes->json_delta += (uint32_t)json_len;
+        bytes->binary_delta += (uint32_t)binary_len;
+        if (binary_len > 0) {
+            bytes->deltas_sent++;
+            if (!metrics_delta_apply_binary(s_client_binary, binary_delta, binary_len)) {
+                bytes->mismatches++;
+            }
+        }
+        // The sequence number only travels in keyframes
+        s_client_binary[2] = frame->binary[2];
+        s_client_binary[3] = frame->binary[3];
+        if (memcmp(s_client_binary, frame->binary, METRICS_BINARY_SIZE) != 0) {
+            bytes->mismatches++;
+        }
+    }
+
+    memcpy(s_prev_json, json, frame->json_len);
+    s_prev_json_len = frame->json_len;
+    memcpy(s_prev_binary, frame->binary, METRICS_BINARY_SIZE);
+    s_prev_valid = true;
+    metrics_frame_release(frame);
+}
+
+static void print_segment(const char *name, const segment_bytes_t *bytes, int seconds) {
+    double s = seconds > 0 ? seconds : 1;
+    printf("%8s %10.0f %10.0f %10.0f %10.0f %8lu\n", name,
+           bytes->json_full / s, bytes->json_delta / s,
+           bytes->binary_full / s, bytes->binary_delta / s,
+           (unsigned long)bytes->deltas_sent);
+}
+
+int main(int argc, char **argv) {
+    int active_s = 120;
+    int idle_s = 60;
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 < argc && strcmp(argv[i], "--active") == 0) {
+            active_s = atoi(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "--idle") == 0) {
+            idle_s = atoi(argv[++i]);
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (active_s < 0 || idle_s < 0) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    esp_log_level_set("*", ESP_LOG_ERROR);
+
+    // Modules the JSON encoder queries
+    hr_receiver_init();
+
+    config_t config;
+    config_manager_get_defaults(&config);
+    static rowing_metrics_t metrics;
+    metrics_calculator_init(&metrics, &config);
+    metrics_frame_init();
+
+    const int ticks_per_s = 1000 / WS_BROADCAST_INTERVAL_MS;
+    segment_bytes_t active = {0};
+    segment_bytes_t idle = {0};
+
+    int tick = 0;
+    for (; tick < active_s * ticks_per_s; tick++) {
+        publish(&metrics, tick, true);
+        broadcast(&active);
+    }
+    for (int t = 0; t < idle_s * ticks_per_s; t++, tick++) {
+        publish(&metrics, tick, false);
+        broadcast(&idle);
+    }
+
+    printf("# bytes/s to one client, keyframe every %d broadcasts (%d ms)\n",
+           METRICS_KEYFRAME_INTERVAL, WS_BROADCAST_INTERVAL_MS);
+    printf("# segment  json full json delta   bin full  bin delta   deltas\n");
+    print_segment("active", &active, active_s);
+    print_segment("idle", &idle, idle_s);
+
+    uint32_t mismatches = active.mismatches + idle.mismatches;
+    if (mismatches > 0) {
+        printf("FAIL: %lu binary deltas did not reproduce the frame\n", (unsigned long)mismatches);
+        return 1;
+    }
+    printf("OK: every binary delta reproduced the frame\n");
+    return 0;
+}
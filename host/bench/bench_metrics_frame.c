@@ -0,0 +1,165 @@
+/**
+ * @file bench_metrics_frame.c
+ * @brief Cost of serving metrics to many clients: per-request encode vs shared frame
+ *
+ * Usage: bench_metrics_frame [options]
+ *
+ * Replays the broadcast pattern of the web server on the host: every tick
+ * the metrics are published (as the sensor task does), then delivered to
+ * the streaming clients and answered for a number of HTTP polls.
+ *   - "encode": the previous web server, which encoded the JSON for the
+ *               broadcast, re-formatted it for SSE and encoded again for
+ *               each /api/metrics poll
+ *   - "frame":  metrics_frame, one encode per published state shared by
+ *               every client and poll
+ * Sending is not simulated; the bench measures the CPU spent producing the
+ * bytes and counts the encodes. It also reports the bytes per WebSocket
+ * message for JSON text and for the binary subprotocol.
+ */
+
+#include "metrics_calculator.h"
+#include "metrics_frame.h"
+#include "app_config.h"
+#include "config_manager.h"
+#include "esp_log.h"
+#include "hr_receiver.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Keeps the compiler from dropping the produced bytes
+static volatile uint32_t s_sink;
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  --ticks <n>          broadcast ticks (default 20000)\n"
+            "  --clients <n>        streaming clients per tick (default 4)\n"
+            "  --polls <n>          HTTP polls per tick (default 2)\n",
+            prog);
+}
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void publish(rowing_metrics_t *metrics, int tick) {
+    metrics_calculator_begin_update();
+    metrics->total_distance_meters = tick * 0.8f;
+    metrics->stroke_count = (uint32_t)tick / 12;
+    metrics->instantaneous_pace_sec_500m = 110.0f + (float)(tick % 20);
+    metrics_calculator_end_update(metrics);
+}
+
+static uint32_t run_encode(rowing_metrics_t *metrics, int ticks, int clients, int polls) {
+    uint32_t encodes = 0;
+    for (int t = 0; t < ticks; t++) {
+        publish(metrics, t);
+
+        rowing_metrics_t snapshot;
+        char buffer[JSON_BUFFER_SIZE];
+        char sse_buffer[JSON_BUFFER_SIZE + 16];
+        if (clients > 0) {
+            metrics_calculator_get_snapshot(&snapshot);
+            int len = metrics_calculator_to_json(&snapshot, buffer, sizeof(buffer));
+            int sse_len = snprintf(sse_buffer, sizeof(sse_buffer), "data: %s\n\n", buffer);
+            encodes++;
+            for (int c = 0; c < clients; c++) {
+                s_sink += (uint32_t)(c % 2 == 0 ? len : sse_len);
+            }
+        }
+        for (int p = 0; p < polls; p++) {
+            metrics_calculator_get_snapshot(&snapshot);
+            s_sink += (uint32_t)metrics_calculator_to_json(&snapshot, buffer, sizeof(buffer));
+            encodes++;
+        }
+    }
+    return encodes;
+}
+
+static uint32_t run_frame(rowing_metrics_t *metrics, int ticks, int clients, int polls) {
+    metrics_frame_stats_t before;
+    metrics_frame_get_stats(&before);
+
+    for (int t = 0; t < ticks; t++) {
+        publish(metrics, t);
+
+        if (clients > 0) {
+            metrics_frame_t *frame = metrics_frame_acquire();
+            for (int c = 0; c < clients; c++) {
+                s_sink += c % 2 == 0 ? frame->json_len : frame->sse_len;
+            }
+            metrics_frame_release(frame);
+        }
+        for (int p = 0; p < polls; p++) {
+            metrics_frame_t *frame = metrics_frame_acquire();
+            s_sink += frame->json_len;
+            metrics_frame_release(frame);
+        }
+    }
+
+    metrics_frame_stats_t after;
+    metrics_frame_get_stats(&after);
+    return after.encodes - before.encodes;
+}
+
+int main(int argc, char **argv) {
+    int ticks = 20000;
+    int clients = 4;
+    int polls = 2;
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 < argc && strcmp(argv[i], "--ticks") == 0) {
+            ticks = atoi(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "--clients") == 0) {
+            clients = atoi(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "--polls") == 0) {
+            polls = atoi(argv[++i]);
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (ticks < 1 || clients < 0 || polls < 0) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    esp_log_level_set("*", ESP_LOG_ERROR);
+
+    // Modules the JSON encoder queries
+    hr_receiver_init();
+
+    config_t config;
+    config_manager_get_defaults(&config);
+    static rowing_metrics_t metrics;
+    metrics_calculator_init(&metrics, &config);
+    metrics_frame_init();
+
+    printf("# %d ticks, %d streaming clients, %d polls per tick\n", ticks, clients, polls);
+    printf("# method   encodes  encodes/tick   ns/tick\n");
+
+    double start = now_ns();
+    uint32_t encodes = run_encode(&metrics, ticks, clients, polls);
+    double encode_ns = (now_ns() - start) / ticks;
+    printf("%8s %9lu %13.2f %9.0f\n", "encode", (unsigned long)encodes, (double)encodes / ticks, encode_ns);
+
+    start = now_ns();
+    encodes = run_frame(&metrics, ticks, clients, polls);
+    double frame_ns = (now_ns() - start) / ticks;
+    printf("%8s %9lu %13.2f %9.0f\n", "frame", (unsigned long)encodes, (double)encodes / ticks, frame_ns);
+
+    // WebSocket payload sizes (without the 2-byte frame header)
+    metrics_frame_t *frame = metrics_frame_acquire();
+    if (frame != NULL) {
+        printf("# ws payload: json %u bytes, binary %u bytes (%.1fx smaller)\n",
+               (unsigned)frame->json_len, (unsigned)sizeof(frame->binary),
+               (double)frame->json_len / sizeof(frame->binary));
+        metrics_frame_release(frame);
+    }
+    return 0;
+}
@@ -0,0 +1,161 @@
+/**
+ * @file bench_metrics_snapshot.c
+ * @brief Torture check of the seqlocked metrics snapshot
+ *
+ * Usage: bench_metrics_snapshot [options]
+ *
+ * Writer threads update the live metrics the way the sensor and metrics
+ * tasks do (metrics_calculator_begin_update / publish / end_update), filling
+ * the whole structure with one byte value per update. Reader threads take
+ * snapshots with metrics_calculator_get_snapshot() as fast as they can and
+ * check that every byte of each copy is the same, i.e. that no snapshot
+ * mixes two updates.
+ *
+ * With --unsafe the readers memcpy the live structure instead, which shows
+ * the check does catch torn copies on this machine.
+ *
+ * Exits 1 if any torn snapshot was seen (in the default mode).
+ */
+
+#include "metrics_calculator.h"
+#include "config_manager.h"
+#include "esp_log.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define MAX_THREADS     16
+
+typedef struct {
+    pthread_t thread;
+    uint64_t snapshots;
+    uint64_t torn;
+    uint64_t updates;
+} worker_t;
+
+static rowing_metrics_t s_live;
+static atomic_bool s_stop;
+static bool s_unsafe = false;
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  --seconds <s>        run time (default 2)\n"
+            "  --readers <n>        reader threads (default 3)\n"
+            "  --writers <n>        writer threads (default 2)\n"
+            "  --unsafe             read the live metrics without the snapshot\n",
+            prog);
+}
+
+static void *writer_main(void *arg) {
+    worker_t *worker = arg;
+    uint8_t value = (uint8_t)(uintptr_t)worker;
+
+    while (!atomic_load_explicit(&s_stop, memory_order_relaxed)) {
+        metrics_calculator_begin_update();
+        // Two publishes per section, like a pulse followed by end_update
+        memset(&s_live, value++, sizeof(s_live));
+        metrics_calculator_publish(&s_live);
+        memset(&s_live, value++, sizeof(s_live));
+        metrics_calculator_end_update(&s_live);
+        worker->updates += 2;
+    }
+    return NULL;
+}
+
+static void *reader_main(void *arg) {
+    worker_t *worker = arg;
+    rowing_metrics_t copy;
+
+    while (!atomic_load_explicit(&s_stop, memory_order_relaxed)) {
+        if (s_unsafe) {
+            memcpy(&copy, (const void *)&s_live, sizeof(copy));
+        } else {
+            metrics_calculator_get_snapshot(&copy);
+        }
+
+        const uint8_t *bytes = (const uint8_t *)&copy;
+        for (size_t i = 1; i < sizeof(copy); i++) {
+            if (bytes[i] != bytes[0]) {
+                worker->torn++;
+                break;
+            }
+        }
+        worker->snapshots++;
+    }
+    return NULL;
+}
+
+int main(int argc, char **argv) {
+    double seconds = 2.0;
+    int readers = 3;
+    int writers = 2;
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 < argc && strcmp(argv[i], "--seconds") == 0) {
+            seconds = atof(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "--readers") == 0) {
+            readers = atoi(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "--writers") == 0) {
+            writers = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--unsafe") == 0) {
+            s_unsafe = true;
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (seconds <= 0 || readers < 1 || writers < 1 || readers + writers > MAX_THREADS) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    esp_log_level_set("*", ESP_LOG_ERROR);
+
+    config_t config;
+    config_manager_get_defaults(&config);
+    metrics_calculator_init(&s_live, &config);
+
+    static worker_t workers[MAX_THREADS];
+    int threads = readers + writers;
+    for (int i = 0; i < threads; i++) {
+        void *(*entry)(void *) = i < writers ? writer_main : reader_main;
+        if (pthread_create(&workers[i].thread, NULL, entry, &workers[i]) != 0) {
+            fprintf(stderr, "pthread_create failed\n");
+            return 2;
+        }
+    }
+
+    struct timespec pause = {
+        .tv_sec = (time_t)seconds,
+        .tv_nsec = (long)((seconds - (double)(time_t)seconds) * 1e9),
+    };
+    nanosleep(&pause, NULL);
+    atomic_store(&s_stop, true);
+
+    uint64_t updates = 0;
+    uint64_t snapshots = 0;
+    uint64_t torn = 0;
+    for (int i = 0; i < threads; i++) {
+        pthread_join(workers[i].thread, NULL);
+        updates += workers[i].updates;
+        snapshots += workers[i].snapshots;
+        torn += workers[i].torn;
+    }
+
+    printf("# %s, %d writers, %d readers, %.1f s\n",
+           s_unsafe ? "unsafe memcpy" : "snapshot", writers, readers, seconds);
+    printf("publishes  %12llu\n", (unsigned long long)updates);
+    printf("snapshots  %12llu\n", (unsigned long long)snapshots);
+    printf("torn       %12llu\n", (unsigned long long)torn);
+
+    if (!s_unsafe && torn > 0) {
+        printf("FAIL: torn snapshots\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,164 @@
+/**
+ * @file bench_physics_accuracy.c
+ * @brief Distance/work accuracy of the firmware pipeline on synthetic rows
+ *
+ * Usage: bench_physics_accuracy [options]
+ *
+ * Rows a set of workouts (stroke rate / peak torque) through the flywheel
+ * model (flywheel_sim.c) once per magnet count, feeds the events through the
+ * firmware pipeline (replay_pipeline.c) and compares the resulting work and
+ * distance with the model. The model distance is the flywheel-linked
+ * Concept2 distance ∛(k/2.80) × exact flywheel angle.
+ *
+ * The physics must not depend on how finely the flywheel angle is sampled:
+ * the run fails (exit 1) if, for any workout, the distance for different
+ * magnet counts spreads by more than the tolerance.
+ */
+
+#include "replay_pipeline.h"
+#include "app_config.h"
+#include "config_manager.h"
+#include "esp_log.h"
+#include "flywheel_sim.h"
+#include "rowing_physics.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    double spm;
+    double torque;
+} workout_t;
+
+static const workout_t s_workouts[] = {
+    { 18.0, 6.0 },
+    { 24.0, 8.0 },
+    { 30.0, 7.0 },
+};
+
+// Kept below the 10ms flywheel debounce at the fastest workout
+static const int s_magnets[] = { 1, 2, 3, 4 };
+
+#define NUM_WORKOUTS    (sizeof(s_workouts) / sizeof(s_workouts[0]))
+#define NUM_MAGNETS     (sizeof(s_magnets) / sizeof(s_magnets[0]))
+
+typedef struct {
+    uint32_t strokes;
+    double work_joules;
+    double distance_m;
+    double model_work_joules;
+    double model_distance_m;
+    long debounced;
+} accuracy_result_t;
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  --minutes <m>     rowing time per workout (default 5)\n"
+            "  --jitter <us>     max pulse time jitter (default 20)\n"
+            "  --tolerance <%%>   allowed distance spread across magnet counts (default 2)\n",
+            prog);
+}
+
+static accuracy_result_t row_workout(const workout_t *workout, int magnets, double minutes, int jitter_us) {
+    static replay_pipeline_t pipeline;
+    accuracy_result_t result = {0};
+
+    flywheel_sim_params_t params;
+    flywheel_sim_default_params(&params);
+    params.spm = workout->spm;
+    params.torque = workout->torque;
+    params.magnets = magnets;
+    params.jitter_us = jitter_us;
+
+    config_t config;
+    config_manager_get_defaults(&config);
+    config.moment_of_inertia = (float)params.inertia;
+    config.initial_drag_coefficient = (float)params.drag;
+
+    rowing_physics_set_magnets_per_rev((uint8_t)magnets);
+    replay_pipeline_init(&pipeline, &config, FLYWHEEL_SIM_START_TIME_US);
+
+    flywheel_sim_t sim;
+    flywheel_sim_init(&sim, &params);
+    flywheel_sim_event_t event;
+    int64_t last_us = FLYWHEEL_SIM_START_TIME_US;
+    while (flywheel_sim_next(&sim, minutes * 60.0, &event)) {
+        replay_pipeline_event(&pipeline, event.channel, event.timestamp_us);
+        last_us = event.timestamp_us;
+    }
+    replay_pipeline_finish(&pipeline, last_us);
+
+    result.strokes = pipeline.metrics.stroke_count;
+    result.work_joules = pipeline.metrics.total_work_joules;
+    result.distance_m = pipeline.metrics.total_distance_meters;
+    result.model_work_joules = sim.work_joules;
+    result.model_distance_m = sim.model_distance_m;
+    result.debounced = sim.debounced;
+    return result;
+}
+
+int main(int argc, char **argv) {
+    double minutes = 5.0;
+    int jitter_us = 20;
+    double tolerance_pct = 2.0;
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 < argc && strcmp(argv[i], "--minutes") == 0) {
+            minutes = atof(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "--jitter") == 0) {
+            jitter_us = atoi(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "--tolerance") == 0) {
+            tolerance_pct = atof(argv[++i]);
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (minutes <= 0 || jitter_us < 0 || tolerance_pct <= 0) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    esp_log_level_set("*", ESP_LOG_ERROR);
+
+    int failures = 0;
+    printf("# spm torque magnets strokes   work_J  model_J  work_err%%  distance_m  model_m  dist_err%%\n");
+
+    for (size_t w = 0; w < NUM_WORKOUTS; w++) {
+        double min_distance = INFINITY;
+        double max_distance = 0;
+        double sum_distance = 0;
+
+        for (size_t m = 0; m < NUM_MAGNETS; m++) {
+            accuracy_result_t r = row_workout(&s_workouts[w], s_magnets[m], minutes, jitter_us);
+            if (r.debounced > 0) {
+                fprintf(stderr, "warning: %ld pulses lost to debounce (%.0f spm, %d magnets)\n",
+                        r.debounced, s_workouts[w].spm, s_magnets[m]);
+            }
+            printf("%5.0f %6.1f %7d %7lu %8.0f %8.0f %9.1f %11.1f %8.1f %9.1f\n",
+                   s_workouts[w].spm, s_workouts[w].torque, s_magnets[m], (unsigned long)r.strokes,
+                   r.work_joules, r.model_work_joules,
+                   100.0 * (r.work_joules - r.model_work_joules) / r.model_work_joules,
+                   r.distance_m, r.model_distance_m,
+                   100.0 * (r.distance_m - r.model_distance_m) / r.model_distance_m);
+
+            min_distance = fmin(min_distance, r.distance_m);
+            max_distance = fmax(max_distance, r.distance_m);
+            sum_distance += r.distance_m;
+        }
+
+        double spread_pct = 100.0 * (max_distance - min_distance) / (sum_distance / NUM_MAGNETS);
+        bool ok = spread_pct <= tolerance_pct;
+        printf("# %.0f spm: distance spread across magnet counts %.1f%% (limit %.1f%%) %s\n",
+               s_workouts[w].spm, spread_pct, tolerance_pct, ok ? "ok" : "FAIL");
+        if (!ok) {
+            failures++;
+        }
+    }
+
+    printf("# %s\n", failures == 0 ? "PASS" : "FAIL");
+    return failures == 0 ? 0 : 1;
+}
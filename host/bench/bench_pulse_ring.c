@@ -0,0 +1,282 @@
+/**
+ * @file bench_pulse_ring.c
+ * @brief Stress check of the ISR -> sensor task pulse ring
+ *
+ * Usage: bench_pulse_ring [--seconds <s>]
+ *
+ * A producer thread pushes numbered pulses into a pulse_ring_t of
+ * FLYWHEEL_PULSE_RING_SIZE slots at a fixed rate, on absolute deadlines
+ * like the flywheel ISR (a late producer catches up in a burst). A consumer
+ * thread drains it the way the sensor task does: wake up, pop until empty,
+ * sleep. Its sleeps model scheduling gaps: 1-3 ms normally, 10 ms every
+ * 25th wake-up and CONSUMER_STALL_MS every 100th.
+ *
+ * Rates from MAX_FLYWHEEL_FREQ_HZ up to the ring's limit for that stall
+ * (FLYWHEEL_PULSE_RING_SIZE pulses per stall) must lose nothing: every
+ * pulse is popped, in order, overflow_count stays 0, and high_watermark
+ * covers the fullest ring the consumer saw without exceeding the capacity.
+ * Past the limit pulses may be dropped, but every drop must be counted:
+ * popped pulses stay in order and the pulses missing from the sequence
+ * equal overflow_count. A deterministic check fills the ring with the
+ * consumer stopped and expects exact counters.
+ *
+ * Exits with 1 if any check fails.
+ */
+
+#include "pulse_ring.h"
+#include "app_config.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define CONSUMER_STALL_MS       40      // Longest scheduling gap of the sensor task modelled
+#define OVERFILL_PULSES         10      // Pushes past a full ring in the deterministic check
+
+typedef struct {
+    uint32_t rate_hz;
+    bool lossless;                      // Rate within what the ring absorbs over a stall
+} scenario_t;
+
+static const scenario_t s_scenarios[] = {
+    { MAX_FLYWHEEL_FREQ_HZ, true },
+    { 2 * MAX_FLYWHEEL_FREQ_HZ, true },
+    { 4 * MAX_FLYWHEEL_FREQ_HZ, true },
+    { 16 * MAX_FLYWHEEL_FREQ_HZ, false },
+};
+
+#define NUM_SCENARIOS (sizeof(s_scenarios) / sizeof(s_scenarios[0]))
+
+typedef struct {
+    pulse_ring_t ring;
+    uint32_t rate_hz;
+    uint32_t pulses;                    // Pulses the producer pushes
+    atomic_bool done;                   // Producer finished
+
+    // Producer
+    uint32_t pushed;
+    uint32_t rejected;
+
+    // Consumer
+    uint32_t popped;
+    uint32_t missing;                   // Gaps in the popped sequence
+    uint32_t out_of_order;
+    uint32_t max_seen;                  // Fullest ring seen on a wake-up
+    uint32_t wakeups;
+} run_t;
+
+static int s_failures = 0;
+
+static void check(bool ok, const char *what) {
+    if (!ok) {
+        printf("FAIL: %s\n", what);
+        s_failures++;
+    }
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  --seconds <s>        run time per rate (default 1.5)\n",
+            prog);
+}
+
+static void add_ns(struct timespec *t, long ns) {
+    t->tv_nsec += ns;
+    while (t->tv_nsec >= 1000000000L) {
+        t->tv_nsec -= 1000000000L;
+        t->tv_sec++;
+    }
+}
+
+static void sleep_us(long us) {
+    struct timespec pause = { .tv_sec = us / 1000000, .tv_nsec = (us % 1000000) * 1000L };
+    nanosleep(&pause, NULL);
+}
+
+static void *producer_main(void *arg) {
+    run_t *run = arg;
+    long period_ns = 1000000000L / (long)run->rate_hz;
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+
+    for (uint32_t i = 1; i <= run->pulses; i++) {
+        add_ns(&next, period_ns);
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+        if (pulse_ring_push(&run->ring, (int64_t)i)) {
+            run->pushed++;
+        } else {
+            run->rejected++;
+        }
+    }
+    atomic_store_explicit(&run->done, true, memory_order_release);
+    return NULL;
+}
+
+/**
+ * Pop everything waiting and check the sequence
+ */
+static void drain(run_t *run, int64_t *last) {
+    uint32_t waiting = pulse_ring_count(&run->ring);
+    if (waiting > run->max_seen) {
+        run->max_seen = waiting;
+    }
+    int64_t pulse;
+    while (pulse_ring_pop(&run->ring, &pulse)) {
+        if (pulse <= *last) {
+            run->out_of_order++;
+        } else {
+            run->missing += (uint32_t)(pulse - *last - 1);
+        }
+        *last = pulse;
+        run->popped++;
+    }
+}
+
+static void *consumer_main(void *arg) {
+    run_t *run = arg;
+    int64_t last = 0;
+    uint32_t rng = 1;
+
+    while (!atomic_load_explicit(&run->done, memory_order_acquire)) {
+        run->wakeups++;
+        long gap_us;
+        if (run->wakeups % 100 == 0) {
+            gap_us = CONSUMER_STALL_MS * 1000L;
+        } else if (run->wakeups % 25 == 0) {
+            gap_us = 10000;
+        } else {
+            rng = rng * 1103515245u + 12345u;
+            gap_us = 1000 + (long)((rng >> 16) % 2000);
+        }
+        sleep_us(gap_us);
+        drain(run, &last);
+    }
+    drain(run, &last);
+
+    // Sequence ends at the last pulse pushed: drops at the end count too
+    run->missing += run->pulses - (uint32_t)last;
+    return NULL;
+}
+
+/**
+ * Run one rate and check the result
+ */
+static void run_rate(const scenario_t *scenario, double seconds) {
+    static run_t run;
+    char what[160];
+
+    memset(&run, 0, sizeof(run));
+    pulse_ring_init(&run.ring, FLYWHEEL_PULSE_RING_SIZE);
+    run.rate_hz = scenario->rate_hz;
+    run.pulses = (uint32_t)(seconds * scenario->rate_hz);
+
+    pthread_t producer;
+    pthread_t consumer;
+    if (pthread_create(&consumer, NULL, consumer_main, &run) != 0 ||
+        pthread_create(&producer, NULL, producer_main, &run) != 0) {
+        fprintf(stderr, "pthread_create failed\n");
+        exit(2);
+    }
+    pthread_join(producer, NULL);
+    pthread_join(consumer, NULL);
+
+    printf("  %7lu %8lu %8lu %9lu %9lu %8lu %9lu %8lu\n", (unsigned long)run.rate_hz,
+           (unsigned long)run.pulses, (unsigned long)run.popped, (unsigned long)run.ring.overflow_count,
+           (unsigned long)run.missing, (unsigned long)run.max_seen, (unsigned long)run.ring.high_watermark,
+           (unsigned long)run.wakeups);
+
+    snprintf(what, sizeof(what), "%lu Hz: %lu out of order", (unsigned long)run.rate_hz,
+             (unsigned long)run.out_of_order);
+    check(run.out_of_order == 0, what);
+    snprintf(what, sizeof(what), "%lu Hz: %lu missing, overflow_count %lu, %lu rejected pushes",
+             (unsigned long)run.rate_hz, (unsigned long)run.missing, (unsigned long)run.ring.overflow_count,
+             (unsigned long)run.rejected);
+    check(run.missing == run.ring.overflow_count && run.rejected == run.ring.overflow_count &&
+          run.popped + run.missing == run.pulses, what);
+    snprintf(what, sizeof(what), "%lu Hz: high_watermark %lu for at most %lu seen waiting, capacity %d",
+             (unsigned long)run.rate_hz, (unsigned long)run.ring.high_watermark, (unsigned long)run.max_seen,
+             FLYWHEEL_PULSE_RING_SIZE);
+    check(run.ring.high_watermark >= run.max_seen && run.ring.high_watermark >= 1 &&
+          run.ring.high_watermark <= FLYWHEEL_PULSE_RING_SIZE, what);
+    if (scenario->lossless) {
+        snprintf(what, sizeof(what), "%lu Hz: %lu of %lu pulses lost", (unsigned long)run.rate_hz,
+                 (unsigned long)run.missing, (unsigned long)run.pulses);
+        check(run.popped == run.pulses && run.ring.overflow_count == 0, what);
+    }
+}
+
+/**
+ * Fill the ring with the consumer stopped, then drain it
+ */
+static void check_full_ring(void) {
+    static pulse_ring_t ring;
+    char what[128];
+
+    pulse_ring_init(&ring, FLYWHEEL_PULSE_RING_SIZE);
+    uint32_t accepted = 0;
+    for (int64_t i = 1; i <= FLYWHEEL_PULSE_RING_SIZE + OVERFILL_PULSES; i++) {
+        accepted += pulse_ring_push(&ring, i);
+    }
+    snprintf(what, sizeof(what), "full ring: %lu accepted, overflow_count %lu, high_watermark %lu",
+             (unsigned long)accepted, (unsigned long)ring.overflow_count, (unsigned long)ring.high_watermark);
+    check(accepted == FLYWHEEL_PULSE_RING_SIZE && ring.overflow_count == OVERFILL_PULSES &&
+          ring.high_watermark == FLYWHEEL_PULSE_RING_SIZE &&
+          pulse_ring_count(&ring) == FLYWHEEL_PULSE_RING_SIZE, what);
+
+    // The oldest pulses are kept, the ones pushed into a full ring dropped
+    int64_t pulse;
+    int64_t expect = 1;
+    bool ordered = true;
+    while (pulse_ring_pop(&ring, &pulse)) {
+        ordered = ordered && pulse == expect++;
+    }
+    snprintf(what, sizeof(what), "full ring: pops 1..%d in order", FLYWHEEL_PULSE_RING_SIZE);
+    check(ordered && expect == FLYWHEEL_PULSE_RING_SIZE + 1, what);
+
+    // Room again after the drain; the counters keep their values
+    check(pulse_ring_push(&ring, 100) && pulse_ring_pop(&ring, &pulse) && pulse == 100 &&
+          ring.overflow_count == OVERFILL_PULSES && ring.high_watermark == FLYWHEEL_PULSE_RING_SIZE,
+          "full ring: accepts pushes after the drain");
+}
+
+int main(int argc, char **argv) {
+    double seconds = 1.5;
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 < argc && strcmp(argv[i], "--seconds") == 0) {
+            seconds = atof(argv[++i]);
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (seconds <= 0) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    check_full_ring();
+
+    printf("# %d slots, consumer gaps 1-3 ms, 10 ms every 25th, %d ms every 100th wake-up; %.1f s per rate\n",
+           FLYWHEEL_PULSE_RING_SIZE, CONSUMER_STALL_MS, seconds);
+    printf("# lossless up to %d Hz (%d slots per %d ms stall), MAX_FLYWHEEL_FREQ_HZ %d\n",
+           FLYWHEEL_PULSE_RING_SIZE * 1000 / CONSUMER_STALL_MS, FLYWHEEL_PULSE_RING_SIZE, CONSUMER_STALL_MS,
+           MAX_FLYWHEEL_FREQ_HZ);
+    printf("  %7s %8s %8s %9s %9s %8s %9s %8s\n", "rate_hz", "pushed", "popped", "overflow", "missing",
+           "max_seen", "high_wm", "wakeups");
+    for (size_t s = 0; s < NUM_SCENARIOS; s++) {
+        run_rate(&s_scenarios[s], seconds);
+    }
+
+    if (s_failures > 0) {
+        printf("FAIL: %d check(s) failed\n", s_failures);
+        return 1;
+    }
+    printf("OK: no pulse lost up to %d Hz, every drop counted beyond\n",
+           4 * MAX_FLYWHEEL_FREQ_HZ);
+    return 0;
+}
@@ -0,0 +1,355 @@
+/**
+ * @file bench_recording_profiles.c
+ * @brief Recording profiles: record sizes, flash per minute and the cost model
+ *
+ * Usage: bench_recording_profiles
+ *
+ * Rows three simulated workouts (flywheel_sim.c) through the firmware
+ * pipeline (replay_pipeline.c) once per recording profile (1 Hz, 10 Hz,
+ * per pulse) and reports, per session, the records stored, their
+ * compressed size in bits per record and the flash taken per minute rowed
+ * (pages of every stream, stroke records included, plus the store's
+ * per-append overhead), next to what
+ * session_manager_estimate_recording() predicted before the session (with
+ * the app_config.h defaults until the first pages were measured). Checks:
+ *   - the per-second samples do not depend on the profile
+ *   - 10 Hz records cover the session in 100 ms steps, their distance adds
+ *     up to the session distance and their energy to within 1% of the
+ *     per-second samples
+ *   - one per-pulse record per pulse rowed, the intervals adding up to the
+ *     last pulse's time since the session start, none dropped
+ *   - samples.bin and pages.bin of each profile read back the stored
+ *     records, and the other detail profile is not found
+ *   - once measured, the estimate is within -5% to +15% of the flash used
+ * Exits with 1 if any check fails.
+ */
+
+#include "replay_pipeline.h"
+#include "sample_codec.h"
+#include "session_detail.h"
+#include "session_manager.h"
+#include "session_samples.h"
+#include "session_store.h"
+#include "config_manager.h"
+#include "app_config.h"
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "flywheel_sim.h"
+#include "session_download.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_ENERGY_DIFF     0.01    // 10 Hz against per-second energy
+
+typedef struct {
+    const char *name;
+    double spm;
+    double torque;
+    double minutes;
+} workout_t;
+
+static const workout_t s_workouts[] = {
+    { "steady 24 spm", 24.0, 8.0, 20.0 },
+    { "hard 30 spm", 30.0, 12.0, 10.0 },
+    { "easy 18 spm", 18.0, 5.0, 10.0 },
+};
+
+#define NUM_WORKOUTS (sizeof(s_workouts) / sizeof(s_workouts[0]))
+
+/**
+ * State of the session being rowed
+ */
+typedef struct {
+    int64_t start_us;               // Session start (0 until it started)
+    uint32_t pulses;                // Flywheel pulses since the start
+    int64_t last_pulse_us;
+} rowing_t;
+
+/**
+ * Flash used by the sessions of one profile
+ */
+typedef struct {
+    double minutes;
+    uint64_t records;
+    uint64_t bytes;                 // Pages plus append overhead, both streams
+} profile_total_t;
+
+static int s_failures = 0;
+static sample_data_t *s_reference[NUM_WORKOUTS];   // Per-second samples of the 1 Hz sessions
+static uint32_t s_reference_count[NUM_WORKOUTS];
+static profile_total_t s_totals[RECORDING_PROFILE_COUNT];
+
+static void check(bool ok, const char *what) {
+    if (!ok) {
+        printf("FAIL: %s\n", what);
+        s_failures++;
+    }
+}
+
+static void on_second(void *ctx, uint32_t second, const rowing_metrics_t *metrics) {
+    (void)second;
+    rowing_t *rowing = ctx;
+    if (rowing->start_us == 0) {
+        rowing->start_us = metrics->session_start_time_us;
+    }
+}
+
+/**
+ * Check the detail records of a stored session
+ */
+static void check_detail(const char *name, recording_profile_t profile, const session_record_t *record,
+                         const rowing_t *rowing, const sample_data_t *samples,
+                         const uint8_t *records, uint32_t count) {
+    char what[128];
+    if (profile == RECORDING_PROFILE_10HZ) {
+        const sample_10hz_t *r = (const sample_10hz_t *)records;
+        uint64_t distance_cm = 0;
+        for (uint32_t i = 0; i < count; i++) {
+            distance_cm += r[i].distance_cm;
+        }
+        // The last record is the partial 100 ms of the last second
+        uint32_t seconds = record->sample_count;
+        snprintf(what, sizeof(what), "%s 10hz: %lu records for %lu samples", name,
+                 (unsigned long)count, (unsigned long)seconds);
+        check(seconds > 0 && count > (seconds - 1) * 10 && count <= seconds * 10, what);
+        snprintf(what, sizeof(what), "%s 10hz: distance %.2f m of %.2f m", name,
+                 distance_cm / 100.0, record->total_distance_meters);
+        check(fabs(distance_cm / 100.0 - record->total_distance_meters) <= 0.01, what);
+
+        // Energy against the per-second samples: the same within rounding
+        // where the work total only grows; where it dips (drag estimate
+        // moving) each sampler holds its rows at 0 until it is back above
+        // what it handed out, at its own boundaries
+        uint64_t work_dj = 0;
+        uint64_t work_j = 0;
+        for (uint32_t i = 0; i < count; i++) {
+            work_dj += r[i].power_watts;
+        }
+        for (uint32_t s = 0; s + 1 < seconds; s++) {
+            work_j += samples[s].power_watts;
+        }
+        // Last rows: power over the part of the bucket rowed
+        work_dj -= r[count - 1].power_watts;
+        snprintf(what, sizeof(what), "%s 10hz: energy %.0f J, per-second samples %.0f J", name,
+                 work_dj / 10.0, (double)work_j);
+        check(fabs(work_dj / 10.0 - work_j) <= MAX_ENERGY_DIFF * work_j + 10.0, what);
+    } else {
+        const sample_pulse_t *r = (const sample_pulse_t *)records;
+        int64_t time_us = 0;
+        for (uint32_t i = 0; i < count; i++) {
+            time_us += r[i].interval_us | ((int64_t)r[i].interval_us_high << 16);
+        }
+        session_detail_stats_t stats;
+        session_detail_get_stats(&stats);
+        snprintf(what, sizeof(what), "%s pulse: %lu records for %lu pulses, %lu dropped", name,
+                 (unsigned long)count, (unsigned long)rowing->pulses, (unsigned long)stats.dropped);
+        check(count == rowing->pulses && stats.dropped == 0, what);
+        snprintf(what, sizeof(what), "%s pulse: intervals add up to the last pulse", name);
+        check(time_us == rowing->last_pulse_us - rowing->start_us, what);
+    }
+}
+
+/**
+ * Row one workout with a profile and check what was stored
+ */
+static void row_workout(size_t w, recording_profile_t profile) {
+    static replay_pipeline_t pipeline;
+    const workout_t *workout = &s_workouts[w];
+    const char *profile_name = session_detail_profile_name(profile);
+    profile_total_t *total = &s_totals[profile];
+    char what[128];
+
+    session_manager_set_recording_profile(profile);
+    // Before the first session the store is not mounted yet
+    recording_estimate_t estimate;
+    char estimated[24] = "-";
+    if (session_manager_estimate_recording(profile, (uint32_t)workout->minutes, &estimate) == ESP_OK) {
+        snprintf(estimated, sizeof(estimated), "%lu%s", (unsigned long)estimate.bytes_per_minute,
+                 estimate.measured ? "" : "*");
+    }
+
+    flywheel_sim_params_t params;
+    flywheel_sim_default_params(&params);
+    params.spm = workout->spm;
+    params.torque = workout->torque;
+    params.seed = (uint32_t)w + 1;
+
+    config_t config;
+    config_manager_get_defaults(&config);
+    config.moment_of_inertia = (float)params.inertia;
+    config.initial_drag_coefficient = (float)params.drag;
+
+    rowing_t rowing;
+    memset(&rowing, 0, sizeof(rowing));
+    pipeline.on_second = on_second;
+    pipeline.ctx = &rowing;
+    replay_pipeline_init(&pipeline, &config, FLYWHEEL_SIM_START_TIME_US);
+
+    flywheel_sim_t sim;
+    flywheel_sim_init(&sim, &params);
+    flywheel_sim_event_t event;
+    int64_t last_us = FLYWHEEL_SIM_START_TIME_US;
+    while (flywheel_sim_next(&sim, workout->minutes * 60.0, &event)) {
+        replay_pipeline_event(&pipeline, event.channel, event.timestamp_us);
+        last_us = event.timestamp_us;
+        // Metrics ticks run before the event: a session started by one is
+        // already running when the pulse is recorded
+        rowing.start_us = pipeline.metrics.session_start_time_us != 0 ? pipeline.metrics.session_start_time_us :
+                          rowing.start_us;
+        if (event.channel == TRACE_CHANNEL_FLYWHEEL && rowing.start_us != 0) {
+            rowing.pulses++;
+            rowing.last_pulse_us = event.timestamp_us;
+        }
+    }
+    replay_pipeline_finish(&pipeline, last_us);
+
+    session_record_t record;
+    uint32_t id = session_manager_get_session_count();
+    snprintf(what, sizeof(what), "%s %s: session stored with its profile", workout->name, profile_name);
+    check(session_manager_get_session(id, &record) == ESP_OK && record.recording_profile == profile, what);
+
+    // Per-second samples, the same whatever the profile
+    sample_data_t *samples = malloc(record.sample_count * sizeof(sample_data_t) + 1);
+    uint32_t sample_count = 0;
+    session_manager_read_samples(id, 0, samples, record.sample_count, &sample_count);
+    if (s_reference[w] == NULL) {
+        s_reference[w] = samples;
+        s_reference_count[w] = sample_count;
+    } else {
+        snprintf(what, sizeof(what), "%s %s: per-second samples as with 1hz", workout->name, profile_name);
+        check(sample_count == s_reference_count[w] &&
+              memcmp(samples, s_reference[w], sample_count * sizeof(sample_data_t)) == 0, what);
+        free(samples);
+    }
+    uint32_t sample_page_bytes = 0;
+    session_manager_get_sample_pages_size(id, &sample_page_bytes);
+    uint8_t *sample_pages = malloc(sample_page_bytes + 1);
+    uint32_t n = 0;
+    session_manager_read_sample_pages(id, 0, sample_pages, sample_page_bytes, &n);
+    static sample_data_t decoded_samples[MAX_SAMPLES_PER_SESSION];
+    uint32_t sample_page_count = 0;
+    uint32_t decoded = session_download_decode_pages(&sample_codec_layout_samples, sample_pages, n, decoded_samples,
+                                                     MAX_SAMPLES_PER_SESSION, &sample_page_count);
+    snprintf(what, sizeof(what), "%s %s: sample pages decode", workout->name, profile_name);
+    check(n == sample_page_bytes && decoded == sample_count, what);
+    free(sample_pages);
+
+    uint64_t bytes = sample_page_bytes + (uint64_t)sample_page_count * SESSION_STORE_APPEND_OVERHEAD;
+    uint32_t detail_records = 0;
+    uint32_t detail_page_bytes = 0;
+    const sample_codec_layout_t *layout = session_detail_layout(profile);
+    if (layout != NULL) {
+        snprintf(what, sizeof(what), "%s %s: detail records stored", workout->name, profile_name);
+        check(session_manager_get_detail_size(id, profile, &detail_records, &detail_page_bytes) == ESP_OK &&
+              detail_records > 0, what);
+
+        // Decoded download, pages download and the other profile
+        session_samples_doc_t doc;
+        session_samples_header_t header;
+        uint8_t *records = session_samples_open(id, false, profile, &doc) == ESP_OK ?
+                           session_download_read(&doc, &header) : NULL;
+        snprintf(what, sizeof(what), "%s %s: samples.bin header", workout->name, profile_name);
+        check(records != NULL && header.sample_count == detail_records && header.sample_size == layout->record_size &&
+              header.sample_interval_ms == (profile == RECORDING_PROFILE_10HZ ? SESSION_DETAIL_10HZ_MS : 0) &&
+              header.data_bytes == detail_records * layout->record_size, what);
+        uint8_t *pages = session_samples_open(id, true, profile, &doc) == ESP_OK ?
+                         session_download_read(&doc, &header) : NULL;
+        uint8_t *from_pages = malloc((size_t)detail_records * layout->record_size + 1);
+        uint32_t page_count = 0;
+        decoded = pages != NULL ? session_download_decode_pages(layout, pages, header.data_bytes, from_pages,
+                                                                detail_records, &page_count) : 0;
+        snprintf(what, sizeof(what), "%s %s: pages.bin decodes to samples.bin", workout->name, profile_name);
+        check(records != NULL && pages != NULL && header.data_bytes == detail_page_bytes &&
+              decoded == detail_records &&
+              memcmp(records, from_pages, (size_t)detail_records * layout->record_size) == 0, what);
+        recording_profile_t other = profile == RECORDING_PROFILE_10HZ ? RECORDING_PROFILE_PULSE : RECORDING_PROFILE_10HZ;
+        snprintf(what, sizeof(what), "%s %s: no %s records", workout->name, profile_name,
+                 session_detail_profile_name(other));
+        check(session_samples_open(id, false, other, &doc) == ESP_ERR_NOT_FOUND, what);
+
+        if (records != NULL) {
+            check_detail(workout->name, profile, &record, &rowing, s_reference[w], records, detail_records);
+        }
+        bytes += detail_page_bytes + (uint64_t)page_count * SESSION_STORE_APPEND_OVERHEAD;
+        free(records);
+        free(pages);
+        free(from_pages);
+    }
+
+    // Stroke records, stored whatever the profile
+    uint32_t stroke_records = 0;
+    uint32_t stroke_page_bytes = 0;
+    snprintf(what, sizeof(what), "%s %s: stroke records stored", workout->name, profile_name);
+    check(session_manager_get_stroke_size(id, &stroke_records, &stroke_page_bytes) == ESP_OK &&
+          stroke_records > 0, what);
+    bytes += stroke_page_bytes + (uint64_t)((stroke_records + SESSION_STROKE_PAGE_RECORDS - 1) /
+                                            SESSION_STROKE_PAGE_RECORDS) * SESSION_STORE_APPEND_OVERHEAD;
+
+    double minutes = record.duration_seconds / 60.0;
+    total->minutes += minutes;
+    total->records += layout != NULL ? detail_records : sample_count;
+    total->bytes += bytes;
+
+    uint32_t bits = layout != NULL ? detail_page_bytes : sample_page_bytes;
+    uint32_t count = layout != NULL ? detail_records : sample_count;
+    printf("  %-7s %-14s %6.1f %8lu %8.0f %8.1f %9.0f %9s\n", profile_name, workout->name, minutes,
+           (unsigned long)count, count / minutes, count > 0 ? 8.0 * bits / count : 0.0, bytes / minutes, estimated);
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s\n", prog);
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    esp_log_level_set("*", ESP_LOG_ERROR);
+    host_partition_reset(SESSION_STORE_PARTITION_LABEL);
+
+    printf("# flash per minute rowed: pages + %d B per append, every stream\n", SESSION_STORE_APPEND_OVERHEAD);
+    printf("  %-7s %-14s %6s %8s %8s %8s %9s %9s\n", "profile", "workout", "min", "records", "rec/min",
+           "bits/rec", "B/min", "est_B/min");
+    for (int p = 0; p < RECORDING_PROFILE_COUNT; p++) {
+        for (size_t w = 0; w < NUM_WORKOUTS; w++) {
+            row_workout(w, (recording_profile_t)p);
+        }
+    }
+
+    // Measured estimates against the flash the sessions took
+    printf("  (* app_config.h defaults, not measured yet)\n");
+    printf("\n# cost model after these sessions (%d-minute session)\n", RECORDING_PLANNED_MINUTES);
+    printf("  %-7s %9s %9s %9s %10s %9s\n", "profile", "B/min", "est_B/min", "rec/min", "free_min", "max_min");
+    for (int p = 0; p < RECORDING_PROFILE_COUNT; p++) {
+        profile_total_t *total = &s_totals[p];
+        recording_estimate_t estimate;
+        char what[96];
+        snprintf(what, sizeof(what), "%s: estimate available", session_detail_profile_name((recording_profile_t)p));
+        check(session_manager_estimate_recording((recording_profile_t)p, RECORDING_PLANNED_MINUTES, &estimate) == ESP_OK,
+              what);
+        double actual = total->bytes / total->minutes;
+        printf("  %-7s %9.0f %9lu %9lu %10lu %9lu\n", session_detail_profile_name((recording_profile_t)p), actual,
+               (unsigned long)estimate.bytes_per_minute, (unsigned long)estimate.records_per_minute,
+               (unsigned long)estimate.free_minutes, (unsigned long)estimate.max_minutes);
+        snprintf(what, sizeof(what), "%s: measured estimate %lu B/min for %.0f B/min used",
+                 session_detail_profile_name((recording_profile_t)p), (unsigned long)estimate.bytes_per_minute,
+                 actual);
+        check(estimate.measured && estimate.bytes_per_minute >= actual * 0.95 &&
+              estimate.bytes_per_minute <= actual * 1.15, what);
+    }
+
+    for (size_t w = 0; w < NUM_WORKOUTS; w++) {
+        free(s_reference[w]);
+    }
+    if (s_failures > 0) {
+        printf("FAIL: %d check(s) failed\n", s_failures);
+        return 1;
+    }
+    printf("OK: every profile stores and reads back its records, estimates match\n");
+    return 0;
+}
@@ -0,0 +1,527 @@
+/**
+ * @file bench_sample_codec.c
+ * @brief Compressed sample pages: ratio and decode speed on rowed sessions
+ *
+ * Usage: bench_sample_codec [options] [trace.rwt ...]
+ *
+ * Rows sessions through the firmware pipeline (replay_pipeline.c) the way
+ * the device records them: the pulse traces given on the command line, or
+ * else three simulated workouts (flywheel_sim.c) at different rates and
+ * loads. Heart rate comes from a simple strap model that follows power.
+ * For each session it reports the size of the compressed pages the storage
+ * task wrote against the 8-byte samples, then measures encode and decode
+ * speed over all pages and the cost of reading a stored session back
+ * through session_manager. Checks:
+ *   - every stored session decodes to the samples recorded in RAM
+ *   - random pages of every length round-trip within SAMPLE_CODEC_MAX_BYTES
+ *   - truncated or corrupted pages are rejected
+ * Exits with 1 if any check fails.
+ */
+
+#include "replay_pipeline.h"
+#include "sample_codec.h"
+#include "session_manager.h"
+#include "session_series.h"
+#include "session_store.h"
+#include "config_manager.h"
+#include "hr_receiver.h"
+#include "app_config.h"
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "flywheel_sim.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define MAX_SESSIONS        16
+#define READ_SLICE_SAMPLES  128     // 1 KB, like the web server's chunks
+
+typedef struct {
+    const char *name;
+    double spm;
+    double torque;
+    double minutes;
+    int jitter_us;
+} workout_t;
+
+static const workout_t s_workouts[] = {
+    { "steady 24 spm", 24.0, 8.0, 30.0, 20 },
+    { "hard 30 spm", 30.0, 12.0, 10.0, 20 },
+    { "easy 18 spm", 18.0, 5.0, 20.0, 50 },
+};
+
+#define NUM_WORKOUTS (sizeof(s_workouts) / sizeof(s_workouts[0]))
+
+/**
+ * One rowed session
+ */
+typedef struct {
+    char name[48];
+    uint32_t session_id;
+    uint32_t samples;
+    uint32_t page_bytes;
+    uint32_t flash_bytes;       // Programmed while recording (pages, checkpoints, record)
+    uint8_t *pages;             // Stored pages
+    sample_data_t *expected;    // As recorded in RAM
+} session_result_t;
+
+/**
+ * Per-second recording state
+ */
+typedef struct {
+    session_result_t *session;
+    bool heart_rate;
+    double bpm;
+    uint32_t rng;
+} recorder_t;
+
+static int s_failures = 0;
+static session_result_t s_sessions[MAX_SESSIONS];
+static uint32_t s_session_count = 0;
+
+static void check(bool ok, const char *what) {
+    if (!ok) {
+        printf("FAIL: %s\n", what);
+        s_failures++;
+    }
+}
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static uint32_t next_random(uint32_t *state) {
+    *state = *state * 1103515245u + 12345u;
+    return *state >> 8;
+}
+
+/**
+ * Copy the samples recorded this second from RAM, and move the strap's
+ * heart rate toward a level set by power (about a minute to settle)
+ */
+static void on_second(void *ctx, uint32_t second, const rowing_metrics_t *metrics) {
+    (void)second;
+    recorder_t *rec = ctx;
+    uint32_t id = session_manager_get_current_session_id();
+    if (id != 0) {
+        session_result_t *session = rec->session;
+        session->session_id = id;
+        uint32_t count = session_manager_get_current_sample_count();
+        if (count > session->samples) {
+            uint32_t n = 0;
+            session_manager_read_samples(id, session->samples, &session->expected[session->samples],
+                                         count - session->samples, &n);
+            session->samples += n;
+        }
+    }
+
+    if (rec->heart_rate) {
+        double target = 70.0 + metrics->display_power_watts * 0.45;
+        rec->bpm += (target - rec->bpm) / 40.0;
+        int noise = (int)(next_random(&rec->rng) % 3) - 1;
+        hr_receiver_update((uint8_t)(rec->bpm + 0.5 + noise));
+    }
+}
+
+/**
+ * Read a whole file into memory
+ */
+static uint8_t *read_file(const char *path, size_t *size) {
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    long len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t *data = len > 0 ? malloc((size_t)len) : NULL;
+    if (data != NULL && fread(data, 1, (size_t)len, f) != (size_t)len) {
+        free(data);
+        data = NULL;
+    }
+    fclose(f);
+    *size = data != NULL ? (size_t)len : 0;
+    return data;
+}
+
+/**
+ * Start recording a session into the next result slot
+ */
+static session_result_t *begin_session(const char *name, recorder_t *rec, bool heart_rate) {
+    session_result_t *session = &s_sessions[s_session_count];
+    memset(session, 0, sizeof(*session));
+    snprintf(session->name, sizeof(session->name), "%s", name);
+    session->expected = malloc(MAX_SAMPLES_PER_SESSION * sizeof(sample_data_t));
+
+    memset(rec, 0, sizeof(*rec));
+    rec->session = session;
+    rec->heart_rate = heart_rate;
+    rec->bpm = 90.0;
+    rec->rng = s_session_count + 1;
+    hr_receiver_update(0);
+
+    session_store_stats_t stats;
+    session_store_get_stats(&stats);
+    session->flash_bytes = stats.bytes_programmed;
+    return session;
+}
+
+/**
+ * Collect the stored pages of a finished session
+ */
+static void end_session(session_result_t *session) {
+    // The row closing the last partial second, still in the series
+    session->samples += session_series_read(session->samples, &session->expected[session->samples],
+                                            MAX_SAMPLES_PER_SESSION - session->samples);
+
+    session_store_stats_t stats;
+    session_store_get_stats(&stats);
+    session->flash_bytes = stats.bytes_programmed - session->flash_bytes;
+
+    char what[96];
+    snprintf(what, sizeof(what), "%.40s: stored as compressed pages", session->name);
+    check(session->session_id != 0 &&
+          session_manager_get_sample_pages_size(session->session_id, &session->page_bytes) == ESP_OK, what);
+    session->pages = malloc(session->page_bytes > 0 ? session->page_bytes : 1);
+    uint32_t n = 0;
+    session_manager_read_sample_pages(session->session_id, 0, session->pages, session->page_bytes, &n);
+    snprintf(what, sizeof(what), "%.40s: pages readable", session->name);
+    check(n == session->page_bytes, what);
+    s_session_count++;
+}
+
+static bool row_workout(const workout_t *workout, bool heart_rate) {
+    static replay_pipeline_t pipeline;
+    recorder_t rec;
+    begin_session(workout->name, &rec, heart_rate);
+
+    flywheel_sim_params_t params;
+    flywheel_sim_default_params(&params);
+    params.spm = workout->spm;
+    params.torque = workout->torque;
+    params.jitter_us = workout->jitter_us;
+    params.seed = s_session_count + 1;
+
+    config_t config;
+    config_manager_get_defaults(&config);
+    config.moment_of_inertia = (float)params.inertia;
+    config.initial_drag_coefficient = (float)params.drag;
+
+    pipeline.on_second = on_second;
+    pipeline.ctx = &rec;
+    replay_pipeline_init(&pipeline, &config, FLYWHEEL_SIM_START_TIME_US);
+
+    flywheel_sim_t sim;
+    flywheel_sim_init(&sim, &params);
+    flywheel_sim_event_t event;
+    int64_t last_us = FLYWHEEL_SIM_START_TIME_US;
+    while (flywheel_sim_next(&sim, workout->minutes * 60.0, &event)) {
+        replay_pipeline_event(&pipeline, event.channel, event.timestamp_us);
+        last_us = event.timestamp_us;
+    }
+    replay_pipeline_finish(&pipeline, last_us);
+
+    end_session(rec.session);
+    return true;
+}
+
+static bool row_trace(const char *path, bool heart_rate) {
+    static replay_pipeline_t pipeline;
+    size_t file_size;
+    uint8_t *file = read_file(path, &file_size);
+    trace_header_t header;
+    if (file == NULL || file_size < sizeof(header)) {
+        fprintf(stderr, "Cannot read %s\n", path);
+        free(file);
+        return false;
+    }
+    memcpy(&header, file, sizeof(header));
+    if (memcmp(header.magic, TRACE_MAGIC, 4) != 0 || header.version != TRACE_FORMAT_VERSION ||
+        header.header_size < sizeof(header) || header.header_size > file_size) {
+        fprintf(stderr, "%s: not a version %d trace\n", path, TRACE_FORMAT_VERSION);
+        free(file);
+        return false;
+    }
+    size_t data_bytes = file_size - header.header_size;
+    if (header.data_bytes != TRACE_UNFINISHED && header.data_bytes < data_bytes) {
+        data_bytes = header.data_bytes;
+    }
+
+    const char *name = strrchr(path, '/');
+    recorder_t rec;
+    begin_session(name != NULL ? name + 1 : path, &rec, heart_rate);
+
+    if (header.magnets_per_rev > 0) {
+        rowing_physics_set_magnets_per_rev(header.magnets_per_rev);
+    }
+    config_t config;
+    config_manager_get_defaults(&config);
+    config.moment_of_inertia = header.moment_of_inertia;
+    config.initial_drag_coefficient = header.drag_coefficient;
+
+    pipeline.on_second = on_second;
+    pipeline.ctx = &rec;
+    replay_pipeline_init(&pipeline, &config, header.start_time_us);
+
+    const uint8_t *data = file + header.header_size;
+    int64_t timestamp = header.start_time_us;
+    size_t pos = 0;
+    while (pos < data_bytes) {
+        int64_t delta;
+        trace_channel_t channel;
+        size_t used = trace_decode_event(&data[pos], data_bytes - pos, &delta, &channel);
+        if (used == 0) {
+            break;
+        }
+        pos += used;
+        timestamp += delta;
+        replay_pipeline_event(&pipeline, channel, timestamp);
+    }
+    replay_pipeline_finish(&pipeline, timestamp);
+    free(file);
+
+    end_session(rec.session);
+    return true;
+}
+
+/**
+ * Stored sessions decode to what was recorded, through the read path the
+ * web server uses (1 KB slices)
+ * @return Seconds spent reading
+ */
+static double verify_sessions(void) {
+    static sample_data_t slice[READ_SLICE_SAMPLES];
+    double elapsed = 0;
+    for (uint32_t i = 0; i < s_session_count; i++) {
+        const session_result_t *session = &s_sessions[i];
+        session_record_t record;
+        bool ok = session_manager_get_session(session->session_id, &record) == ESP_OK &&
+                  record.sample_count == session->samples;
+        uint32_t first = 0;
+        uint32_t n = 0;
+        double t0 = now_s();
+        while (ok && session_manager_read_samples(session->session_id, first, slice, READ_SLICE_SAMPLES, &n) == ESP_OK &&
+               n > 0) {
+            ok = first + n <= session->samples &&
+                 memcmp(slice, &session->expected[first], n * sizeof(sample_data_t)) == 0;
+            first += n;
+        }
+        elapsed += now_s() - t0;
+        char what[96];
+        snprintf(what, sizeof(what), "%.40s: stored samples match the recording", session->name);
+        check(ok && first == session->samples, what);
+    }
+    return elapsed;
+}
+
+/**
+ * Decode every stored page of every session once
+ * @return Samples decoded
+ */
+static uint64_t decode_all(sample_data_t *out) {
+    uint64_t samples = 0;
+    for (uint32_t i = 0; i < s_session_count; i++) {
+        const session_result_t *session = &s_sessions[i];
+        uint32_t pos = 0;
+        while (pos < session->page_bytes) {
+            uint32_t n = sample_codec_decode(session->pages + pos, session->page_bytes - pos, out,
+                                             SESSION_FLUSH_PAGE_SAMPLES);
+            if (n == 0) {
+                return 0;
+            }
+            pos += (uint32_t)(session->pages[pos] | (session->pages[pos + 1] << 8));
+            samples += n;
+        }
+    }
+    return samples;
+}
+
+/**
+ * Encode every session in flush pages once
+ * @return Samples encoded
+ */
+static uint64_t encode_all(uint8_t *out) {
+    uint64_t samples = 0;
+    for (uint32_t i = 0; i < s_session_count; i++) {
+        const session_result_t *session = &s_sessions[i];
+        for (uint32_t first = 0; first < session->samples; first += SESSION_FLUSH_PAGE_SAMPLES) {
+            uint32_t n = session->samples - first;
+            if (n > SESSION_FLUSH_PAGE_SAMPLES) {
+                n = SESSION_FLUSH_PAGE_SAMPLES;
+            }
+            sample_codec_encode(&session->expected[first], n, out);
+            samples += n;
+        }
+    }
+    return samples;
+}
+
+/**
+ * Random pages of every length, with values from constant to full range
+ */
+static void check_round_trip(void) {
+    static sample_data_t in[SAMPLE_CODEC_MAX_SAMPLES];
+    static sample_data_t out[SAMPLE_CODEC_MAX_SAMPLES];
+    static uint8_t page[SAMPLE_CODEC_MAX_BYTES(SAMPLE_CODEC_MAX_SAMPLES) + 1];
+    uint32_t rng = 7;
+    bool ok = true;
+    for (uint32_t count = 1; count <= SAMPLE_CODEC_MAX_SAMPLES && ok; count++) {
+        uint32_t bits = count % 17;
+        for (uint32_t i = 0; i < count; i++) {
+            uint8_t *bytes = (uint8_t *)&in[i];
+            for (size_t b = 0; b < sizeof(sample_data_t); b++) {
+                bytes[b] = (uint8_t)(next_random(&rng) & ((1u << (bits < 8 ? bits : 8)) - 1));
+            }
+        }
+        page[SAMPLE_CODEC_MAX_BYTES(count)] = 0xA5;
+        size_t len = sample_codec_encode(in, count, page);
+        ok = len > 0 && len <= SAMPLE_CODEC_MAX_BYTES(count) && page[SAMPLE_CODEC_MAX_BYTES(count)] == 0xA5 &&
+             sample_codec_decode(page, len, out, count) == count &&
+             memcmp(in, out, count * sizeof(sample_data_t)) == 0;
+    }
+    check(ok, "random pages round-trip");
+
+    // Extremes: every field swinging between 0 and its maximum
+    for (uint32_t i = 0; i < SAMPLE_CODEC_MAX_SAMPLES; i++) {
+        memset(&in[i], (i & 1) ? 0xFF : 0x00, sizeof(sample_data_t));
+    }
+    size_t len = sample_codec_encode(in, SAMPLE_CODEC_MAX_SAMPLES, page);
+    check(len <= SAMPLE_CODEC_MAX_BYTES(SAMPLE_CODEC_MAX_SAMPLES) &&
+          sample_codec_decode(page, len, out, SAMPLE_CODEC_MAX_SAMPLES) == SAMPLE_CODEC_MAX_SAMPLES &&
+          memcmp(in, out, sizeof(in)) == 0, "full-swing page round-trips");
+    check(sample_codec_encode(in, 0, page) == 0, "empty page refused");
+
+    // Damaged pages
+    len = sample_codec_encode(in, SESSION_FLUSH_PAGE_SAMPLES, page);
+    check(sample_codec_decode(page, len - 1, out, SESSION_FLUSH_PAGE_SAMPLES) == 0, "truncated page rejected");
+    check(sample_codec_decode(page, len, out, SESSION_FLUSH_PAGE_SAMPLES - 1) == 0, "page larger than buffer rejected");
+    page[3] ^= 0xFF;
+    check(sample_codec_decode(page, len, out, SESSION_FLUSH_PAGE_SAMPLES) == 0, "wrong version rejected");
+    page[3] ^= 0xFF;
+    page[0] = (uint8_t)(len - 1);
+    page[1] = (uint8_t)((len - 1) >> 8);
+    check(sample_codec_decode(page, len, out, SESSION_FLUSH_PAGE_SAMPLES) == 0, "wrong length rejected");
+    page[0] = (uint8_t)len;
+    page[1] = (uint8_t)(len >> 8);
+    page[SAMPLE_CODEC_PAGE_HEADER] = 30;
+    check(sample_codec_decode(page, len, out, SESSION_FLUSH_PAGE_SAMPLES) == 0, "bad bit width rejected");
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "Usage: %s [options] [trace.rwt ...]\n"
+            "  --no-hr              record without a heart rate strap\n"
+            "  --seconds <s>        minimum time per speed measurement (default 0.25)\n",
+            prog);
+}
+
+int main(int argc, char **argv) {
+    bool heart_rate = true;
+    double min_seconds = 0.25;
+    const char *traces[MAX_SESSIONS];
+    int trace_count = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--no-hr") == 0) {
+            heart_rate = false;
+        } else if (i + 1 < argc && strcmp(argv[i], "--seconds") == 0) {
+            min_seconds = atof(argv[++i]);
+        } else if (argv[i][0] != '-' && trace_count < MAX_SESSIONS) {
+            traces[trace_count++] = argv[i];
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (min_seconds <= 0) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    esp_log_level_set("*", ESP_LOG_ERROR);
+    host_partition_reset(SESSION_STORE_PARTITION_LABEL);
+
+    if (trace_count > 0) {
+        for (int i = 0; i < trace_count; i++) {
+            if (!row_trace(traces[i], heart_rate)) {
+                return 2;
+            }
+        }
+    } else {
+        for (size_t w = 0; w < NUM_WORKOUTS; w++) {
+            row_workout(&s_workouts[w], heart_rate);
+        }
+    }
+
+    // Size
+    printf("# %-22s %8s %9s %9s %7s %8s %12s\n", "session", "samples", "raw_B", "pages_B", "ratio",
+           "bits/s", "flash_B/min");
+    uint64_t total_samples = 0;
+    uint64_t total_pages = 0;
+    for (uint32_t i = 0; i < s_session_count; i++) {
+        const session_result_t *s = &s_sessions[i];
+        uint32_t raw = s->samples * (uint32_t)sizeof(sample_data_t);
+        printf("  %-22s %8lu %9lu %9lu %6.2fx %8.1f %12.0f\n", s->name, (unsigned long)s->samples,
+               (unsigned long)raw, (unsigned long)s->page_bytes,
+               s->page_bytes > 0 ? (double)raw / s->page_bytes : 0.0,
+               s->samples > 0 ? 8.0 * s->page_bytes / s->samples : 0.0,
+               s->samples > 0 ? 60.0 * s->flash_bytes / s->samples : 0.0);
+        total_samples += s->samples;
+        total_pages += s->page_bytes;
+    }
+    double ratio = total_pages > 0 ? (double)(total_samples * sizeof(sample_data_t)) / (double)total_pages : 0.0;
+    printf("# all sessions: %llu samples, %.2fx smaller (%.1f bits per second of rowing, was %u)\n",
+           (unsigned long long)total_samples, ratio, total_samples > 0 ? 8.0 * total_pages / total_samples : 0.0,
+           (unsigned)(8 * sizeof(sample_data_t)));
+
+    // Correctness
+    double read_s = verify_sessions();
+    check_round_trip();
+
+    // Speed
+    static sample_data_t decoded[SESSION_FLUSH_PAGE_SAMPLES];
+    static uint8_t encoded[SAMPLE_CODEC_MAX_BYTES(SESSION_FLUSH_PAGE_SAMPLES)];
+    uint64_t done = 0;
+    double t0 = now_s();
+    double elapsed;
+    do {
+        done += encode_all(encoded);
+        elapsed = now_s() - t0;
+    } while (elapsed < min_seconds && total_samples > 0);
+    double encode_mb_s = (double)done * sizeof(sample_data_t) / elapsed / 1e6;
+
+    done = 0;
+    t0 = now_s();
+    do {
+        uint64_t n = decode_all(decoded);
+        check(n == total_samples, "all pages decode");
+        if (n != total_samples) {
+            break;
+        }
+        done += n;
+        elapsed = now_s() - t0;
+    } while (elapsed < min_seconds && total_samples > 0);
+    double decode_mb_s = (double)done * sizeof(sample_data_t) / elapsed / 1e6;
+    double decode_ns = done > 0 ? elapsed * 1e9 / (double)done : 0.0;
+
+    printf("# encode %.0f MB/s of samples, decode %.0f MB/s (%.1f ns per sample, %.2f us per %d-sample page)\n",
+           encode_mb_s, decode_mb_s, decode_ns, decode_ns * SESSION_FLUSH_PAGE_SAMPLES / 1000.0,
+           SESSION_FLUSH_PAGE_SAMPLES);
+    printf("# read back through session_manager in %d-sample slices: %.0f MB/s\n", READ_SLICE_SAMPLES,
+           read_s > 0 ? (double)total_samples * sizeof(sample_data_t) / read_s / 1e6 : 0.0);
+
+    for (uint32_t i = 0; i < s_session_count; i++) {
+        free(s_sessions[i].pages);
+        free(s_sessions[i].expected);
+    }
+    if (s_failures > 0) {
+        printf("FAIL: %d check(s) failed\n", s_failures);
+        return 1;
+    }
+    printf("OK: every session decodes to its recorded samples\n");
+    return 0;
+}
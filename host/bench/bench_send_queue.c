@@ -0,0 +1,245 @@
+/**
+ * @file bench_send_queue.c
+ * @brief Per-client send queues against fast, slow, lagging and stalled readers
+ *
+ * Usage: bench_send_queue [options]
+ *
+ * Streams SSE-style messages ("data: {...}\n\n", a keyframe every
+ * METRICS_KEYFRAME_INTERVAL broadcasts and small deltas in between) to four
+ * clients over local socket pairs with small socket buffers, the way
+ * web_server_broadcast_metrics() does: flush, queue, write, and on a drop
+ * resync with a keyframe. The readers take different amounts per tick:
+ *   - fast:    everything available
+ *   - slow:    a little more than the stream's average rate
+ *   - lagging: less than the stream's average rate
+ *   - stalled: nothing
+ * The readers check that every message arrives whole and in order. The
+ * bench exits with 1 if a message was torn or reordered, if the fast
+ * reader lost messages, or if the stalled reader was not evicted.
+ */
+
+#include "send_queue.h"
+#include "app_config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#define KEYFRAME_BYTES  400
+#define DELTA_BYTES     60
+#define SOCKET_BUFFER   4096
+
+typedef struct {
+    const char *name;
+    int read_per_tick;              // -1 = everything
+    int fds[2];                     // [0] server side, [1] reader side
+    send_queue_t queue;
+    bool synced;
+    bool evicted;
+    int evicted_at;
+    uint32_t max_in_flight;
+    // Reader
+    char rx[8192];
+    size_t rx_len;
+    uint32_t received;
+    uint32_t keyframes;
+    long last_seq;
+    uint32_t torn;
+} client_t;
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  --ticks <n>          broadcasts (default 3000, 10 minutes at 5 Hz)\n",
+            prog);
+}
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/**
+ * Build a message: data: {"seq":N,"key":K,"pad":"..."}\n\n of about size bytes
+ */
+static size_t build_message(char *out, size_t out_len, long seq, bool keyframe, size_t size) {
+    int len = snprintf(out, out_len, "data: {\"seq\":%ld,\"key\":%d,\"pad\":\"", seq, keyframe ? 1 : 0);
+    while ((size_t)len + 5 < size && (size_t)len + 5 < out_len) {
+        out[len++] = 'x';
+    }
+    memcpy(out + len, "\"}\n\n", 4);
+    return (size_t)len + 4;
+}
+
+/**
+ * Parse whole messages out of the reader's buffer
+ */
+static void reader_parse(client_t *c) {
+    size_t start = 0;
+    for (size_t i = 0; i + 1 < c->rx_len; i++) {
+        if (c->rx[i] != '\n' || c->rx[i + 1] != '\n') {
+            continue;
+        }
+        const char *msg = c->rx + start;
+        size_t len = i - start;
+        long seq = -1;
+        int key = 0;
+        if (len < 8 || strncmp(msg, "data: {", 7) != 0 || msg[len - 1] != '}' ||
+            sscanf(msg, "data: {\"seq\":%ld,\"key\":%d", &seq, &key) != 2 || seq <= c->last_seq) {
+            c->torn++;
+        } else {
+            // A delta must directly follow what the reader has
+            if (!key && seq != c->last_seq + 1) {
+                c->torn++;
+            }
+            c->last_seq = seq;
+            c->received++;
+            c->keyframes += key ? 1 : 0;
+        }
+        start = i + 2;
+        i++;
+    }
+    memmove(c->rx, c->rx + start, c->rx_len - start);
+    c->rx_len -= start;
+}
+
+static void reader_tick(client_t *c) {
+    size_t budget = c->read_per_tick < 0 ? sizeof(c->rx) : (size_t)c->read_per_tick;
+    while (budget > 0 && c->rx_len < sizeof(c->rx)) {
+        size_t want = sizeof(c->rx) - c->rx_len;
+        if (want > budget) {
+            want = budget;
+        }
+        ssize_t n = recv(c->fds[1], c->rx + c->rx_len, want, MSG_DONTWAIT);
+        if (n <= 0) {
+            break;
+        }
+        c->rx_len += (size_t)n;
+        budget -= (size_t)n;
+        reader_parse(c);
+    }
+}
+
+int main(int argc, char **argv) {
+    int ticks = 3000;
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 < argc && strcmp(argv[i], "--ticks") == 0) {
+            ticks = atoi(argv[++i]);
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (ticks < 1) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    // Average stream rate per tick, to size the slow and lagging readers
+    const int avg = (KEYFRAME_BYTES + DELTA_BYTES * (METRICS_KEYFRAME_INTERVAL - 1)) / METRICS_KEYFRAME_INTERVAL;
+    static client_t clients[] = {
+        { .name = "fast" },
+        { .name = "slow" },
+        { .name = "lagging" },
+        { .name = "stalled" },
+    };
+    const int num_clients = sizeof(clients) / sizeof(clients[0]);
+    clients[0].read_per_tick = -1;
+    clients[1].read_per_tick = avg * 3 / 2;
+    clients[2].read_per_tick = avg / 2;
+    clients[3].read_per_tick = 0;
+
+    for (int c = 0; c < num_clients; c++) {
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, clients[c].fds) != 0) {
+            perror("socketpair");
+            return 2;
+        }
+        int size = SOCKET_BUFFER;
+        setsockopt(clients[c].fds[0], SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+        setsockopt(clients[c].fds[1], SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+        send_queue_reset(&clients[c].queue, clients[c].fds[0]);
+        clients[c].last_seq = -1;
+        clients[c].evicted_at = -1;
+    }
+
+    char keyframe[KEYFRAME_BYTES + 64];
+    char delta[DELTA_BYTES + 64];
+    double max_broadcast_ns = 0;
+
+    for (int t = 0; t < ticks; t++) {
+        size_t key_len = build_message(keyframe, sizeof(keyframe), t, true, KEYFRAME_BYTES);
+        size_t delta_len = build_message(delta, sizeof(delta), t, false, DELTA_BYTES);
+        bool periodic_key = t % METRICS_KEYFRAME_INTERVAL == 0;
+
+        double start = now_ns();
+        for (int c = 0; c < num_clients; c++) {
+            client_t *cl = &clients[c];
+            if (cl->evicted) {
+                continue;
+            }
+            if (send_queue_flush(&cl->queue) < 0) {
+                cl->evicted = true;
+                continue;
+            }
+            bool key = periodic_key || !cl->synced;
+            if (send_queue_push(&cl->queue, NULL, 0, key ? keyframe : delta, key ? key_len : delta_len)) {
+                cl->synced = true;
+                send_queue_flush(&cl->queue);
+            } else {
+                cl->synced = false;
+            }
+            uint32_t pending = (uint32_t)send_queue_pending(&cl->queue);
+            if (pending > cl->max_in_flight) {
+                cl->max_in_flight = pending;
+            }
+            if (send_queue_end_broadcast(&cl->queue, STREAM_STALL_EVICT_BROADCASTS)) {
+                cl->evicted = true;
+                cl->evicted_at = t;
+                close(cl->fds[0]);
+            }
+        }
+        double elapsed = now_ns() - start;
+        if (elapsed > max_broadcast_ns) {
+            max_broadcast_ns = elapsed;
+        }
+
+        for (int c = 0; c < num_clients; c++) {
+            reader_tick(&clients[c]);
+        }
+    }
+
+    printf("# %d broadcasts, %d B/tick average stream, queue %d B, evict after %d stalled broadcasts\n",
+           ticks, avg, STREAM_QUEUE_BYTES, STREAM_STALL_EVICT_BROADCASTS);
+    printf("# client    read/tick  received  keyframes   dropped  max queued  torn  evicted at\n");
+    int failures = 0;
+    for (int c = 0; c < num_clients; c++) {
+        client_t *cl = &clients[c];
+        printf("%-9s %11d %9lu %10lu %9lu %11lu %5lu  %10d\n", cl->name, cl->read_per_tick,
+               (unsigned long)cl->received, (unsigned long)cl->keyframes,
+               (unsigned long)cl->queue.frames_dropped, (unsigned long)cl->max_in_flight,
+               (unsigned long)cl->torn, cl->evicted_at);
+        failures += cl->torn > 0;
+    }
+    printf("# slowest broadcast: %.0f ns\n", max_broadcast_ns);
+
+    if (clients[0].queue.frames_dropped > 0 || clients[0].evicted) {
+        printf("FAIL: the fast reader lost messages\n");
+        failures++;
+    }
+    if (!clients[3].evicted) {
+        printf("FAIL: the stalled reader was not evicted\n");
+        failures++;
+    }
+    if (failures > 0) {
+        printf("FAIL: %d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("OK: messages arrived whole and in order, stalled reader evicted\n");
+    return 0;
+}
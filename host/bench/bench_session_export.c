@@ -0,0 +1,257 @@
+/**
+ * @file bench_session_export.c
+ * @brief Streamed session detail export of a full-length session
+ *
+ * Usage: bench_session_export [options]
+ *
+ * Records a session of per-second samples through the session manager (on
+ * the emulated flash partition), then writes its /api/sessions/{id} document
+ * through json_writer into a sink that only counts and checks the bytes,
+ * the way the detail handler hands chunks to httpd_resp_send_chunk(). The
+ * bench checks that the output is well-formed JSON and that every sample
+ * appears in each array, then exports it again into a sink that fails on its
+ * first chunk (a client that went away) and checks that the export stops
+ * reading flash. Exits with 1 if a check fails.
+ */
+
+#include "json_writer.h"
+#include "session_json.h"
+#include "session_manager.h"
+#include "session_store.h"
+#include "rowing_physics.h"
+#include "esp_timer.h"
+#include "esp_partition.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ * Counting sink with a minimal JSON syntax check (brackets, strings, and
+ * the number of objects per sample array)
+ */
+typedef struct {
+    uint32_t chunks;
+    uint32_t bytes;
+    uint32_t largest_chunk;
+    int depth;
+    int max_depth;
+    bool in_string;
+    bool escaped;
+    bool broken;
+    uint32_t objects_at_depth3;     // Sample objects (root > array > object)
+    char key[32];                   // Last string at depth 1 (the array name)
+    size_t key_len;
+    uint32_t hr_entries;
+    uint32_t power_entries;
+    uint32_t speed_entries;
+} export_sink_t;
+
+static bool export_sink(void *ctx, const char *data, size_t len) {
+    export_sink_t *s = ctx;
+    s->chunks++;
+    s->bytes += (uint32_t)len;
+    if (len > s->largest_chunk) {
+        s->largest_chunk = (uint32_t)len;
+    }
+
+    for (size_t i = 0; i < len; i++) {
+        char c = data[i];
+        if (s->in_string) {
+            if (s->escaped) {
+                s->escaped = false;
+            } else if (c == '\\') {
+                s->escaped = true;
+            } else if (c == '"') {
+                s->in_string = false;
+            } else if (s->depth == 1 && s->key_len + 1 < sizeof(s->key)) {
+                s->key[s->key_len++] = c;
+                s->key[s->key_len] = '\0';
+            }
+            continue;
+        }
+        switch (c) {
+            case '"':
+                s->in_string = true;
+                if (s->depth == 1) {
+                    s->key_len = 0;
+                    s->key[0] = '\0';
+                }
+                break;
+            case '{':
+            case '[':
+                s->depth++;
+                if (s->depth > s->max_depth) {
+                    s->max_depth = s->depth;
+                }
+                if (c == '{' && s->depth == 3) {
+                    if (strcmp(s->key, "heartRateSamples") == 0) {
+                        s->hr_entries++;
+                    } else if (strcmp(s->key, "powerSamples") == 0) {
+                        s->power_entries++;
+                    } else if (strcmp(s->key, "speedSamples") == 0) {
+                        s->speed_entries++;
+                    }
+                }
+                break;
+            case '}':
+            case ']':
+                if (--s->depth < 0) {
+                    s->broken = true;
+                }
+                break;
+            default:
+                if ((unsigned char)c < 0x20) {
+                    s->broken = true;
+                }
+                break;
+        }
+    }
+    return true;
+}
+
+/** Sink of a client that went away: refuses every chunk */
+static bool failing_sink(void *ctx, const char *data, size_t len) {
+    (void)data;
+    (void)len;
+    (*(uint32_t *)ctx)++;
+    return false;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  --seconds <n>        session length (default 7200, 2 hours)\n"
+            "  --buffer <bytes>     json_writer scratch buffer (default 1024)\n",
+            prog);
+}
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+int main(int argc, char **argv) {
+    int seconds = MAX_SAMPLES_PER_SESSION;
+    int buffer_size = 1024;
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 < argc && strcmp(argv[i], "--seconds") == 0) {
+            seconds = atoi(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "--buffer") == 0) {
+            buffer_size = atoi(argv[++i]);
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (seconds < 1 || seconds > MAX_SAMPLES_PER_SESSION || buffer_size < 16) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    // Record a session: power and pace vary, heart rate is missing for the
+    // first minute (the strap connects late)
+    session_manager_init();
+    rowing_metrics_t metrics;
+    memset(&metrics, 0, sizeof(metrics));
+    session_manager_start_session(&metrics);
+    uint32_t hr_expected = 0;
+    for (int s = 0; s < seconds; s++) {
+        host_timer_set_time((int64_t)(s + 1) * 1000000);
+        metrics.instantaneous_power_watts = 150.0f + (float)(s % 60);
+        metrics.total_work_joules += metrics.instantaneous_power_watts;
+        metrics.instantaneous_pace_sec_500m = 120.0f + (float)(s % 17);
+        metrics.total_distance_meters += 4.0f;
+        metrics.stroke_count = (uint32_t)s / 3;
+        metrics.elapsed_time_ms = (uint32_t)(s + 1) * 1000;
+        uint8_t hr = s < 60 ? 0 : (uint8_t)(120 + s % 40);
+        hr_expected += hr > 0;
+        session_manager_record_sample(&metrics, hr);
+    }
+    metrics.stroke_count += 5;
+    session_manager_end_session(&metrics);
+    session_manager_flush();
+
+    uint32_t session_id = session_manager_get_session_count();
+    session_record_t record;
+    if (session_id == 0 || session_manager_get_session(session_id, &record) != ESP_OK) {
+        printf("FAIL: session was not saved\n");
+        return 1;
+    }
+
+    char *buffer = malloc((size_t)buffer_size);
+    static sample_data_t slice[SESSION_JSON_SLICE_SAMPLES];
+    export_sink_t sink;
+    memset(&sink, 0, sizeof(sink));
+
+    host_partition_stats_t flash;
+    host_partition_get_stats(SESSION_STORE_PARTITION_LABEL, &flash, true);
+    json_writer_t writer;
+    json_writer_init(&writer, buffer, (size_t)buffer_size, export_sink, &sink);
+    double start = now_ms();
+    bool samples_ok = session_json_write_detail(&writer, &record, slice);
+    bool finished = json_writer_finish(&writer);
+    double elapsed = now_ms() - start;
+    host_partition_get_stats(SESSION_STORE_PARTITION_LABEL, &flash, true);
+    uint64_t export_read = flash.bytes_read;
+
+    // Same export into a sink that fails right away
+    uint32_t failed_chunks = 0;
+    json_writer_init(&writer, buffer, (size_t)buffer_size, failing_sink, &failed_chunks);
+    bool failed_samples_ok = session_json_write_detail(&writer, &record, slice);
+    bool failed_finished = json_writer_finish(&writer);
+    host_partition_get_stats(SESSION_STORE_PARTITION_LABEL, &flash, true);
+    uint64_t failed_read = flash.bytes_read;
+    free(buffer);
+
+    printf("# session of %lu samples, %d B writer buffer\n", (unsigned long)record.sample_count, buffer_size);
+    printf("# %lu bytes in %lu chunks (largest %lu B), %.1f ms\n",
+           (unsigned long)sink.bytes, (unsigned long)sink.chunks,
+           (unsigned long)sink.largest_chunk, elapsed);
+    printf("# heartRateSamples %lu, powerSamples %lu, speedSamples %lu\n",
+           (unsigned long)sink.hr_entries, (unsigned long)sink.power_entries,
+           (unsigned long)sink.speed_entries);
+    printf("# RAM held by the export: writer buffer + %u B slice\n",
+           (unsigned)sizeof(slice));
+    printf("# flash read: %llu B by the export, %llu B after a failed first chunk\n",
+           (unsigned long long)export_read, (unsigned long long)failed_read);
+
+    int failures = 0;
+    if (!samples_ok || !finished) {
+        printf("FAIL: export did not complete\n");
+        failures++;
+    }
+    if (sink.broken || sink.depth != 0 || sink.in_string || sink.max_depth != 3) {
+        printf("FAIL: output is not well-formed JSON\n");
+        failures++;
+    }
+    if (sink.power_entries != (uint32_t)seconds || sink.speed_entries != (uint32_t)seconds ||
+        sink.hr_entries != hr_expected) {
+        printf("FAIL: expected %d power/speed and %lu heart rate entries\n",
+               seconds, (unsigned long)hr_expected);
+        failures++;
+    }
+    if (sink.largest_chunk > (uint32_t)buffer_size) {
+        printf("FAIL: a chunk exceeded the writer buffer\n");
+        failures++;
+    }
+    if (failed_samples_ok || failed_finished || failed_chunks != 1) {
+        printf("FAIL: export into a failed sink did not report the failure\n");
+        failures++;
+    }
+    // The first pass stops at the failed chunk, so this is well under the
+    // three passes of a full export
+    if (failed_read * 3 > export_read) {
+        printf("FAIL: export kept reading flash after the sink failed\n");
+        failures++;
+    }
+    if (failures > 0) {
+        printf("FAIL: %d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("OK: full session exported as well-formed JSON in bounded chunks\n");
+    return 0;
+}
@@ -0,0 +1,257 @@
+/**
+ * @file bench_session_flush.c
+ * @brief Incremental session flushing: flash cost and recovery after resets
+ *
+ * Usage: bench_session_flush [options]
+ *
+ * Records a session through the session manager on the emulated `storage`
+ * partition, calling session_manager_flush() every SESSION_FLUSH_INTERVAL_MS
+ * the way the storage task does:
+ *   - reference run: flushes, bytes per flush and how long
+ *     session_manager_end_session() takes in the stopping task
+ *   - power cuts: the same session cut after every Nth programmed byte or
+ *     erase, then a reboot (remount and recovery pass). Every sample flushed
+ *     before the cut must come back as a valid session, byte for byte, no
+ *     session may be left open, and a deleted recovered session must stay
+ *     deleted and keep its id across another reboot.
+ * Exits with 1 if any check fails.
+ */
+
+#include "session_manager.h"
+#include "session_store.h"
+#include "app_config.h"
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "esp_timer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define LABEL                   SESSION_STORE_PARTITION_LABEL
+#define FLUSH_EVERY_S           (SESSION_FLUSH_INTERVAL_MS / 1000)
+
+static int s_failures = 0;
+static sample_data_t s_expected[MAX_SAMPLES_PER_SESSION];
+static sample_data_t s_read[MAX_SAMPLES_PER_SESSION];
+
+static void check(bool ok, const char *what, int cut) {
+    if (!ok) {
+        printf("FAIL: %s (cut #%d)\n", what, cut);
+        s_failures++;
+    }
+}
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e6 + (double)ts.tv_nsec / 1e3;
+}
+
+/**
+ * What happened during one recorded session
+ */
+typedef struct {
+    uint32_t session_id;
+    uint32_t recorded;          // Samples recorded
+    uint32_t at_cut;            // Samples recorded when the power went (the device stops there)
+    uint32_t durable;           // Samples on flash per the last flush before the cut
+    uint32_t max_flush_bytes;   // Largest single flush
+    double end_us;              // Wall time of session_manager_end_session()
+    bool completed;             // The final flush finished before the cut
+} run_result_t;
+
+/**
+ * Boot, row a session of the given length and stop it
+ */
+static void row_session(int seconds, int64_t power_cut, run_result_t *result) {
+    memset(result, 0, sizeof(*result));
+    host_timer_set_time(0);
+    session_manager_init();
+    host_partition_set_power_cut(power_cut);
+
+    rowing_metrics_t metrics;
+    memset(&metrics, 0, sizeof(metrics));
+    session_manager_start_session(&metrics);
+    result->session_id = session_manager_get_current_session_id();
+
+    session_flush_stats_t stats;
+    uint32_t bytes_before = 0;
+    for (int s = 0; s < seconds; s++) {
+        host_timer_set_time((int64_t)(s + 1) * 1000000);
+        metrics.instantaneous_power_watts = 150.0f + (float)(s % 60);
+        metrics.total_work_joules += metrics.instantaneous_power_watts;
+        metrics.instantaneous_pace_sec_500m = 120.0f + (float)(s % 17);
+        metrics.total_distance_meters += 4.0f;
+        metrics.stroke_rate_spm = 24.0f;
+        metrics.stroke_count = (uint32_t)(s * 2 / 5);
+        metrics.elapsed_time_ms = (uint32_t)(s + 1) * 1000;
+        session_manager_record_sample(&metrics, (uint8_t)(120 + s % 40));
+        result->recorded++;
+
+        if ((s + 1) % FLUSH_EVERY_S == 0) {
+            session_manager_flush();
+            session_manager_get_flush_stats(&stats);
+            if (stats.bytes_written - bytes_before > result->max_flush_bytes) {
+                result->max_flush_bytes = stats.bytes_written - bytes_before;
+            }
+            bytes_before = stats.bytes_written;
+            if (!host_partition_power_lost()) {
+                result->durable = result->recorded - stats.pending_samples;
+            } else if (result->at_cut == 0) {
+                result->at_cut = result->recorded;
+            }
+        }
+    }
+
+    double t0 = now_us();
+    session_manager_end_session(&metrics);
+    result->end_us = now_us() - t0;
+    session_manager_flush();
+    session_manager_get_flush_stats(&stats);
+    if (stats.bytes_written - bytes_before > result->max_flush_bytes) {
+        result->max_flush_bytes = stats.bytes_written - bytes_before;
+    }
+    result->completed = !host_partition_power_lost();
+    if (result->at_cut == 0) {
+        result->at_cut = result->recorded;
+    }
+    host_partition_set_power_cut(-1);
+}
+
+/**
+ * Reboot after a cut and check what the recovery pass made of the session
+ * @return Samples lost (recorded before the cut but not in the stored session)
+ */
+static uint32_t verify_after_cut(const run_result_t *run, int cut, uint32_t *recovered) {
+    session_manager_init();
+
+    uint32_t ids[SESSION_STORE_MAX_SESSIONS];
+    check(session_store_list_open(ids, SESSION_STORE_MAX_SESSIONS) == 0, "session left open", cut);
+    uint32_t count = session_manager_list_sessions(ids, SESSION_STORE_MAX_SESSIONS);
+    check(count <= 1, "more than one session", cut);
+
+    session_record_t record;
+    bool found = count == 1 && ids[0] == run->session_id &&
+                 session_manager_get_session(run->session_id, &record) == ESP_OK;
+    if (run->completed) {
+        check(found && record.sample_count == run->recorded, "completed session incomplete", cut);
+    } else if (run->durable >= SESSION_FLUSH_PAGE_SAMPLES) {
+        check(found, "flushed session not recovered", cut);
+    }
+    if (!found) {
+        return run->at_cut;
+    }
+
+    check(record.sample_count >= run->durable && record.sample_count <= run->recorded,
+          "recovered sample count out of range", cut);
+    uint32_t n = 0;
+    session_manager_read_samples(run->session_id, 0, s_read, MAX_SAMPLES_PER_SESSION, &n);
+    check(n == record.sample_count && memcmp(s_read, s_expected, n * sizeof(sample_data_t)) == 0,
+          "recovered samples differ", cut);
+    *recovered += !run->completed;
+
+    // Deleted stays deleted, and its id is not handed out again
+    session_manager_delete_session(run->session_id);
+    session_manager_init();
+    check(session_manager_get_session(run->session_id, &record) == ESP_ERR_NOT_FOUND,
+          "deleted session came back", cut);
+    rowing_metrics_t metrics;
+    memset(&metrics, 0, sizeof(metrics));
+    session_manager_start_session(&metrics);
+    check(session_manager_get_current_session_id() > run->session_id, "session id reused", cut);
+    session_manager_end_session(&metrics);
+    session_manager_flush();
+
+    return run->at_cut > n ? run->at_cut - n : 0;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  --seconds <n>        session length (default 1800)\n"
+            "  --cuts <n>           power cuts (default 500)\n",
+            prog);
+}
+
+int main(int argc, char **argv) {
+    int seconds = 1800;
+    int cuts = 500;
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 < argc && strcmp(argv[i], "--seconds") == 0) {
+            seconds = atoi(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "--cuts") == 0) {
+            cuts = atoi(argv[++i]);
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (seconds < 60 || seconds > MAX_SAMPLES_PER_SESSION || cuts < 1) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    // Recovered sessions are logged as warnings
+    esp_log_level_set("*", ESP_LOG_ERROR);
+
+    // Reference run
+    host_partition_reset(LABEL);
+    host_partition_stats_t flash;
+    host_partition_get_stats(LABEL, &flash, true);
+    run_result_t run;
+    row_session(seconds, -1, &run);
+    host_partition_get_stats(LABEL, &flash, true);
+    int64_t total = (int64_t)flash.bytes_written + flash.erases;
+
+    uint32_t n = 0;
+    session_manager_read_samples(run.session_id, 0, s_expected, MAX_SAMPLES_PER_SESSION, &n);
+    check(n == run.recorded, "reference session incomplete", -1);
+    session_flush_stats_t stats;
+    session_manager_get_flush_stats(&stats);
+
+    printf("# session of %d samples, flush every %d s in %d-sample pages (%u B uncompressed)\n", seconds, FLUSH_EVERY_S,
+           SESSION_FLUSH_PAGE_SAMPLES, (unsigned)(SESSION_FLUSH_PAGE_SAMPLES * sizeof(sample_data_t)));
+    printf("# %lu flushes, %lu bytes to the store (%lu of compressed pages for %lu of samples), "
+           "largest flush %lu B\n",
+           (unsigned long)stats.flushes, (unsigned long)stats.bytes_written, (unsigned long)stats.page_bytes,
+           (unsigned long)(n * sizeof(sample_data_t)), (unsigned long)run.max_flush_bytes);
+    printf("# end_session: %.1f us, 0 B written by the stopping task (was %lu B at stop)\n",
+           run.end_us, (unsigned long)(n * sizeof(sample_data_t) + sizeof(session_record_t)));
+
+    // Power cuts
+    uint32_t recovered = 0;
+    uint32_t max_lost = 0;
+    uint64_t lost_sum = 0;
+    uint32_t interrupted = 0;
+    int failures_before = s_failures;
+    for (int i = 0; i < cuts; i++) {
+        host_partition_reset(LABEL);
+        // The last cut comes after the session is saved
+        int64_t budget = (int64_t)((double)i * (double)total / (double)(cuts > 1 ? cuts - 1 : 1)) + (i * 7) % 13;
+        row_session(seconds, budget, &run);
+        uint32_t lost = verify_after_cut(&run, i, &recovered);
+        if (!run.completed) {
+            interrupted++;
+            lost_sum += lost;
+            if (lost > max_lost) {
+                max_lost = lost;
+            }
+        }
+    }
+
+    printf("# power cuts: %d over %lld programmed bytes + erases, %lu during the session, %lu recovered, "
+           "samples lost max %lu avg %.1f (page %d + interval %d s): %s\n",
+           cuts, (long long)total, (unsigned long)interrupted, (unsigned long)recovered,
+           (unsigned long)max_lost, interrupted > 0 ? (double)lost_sum / (double)interrupted : 0.0, SESSION_FLUSH_PAGE_SAMPLES, FLUSH_EVERY_S,
+           s_failures == failures_before ? "all consistent" : "FAILED");
+
+    if (s_failures > 0) {
+        printf("FAIL: %d checks failed\n", s_failures);
+        return 1;
+    }
+    printf("OK: flushed samples survive resets as valid sessions\n");
+    return 0;
+}
@@ -0,0 +1,276 @@
+/**
+ * @file bench_session_samples.c
+ * @brief samples.bin / pages.bin downloads: size against JSON, ranges and resume
+ *
+ * Usage: bench_session_samples [options]
+ *
+ * Records a session through the session manager (emulated flash partition) and
+ * serves its /api/sessions/{id}/samples.bin download through session_samples
+ * the way the web server does:
+ *   - the whole download, compared byte for byte with the stored samples
+ *   - a transfer cut off part-way and resumed with "Range: bytes=N-"
+ *   - Range header parsing and ETag matching edge cases
+ *   - the compressed pages.bin download, resumed the same way and decoded
+ *     back to the samples
+ *   - the running session read from the session series in slices that
+ *     split rows, compared with what was stored
+ * It also prints the size of the same session as detail JSON. Exits with 1
+ * if any check fails.
+ */
+
+#include "session_samples.h"
+#include "session_json.h"
+#include "sample_codec.h"
+#include "session_manager.h"
+#include "json_writer.h"
+#include "esp_timer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CHUNK_BYTES 1024
+
+static int s_failures = 0;
+
+static void check(bool ok, const char *what) {
+    if (!ok) {
+        printf("FAIL: %s\n", what);
+        s_failures++;
+    }
+}
+
+/**
+ * Serve [first, last] of the download the way the handler does
+ * @param stop_after Stop once this many bytes have been sent (0 = no limit)
+ * @return Bytes written to out
+ */
+static uint32_t serve(const session_samples_doc_t *doc, uint32_t first, uint32_t last,
+                      uint8_t *out, uint32_t stop_after) {
+    uint8_t chunk[CHUNK_BYTES];
+    uint32_t sent = 0;
+    uint32_t offset = first;
+    while (offset <= last) {
+        uint32_t want = last - offset + 1;
+        if (want > sizeof(chunk)) {
+            want = sizeof(chunk);
+        }
+        uint32_t got = 0;
+        if (session_samples_read(doc, offset, chunk, want, &got) != ESP_OK || got == 0) {
+            break;
+        }
+        if (stop_after > 0 && sent + got > stop_after) {
+            got = stop_after - sent;
+        }
+        memcpy(out + sent, chunk, got);
+        sent += got;
+        offset += got;
+        if (stop_after > 0 && sent >= stop_after) {
+            break;
+        }
+    }
+    return sent;
+}
+
+static bool count_sink(void *ctx, const char *data, size_t len) {
+    (void)data;
+    *(uint32_t *)ctx += (uint32_t)len;
+    return true;
+}
+
+static void check_range(const char *value, uint32_t size, session_samples_range_t expect,
+                        uint32_t expect_first, uint32_t expect_last) {
+    uint32_t first = 0;
+    uint32_t last = 0;
+    session_samples_range_t got = session_samples_parse_range(value, size, &first, &last);
+    bool ok = got == expect &&
+              (expect != SESSION_SAMPLES_RANGE_OK || (first == expect_first && last == expect_last));
+    if (!ok) {
+        char what[96];
+        snprintf(what, sizeof(what), "Range \"%s\" of %lu bytes", value, (unsigned long)size);
+        check(false, what);
+    }
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  --seconds <n>        session length (default 7200, 2 hours)\n",
+            prog);
+}
+
+int main(int argc, char **argv) {
+    int seconds = MAX_SAMPLES_PER_SESSION;
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 < argc && strcmp(argv[i], "--seconds") == 0) {
+            seconds = atoi(argv[++i]);
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (seconds < 1 || seconds > MAX_SAMPLES_PER_SESSION) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    session_manager_init();
+    rowing_metrics_t metrics;
+    memset(&metrics, 0, sizeof(metrics));
+    session_manager_start_session(&metrics);
+    for (int s = 0; s < seconds; s++) {
+        host_timer_set_time((int64_t)(s + 1) * 1000000);
+        metrics.instantaneous_power_watts = 150.0f + (float)(s % 60);
+        metrics.total_work_joules += metrics.instantaneous_power_watts;
+        metrics.instantaneous_pace_sec_500m = 120.0f + (float)(s % 17);
+        metrics.total_distance_meters += 4.0f;
+        metrics.elapsed_time_ms = (uint32_t)(s + 1) * 1000;
+        session_manager_record_sample(&metrics, (uint8_t)(120 + s % 40));
+    }
+    
+    // The running session, read from the series in slices that split rows
+    uint32_t live_size = (uint32_t)seconds * sizeof(sample_data_t);
+    uint8_t *live = malloc(live_size);
+    uint32_t live_read = 0;
+    while (live_read < live_size) {
+        uint32_t want = live_size - live_read < 1001 ? live_size - live_read : 1001;
+        uint32_t got = 0;
+        if (session_manager_read_sample_bytes(session_manager_get_current_session_id(), live_read,
+                                              live + live_read, want, &got) != ESP_OK || got == 0) {
+            break;
+        }
+        live_read += got;
+    }
+    
+    metrics.stroke_count = 5 + (uint32_t)seconds / 3;
+    session_manager_end_session(&metrics);
+    session_manager_flush();
+
+    session_samples_doc_t doc;
+    if (session_samples_open(session_manager_get_session_count(), false, RECORDING_PROFILE_1HZ, &doc) != ESP_OK) {
+        printf("FAIL: session was not saved\n");
+        return 1;
+    }
+    const session_record_t record = doc.record;
+
+    // Reference: header + samples as stored
+    uint32_t size = session_samples_size(&doc);
+    uint8_t *expected = malloc(size);
+    uint8_t *download = malloc(size);
+    session_samples_header_t header;
+    session_samples_make_header(&doc, &header);
+    memcpy(expected, &header, sizeof(header));
+    uint32_t count = 0;
+    session_manager_read_samples(record.session_id, 0, (sample_data_t *)(expected + sizeof(header)),
+                                 record.sample_count, &count);
+    check(count == record.sample_count, "stored sample count");
+    check(live_read == live_size && memcmp(live, expected + sizeof(header), live_size) == 0,
+          "running session reads match the stored samples");
+
+    // Whole download
+    uint32_t got = serve(&doc, 0, size - 1, download, 0);
+    check(got == size && memcmp(download, expected, size) == 0, "full download matches the stored samples");
+
+    // Interrupted at an odd offset (mid-sample), then resumed
+    uint32_t cut = size / 3 + 5;
+    memset(download, 0, size);
+    uint32_t part = serve(&doc, 0, size - 1, download, cut);
+    char range[32];
+    snprintf(range, sizeof(range), "bytes=%lu-", (unsigned long)part);
+    uint32_t first = 0;
+    uint32_t last = 0;
+    bool resumed = session_samples_parse_range(range, size, &first, &last) == SESSION_SAMPLES_RANGE_OK;
+    if (resumed) {
+        part += serve(&doc, first, last, download + first, 0);
+    }
+    check(resumed && part == size && memcmp(download, expected, size) == 0, "resumed download matches");
+
+    // Suffix range: the last sample only
+    got = serve(&doc, size - sizeof(sample_data_t), size - 1, download, 0);
+    check(got == sizeof(sample_data_t) &&
+          memcmp(download, expected + size - sizeof(sample_data_t), got) == 0, "last-sample range");
+
+    // Range parsing
+    check_range("bytes=0-99", size, SESSION_SAMPLES_RANGE_OK, 0, 99);
+    check_range("bytes=100-", size, SESSION_SAMPLES_RANGE_OK, 100, size - 1);
+    check_range("bytes=-8", size, SESSION_SAMPLES_RANGE_OK, size - 8, size - 1);
+    check_range("bytes=-999999999", size, SESSION_SAMPLES_RANGE_OK, 0, size - 1);
+    check_range("bytes=10-999999999", size, SESSION_SAMPLES_RANGE_OK, 10, size - 1);
+    check_range("bytes=0-0", size, SESSION_SAMPLES_RANGE_OK, 0, 0);
+    check_range("bytes=-0", size, SESSION_SAMPLES_RANGE_UNSATISFIABLE, 0, 0);
+    snprintf(range, sizeof(range), "bytes=%lu-", (unsigned long)size);
+    check_range(range, size, SESSION_SAMPLES_RANGE_UNSATISFIABLE, 0, 0);
+    check_range("bytes=5-4", size, SESSION_SAMPLES_RANGE_NONE, 0, 0);
+    check_range("bytes=0-1,5-9", size, SESSION_SAMPLES_RANGE_NONE, 0, 0);
+    check_range("bytes=abc", size, SESSION_SAMPLES_RANGE_NONE, 0, 0);
+    check_range("items=0-9", size, SESSION_SAMPLES_RANGE_NONE, 0, 0);
+    check_range("bytes=99999999999-", size, SESSION_SAMPLES_RANGE_NONE, 0, 0);
+
+    // ETags: strong comparison, lists and "*"
+    char etag[SESSION_SAMPLES_ETAG_LEN];
+    session_samples_etag(&doc, etag, sizeof(etag));
+    char list[96];
+    snprintf(list, sizeof(list), "\"other\", %s", etag);
+    char weak[48];
+    snprintf(weak, sizeof(weak), "W/%s", etag);
+    check(session_samples_etag_matches(etag, etag), "ETag matches itself");
+    check(session_samples_etag_matches(list, etag), "ETag matches in a list");
+    check(session_samples_etag_matches("*", etag), "ETag matches *");
+    check(!session_samples_etag_matches(weak, etag), "weak ETag does not match");
+    check(!session_samples_etag_matches("\"other\"", etag), "other ETag does not match");
+
+    // Compressed pages: resumed mid-page, then decoded page by page
+    session_samples_doc_t pages_doc;
+    check(session_samples_open(record.session_id, true, RECORDING_PROFILE_1HZ, &pages_doc) == ESP_OK &&
+          pages_doc.version == SESSION_SAMPLES_VERSION_PAGES, "pages.bin available");
+    uint32_t pages_size = session_samples_size(&pages_doc);
+    char pages_etag[SESSION_SAMPLES_ETAG_LEN];
+    session_samples_etag(&pages_doc, pages_etag, sizeof(pages_etag));
+    check(!session_samples_etag_matches(pages_etag, etag), "pages.bin and samples.bin ETags differ");
+    memset(download, 0, size);
+    part = serve(&pages_doc, 0, pages_size - 1, download, pages_size / 2 + 3);
+    part += serve(&pages_doc, part, pages_size - 1, download + part, 0);
+    const session_samples_header_t *pages_header = (const session_samples_header_t *)download;
+    uint32_t pos = sizeof(session_samples_header_t);
+    uint32_t decoded = 0;
+    static sample_data_t page[SAMPLE_CODEC_MAX_SAMPLES];
+    while (part == pages_size && pos < pages_size) {
+        uint32_t n = sample_codec_decode(download + pos, pages_size - pos, page, SAMPLE_CODEC_MAX_SAMPLES);
+        if (n == 0 || decoded + n > record.sample_count ||
+            memcmp(page, expected + sizeof(header) + decoded * sizeof(sample_data_t), n * sizeof(sample_data_t)) != 0) {
+            break;
+        }
+        pos += (uint32_t)(download[pos] | (download[pos + 1] << 8));
+        decoded += n;
+    }
+    check(pages_header->data_bytes == pages_size - sizeof(session_samples_header_t) &&
+          pos == pages_size && decoded == record.sample_count, "resumed pages.bin decodes to the samples");
+
+    // Same session as detail JSON
+    uint32_t json_bytes = 0;
+    char buffer[CHUNK_BYTES];
+    static sample_data_t slice[SESSION_JSON_SLICE_SAMPLES];
+    json_writer_t writer;
+    json_writer_init(&writer, buffer, sizeof(buffer), count_sink, &json_bytes);
+    session_json_write_detail(&writer, &record, slice);
+    json_writer_finish(&writer);
+
+    printf("# session of %lu samples, ETag %s\n", (unsigned long)record.sample_count, etag);
+    printf("# samples.bin %lu bytes (%u B header), detail JSON %lu bytes (%.1fx)\n",
+           (unsigned long)size, (unsigned)sizeof(header), (unsigned long)json_bytes,
+           (double)json_bytes / size);
+    printf("# pages.bin %lu bytes (%.2fx smaller than samples.bin)\n", (unsigned long)pages_size,
+           (double)size / pages_size);
+    printf("# resumed at byte %lu\n", (unsigned long)cut);
+
+    free(expected);
+    free(download);
+    free(live);
+    if (s_failures > 0) {
+        printf("FAIL: %d check(s) failed\n", s_failures);
+        return 1;
+    }
+    printf("OK: full, resumed and ranged downloads match the stored samples\n");
+    return 0;
+}
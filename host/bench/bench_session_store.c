@@ -0,0 +1,451 @@
+/**
+ * @file bench_session_store.c
+ * @brief Session store: capacity, write amplification, wear and power-cut safety
+ *
+ * Usage: bench_session_store [options]
+ *   --sessions N   Sessions in the long-use run (default 3000)
+ *   --cuts N       Power cuts in the sweep (default 2000)
+ *   --image PATH   Back the partition with a file, left holding the
+ *                  long-use store
+ *
+ * Runs the firmware session store on the emulated `storage` partition
+ * (NOR semantics, see host/shims/esp_partition.h):
+ *   - capacity: 30-minute sessions committed until the first one is dropped
+ *   - long use: a few thousand sessions of 5-90 minutes, synced and deleted
+ *     the way the companion app does for the first half and never deleted
+ *     for the second half (the store must drop the oldest ones). Reports
+ *     write amplification, GC work, erase counts and read throughput, then
+ *     checks every remaining session byte for byte after a remount.
+ *   - power cuts: a script of commits, synced flags and deletes on a small
+ *     partition (so GC runs all the time) is cut after every Nth programmed
+ *     byte or erase. After each cut the store is remounted and must hold
+ *     every operation that finished before the cut, none that was undone,
+ *     no partial session, and still accept and keep a new session.
+ * Exits with 1 if any check fails.
+ */
+
+#include "session_store.h"
+#include "esp_partition.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define LABEL                   SESSION_STORE_PARTITION_LABEL
+#define SAMPLE_BYTES            8
+#define READ_SLICE_BYTES        1024
+
+// Power-cut script
+#define SCRIPT_SECTORS          16
+#define SCRIPT_SESSIONS         24
+#define SCRIPT_LIVE_SESSIONS    4
+#define SCRIPT_MAX_OPS          (SCRIPT_SESSIONS * 3)
+
+static int s_failures = 0;
+
+static void check(bool ok, const char *what, uint32_t session_id) {
+    if (!ok) {
+        if (s_failures < 20) {
+            printf("FAIL: %s (session #%lu)\n", what, (unsigned long)session_id);
+        }
+        s_failures++;
+    }
+}
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static uint32_t s_rng = 12345;
+
+static uint32_t rng_next(void) {
+    s_rng = s_rng * 1103515245u + 12345u;
+    return s_rng >> 8;
+}
+
+// ============================================================================
+// Sessions with content derived from their id
+// ============================================================================
+
+static uint32_t session_seconds(uint32_t session_id, uint32_t min_s, uint32_t max_s) {
+    uint32_t h = session_id * 2654435761u;
+    return min_s + (h >> 8) % (max_s - min_s + 1);
+}
+
+static uint8_t sample_byte(uint32_t session_id, uint32_t offset) {
+    uint32_t h = (session_id * 0x9E3779B1u) ^ (offset * 0x85EBCA77u);
+    h ^= h >> 15;
+    return (uint8_t)(h * 0xC2B2AE3Du >> 24);
+}
+
+static void make_record(uint32_t session_id, uint32_t seconds, session_record_t *record) {
+    memset(record, 0, sizeof(*record));
+    record->session_id = session_id;
+    record->start_timestamp = 1700000000000LL + (int64_t)session_id * 86400000LL;
+    record->duration_seconds = seconds;
+    record->total_distance_meters = (float)seconds * 4.1f;
+    record->average_pace_sec_500m = 121.9f;
+    record->average_power_watts = 180.0f + (float)(session_id % 50);
+    record->stroke_count = seconds / 3;
+    record->total_calories = seconds / 12;
+    record->drag_factor = 110.0f;
+    record->sample_count = seconds;
+    record->average_heart_rate = 140.0f;
+    record->max_heart_rate = 172;
+}
+
+static esp_err_t write_session(uint32_t session_id, uint32_t seconds) {
+    static uint8_t data[SAMPLE_BYTES * 90 * 60];
+    uint32_t len = seconds * SAMPLE_BYTES;
+    for (uint32_t i = 0; i < len; i++) {
+        data[i] = sample_byte(session_id, i);
+    }
+
+    session_record_t record;
+    make_record(session_id, seconds, &record);
+    esp_err_t ret = session_store_begin(session_id);
+    if (ret == ESP_OK) {
+        ret = session_store_append(session_id, SESSION_STORE_STREAM_SAMPLE_PAGES, 0, data, len);
+    }
+    if (ret == ESP_OK) {
+        ret = session_store_commit(&record);
+    }
+    if (ret != ESP_OK) {
+        session_store_abandon(session_id);
+    }
+    return ret;
+}
+
+/**
+ * Check a stored session against the content it was written with
+ */
+static bool verify_session(uint32_t session_id, uint32_t seconds, uint64_t *bytes) {
+    session_record_t expected;
+    session_record_t record;
+    make_record(session_id, seconds, &expected);
+    if (session_store_get(session_id, &record) != ESP_OK) {
+        return false;
+    }
+    expected.synced = record.synced;
+    if (memcmp(&expected, &record, sizeof(record)) != 0) {
+        return false;
+    }
+
+    uint8_t slice[READ_SLICE_BYTES];
+    uint32_t offset = 0;
+    uint32_t len = seconds * SAMPLE_BYTES;
+    // Reads stop at the recorded length, as the web handlers do
+    while (offset < len) {
+        uint32_t want = len - offset < sizeof(slice) ? len - offset : sizeof(slice);
+        uint32_t got = 0;
+        if (session_store_read(session_id, SESSION_STORE_STREAM_SAMPLE_PAGES, offset, slice,
+                               want, &got) != ESP_OK || got == 0) {
+            return false;
+        }
+        for (uint32_t i = 0; i < got; i++) {
+            if (slice[i] != sample_byte(session_id, offset + i)) {
+                return false;
+            }
+        }
+        offset += got;
+    }
+    if (bytes != NULL) {
+        *bytes += offset;
+    }
+    return offset == len;
+}
+
+// ============================================================================
+// Capacity and long use
+// ============================================================================
+
+static void run_capacity(void) {
+    host_partition_reset(LABEL);
+    session_store_init();
+
+    session_store_stats_t stats;
+    uint32_t id = 0;
+    do {
+        if (write_session(++id, 30 * 60) != ESP_OK) {
+            check(false, "commit failed while filling", id);
+            break;
+        }
+        session_store_get_stats(&stats);
+    } while (stats.sessions_evicted == 0);
+
+    printf("# capacity: %lu sessions of 30 min (%lu KB partition, index holds %d)\n",
+           (unsigned long)(id - 1), (unsigned long)(stats.sectors * 4), SESSION_STORE_MAX_SESSIONS);
+}
+
+static void run_long_use(uint32_t sessions) {
+    host_partition_reset(LABEL);
+    host_partition_stats_t flash;
+    host_partition_get_stats(LABEL, &flash, true);
+    session_store_init();
+
+    uint64_t payload = 0;
+    double t0 = now_s();
+    for (uint32_t id = 1; id <= sessions; id++) {
+        uint32_t seconds = session_seconds(id, 5 * 60, 90 * 60);
+        if (write_session(id, seconds) != ESP_OK) {
+            check(false, "commit failed", id);
+            break;
+        }
+        payload += seconds * SAMPLE_BYTES;
+        if (id > 1) {
+            session_store_set_synced(id - 1);
+        }
+        // First half: synced sessions deleted now and then
+        if (id <= sessions / 2 && rng_next() % 8 == 0) {
+            uint32_t ids[SESSION_STORE_MAX_SESSIONS];
+            uint32_t count = session_store_list(ids, SESSION_STORE_MAX_SESSIONS);
+            for (uint32_t i = 0; i < count; i++) {
+                session_record_t record;
+                if (session_store_get(ids[i], &record) == ESP_OK && record.synced) {
+                    session_store_delete(ids[i]);
+                }
+            }
+        }
+    }
+    double write_s = now_s() - t0;
+
+    session_store_stats_t stats;
+    session_store_get_stats(&stats);
+    host_partition_get_stats(LABEL, &flash, true);
+
+    printf("# long use: %lu sessions, %.1f MB of samples in %.2f s\n",
+           (unsigned long)sessions, (double)payload / 1e6, write_s);
+    printf("#   write amplification %.3f (programmed %lu / appended %lu bytes)\n",
+           (double)stats.bytes_programmed / (double)stats.bytes_appended,
+           (unsigned long)stats.bytes_programmed, (unsigned long)stats.bytes_appended);
+    printf("#   gc runs %lu, %lu bytes copied, %lu wear moves, %lu sessions dropped\n",
+           (unsigned long)stats.gc_runs, (unsigned long)stats.gc_bytes_copied,
+           (unsigned long)stats.wear_moves, (unsigned long)stats.sessions_evicted);
+    printf("#   erases %lu over %lu sectors, per sector min %lu max %lu (ideal %.1f)\n",
+           (unsigned long)flash.erases, (unsigned long)stats.sectors,
+           (unsigned long)stats.min_erase_count, (unsigned long)stats.max_erase_count,
+           (double)flash.erases / (double)stats.sectors);
+    if (payload > (uint64_t)stats.sectors * 4096 * 2) {
+        check(stats.sessions_evicted > 0, "second half never dropped a session", 0);
+    }
+
+    // Remount and read everything back
+    uint32_t before[SESSION_STORE_MAX_SESSIONS];
+    uint32_t count = session_store_list(before, SESSION_STORE_MAX_SESSIONS);
+    t0 = now_s();
+    session_store_init();
+    double mount_ms = (now_s() - t0) * 1000.0;
+
+    uint32_t after[SESSION_STORE_MAX_SESSIONS];
+    uint32_t remounted = session_store_list(after, SESSION_STORE_MAX_SESSIONS);
+    check(remounted == count && memcmp(before, after, count * sizeof(uint32_t)) == 0,
+          "session list changed by remount", 0);
+    count = remounted;
+    check(session_store_latest_id() == sessions, "latest id lost by remount", sessions);
+
+    host_partition_get_stats(LABEL, &flash, true);
+    uint64_t read_bytes = 0;
+    t0 = now_s();
+    for (uint32_t i = 0; i < count; i++) {
+        check(verify_session(after[i], session_seconds(after[i], 5 * 60, 90 * 60), &read_bytes),
+              "stored session differs", after[i]);
+    }
+    double read_s = now_s() - t0;
+    host_partition_get_stats(LABEL, &flash, true);
+
+    printf("#   %lu sessions kept (%lu..%lu), mount %.2f ms\n", (unsigned long)count,
+           (unsigned long)(count > 0 ? after[0] : 0), (unsigned long)(count > 0 ? after[count - 1] : 0),
+           mount_ms);
+    printf("#   read %.1f MB in %d B slices: %.0f MB/s, %.3f flash bytes per sample byte\n",
+           (double)read_bytes / 1e6, READ_SLICE_BYTES, (double)read_bytes / 1e6 / read_s,
+           (double)flash.bytes_read / (double)read_bytes);
+}
+
+// ============================================================================
+// Power cuts
+// ============================================================================
+
+typedef enum { OP_COMMIT, OP_SYNC, OP_DELETE } op_type_t;
+
+typedef struct {
+    op_type_t type;
+    uint32_t session_id;
+} op_t;
+
+static op_t s_ops[SCRIPT_MAX_OPS];
+static int s_op_count = 0;
+
+static uint32_t script_seconds(uint32_t session_id) {
+    return session_seconds(session_id, 5 * 60, 20 * 60);
+}
+
+static void build_script(void) {
+    uint32_t live[SCRIPT_SESSIONS];
+    int live_count = 0;
+    for (uint32_t id = 1; id <= SCRIPT_SESSIONS; id++) {
+        s_ops[s_op_count++] = (op_t){ OP_COMMIT, id };
+        live[live_count++] = id;
+        if (id % 3 == 0) {
+            s_ops[s_op_count++] = (op_t){ OP_SYNC, id - 1 };
+        }
+        if (live_count > SCRIPT_LIVE_SESSIONS) {
+            s_ops[s_op_count++] = (op_t){ OP_DELETE, live[0] };
+            memmove(live, live + 1, (size_t)(--live_count) * sizeof(uint32_t));
+        }
+    }
+}
+
+/**
+ * Run the script until the power goes
+ * @return Index of the operation that was running at the cut (s_op_count if none)
+ */
+static int run_script(void) {
+    host_partition_set_size(LABEL, SCRIPT_SECTORS * 4096);
+    session_store_init();
+    for (int i = 0; i < s_op_count; i++) {
+        const op_t *op = &s_ops[i];
+        switch (op->type) {
+            case OP_COMMIT: write_session(op->session_id, script_seconds(op->session_id)); break;
+            case OP_SYNC:   session_store_set_synced(op->session_id); break;
+            case OP_DELETE: session_store_delete(op->session_id); break;
+        }
+        if (host_partition_power_lost()) {
+            return i;
+        }
+    }
+    return s_op_count;
+}
+
+/**
+ * Remount after a cut during s_ops[cut] and check what survived
+ */
+static void verify_after_cut(int cut) {
+    host_partition_set_power_cut(-1);
+    session_store_init();
+
+    for (uint32_t id = 1; id <= SCRIPT_SESSIONS; id++) {
+        bool committed = false, deleted = false, synced = false;
+        bool in_flight = false, sync_in_flight = false;
+        for (int i = 0; i <= cut && i < s_op_count; i++) {
+            if (s_ops[i].session_id != id) {
+                continue;
+            }
+            if (i == cut) {
+                in_flight = s_ops[i].type != OP_SYNC;
+                sync_in_flight = s_ops[i].type == OP_SYNC;
+            } else if (s_ops[i].type == OP_COMMIT) {
+                committed = true;
+            } else if (s_ops[i].type == OP_DELETE) {
+                deleted = true;
+            } else {
+                synced = true;
+            }
+        }
+
+        bool must_exist = committed && !deleted && !in_flight;
+        bool may_exist = must_exist || in_flight;
+        session_record_t record;
+        bool exists = session_store_get(id, &record) == ESP_OK;
+
+        check(exists || !must_exist, "committed session lost", id);
+        check(!exists || may_exist, "deleted or unwritten session present", id);
+        if (exists) {
+            check(verify_session(id, script_seconds(id), NULL), "session corrupt", id);
+            check(!synced || record.synced, "synced flag lost", id);
+            check(synced || sync_in_flight || !record.synced, "synced flag appeared", id);
+        }
+    }
+
+    // Still usable: a new session survives another remount
+    uint32_t id = session_store_latest_id() + 1;
+    check(write_session(id, 600) == ESP_OK, "commit after cut failed", id);
+    session_store_init();
+    check(verify_session(id, 600, NULL), "session after cut lost", id);
+}
+
+static void run_power_cuts(uint32_t cuts) {
+    build_script();
+
+    // Reference run: how much the script programs
+    host_partition_stats_t flash;
+    host_partition_get_stats(LABEL, &flash, true);
+    run_script();
+    session_store_stats_t stats;
+    session_store_get_stats(&stats);
+    host_partition_get_stats(LABEL, &flash, true);
+    int64_t total = (int64_t)flash.bytes_written + flash.erases;
+    check(stats.gc_runs > 0, "script never ran GC", 0);
+    check(stats.sessions_evicted == 0, "script dropped a session", 0);
+
+    int failures_before = s_failures;
+    uint32_t cuts_in_gc = 0;
+    for (uint32_t i = 0; i < cuts; i++) {
+        int64_t budget = (int64_t)((double)i * (double)total / (double)cuts) + (int64_t)(rng_next() % 13);
+        host_partition_set_power_cut(budget);
+        int cut = run_script();
+        session_store_get_stats(&stats);
+        cuts_in_gc += stats.gc_runs > 0;
+        verify_after_cut(cut);
+    }
+
+    printf("# power cuts: %lu cuts over %lld programmed bytes + erases (%d ops, %lu GC runs in full script), "
+           "%lu after GC started: %s\n",
+           (unsigned long)cuts, (long long)total, s_op_count, (unsigned long)stats.gc_runs,
+           (unsigned long)cuts_in_gc, s_failures == failures_before ? "all consistent" : "FAILED");
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [--sessions N] [--cuts N] [--image PATH]\n", prog);
+}
+
+int main(int argc, char **argv) {
+    uint32_t sessions = 3000;
+    uint32_t cuts = 2000;
+    const char *image = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 < argc && strcmp(argv[i], "--sessions") == 0) {
+            sessions = (uint32_t)atoi(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "--cuts") == 0) {
+            cuts = (uint32_t)atoi(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "--image") == 0) {
+            image = argv[++i];
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (sessions < 2) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    // Dropped sessions are expected here
+    esp_log_level_set("*", ESP_LOG_ERROR);
+
+    if (image != NULL && host_partition_attach_file(LABEL, image) != ESP_OK) {
+        fprintf(stderr, "Cannot map %s\n", image);
+        return 2;
+    }
+
+    const esp_partition_t *partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                                                ESP_PARTITION_SUBTYPE_ANY, LABEL);
+    uint32_t partition_size = partition->size;
+
+    run_capacity();
+    run_power_cuts(cuts);
+    host_partition_set_size(LABEL, partition_size);
+    run_long_use(sessions);
+
+    if (s_failures > 0) {
+        printf("FAIL: %d checks failed\n", s_failures);
+        return 1;
+    }
+    printf("OK: sessions survive GC, remounts and power cuts intact\n");
+    return 0;
+}
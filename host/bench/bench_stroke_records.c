@@ -0,0 +1,402 @@
+/**
+ * @file bench_stroke_records.c
+ * @brief Stroke records: force curves against the model, storage and messages
+ *
+ * Usage: bench_stroke_records
+ *
+ * Rows three simulated workouts (flywheel_sim.c) through the firmware
+ * pipeline (replay_pipeline.c), keeps the latest stroke record after every
+ * stroke the way the broadcast task reads it, and reports per workout the
+ * records, their flash cost, and how the force curves and totals compare
+ * with the model. Checks:
+ *   - one record per stroke, numbered in order, finish times increasing,
+ *     none dropped from the ring
+ *   - the session stores exactly the records published from the stroke
+ *     that started it on, and samples.bin / pages.bin (?records=strokes)
+ *     read them back
+ *   - the distances add up to the session distance, the work of the
+ *     stroke cycles to the model's work over them (within 5%)
+ *   - past the first strokes from rest, every curve correlates with the
+ *     model torque I×α + k×ω² over the same drive (r >= 0.95), and the
+ *     peak torque is within 15% of the model's peak on average (20% worst;
+ *     the flywheel estimator overshoots at the peak)
+ *   - the JSON and binary messages encode the record
+ * Exits with 1 if any check fails.
+ */
+
+#include "replay_pipeline.h"
+#include "sample_codec.h"
+#include "session_manager.h"
+#include "session_samples.h"
+#include "session_store.h"
+#include "stroke_record.h"
+#include "config_manager.h"
+#include "app_config.h"
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "flywheel_sim.h"
+#include "session_download.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_STROKES         1024
+#define MAX_MODEL_POINTS    4096    // Model torque points of one drive
+#define WARMUP_STROKES      5       // Strokes from rest not compared with the model
+#define MIN_CORRELATION     0.95
+#define MAX_PEAK_DIFF       0.15    // Mean over the strokes
+#define MAX_PEAK_DIFF_WORST 0.20
+#define MAX_WORK_DIFF       0.05
+
+typedef struct {
+    const char *name;
+    double spm;
+    double torque;
+    double minutes;
+} workout_t;
+
+static const workout_t s_workouts[] = {
+    { "steady 24 spm", 24.0, 8.0, 6.0 },
+    { "fast 30 spm", 30.0, 8.0, 4.0 },
+    { "easy 18 spm", 18.0, 5.0, 4.0 },
+};
+
+#define NUM_WORKOUTS (sizeof(s_workouts) / sizeof(s_workouts[0]))
+
+typedef struct {
+    int64_t time_us;
+    double torque;
+} model_point_t;
+
+/**
+ * What the workout's strokes looked like, live
+ */
+typedef struct {
+    const flywheel_sim_t *sim;
+    model_point_t points[MAX_MODEL_POINTS];     // Model torque since the last finish
+    uint32_t point_count;
+
+    stroke_record_t records[MAX_STROKES];       // Latest record after each stroke
+    double model_work[MAX_STROKES];             // Model work at each finish (J)
+    double correlation[MAX_STROKES];
+    double model_peak[MAX_STROKES];
+    uint32_t count;
+    uint32_t total_before;                      // stroke_record_latest() before the workout
+    uint32_t total;
+    uint32_t first_session;                     // Index of the stroke that started the session
+    bool session_seen;
+} strokes_t;
+
+static int s_failures = 0;
+
+static void check(bool ok, const char *what) {
+    if (!ok) {
+        printf("FAIL: %s\n", what);
+        s_failures++;
+    }
+}
+
+/**
+ * Model torque at a time (linear between points)
+ */
+static double model_torque(const strokes_t *strokes, double time_us) {
+    const model_point_t *p = strokes->points;
+    uint32_t n = strokes->point_count;
+    if (n == 0) {
+        return 0;
+    }
+    if (time_us <= p[0].time_us) {
+        return p[0].torque;
+    }
+    for (uint32_t i = 1; i < n; i++) {
+        if (time_us <= p[i].time_us) {
+            double f = (time_us - p[i - 1].time_us) / (double)(p[i].time_us - p[i - 1].time_us);
+            return p[i - 1].torque + (p[i].torque - p[i - 1].torque) * f;
+        }
+    }
+    return p[n - 1].torque;
+}
+
+/**
+ * Correlation of a record's curve with the model over the same drive
+ */
+static double curve_correlation(const strokes_t *strokes, const stroke_record_t *record,
+                                int64_t catch_us, int64_t finish_us, double *model_peak) {
+    double x[STROKE_CURVE_POINTS];
+    double y[STROKE_CURVE_POINTS];
+    double mx = 0, my = 0;
+    *model_peak = 0;
+    for (int i = 0; i < STROKE_CURVE_POINTS; i++) {
+        double t = catch_us + (double)(finish_us - catch_us) * i / (STROKE_CURVE_POINTS - 1);
+        x[i] = record->curve[i];
+        y[i] = model_torque(strokes, t);
+        mx += x[i];
+        my += y[i];
+    }
+    for (uint32_t i = 0; i < strokes->point_count; i++) {
+        const model_point_t *p = &strokes->points[i];
+        if (p->time_us >= catch_us && p->time_us <= finish_us && p->torque > *model_peak) {
+            *model_peak = p->torque;
+        }
+    }
+    mx /= STROKE_CURVE_POINTS;
+    my /= STROKE_CURVE_POINTS;
+    double sxy = 0, sxx = 0, syy = 0;
+    for (int i = 0; i < STROKE_CURVE_POINTS; i++) {
+        sxy += (x[i] - mx) * (y[i] - my);
+        sxx += (x[i] - mx) * (x[i] - mx);
+        syy += (y[i] - my) * (y[i] - my);
+    }
+    return sxx > 0 && syy > 0 ? sxy / sqrt(sxx * syy) : 0;
+}
+
+static void on_stroke(void *ctx, const rowing_metrics_t *metrics) {
+    strokes_t *strokes = ctx;
+    stroke_record_t record;
+    uint32_t total = stroke_record_latest(&record);
+    if (total == strokes->total || strokes->count >= MAX_STROKES) {
+        return;
+    }
+    strokes->total = total;
+
+    uint32_t i = strokes->count++;
+    strokes->records[i] = record;
+    strokes->model_work[i] = strokes->sim->work_joules;
+    strokes->correlation[i] = curve_correlation(strokes, &record, metrics->last_stroke_start_time_us,
+                                                metrics->last_stroke_end_time_us, &strokes->model_peak[i]);
+    // A session starts at the metrics tick after its first stroke
+    if (!strokes->session_seen && metrics->session_start_time_us != 0) {
+        strokes->session_seen = true;
+        strokes->first_session = i > 0 ? i - 1 : 0;
+    }
+    strokes->point_count = 0;
+}
+
+/**
+ * Check the JSON and binary messages of a record
+ */
+static void check_messages(const char *name, const stroke_record_t *record) {
+    char what[128];
+    char json[STROKE_RECORD_JSON_SIZE];
+    int len = stroke_record_to_json(record, json, sizeof(json));
+    char expect[64];
+    snprintf(expect, sizeof(expect), "{\"type\":\"stroke\",\"stroke\":%u,", record->stroke);
+    int commas = 0;
+    const char *curve = len > 0 ? strstr(json, "\"curve\":[") : NULL;
+    for (const char *p = curve; p != NULL && *p != '\0'; p++) {
+        commas += *p == ',';
+    }
+    snprintf(what, sizeof(what), "%s: JSON message (%d bytes)", name, len);
+    check(len > 0 && (size_t)len == strlen(json) && strncmp(json, expect, strlen(expect)) == 0 &&
+          curve != NULL && commas == STROKE_CURVE_POINTS - 1 && strcmp(json + len - 2, "]}") == 0, what);
+
+    char small[64];
+    snprintf(what, sizeof(what), "%s: JSON message into a short buffer fails", name);
+    check(stroke_record_to_json(record, small, sizeof(small)) < 0, what);
+
+    uint8_t binary[STROKE_RECORD_BINARY_SIZE];
+    size_t binary_len = stroke_record_to_binary(record, binary);
+    snprintf(what, sizeof(what), "%s: binary message", name);
+    check(binary_len == STROKE_RECORD_BINARY_SIZE && binary[0] == STROKE_RECORD_BINARY_TYPE &&
+          memcmp(binary + 1, record, sizeof(*record)) == 0, what);
+}
+
+/**
+ * Row one workout and check its stroke records
+ */
+static void row_workout(size_t w) {
+    static replay_pipeline_t pipeline;
+    static strokes_t strokes;
+    static stroke_record_t stored[MAX_STROKES];
+    static stroke_record_t from_pages[MAX_STROKES];
+    const workout_t *workout = &s_workouts[w];
+    char what[160];
+
+    flywheel_sim_params_t params;
+    flywheel_sim_default_params(&params);
+    params.spm = workout->spm;
+    params.torque = workout->torque;
+    params.seed = (uint32_t)w + 1;
+
+    config_t config;
+    config_manager_get_defaults(&config);
+    config.moment_of_inertia = (float)params.inertia;
+    config.initial_drag_coefficient = (float)params.drag;
+
+    flywheel_sim_t sim;
+    flywheel_sim_init(&sim, &params);
+
+    memset(&strokes, 0, sizeof(strokes));
+    strokes.sim = &sim;
+    stroke_record_t ignored;
+    strokes.total_before = stroke_record_latest(&ignored);
+    strokes.total = strokes.total_before;
+    pipeline.on_stroke = on_stroke;
+    pipeline.ctx = &strokes;
+    replay_pipeline_init(&pipeline, &config, FLYWHEEL_SIM_START_TIME_US);
+
+    flywheel_sim_event_t event;
+    int64_t last_us = FLYWHEEL_SIM_START_TIME_US;
+    while (flywheel_sim_next(&sim, workout->minutes * 60.0, &event)) {
+        if (event.channel == TRACE_CHANNEL_FLYWHEEL && strokes.point_count < MAX_MODEL_POINTS) {
+            model_point_t *p = &strokes.points[strokes.point_count++];
+            p->time_us = event.timestamp_us;
+            p->torque = params.inertia * event.alpha + params.drag * event.omega * event.omega;
+        }
+        replay_pipeline_event(&pipeline, event.channel, event.timestamp_us);
+        last_us = event.timestamp_us;
+    }
+    replay_pipeline_finish(&pipeline, last_us);
+
+    stroke_record_stats_t ring;
+    stroke_record_get_stats(&ring);
+    uint32_t count = strokes.count;
+    const stroke_record_t *live = strokes.records;
+
+    // Live records: one per stroke, in order
+    bool ordered = count > 0;
+    for (uint32_t i = 1; i < count; i++) {
+        ordered = ordered && live[i].stroke == (uint16_t)(live[i - 1].stroke + 1);
+    }
+    snprintf(what, sizeof(what), "%s: %lu records for %lu strokes, numbered in order", workout->name,
+             (unsigned long)count, (unsigned long)pipeline.metrics.stroke_count);
+    check(ordered && count == pipeline.metrics.stroke_count &&
+          strokes.total - strokes.total_before == count, what);
+
+    // Stored: the session's strokes, as published
+    session_record_t record;
+    uint32_t id = session_manager_get_session_count();
+    snprintf(what, sizeof(what), "%s: session stored", workout->name);
+    check(strokes.session_seen && session_manager_get_session(id, &record) == ESP_OK, what);
+    if (!strokes.session_seen) {
+        return;
+    }
+    uint32_t session_count = count - strokes.first_session;
+    const stroke_record_t *session = live + strokes.first_session;
+    uint32_t stored_records = 0;
+    uint32_t stored_page_bytes = 0;
+    session_manager_get_stroke_size(id, &stored_records, &stored_page_bytes);
+    uint32_t n = 0;
+    session_manager_read_stroke_bytes(id, 0, stored, sizeof(stored), &n);
+    n /= sizeof(stroke_record_t);
+    snprintf(what, sizeof(what), "%s: %lu stored records, %lu published in the session, %lu dropped",
+             workout->name, (unsigned long)stored_records, (unsigned long)session_count,
+             (unsigned long)ring.dropped);
+    check(stored_records == session_count && n == session_count && ring.dropped == 0 &&
+          ring.records == session_count &&
+          memcmp(stored, session, session_count * sizeof(stroke_record_t)) == 0, what);
+
+    bool increasing = true;
+    for (uint32_t i = 1; i < session_count; i++) {
+        uint32_t a = session[i - 1].finish_ms | ((uint32_t)session[i - 1].finish_ms_high << 16);
+        uint32_t b = session[i].finish_ms | ((uint32_t)session[i].finish_ms_high << 16);
+        increasing = increasing && b > a;
+    }
+    snprintf(what, sizeof(what), "%s: finish times increase", workout->name);
+    check(increasing, what);
+
+    // Downloads
+    session_samples_doc_t doc;
+    session_samples_header_t header;
+    uint8_t *records = session_samples_open_strokes(id, false, &doc) == ESP_OK ?
+                       session_download_read(&doc, &header) : NULL;
+    snprintf(what, sizeof(what), "%s: samples.bin?records=strokes", workout->name);
+    check(records != NULL && header.sample_count == session_count && header.sample_size == sizeof(stroke_record_t) &&
+          header.sample_interval_ms == SESSION_SAMPLES_INTERVAL_STROKE &&
+          header.data_bytes == session_count * sizeof(stroke_record_t) &&
+          memcmp(records, session, header.data_bytes) == 0, what);
+    uint8_t *pages = session_samples_open_strokes(id, true, &doc) == ESP_OK ?
+                     session_download_read(&doc, &header) : NULL;
+    uint32_t decoded = pages != NULL ? session_download_decode_pages(&sample_codec_layout_strokes, pages,
+                                                                     header.data_bytes, from_pages, MAX_STROKES,
+                                                                     NULL) : 0;
+    snprintf(what, sizeof(what), "%s: pages.bin?records=strokes decodes to the records", workout->name);
+    check(pages != NULL && header.data_bytes == stored_page_bytes && decoded == session_count &&
+          memcmp(from_pages, session, session_count * sizeof(stroke_record_t)) == 0, what);
+    free(records);
+    free(pages);
+
+    // Totals: distance of the session, work of the cycles against the model
+    double distance = 0;
+    double work = 0;
+    for (uint32_t i = 0; i < session_count; i++) {
+        distance += session[i].distance_cm / 100.0;
+    }
+    for (uint32_t i = 1; i < count; i++) {
+        work += live[i].work_dj / 10.0;
+    }
+    double model_work = strokes.model_work[count - 1] - strokes.model_work[0];
+    snprintf(what, sizeof(what), "%s: distance %.1f m of %.1f m", workout->name, distance,
+             record.total_distance_meters);
+    check(fabs(distance - record.total_distance_meters) <= 0.01 * record.total_distance_meters + 1.0, what);
+    snprintf(what, sizeof(what), "%s: work %.0f J, model %.0f J", workout->name, work, model_work);
+    check(fabs(work - model_work) <= MAX_WORK_DIFF * model_work, what);
+
+    // Curves against the model, once the flywheel is up to speed and the
+    // drag estimate settled
+    double min_r = 1.0;
+    double sum_r = 0;
+    double sum_peak_diff = 0;
+    double max_peak_diff = 0;
+    double drive_ms = 0;
+    double recovery_ms = 0;
+    uint32_t compared = 0;
+    for (uint32_t i = WARMUP_STROKES; i < count; i++) {
+        double peak = live[i].peak_torque_cnm / 100.0;
+        double peak_diff = fabs(peak - strokes.model_peak[i]) / strokes.model_peak[i];
+        min_r = fmin(min_r, strokes.correlation[i]);
+        sum_r += strokes.correlation[i];
+        sum_peak_diff += peak_diff;
+        max_peak_diff = fmax(max_peak_diff, peak_diff);
+        drive_ms += live[i].drive_ms;
+        recovery_ms += live[i].recovery_ms;
+        compared++;
+    }
+    if (compared == 0) {
+        compared = 1;
+    }
+    snprintf(what, sizeof(what), "%s: curve correlation %.3f (lowest)", workout->name, min_r);
+    check(min_r >= MIN_CORRELATION, what);
+    snprintf(what, sizeof(what), "%s: peak torque off by %.1f%% (mean), %.1f%% (worst)", workout->name,
+             100.0 * sum_peak_diff / compared, 100.0 * max_peak_diff);
+    check(sum_peak_diff / compared <= MAX_PEAK_DIFF && max_peak_diff <= MAX_PEAK_DIFF_WORST, what);
+
+    check_messages(workout->name, &session[session_count - 1]);
+
+    printf("  %-14s %7lu %7lu %8.1f %8.1f %7.0f %7.0f %7.3f %7.1f\n", workout->name,
+           (unsigned long)session_count, (unsigned long)stored_page_bytes,
+           session_count > 0 ? 8.0 * stored_page_bytes / session_count : 0.0,
+           stored_page_bytes / (record.duration_seconds / 60.0),
+           drive_ms / compared, recovery_ms / compared, sum_r / compared, 100.0 * sum_peak_diff / compared);
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s\n", prog);
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    esp_log_level_set("*", ESP_LOG_ERROR);
+    host_partition_reset(SESSION_STORE_PARTITION_LABEL);
+
+    printf("# %u-byte records, %d curve points; pages as stored\n", (unsigned)sizeof(stroke_record_t),
+           STROKE_CURVE_POINTS);
+    printf("  %-14s %7s %7s %8s %8s %7s %7s %7s %7s\n", "workout", "strokes", "bytes", "bits/rec", "B/min",
+           "drive", "recov", "curve_r", "peak_%");
+    for (size_t w = 0; w < NUM_WORKOUTS; w++) {
+        row_workout(w);
+    }
+
+    if (s_failures > 0) {
+        printf("FAIL: %d check(s) failed\n", s_failures);
+        return 1;
+    }
+    printf("OK: every stroke recorded, stored and encoded; curves follow the model\n");
+    return 0;
+}
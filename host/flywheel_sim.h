@@ -0,0 +1,75 @@
+/**
+ * @file flywheel_sim.h
+ * @brief Simple rowing flywheel model producing sensor events
+ *
+ * Integrates I*dω/dt = τ_drive(t) - k*ω² with a half-sine drive torque once
+ * per stroke, emits a flywheel event each time the wheel turns one magnet
+ * spacing (subject to the same debounce as the ISR), and a seat event in
+ * the middle of every drive. The model's ω, α and the work done by the
+ * drive torque are exposed so tools can compare the firmware against them.
+ * Output is deterministic for a given seed.
+ */
+
+#ifndef FLYWHEEL_SIM_H
+#define FLYWHEEL_SIM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "trace_format.h"
+
+// Integration step
+#define FLYWHEEL_SIM_DT_S           20e-6
+
+// Arbitrary but fixed virtual start time (like esp_timer a few seconds after boot)
+#define FLYWHEEL_SIM_START_TIME_US  5000000LL
+
+typedef struct {
+    double spm;             // Stroke rate
+    double torque;          // Peak drive torque (N*m)
+    double drive_s;         // Drive duration (s)
+    double inertia;         // Moment of inertia (kg*m²)
+    double drag;            // Drag coefficient k
+    int magnets;            // Magnets per revolution
+    int jitter_us;          // Max timestamp jitter (±µs)
+    uint32_t seed;          // Jitter seed
+} flywheel_sim_params_t;
+
+typedef struct {
+    trace_channel_t channel;
+    int64_t timestamp_us;   // Measured (jittered) event time
+    double omega;           // Model ω at the true event time (rad/s)
+    double alpha;           // Model α at the true event time (rad/s²)
+} flywheel_sim_event_t;
+
+typedef struct {
+    flywheel_sim_params_t params;
+    long step;
+    double omega;
+    double angle;
+    long seat_stroke;
+    int64_t last_event_us;
+    int64_t last_flywheel_us;
+    uint32_t rng;
+
+    long debounced;                 // Flywheel pulses lost to the debounce
+    double work_joules;             // Work done by the drive torque so far
+    double model_distance_m;        // ∛(k / 2.80) × flywheel angle turned so far
+} flywheel_sim_t;
+
+/**
+ * Defaults matching trace_synth (24 spm, 8 N*m, firmware I and k)
+ */
+void flywheel_sim_default_params(flywheel_sim_params_t *params);
+
+void flywheel_sim_init(flywheel_sim_t *sim, const flywheel_sim_params_t *params);
+
+/**
+ * Advance the model to the next sensor event
+ * @param sim Simulation state
+ * @param duration_s Stop after this much model time
+ * @param event Output: next event
+ * @return false once duration_s is reached
+ */
+bool flywheel_sim_next(flywheel_sim_t *sim, double duration_s, flywheel_sim_event_t *event);
+
+#endif // FLYWHEEL_SIM_H
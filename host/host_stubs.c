@@ -0,0 +1,27 @@
+/**
+ * @file host_stubs.c
+ * @brief Host stand-ins for firmware modules that are not part of the host build
+ *
+ * The pipeline sources call into the web server, WiFi and BLE modules for
+ * a handful of status queries. On the host those subsystems do not exist,
+ * so each query returns the "not present" answer.
+ */
+
+#include "ble_hr_client.h"
+#include "web_server.h"
+#include "wifi_manager.h"
+
+// web_server.c: inertia calibration is never active during replay
+bool web_server_is_calibrating_inertia(void) {
+    return false;
+}
+
+// wifi_manager.c: no SNTP on the host, sessions fall back to uptime timestamps
+int64_t wifi_manager_get_unix_time_ms(void) {
+    return 0;
+}
+
+// ble_hr_client.c
+ble_hr_state_t ble_hr_client_get_state(void) {
+    return BLE_HR_STATE_IDLE;
+}
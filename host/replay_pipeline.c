@@ -0,0 +1,201 @@
+/**
+ * @file replay_pipeline.c
+ * @brief Drives the firmware physics/stroke/session pipeline from a pulse trace
+ *
+ * Mirrors sensor_manager.c (per-event processing, and the idle check and
+ * 10 Hz recording done on every sensor task wake-up), main.c
+ * metrics_update_task (100ms tick that feeds the session sampler),
+ * including their metrics update/publish sections, and the session
+ * storage task (a flush every SESSION_FLUSH_INTERVAL_MS).
+ * Inertia calibration is never active during replay.
+ */
+
+#include "replay_pipeline.h"
+#include "app_config.h"
+#include "esp_timer.h"
+#include "hr_receiver.h"
+#include "metrics_calculator.h"
+#include "rowing_clock.h"
+#include "session_detail.h"
+#include "stroke_record.h"
+#include "session_manager.h"
+#include "stroke_detector.h"
+
+#include <string.h>
+
+// Pipeline time: timestamp of the event or tick being processed
+static int64_t s_now_us = 0;
+
+static int64_t replay_clock_now(void) {
+    return s_now_us;
+}
+
+/**
+ * Move pipeline time (esp_timer follows so log lines carry trace time)
+ */
+static void set_time(int64_t time_us) {
+    s_now_us = time_us;
+    host_timer_set_time(time_us);
+}
+
+/**
+ * Sensor task housekeeping after a wake-up (idle check + elapsed time)
+ */
+static void sensor_wakeup(replay_pipeline_t *pipeline) {
+    rowing_metrics_t *metrics = &pipeline->metrics;
+    int64_t now = rowing_clock_now_us();
+    int64_t time_since_last_pulse = now - pipeline->last_flywheel_time_us;
+
+    if (time_since_last_pulse > (IDLE_TIMEOUT_MS * 1000LL)) {
+        if (metrics->is_active) {
+            metrics->is_active = false;
+            metrics->current_phase = STROKE_PHASE_IDLE;
+        }
+    } else if (pipeline->flywheel_pulses > 0) {
+        metrics->is_active = true;
+    }
+
+    rowing_physics_update_elapsed_time(metrics);
+    session_detail_update(metrics);
+}
+
+/**
+ * One metrics_update_task iteration
+ */
+static void metrics_tick(replay_pipeline_t *pipeline) {
+    rowing_metrics_t *metrics = &pipeline->metrics;
+
+    metrics_calculator_begin_update();
+    metrics_calculator_update(metrics, &pipeline->config);
+    rowing_physics_calculate_calories(metrics, pipeline->config.user_weight_kg);
+    session_manager_check_activity(metrics, &pipeline->config);
+    metrics_calculator_end_update(metrics);
+
+    if (session_manager_get_current_session_id() > 0) {
+        rowing_metrics_t snapshot;
+        metrics_calculator_get_snapshot(&snapshot);
+        session_manager_record_sample(&snapshot, hr_receiver_get_current());
+    }
+
+    pipeline->tick_count++;
+    if (pipeline->tick_count % REPLAY_TICKS_PER_SECOND == 0 && pipeline->on_second != NULL) {
+        pipeline->on_second(pipeline->ctx, pipeline->tick_count / REPLAY_TICKS_PER_SECOND, metrics);
+    }
+
+    // Storage task wake-up
+    if (pipeline->tick_count % (SESSION_FLUSH_INTERVAL_MS * 1000 / REPLAY_TICK_US) == 0) {
+        session_manager_flush();
+    }
+}
+
+/**
+ * Scheduling delay of the next tick, uniform in [0, tick_jitter_us]
+ * (a fixed LCG, so jittered replays are repeatable too)
+ */
+static uint32_t next_delay(replay_pipeline_t *pipeline) {
+    if (pipeline->tick_jitter_us == 0) {
+        return 0;
+    }
+    pipeline->jitter_state = pipeline->jitter_state * 1664525u + 1013904223u;
+    return (uint32_t)(((uint64_t)(pipeline->jitter_state >> 8) * (pipeline->tick_jitter_us + 1)) >> 24);
+}
+
+/**
+ * When the next tick runs: vTaskDelayUntil keeps the 100ms schedule, a late
+ * wake-up delays only that tick (but never before the previous one)
+ */
+static int64_t tick_time(const replay_pipeline_t *pipeline) {
+    int64_t time_us = pipeline->next_tick_us + pipeline->tick_delay_us;
+    return time_us > pipeline->last_tick_us ? time_us : pipeline->last_tick_us;
+}
+
+void replay_pipeline_init(replay_pipeline_t *pipeline, const config_t *config, int64_t start_time_us) {
+    static bool modules_initialized = false;
+
+    uint32_t tick_jitter_us = pipeline->tick_jitter_us;
+    replay_stroke_cb_t on_stroke = pipeline->on_stroke;
+    replay_second_cb_t on_second = pipeline->on_second;
+    void *ctx = pipeline->ctx;
+
+    memset(pipeline, 0, sizeof(*pipeline));
+    pipeline->config = *config;
+    pipeline->on_stroke = on_stroke;
+    pipeline->on_second = on_second;
+    pipeline->ctx = ctx;
+    pipeline->start_time_us = start_time_us;
+    pipeline->next_tick_us = start_time_us + REPLAY_TICK_US;
+    pipeline->tick_jitter_us = tick_jitter_us;
+    pipeline->jitter_state = 1;
+
+    rowing_clock_set_source(replay_clock_now);
+    set_time(start_time_us);
+
+    // Buffers are allocated once; later pipelines reuse them
+    if (!modules_initialized) {
+        session_manager_init();
+        hr_receiver_init();
+        modules_initialized = true;
+    }
+
+    metrics_calculator_init(&pipeline->metrics, &pipeline->config);
+    stroke_detector_init(&pipeline->config);
+}
+
+void replay_pipeline_advance(replay_pipeline_t *pipeline, int64_t time_us) {
+    while (tick_time(pipeline) <= time_us) {
+        pipeline->last_tick_us = tick_time(pipeline);
+        set_time(pipeline->last_tick_us);
+        metrics_calculator_begin_update();
+        sensor_wakeup(pipeline);    // Sensor task wait times out every 100ms
+        metrics_calculator_end_update(&pipeline->metrics);
+        metrics_tick(pipeline);
+        pipeline->next_tick_us += REPLAY_TICK_US;
+        pipeline->tick_delay_us = next_delay(pipeline);
+    }
+}
+
+void replay_pipeline_event(replay_pipeline_t *pipeline, trace_channel_t channel, int64_t timestamp_us) {
+    rowing_metrics_t *metrics = &pipeline->metrics;
+
+    replay_pipeline_advance(pipeline, timestamp_us);
+    set_time(timestamp_us);
+
+    metrics_calculator_begin_update();
+    if (channel == TRACE_CHANNEL_FLYWHEEL) {
+        pipeline->flywheel_pulses++;
+        pipeline->last_flywheel_time_us = timestamp_us;
+        rowing_physics_process_flywheel_pulse(metrics, timestamp_us);
+        stroke_record_on_pulse(metrics, stroke_detector_update(metrics));
+        session_detail_on_pulse(metrics, timestamp_us);
+        metrics_calculator_publish(metrics);
+    } else {
+        stroke_record_on_seat(metrics, stroke_detector_process_seat_trigger(metrics, timestamp_us));
+    }
+
+    sensor_wakeup(pipeline);
+    metrics_calculator_end_update(metrics);
+    pipeline->events++;
+
+    if (metrics->stroke_count != pipeline->last_stroke_count) {
+        pipeline->last_stroke_count = metrics->stroke_count;
+        if (pipeline->on_stroke != NULL) {
+            pipeline->on_stroke(pipeline->ctx, metrics);
+        }
+    }
+}
+
+void replay_pipeline_finish(replay_pipeline_t *pipeline, int64_t end_time_us) {
+    // Let idle detection and auto-pause fire as they would on the device
+    int64_t settle_ms = IDLE_TIMEOUT_MS;
+    if ((int64_t)pipeline->config.auto_pause_seconds * 1000 > settle_ms) {
+        settle_ms = (int64_t)pipeline->config.auto_pause_seconds * 1000;
+    }
+    replay_pipeline_advance(pipeline, end_time_us + (settle_ms + 1000) * 1000);
+
+    if (session_manager_get_current_session_id() > 0) {
+        metrics_calculator_begin_update();
+        session_manager_end_session(&pipeline->metrics);
+        metrics_calculator_end_update(&pipeline->metrics);
+    }
+    session_manager_flush();
+}
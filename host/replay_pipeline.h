@@ -0,0 +1,87 @@
+/**
+ * @file replay_pipeline.h
+ * @brief Drives the firmware physics/stroke/session pipeline from a pulse trace
+ *
+ * Reproduces what the sensor task and metrics task do on the device, but on
+ * the virtual clock: each event sets the time to its ISR timestamp, and the
+ * 100ms metrics tick runs at exact multiples of 100ms since the trace start
+ * (plus a pseudo-random scheduling delay if tick_jitter_us is set).
+ *
+ * The firmware modules keep their state in file-scope statics, so only one
+ * pipeline can be active per process.
+ */
+
+#ifndef REPLAY_PIPELINE_H
+#define REPLAY_PIPELINE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "rowing_physics.h"
+#include "trace_format.h"
+
+// Metrics task period on the device (main.c)
+#define REPLAY_TICK_US              100000
+
+// Metrics ticks per second of trace time (on_second callback)
+#define REPLAY_TICKS_PER_SECOND     10
+
+typedef struct replay_pipeline replay_pipeline_t;
+
+/**
+ * Called after a stroke completes (stroke_count incremented)
+ */
+typedef void (*replay_stroke_cb_t)(void *ctx, const rowing_metrics_t *metrics);
+
+/**
+ * Called after every tenth metrics tick
+ */
+typedef void (*replay_second_cb_t)(void *ctx, uint32_t second, const rowing_metrics_t *metrics);
+
+struct replay_pipeline {
+    rowing_metrics_t metrics;
+    config_t config;
+
+    int64_t start_time_us;              // Trace start (virtual time origin)
+    int64_t next_tick_us;               // Next metrics tick (on schedule)
+    int64_t last_tick_us;               // When the last tick ran
+    uint32_t tick_delay_us;             // Scheduling delay of the next tick
+    uint32_t tick_jitter_us;            // Largest scheduling delay (set before init, kept)
+    uint32_t jitter_state;
+    uint32_t tick_count;                // Metrics ticks run
+    uint32_t flywheel_pulses;           // Mirrors sensor_manager's ISR counter
+    int64_t last_flywheel_time_us;      // Mirrors sensor_manager's ISR timestamp
+    uint32_t last_stroke_count;
+    uint64_t events;                    // Events processed
+
+    replay_stroke_cb_t on_stroke;
+    replay_second_cb_t on_second;
+    void *ctx;
+};
+
+/**
+ * Initialize the pipeline (resets all firmware module state)
+ * @param pipeline Pipeline to initialize
+ * @param config Configuration (copied)
+ * @param start_time_us Virtual time of the first metrics tick
+ */
+void replay_pipeline_init(replay_pipeline_t *pipeline, const config_t *config, int64_t start_time_us);
+
+/**
+ * Feed one sensor event (timestamps must be non-decreasing)
+ * Runs any metrics ticks due before the event first.
+ */
+void replay_pipeline_event(replay_pipeline_t *pipeline, trace_channel_t channel, int64_t timestamp_us);
+
+/**
+ * Run metrics ticks up to (and including) the given time
+ */
+void replay_pipeline_advance(replay_pipeline_t *pipeline, int64_t time_us);
+
+/**
+ * Advance past the idle/auto-pause timeouts and end the session
+ * @param pipeline Pipeline
+ * @param end_time_us Time of the last event
+ */
+void replay_pipeline_finish(replay_pipeline_t *pipeline, int64_t end_time_us);
+
+#endif // REPLAY_PIPELINE_H
@@ -0,0 +1,55 @@
+/**
+ * @file session_download.c
+ * @brief Host helpers: read a session download and decode its pages
+ */
+
+#include "session_download.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+uint8_t *session_download_read(const session_samples_doc_t *doc, session_samples_header_t *header) {
+    uint32_t size = session_samples_size(doc);
+    uint8_t *data = malloc(size);
+    if (data == NULL) {
+        return NULL;
+    }
+    uint32_t offset = 0;
+    while (offset < size) {
+        uint32_t want = size - offset < SESSION_DOWNLOAD_CHUNK_BYTES ? size - offset : SESSION_DOWNLOAD_CHUNK_BYTES;
+        uint32_t got = 0;
+        if (session_samples_read(doc, offset, data + offset, want, &got) != ESP_OK || got == 0) {
+            break;
+        }
+        offset += got;
+    }
+    memcpy(header, data, sizeof(*header));
+    if (offset != size) {
+        free(data);
+        return NULL;
+    }
+    memmove(data, data + sizeof(*header), size - sizeof(*header));
+    return data;
+}
+
+uint32_t session_download_decode_pages(const sample_codec_layout_t *layout, const uint8_t *data, uint32_t bytes,
+                                       void *out, uint32_t max_records, uint32_t *pages) {
+    uint32_t pos = 0;
+    uint32_t records = 0;
+    uint32_t count = 0;
+    while (pos < bytes) {
+        uint32_t n = sample_codec_decode_records(layout, data + pos, bytes - pos,
+                                                 (uint8_t *)out + records * layout->record_size,
+                                                 max_records - records);
+        if (n == 0) {
+            return UINT32_MAX;
+        }
+        pos += (uint32_t)(data[pos] | (data[pos + 1] << 8));
+        records += n;
+        count++;
+    }
+    if (pages != NULL) {
+        *pages = count;
+    }
+    return records;
+}
@@ -0,0 +1,39 @@
+/**
+ * @file session_download.h
+ * @brief Host helpers: read a session download and decode its pages
+ *
+ * Reads a samples.bin / pages.bin document (session_samples.h) in the web
+ * server's chunk size, and decodes the sample_codec pages of a pages.bin
+ * back into records, for the benchmarks that check stored sessions.
+ */
+
+#ifndef SESSION_DOWNLOAD_H
+#define SESSION_DOWNLOAD_H
+
+#include <stdint.h>
+#include "sample_codec.h"
+#include "session_samples.h"
+
+// Read size per call, like the web server's chunks
+#define SESSION_DOWNLOAD_CHUNK_BYTES    1024
+
+/**
+ * Read a whole download, the way the handler sends it
+ * @param doc Opened with session_samples_open() or session_samples_open_strokes()
+ * @param header Out: the download header
+ * @return The bytes after the header (free() them), or NULL if a read failed
+ */
+uint8_t *session_download_read(const session_samples_doc_t *doc, session_samples_header_t *header);
+
+/**
+ * Decode consecutive pages (sample_codec format) into records
+ * @param layout Layout the pages were encoded with
+ * @param out Output records (layout->record_size bytes each)
+ * @param max_records Capacity of out
+ * @param pages Out: number of pages (may be NULL)
+ * @return Records decoded, or UINT32_MAX if a page is corrupt
+ */
+uint32_t session_download_decode_pages(const sample_codec_layout_t *layout, const uint8_t *data, uint32_t bytes,
+                                       void *out, uint32_t max_records, uint32_t *pages);
+
+#endif // SESSION_DOWNLOAD_H
@@ -0,0 +1,12 @@
+/**
+ * @file esp_http_server.h
+ * @brief Host shim: opaque HTTP server types referenced by web_server.h
+ */
+
+#ifndef HOST_ESP_HTTP_SERVER_H
+#define HOST_ESP_HTTP_SERVER_H
+
+typedef void *httpd_handle_t;
+typedef struct httpd_req httpd_req_t;
+
+#endif // HOST_ESP_HTTP_SERVER_H
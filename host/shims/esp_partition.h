@@ -0,0 +1,93 @@
+/**
+ * @file esp_partition.h
+ * @brief Host shim for flash partitions (NOR flash emulated in memory or a file)
+ *
+ * The data partitions of partitions.csv exist with their real sizes and
+ * start out erased, in memory unless host_partition_attach_file() maps a
+ * file over one so its contents outlive the process. Writes can only clear bits (the image is ANDed with the
+ * data, as on NOR flash) and erases must cover whole 4 KB sectors.
+ *
+ * For crash tests, host_partition_set_power_cut() lets a budget of bytes be
+ * programmed (an erase costs one) and silently drops everything after. The
+ * last write is cut part-way through; an erase hit by the cut only clears
+ * the first half of its sector.
+ */
+
+#ifndef HOST_ESP_PARTITION_H
+#define HOST_ESP_PARTITION_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#define SPI_FLASH_SEC_SIZE          4096
+
+typedef enum {
+    ESP_PARTITION_TYPE_APP = 0x00,
+    ESP_PARTITION_TYPE_DATA = 0x01,
+    ESP_PARTITION_TYPE_ANY = 0xff,
+} esp_partition_type_t;
+
+typedef enum {
+    ESP_PARTITION_SUBTYPE_DATA_NVS = 0x02,
+    ESP_PARTITION_SUBTYPE_DATA_SPIFFS = 0x82,
+    ESP_PARTITION_SUBTYPE_ANY = 0xff,
+} esp_partition_subtype_t;
+
+typedef struct {
+    esp_partition_type_t type;
+    uint8_t subtype;
+    uint32_t address;
+    uint32_t size;
+    uint32_t erase_size;
+    char label[17];
+} esp_partition_t;
+
+/**
+ * Flash activity on a partition
+ */
+typedef struct {
+    uint64_t bytes_written;
+    uint64_t bytes_read;
+    uint32_t erases;
+} host_partition_stats_t;
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+                                                const char *label);
+esp_err_t esp_partition_read(const esp_partition_t *partition, size_t src_offset, void *dst, size_t size);
+esp_err_t esp_partition_write(const esp_partition_t *partition, size_t dst_offset, const void *src, size_t size);
+esp_err_t esp_partition_erase_range(const esp_partition_t *partition, size_t offset, size_t size);
+
+/**
+ * Erase a whole partition image (not counted in the stats)
+ */
+esp_err_t host_partition_reset(const char *label);
+
+/**
+ * Shrink a partition (at most its partitions.csv size), e.g. to make a store
+ * collect garbage sooner. Erases the image.
+ */
+esp_err_t host_partition_set_size(const char *label, uint32_t size);
+
+/**
+ * Back a partition with a file (created erased, or kept if it exists)
+ */
+esp_err_t host_partition_attach_file(const char *label, const char *path);
+
+/**
+ * Cut power after this many more programmed bytes (-1 = never)
+ */
+void host_partition_set_power_cut(int64_t bytes);
+
+/**
+ * Whether the power cut has happened
+ */
+bool host_partition_power_lost(void);
+
+/**
+ * Get and clear the flash activity counters of a partition
+ */
+void host_partition_get_stats(const char *label, host_partition_stats_t *stats, bool reset);
+
+#endif // HOST_ESP_PARTITION_H
@@ -0,0 +1,16 @@
+/**
+ * @file esp_rom_crc.h
+ * @brief Host shim for the ROM CRC32 (same polynomial and chaining as the ROM)
+ */
+
+#ifndef HOST_ESP_ROM_CRC_H
+#define HOST_ESP_ROM_CRC_H
+
+#include <stdint.h>
+
+/**
+ * CRC32 (IEEE 802.3, reflected). Pass the previous result to continue.
+ */
+uint32_t esp_rom_crc32_le(uint32_t crc, uint8_t const *buf, uint32_t len);
+
+#endif // HOST_ESP_ROM_CRC_H
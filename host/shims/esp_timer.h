@@ -0,0 +1,26 @@
+/**
+ * @file esp_timer.h
+ * @brief Host shim for esp_timer backed by a virtual clock
+ *
+ * Time only moves when the host driver calls host_timer_set_time(), so
+ * replays run as fast as the CPU allows and are fully deterministic.
+ */
+
+#ifndef HOST_ESP_TIMER_H
+#define HOST_ESP_TIMER_H
+
+#include <stdint.h>
+
+/**
+ * Get current virtual time
+ * @return Microseconds
+ */
+int64_t esp_timer_get_time(void);
+
+/**
+ * Set virtual time (host only)
+ * @param time_us New time in microseconds
+ */
+void host_timer_set_time(int64_t time_us);
+
+#endif // HOST_ESP_TIMER_H
@@ -0,0 +1,19 @@
+/**
+ * @file esp_wifi_types.h
+ * @brief Host shim: WiFi types referenced by wifi_manager.h
+ */
+
+#ifndef HOST_ESP_WIFI_TYPES_H
+#define HOST_ESP_WIFI_TYPES_H
+
+#include <stdint.h>
+
+typedef struct {
+    uint8_t bssid[6];
+    uint8_t ssid[33];
+    uint8_t primary;
+    int8_t rssi;
+    int authmode;
+} wifi_ap_record_t;
+
+#endif // HOST_ESP_WIFI_TYPES_H
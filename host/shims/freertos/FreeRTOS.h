@@ -0,0 +1,43 @@
+/**
+ * @file FreeRTOS.h
+ * @brief Host shim for the FreeRTOS base types
+ *
+ * The host build is single-threaded per pipeline instance; synchronization
+ * primitives map onto pthreads so shared code stays correct if a host tool
+ * does use threads.
+ */
+
+#ifndef HOST_FREERTOS_H
+#define HOST_FREERTOS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+// Pulled in transitively by the ESP-IDF FreeRTOS port headers
+#include "esp_heap_caps.h"
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdFALSE                 0
+#define pdTRUE                  1
+#define pdPASS                  pdTRUE
+#define pdFAIL                  pdFALSE
+
+#define portMAX_DELAY           ((TickType_t)0xFFFFFFFFu)
+#define portTICK_PERIOD_MS      1
+#define configTICK_RATE_HZ      1000
+
+#define pdMS_TO_TICKS(ms)       ((TickType_t)(ms))
+
+// Critical sections (portmacro.h): each spinlock is a pthread mutex
+typedef pthread_mutex_t portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED    PTHREAD_MUTEX_INITIALIZER
+#define portENTER_CRITICAL(mux)         pthread_mutex_lock(mux)
+#define portEXIT_CRITICAL(mux)          pthread_mutex_unlock(mux)
+
+#endif // HOST_FREERTOS_H
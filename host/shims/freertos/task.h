@@ -0,0 +1,46 @@
+/**
+ * @file task.h
+ * @brief Host shim for FreeRTOS task helpers
+ *
+ * Tick count follows the virtual esp_timer clock; delays advance nothing
+ * (the host driver owns time).
+ */
+
+#ifndef HOST_FREERTOS_TASK_H
+#define HOST_FREERTOS_TASK_H
+
+#include "freertos/FreeRTOS.h"
+
+typedef void *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+TickType_t xTaskGetTickCount(void);
+
+static inline void vTaskDelay(TickType_t ticks) {
+    (void)ticks;
+}
+
+// Host tools run no background tasks; they call the work functions themselves
+static inline BaseType_t xTaskCreate(TaskFunction_t function, const char *name, uint32_t stack_depth,
+                                     void *parameters, UBaseType_t priority, TaskHandle_t *handle) {
+    (void)function;
+    (void)name;
+    (void)stack_depth;
+    (void)parameters;
+    (void)priority;
+    (void)handle;
+    return pdFAIL;
+}
+
+static inline uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks) {
+    (void)clear_on_exit;
+    (void)ticks;
+    return 0;
+}
+
+static inline BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    (void)task;
+    return pdPASS;
+}
+
+#endif // HOST_FREERTOS_TASK_H
@@ -0,0 +1,598 @@
+/**
+ * @file host_shims.c
+ * @brief Host implementations of the ESP-IDF / FreeRTOS shims
+ */
+
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+#include "esp_timer.h"
+#include "nvs.h"
+#include "nvs_flash.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// ============================================================================
+// Errors
+// ============================================================================
+
+const char *esp_err_to_name(esp_err_t code) {
+    switch (code) {
+        case ESP_OK:                        return "ESP_OK";
+        case ESP_FAIL:                      return "ESP_FAIL";
+        case ESP_ERR_NO_MEM:                return "ESP_ERR_NO_MEM";
+        case ESP_ERR_INVALID_ARG:           return "ESP_ERR_INVALID_ARG";
+        case ESP_ERR_INVALID_STATE:         return "ESP_ERR_INVALID_STATE";
+        case ESP_ERR_INVALID_SIZE:          return "ESP_ERR_INVALID_SIZE";
+        case ESP_ERR_NOT_FOUND:             return "ESP_ERR_NOT_FOUND";
+        case ESP_ERR_NOT_SUPPORTED:         return "ESP_ERR_NOT_SUPPORTED";
+        case ESP_ERR_TIMEOUT:               return "ESP_ERR_TIMEOUT";
+        case ESP_ERR_INVALID_CRC:           return "ESP_ERR_INVALID_CRC";
+        case ESP_ERR_INVALID_VERSION:       return "ESP_ERR_INVALID_VERSION";
+        case ESP_ERR_NOT_FINISHED:          return "ESP_ERR_NOT_FINISHED";
+        case ESP_ERR_NVS_NOT_INITIALIZED:   return "ESP_ERR_NVS_NOT_INITIALIZED";
+        case ESP_ERR_NVS_NOT_FOUND:         return "ESP_ERR_NVS_NOT_FOUND";
+        case ESP_ERR_NVS_INVALID_HANDLE:    return "ESP_ERR_NVS_INVALID_HANDLE";
+        case ESP_ERR_NVS_INVALID_LENGTH:    return "ESP_ERR_NVS_INVALID_LENGTH";
+        case ESP_ERR_NVS_NO_FREE_PAGES:     return "ESP_ERR_NVS_NO_FREE_PAGES";
+        case ESP_ERR_NVS_NEW_VERSION_FOUND: return "ESP_ERR_NVS_NEW_VERSION_FOUND";
+        default:                            return "UNKNOWN_ERROR";
+    }
+}
+
+void host_esp_error_check_failed(esp_err_t rc, const char *file, int line, const char *expression) {
+    fprintf(stderr, "ESP_ERROR_CHECK failed: %s (0x%x) at %s:%d\nexpression: %s\n",
+            esp_err_to_name(rc), rc, file, line, expression);
+    abort();
+}
+
+// ============================================================================
+// Logging
+// ============================================================================
+
+static esp_log_level_t s_log_level = ESP_LOG_WARN;
+
+void esp_log_level_set(const char *tag, esp_log_level_t level) {
+    (void)tag;
+    s_log_level = level;
+}
+
+void host_log_write(esp_log_level_t level, const char *tag, const char *format, ...) {
+    static const char letters[] = "NEWIDV";
+
+    if (level > s_log_level) {
+        return;
+    }
+
+    va_list args;
+    va_start(args, format);
+    fprintf(stderr, "%c (%lld) %s: ", letters[level],
+            (long long)(esp_timer_get_time() / 1000), tag);
+    vfprintf(stderr, format, args);
+    fputc('\n', stderr);
+    va_end(args);
+}
+
+// ============================================================================
+// Virtual time
+// ============================================================================
+
+static int64_t s_time_us = 0;
+
+int64_t esp_timer_get_time(void) {
+    return s_time_us;
+}
+
+void host_timer_set_time(int64_t time_us) {
+    s_time_us = time_us;
+}
+
+TickType_t xTaskGetTickCount(void) {
+    return (TickType_t)(s_time_us / 1000);
+}
+
+// ============================================================================
+// Mutexes
+// ============================================================================
+
+struct host_semaphore {
+    pthread_mutex_t mutex;
+};
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void) {
+    SemaphoreHandle_t sem = malloc(sizeof(*sem));
+    if (sem != NULL) {
+        pthread_mutex_init(&sem->mutex, NULL);
+    }
+    return sem;
+}
+
+// Polling takes (zero timeout) fail at once; any other timeout waits forever
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks_to_wait) {
+    if (ticks_to_wait == 0) {
+        return pthread_mutex_trylock(&semaphore->mutex) == 0 ? pdTRUE : pdFALSE;
+    }
+    return pthread_mutex_lock(&semaphore->mutex) == 0 ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore) {
+    return pthread_mutex_unlock(&semaphore->mutex) == 0 ? pdTRUE : pdFALSE;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t semaphore) {
+    if (semaphore != NULL) {
+        pthread_mutex_destroy(&semaphore->mutex);
+        free(semaphore);
+    }
+}
+
+// ============================================================================
+// NVS (in memory)
+// ============================================================================
+
+#define HOST_NVS_MAX_NAMESPACES     8
+#define HOST_NVS_KEY_MAX_LEN        16
+
+typedef struct host_nvs_entry {
+    char key[HOST_NVS_KEY_MAX_LEN];
+    void *data;
+    size_t length;
+    struct host_nvs_entry *next;
+} host_nvs_entry_t;
+
+typedef struct {
+    char name[HOST_NVS_KEY_MAX_LEN];
+    host_nvs_entry_t *entries;
+} host_nvs_namespace_t;
+
+static host_nvs_namespace_t s_namespaces[HOST_NVS_MAX_NAMESPACES];
+
+static host_nvs_namespace_t *nvs_namespace_from_handle(nvs_handle_t handle) {
+    if (handle == 0 || handle > HOST_NVS_MAX_NAMESPACES || s_namespaces[handle - 1].name[0] == '\0') {
+        return NULL;
+    }
+    return &s_namespaces[handle - 1];
+}
+
+static host_nvs_entry_t *nvs_find(host_nvs_namespace_t *ns, const char *key) {
+    for (host_nvs_entry_t *entry = ns->entries; entry != NULL; entry = entry->next) {
+        if (strcmp(entry->key, key) == 0) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+static esp_err_t nvs_set(nvs_handle_t handle, const char *key, const void *value, size_t length) {
+    host_nvs_namespace_t *ns = nvs_namespace_from_handle(handle);
+    if (ns == NULL) {
+        return ESP_ERR_NVS_INVALID_HANDLE;
+    }
+    if (strlen(key) >= HOST_NVS_KEY_MAX_LEN) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    host_nvs_entry_t *entry = nvs_find(ns, key);
+    if (entry == NULL) {
+        entry = calloc(1, sizeof(*entry));
+        if (entry == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+        strcpy(entry->key, key);
+        entry->next = ns->entries;
+        ns->entries = entry;
+    }
+
+    void *data = malloc(length > 0 ? length : 1);
+    if (data == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    memcpy(data, value, length);
+    free(entry->data);
+    entry->data = data;
+    entry->length = length;
+    return ESP_OK;
+}
+
+static esp_err_t nvs_get_fixed(nvs_handle_t handle, const char *key, void *out, size_t length) {
+    host_nvs_namespace_t *ns = nvs_namespace_from_handle(handle);
+    if (ns == NULL) {
+        return ESP_ERR_NVS_INVALID_HANDLE;
+    }
+    host_nvs_entry_t *entry = nvs_find(ns, key);
+    if (entry == NULL) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    if (entry->length != length) {
+        return ESP_ERR_NVS_INVALID_LENGTH;
+    }
+    memcpy(out, entry->data, length);
+    return ESP_OK;
+}
+
+static esp_err_t nvs_get_variable(nvs_handle_t handle, const char *key, void *out, size_t *length) {
+    host_nvs_namespace_t *ns = nvs_namespace_from_handle(handle);
+    if (ns == NULL) {
+        return ESP_ERR_NVS_INVALID_HANDLE;
+    }
+    host_nvs_entry_t *entry = nvs_find(ns, key);
+    if (entry == NULL) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    if (out == NULL) {
+        *length = entry->length;
+        return ESP_OK;
+    }
+    if (*length < entry->length) {
+        return ESP_ERR_NVS_INVALID_LENGTH;
+    }
+    memcpy(out, entry->data, entry->length);
+    *length = entry->length;
+    return ESP_OK;
+}
+
+esp_err_t nvs_flash_init(void) {
+    return ESP_OK;
+}
+
+esp_err_t nvs_flash_erase(void) {
+    for (int i = 0; i < HOST_NVS_MAX_NAMESPACES; i++) {
+        nvs_handle_t handle = (nvs_handle_t)(i + 1);
+        if (nvs_namespace_from_handle(handle) != NULL) {
+            nvs_erase_all(handle);
+        }
+        s_namespaces[i].name[0] = '\0';
+    }
+    return ESP_OK;
+}
+
+esp_err_t nvs_open(const char *namespace_name, nvs_open_mode_t open_mode, nvs_handle_t *out_handle) {
+    int free_slot = -1;
+
+    for (int i = 0; i < HOST_NVS_MAX_NAMESPACES; i++) {
+        if (s_namespaces[i].name[0] == '\0') {
+            if (free_slot < 0) {
+                free_slot = i;
+            }
+        } else if (strcmp(s_namespaces[i].name, namespace_name) == 0) {
+            *out_handle = (nvs_handle_t)(i + 1);
+            return ESP_OK;
+        }
+    }
+
+    if (open_mode == NVS_READONLY) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    if (free_slot < 0 || strlen(namespace_name) >= HOST_NVS_KEY_MAX_LEN) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    strcpy(s_namespaces[free_slot].name, namespace_name);
+    *out_handle = (nvs_handle_t)(free_slot + 1);
+    return ESP_OK;
+}
+
+void nvs_close(nvs_handle_t handle) {
+    (void)handle;
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle) {
+    return nvs_namespace_from_handle(handle) != NULL ? ESP_OK : ESP_ERR_NVS_INVALID_HANDLE;
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char *key) {
+    host_nvs_namespace_t *ns = nvs_namespace_from_handle(handle);
+    if (ns == NULL) {
+        return ESP_ERR_NVS_INVALID_HANDLE;
+    }
+    for (host_nvs_entry_t **link = &ns->entries; *link != NULL; link = &(*link)->next) {
+        if (strcmp((*link)->key, key) == 0) {
+            host_nvs_entry_t *entry = *link;
+            *link = entry->next;
+            free(entry->data);
+            free(entry);
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NVS_NOT_FOUND;
+}
+
+esp_err_t nvs_erase_all(nvs_handle_t handle) {
+    host_nvs_namespace_t *ns = nvs_namespace_from_handle(handle);
+    if (ns == NULL) {
+        return ESP_ERR_NVS_INVALID_HANDLE;
+    }
+    while (ns->entries != NULL) {
+        host_nvs_entry_t *entry = ns->entries;
+        ns->entries = entry->next;
+        free(entry->data);
+        free(entry);
+    }
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_u8(nvs_handle_t handle, const char *key, uint8_t value) {
+    return nvs_set(handle, key, &value, sizeof(value));
+}
+
+esp_err_t nvs_get_u8(nvs_handle_t handle, const char *key, uint8_t *out_value) {
+    return nvs_get_fixed(handle, key, out_value, sizeof(*out_value));
+}
+
+esp_err_t nvs_set_u16(nvs_handle_t handle, const char *key, uint16_t value) {
+    return nvs_set(handle, key, &value, sizeof(value));
+}
+
+esp_err_t nvs_get_u16(nvs_handle_t handle, const char *key, uint16_t *out_value) {
+    return nvs_get_fixed(handle, key, out_value, sizeof(*out_value));
+}
+
+esp_err_t nvs_set_u32(nvs_handle_t handle, const char *key, uint32_t value) {
+    return nvs_set(handle, key, &value, sizeof(value));
+}
+
+esp_err_t nvs_get_u32(nvs_handle_t handle, const char *key, uint32_t *out_value) {
+    return nvs_get_fixed(handle, key, out_value, sizeof(*out_value));
+}
+
+esp_err_t nvs_set_i32(nvs_handle_t handle, const char *key, int32_t value) {
+    return nvs_set(handle, key, &value, sizeof(value));
+}
+
+esp_err_t nvs_get_i32(nvs_handle_t handle, const char *key, int32_t *out_value) {
+    return nvs_get_fixed(handle, key, out_value, sizeof(*out_value));
+}
+
+esp_err_t nvs_set_str(nvs_handle_t handle, const char *key, const char *value) {
+    return nvs_set(handle, key, value, strlen(value) + 1);
+}
+
+esp_err_t nvs_get_str(nvs_handle_t handle, const char *key, char *out_value, size_t *length) {
+    return nvs_get_variable(handle, key, out_value, length);
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length) {
+    return nvs_set(handle, key, value, length);
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *out_value, size_t *length) {
+    return nvs_get_variable(handle, key, out_value, length);
+}
+
+// ============================================================================
+// Flash partitions (NOR semantics, in memory or in a mapped file)
+// ============================================================================
+
+typedef struct {
+    esp_partition_t partition;
+    uint8_t *image;
+    uint32_t capacity;              // Size of the image (partitions.csv size)
+    bool mapped;                    // Image is a mapped file
+    host_partition_stats_t stats;
+} host_partition_t;
+
+// Data partitions of partitions.csv
+static host_partition_t s_partitions[] = {
+    { { ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_NVS, 0x9000, 0x6000, SPI_FLASH_SEC_SIZE, "nvs" } },
+    { { ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_SPIFFS, 0x310000, 0xF0000, SPI_FLASH_SEC_SIZE, "storage" } },
+    { { ESP_PARTITION_TYPE_DATA, 0x40, 0x400000, 0x100000, SPI_FLASH_SEC_SIZE, "trace" } },
+};
+
+#define HOST_PARTITION_COUNT    (sizeof(s_partitions) / sizeof(s_partitions[0]))
+
+static int64_t s_power_budget = -1;
+
+static host_partition_t *partition_by_label(const char *label) {
+    for (size_t i = 0; i < HOST_PARTITION_COUNT; i++) {
+        if (strcmp(s_partitions[i].partition.label, label) == 0) {
+            return &s_partitions[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Image of a partition, allocated erased on first use
+ */
+static host_partition_t *partition_image(const esp_partition_t *partition) {
+    host_partition_t *hp = (host_partition_t *)partition;
+    if (hp->capacity == 0) {
+        hp->capacity = hp->partition.size;
+    }
+    if (hp->image == NULL) {
+        hp->image = malloc(hp->capacity);
+        if (hp->image != NULL) {
+            memset(hp->image, 0xFF, hp->capacity);
+        }
+    }
+    return hp->image != NULL ? hp : NULL;
+}
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+                                                const char *label) {
+    for (size_t i = 0; i < HOST_PARTITION_COUNT; i++) {
+        const esp_partition_t *p = &s_partitions[i].partition;
+        if ((type == ESP_PARTITION_TYPE_ANY || p->type == type) &&
+            (subtype == ESP_PARTITION_SUBTYPE_ANY || p->subtype == subtype) &&
+            (label == NULL || strcmp(p->label, label) == 0)) {
+            return p;
+        }
+    }
+    return NULL;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *partition, size_t src_offset, void *dst, size_t size) {
+    host_partition_t *hp = partition_image(partition);
+    if (hp == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    if (src_offset > partition->size || size > partition->size - src_offset) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memcpy(dst, hp->image + src_offset, size);
+    hp->stats.bytes_read += size;
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t *partition, size_t dst_offset, const void *src, size_t size) {
+    host_partition_t *hp = partition_image(partition);
+    if (hp == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    if (dst_offset > partition->size || size > partition->size - dst_offset) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (s_power_budget >= 0 && (int64_t)size > s_power_budget) {
+        size = (size_t)s_power_budget;
+    }
+    const uint8_t *bytes = src;
+    for (size_t i = 0; i < size; i++) {
+        hp->image[dst_offset + i] &= bytes[i];
+    }
+    if (s_power_budget >= 0) {
+        s_power_budget -= (int64_t)size;
+    }
+    hp->stats.bytes_written += size;
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *partition, size_t offset, size_t size) {
+    host_partition_t *hp = partition_image(partition);
+    if (hp == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    if (offset % SPI_FLASH_SEC_SIZE != 0 || size % SPI_FLASH_SEC_SIZE != 0 ||
+        offset > partition->size || size > partition->size - offset) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_power_budget == 0) {
+        return ESP_OK;
+    }
+    if (s_power_budget > 0) {
+        s_power_budget--;
+        if (s_power_budget == 0) {
+            // Interrupted erase
+            memset(hp->image + offset, 0xFF, SPI_FLASH_SEC_SIZE / 2);
+            return ESP_OK;
+        }
+    }
+    memset(hp->image + offset, 0xFF, size);
+    hp->stats.erases += (uint32_t)(size / SPI_FLASH_SEC_SIZE);
+    return ESP_OK;
+}
+
+esp_err_t host_partition_reset(const char *label) {
+    host_partition_t *hp = partition_by_label(label);
+    if (hp == NULL || partition_image(&hp->partition) == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    memset(hp->image, 0xFF, hp->partition.size);
+    return ESP_OK;
+}
+
+esp_err_t host_partition_set_size(const char *label, uint32_t size) {
+    host_partition_t *hp = partition_by_label(label);
+    if (hp == NULL || partition_image(&hp->partition) == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (size == 0 || size > hp->capacity || size % SPI_FLASH_SEC_SIZE != 0) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    hp->partition.size = size;
+    memset(hp->image, 0xFF, hp->capacity);
+    return ESP_OK;
+}
+
+esp_err_t host_partition_attach_file(const char *label, const char *path) {
+    host_partition_t *hp = partition_by_label(label);
+    if (hp == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (hp->capacity == 0) {
+        hp->capacity = hp->partition.size;
+    }
+
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        return ESP_FAIL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return ESP_FAIL;
+    }
+    // Grow a new or short file with erased bytes
+    uint8_t erased[SPI_FLASH_SEC_SIZE];
+    memset(erased, 0xFF, sizeof(erased));
+    for (off_t size = st.st_size; size < (off_t)hp->capacity; size += SPI_FLASH_SEC_SIZE) {
+        size_t chunk = (size_t)((off_t)hp->capacity - size);
+        if (chunk > sizeof(erased)) {
+            chunk = sizeof(erased);
+        }
+        if (pwrite(fd, erased, chunk, size) != (ssize_t)chunk) {
+            close(fd);
+            return ESP_FAIL;
+        }
+    }
+    uint8_t *image = mmap(NULL, hp->capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (image == MAP_FAILED) {
+        return ESP_FAIL;
+    }
+
+    if (hp->mapped) {
+        munmap(hp->image, hp->capacity);
+    } else {
+        free(hp->image);
+    }
+    hp->image = image;
+    hp->mapped = true;
+    return ESP_OK;
+}
+
+void host_partition_set_power_cut(int64_t bytes) {
+    s_power_budget = bytes;
+}
+
+bool host_partition_power_lost(void) {
+    return s_power_budget == 0;
+}
+
+void host_partition_get_stats(const char *label, host_partition_stats_t *stats, bool reset) {
+    host_partition_t *hp = partition_by_label(label);
+    if (hp == NULL) {
+        memset(stats, 0, sizeof(*stats));
+        return;
+    }
+    *stats = hp->stats;
+    if (reset) {
+        memset(&hp->stats, 0, sizeof(hp->stats));
+    }
+}
+
+// ============================================================================
+// ROM CRC32
+// ============================================================================
+
+uint32_t esp_rom_crc32_le(uint32_t crc, uint8_t const *buf, uint32_t len) {
+    crc = ~crc;
+    for (uint32_t i = 0; i < len; i++) {
+        crc ^= buf[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+        }
+    }
+    return ~crc;
+}
@@ -0,0 +1,332 @@
+/**
+ * @file row_replay.c
+ * @brief Replay a raw pulse trace through the firmware pipeline
+ *
+ * Usage: row_replay [options] trace.rwt
+ *
+ * Prints one CSV line per completed stroke ("stroke,...") and per second of
+ * trace time ("second,...") on stdout, followed by a "#"-prefixed session
+ * summary. stdout depends only on the trace and options, so two runs can be
+ * diffed; wall-clock replay speed is reported on stderr.
+ *
+ * --repeat N replays the trace N times in one process and fails if the final
+ * metrics of any run differ bit-for-bit from the first.
+ *
+ * The "# sampler" lines report how the recorded rows line up with the
+ * session clock: rows against elapsed seconds (drift), the delay of each
+ * second's boundary to the metrics tick that closed it (jitter), and the
+ * rows' distance against the session total. For comparison, "tick_rows"
+ * counts the rows the former every-tenth-tick recorder would have written.
+ * --tick-jitter delays each metrics tick by up to the given time.
+ */
+
+#include "replay_pipeline.h"
+#include "app_config.h"
+#include "config_manager.h"
+#include "esp_log.h"
+#include "rowing_physics.h"
+#include "session_manager.h"
+#include "stroke_detector.h"
+#include "trace_format.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+typedef struct {
+    bool print_strokes;
+    bool print_seconds;
+    double trace_start_s;
+} output_options_t;
+
+// Rows of the former recorder: every tenth tick while running, not paused
+static uint32_t s_tick_rows = 0;
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "Usage: %s [options] trace.rwt\n"
+            "  --strokes         print per-stroke lines only\n"
+            "  --seconds         print per-second lines only\n"
+            "  -q                print the summary only\n"
+            "  --repeat <n>      replay n times and verify bit-identical results\n"
+            "  --inertia <I>     override moment of inertia (kg*m^2)\n"
+            "  --drag <k>        override initial drag coefficient\n"
+            "  --tick-jitter <ms> delay each metrics tick by 0..ms (repeatable)\n"
+            "  -v, -vv           log pipeline info / debug messages to stderr\n",
+            prog);
+}
+
+/**
+ * Read a whole file into memory
+ */
+static uint8_t *read_file(const char *path, size_t *size) {
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        return NULL;
+    }
+
+    fseek(f, 0, SEEK_END);
+    long len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    uint8_t *data = len > 0 ? malloc((size_t)len) : NULL;
+    if (data != NULL && fread(data, 1, (size_t)len, f) != (size_t)len) {
+        free(data);
+        data = NULL;
+    }
+    fclose(f);
+
+    *size = data != NULL ? (size_t)len : 0;
+    return data;
+}
+
+/**
+ * Feed all events of a trace through the pipeline
+ * @return Timestamp of the last event
+ */
+static int64_t replay_trace(replay_pipeline_t *pipeline, const config_t *config,
+                            const trace_header_t *header, const uint8_t *data, size_t data_bytes) {
+    replay_pipeline_init(pipeline, config, header->start_time_us);
+    s_tick_rows = 0;
+
+    int64_t timestamp = header->start_time_us;
+    size_t pos = 0;
+    while (pos < data_bytes) {
+        int64_t delta;
+        trace_channel_t channel;
+        size_t used = trace_decode_event(&data[pos], data_bytes - pos, &delta, &channel);
+        if (used == 0) {
+            fprintf(stderr, "warning: truncated event at data offset %lu\n", (unsigned long)pos);
+            break;
+        }
+        pos += used;
+        timestamp += delta;
+        replay_pipeline_event(pipeline, channel, timestamp);
+    }
+
+    replay_pipeline_finish(pipeline, timestamp);
+    return timestamp;
+}
+
+static void print_stroke(void *ctx, const rowing_metrics_t *m) {
+    const output_options_t *opts = ctx;
+    if (!opts->print_strokes) {
+        return;
+    }
+    double t = (double)m->last_stroke_end_time_us / 1e6 - opts->trace_start_s;
+    printf("stroke,%lu,%.3f,%.1f,%lu,%lu,%.1f,%.1f,%.1f,%.6f\n",
+           (unsigned long)m->stroke_count, t, m->stroke_rate_spm,
+           (unsigned long)m->drive_phase_duration_ms,
+           (unsigned long)m->recovery_phase_duration_ms,
+           m->display_power_watts, m->total_distance_meters,
+           m->drag_factor, m->drag_coefficient);
+}
+
+static void print_second(void *ctx, uint32_t second, const rowing_metrics_t *m) {
+    const output_options_t *opts = ctx;
+    if (session_manager_get_current_session_id() > 0 && !m->is_paused) {
+        s_tick_rows++;
+    }
+    if (!opts->print_seconds) {
+        return;
+    }
+    printf("second,%lu,%.1f,%.1f,%.1f,%.1f,%.1f,%lu,%lu,%s\n",
+           (unsigned long)second, m->elapsed_time_ms / 1000.0,
+           m->total_distance_meters, m->instantaneous_pace_sec_500m,
+           m->instantaneous_power_watts, m->stroke_rate_spm,
+           (unsigned long)m->stroke_count, (unsigned long)m->total_calories,
+           stroke_detector_phase_to_string(m->current_phase));
+}
+
+/**
+ * Jitter and drift of the last session's rows
+ */
+static void print_sampler_report(const session_record_t *record) {
+    session_sampler_stats_t stats;
+    session_manager_get_sampler_stats(&stats);
+
+    // Sum the stored rows
+    static sample_data_t rows[256];
+    uint64_t distance_dm = 0;
+    uint64_t energy_j = 0;
+    uint32_t count = 0;
+    uint32_t got;
+    while (session_manager_read_samples(record->session_id, count, rows, 256, &got) == ESP_OK && got > 0) {
+        for (uint32_t i = 0; i < got; i++) {
+            distance_dm += rows[i].distance_dm;
+            energy_j += rows[i].power_watts;
+        }
+        count += got;
+    }
+
+    uint32_t elapsed_s = stats.elapsed_ms / SESSION_SAMPLER_BUCKET_MS;
+    uint32_t whole_rows = stats.rows - (stats.elapsed_ms % SESSION_SAMPLER_BUCKET_MS != 0);
+    printf("# sampler rows=%lu elapsed_s=%.3f drift_rows=%ld tick_rows=%lu tick_drift_rows=%ld\n",
+           (unsigned long)stats.rows, stats.elapsed_ms / 1000.0,
+           (long)whole_rows - (long)elapsed_s, (unsigned long)s_tick_rows,
+           (long)s_tick_rows - (long)elapsed_s);
+    printf("# sampler lag_ms_avg=%.1f lag_ms_max=%lu filled_rows=%lu max_interval_ms=%lu updates=%lu held=%lu held_distance_m=%.1f\n",
+           stats.rows > 0 ? (double)stats.lag_sum_ms / stats.rows : 0.0,
+           (unsigned long)stats.max_lag_ms, (unsigned long)stats.filled_rows,
+           (unsigned long)stats.max_interval_ms, (unsigned long)stats.updates,
+           (unsigned long)stats.held_updates, stats.held_distance_m);
+    printf("# sampler stored=%lu row_distance_m=%.1f session_distance_m=%.1f row_energy_kj=%.1f\n",
+           (unsigned long)count, distance_dm / 10.0, record->total_distance_meters, energy_j / 1000.0);
+}
+
+int main(int argc, char **argv) {
+    output_options_t opts = { .print_strokes = true, .print_seconds = true };
+    const char *path = NULL;
+    float inertia_override = 0;
+    float drag_override = 0;
+    esp_log_level_t log_level = ESP_LOG_WARN;
+    int repeat = 1;
+    uint32_t tick_jitter_ms = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--strokes") == 0) {
+            opts.print_seconds = false;
+        } else if (strcmp(argv[i], "--seconds") == 0) {
+            opts.print_strokes = false;
+        } else if (strcmp(argv[i], "-q") == 0) {
+            opts.print_strokes = false;
+            opts.print_seconds = false;
+        } else if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) {
+            repeat = atoi(argv[++i]);
+            if (repeat < 1) {
+                repeat = 1;
+            }
+        } else if (strcmp(argv[i], "--inertia") == 0 && i + 1 < argc) {
+            inertia_override = strtof(argv[++i], NULL);
+        } else if (strcmp(argv[i], "--drag") == 0 && i + 1 < argc) {
+            drag_override = strtof(argv[++i], NULL);
+        } else if (strcmp(argv[i], "--tick-jitter") == 0 && i + 1 < argc) {
+            tick_jitter_ms = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-v") == 0) {
+            log_level = ESP_LOG_INFO;
+        } else if (strcmp(argv[i], "-vv") == 0) {
+            log_level = ESP_LOG_DEBUG;
+        } else if (argv[i][0] == '-' || path != NULL) {
+            usage(argv[0]);
+            return 2;
+        } else {
+            path = argv[i];
+        }
+    }
+
+    if (path == NULL) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    esp_log_level_set("*", log_level);
+
+    size_t file_size;
+    uint8_t *file = read_file(path, &file_size);
+    if (file == NULL) {
+        fprintf(stderr, "Cannot read %s\n", path);
+        return 1;
+    }
+
+    trace_header_t header;
+    if (file_size < sizeof(header)) {
+        fprintf(stderr, "%s: too short for a trace header\n", path);
+        return 1;
+    }
+    memcpy(&header, file, sizeof(header));
+    if (memcmp(header.magic, TRACE_MAGIC, 4) != 0 || header.version != TRACE_FORMAT_VERSION ||
+        header.header_size < sizeof(header) || header.header_size > file_size) {
+        fprintf(stderr, "%s: not a version %d trace\n", path, TRACE_FORMAT_VERSION);
+        return 1;
+    }
+
+    size_t data_bytes = file_size - header.header_size;
+    if (header.data_bytes != TRACE_UNFINISHED) {
+        if (header.data_bytes > data_bytes) {
+            fprintf(stderr, "warning: trace truncated (%lu of %lu data bytes)\n",
+                    (unsigned long)data_bytes, (unsigned long)header.data_bytes);
+        } else {
+            data_bytes = header.data_bytes;
+        }
+    } else {
+        fprintf(stderr, "warning: trace was not finalized, replaying all data\n");
+    }
+
+    // Replay with the magnet count the trace was recorded with
+    if (header.magnets_per_rev > 0) {
+        rowing_physics_set_magnets_per_rev(header.magnets_per_rev);
+    }
+
+    config_t config;
+    config_manager_get_defaults(&config);
+    config.moment_of_inertia = inertia_override > 0 ? inertia_override : header.moment_of_inertia;
+    config.initial_drag_coefficient = drag_override > 0 ? drag_override : header.drag_coefficient;
+
+    static replay_pipeline_t pipeline;
+    pipeline.on_stroke = print_stroke;
+    pipeline.on_second = print_second;
+    pipeline.ctx = &opts;
+    pipeline.tick_jitter_us = tick_jitter_ms * 1000;
+    opts.trace_start_s = (double)header.start_time_us / 1e6;
+
+    if (opts.print_strokes) {
+        printf("# stroke,n,t_s,spm,drive_ms,recovery_ms,power_w,distance_m,drag_factor,k\n");
+    }
+    if (opts.print_seconds) {
+        printf("# second,n,elapsed_s,distance_m,pace_s500m,power_w,spm,strokes,kcal,phase\n");
+    }
+
+    struct timespec wall_start, wall_end;
+    clock_gettime(CLOCK_MONOTONIC, &wall_start);
+
+    const uint8_t *data = file + header.header_size;
+    int64_t timestamp = replay_trace(&pipeline, &config, &header, data, data_bytes);
+    rowing_metrics_t first_run = pipeline.metrics;
+    int mismatches = 0;
+
+    // Later runs are silent and only checked against the first
+    for (int run = 1; run < repeat; run++) {
+        output_options_t quiet = opts;
+        quiet.print_strokes = false;
+        quiet.print_seconds = false;
+        pipeline.ctx = &quiet;
+        replay_trace(&pipeline, &config, &header, data, data_bytes);
+        if (memcmp(&first_run, &pipeline.metrics, sizeof(first_run)) != 0) {
+            fprintf(stderr, "error: run %d differs from run 1\n", run + 1);
+            mismatches++;
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &wall_end);
+
+    const rowing_metrics_t *m = &pipeline.metrics;
+    double trace_s = (double)(timestamp - header.start_time_us) / 1e6;
+    double wall_s = (double)(wall_end.tv_sec - wall_start.tv_sec) +
+                    (double)(wall_end.tv_nsec - wall_start.tv_nsec) / 1e9;
+
+    printf("# events=%llu trace_s=%.1f\n", (unsigned long long)pipeline.events, trace_s);
+    printf("# strokes=%lu distance_m=%.1f avg_power_w=%.1f avg_pace_s500m=%.1f kcal=%lu drag_factor=%.1f\n",
+           (unsigned long)m->stroke_count, m->total_distance_meters,
+           m->average_power_watts, m->average_pace_sec_500m,
+           (unsigned long)m->total_calories, m->drag_factor);
+
+    // What the device would have stored for this workout
+    session_record_t record;
+    uint32_t session_id = session_manager_get_session_count();
+    if (session_id > 0 && session_manager_get_session(session_id, &record) == ESP_OK) {
+        printf("# session=%lu duration_s=%lu distance_m=%.1f strokes=%lu avg_spm=%.1f samples=%lu\n",
+               (unsigned long)record.session_id, (unsigned long)record.duration_seconds,
+               record.total_distance_meters, (unsigned long)record.stroke_count,
+               record.average_stroke_rate, (unsigned long)record.sample_count);
+        print_sampler_report(&record);
+    } else {
+        printf("# session=none\n");
+    }
+
+    fprintf(stderr, "replayed %.1f s of trace %d time(s) in %.3f s (%.0fx real time)\n",
+            trace_s, repeat, wall_s, wall_s > 0 ? trace_s * repeat / wall_s : 0.0);
+
+    free(file);
+    return mismatches > 0 ? 1 : 0;
+}
@@ -0,0 +1,123 @@
+/**
+ * @file trace_synth.c
+ * @brief Generate a synthetic pulse trace from a simple flywheel model
+ *
+ * Usage: trace_synth [options] out.rwt
+ *
+ * Writes the sensor events of the flywheel model in flywheel_sim.c as a
+ * finished trace file.
+ */
+
+#include "app_config.h"
+#include "flywheel_sim.h"
+#include "trace_format.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "Usage: %s [options] out.rwt\n"
+            "  --minutes <m>     rowing time (default 10)\n"
+            "  --spm <r>         stroke rate (default 24)\n"
+            "  --torque <N*m>    peak drive torque (default 8)\n"
+            "  --drive <s>       drive duration (default 0.8)\n"
+            "  --inertia <I>     moment of inertia (default %.3f)\n"
+            "  --drag <k>        drag coefficient (default %.6f)\n"
+            "  --magnets <n>     magnets per revolution (default %d)\n"
+            "  --jitter <us>     max timestamp jitter (default 0)\n"
+            "  --seed <n>        jitter seed (default 1)\n",
+            prog, DEFAULT_MOMENT_OF_INERTIA, DEFAULT_DRAG_COEFFICIENT, DEFAULT_MAGNETS_PER_REV);
+}
+
+int main(int argc, char **argv) {
+    double minutes = 10.0;
+    flywheel_sim_params_t params;
+    flywheel_sim_default_params(&params);
+    const char *path = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 < argc && strcmp(argv[i], "--minutes") == 0) {
+            minutes = atof(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "--spm") == 0) {
+            params.spm = atof(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "--torque") == 0) {
+            params.torque = atof(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "--drive") == 0) {
+            params.drive_s = atof(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "--inertia") == 0) {
+            params.inertia = atof(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "--drag") == 0) {
+            params.drag = atof(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "--magnets") == 0) {
+            params.magnets = atoi(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "--jitter") == 0) {
+            params.jitter_us = atoi(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "--seed") == 0) {
+            params.seed = (uint32_t)strtoul(argv[++i], NULL, 0);
+        } else if (argv[i][0] == '-' || path != NULL) {
+            usage(argv[0]);
+            return 2;
+        } else {
+            path = argv[i];
+        }
+    }
+
+    if (path == NULL || params.spm <= 0 || params.drive_s <= 0 ||
+        params.drive_s >= 60.0 / params.spm || params.inertia <= 0 ||
+        params.magnets < 1 || params.magnets > 255) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    FILE *out = fopen(path, "wb");
+    if (out == NULL) {
+        fprintf(stderr, "Cannot write %s\n", path);
+        return 1;
+    }
+
+    trace_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, TRACE_MAGIC, 4);
+    header.version = TRACE_FORMAT_VERSION;
+    header.header_size = sizeof(header);
+    header.magnets_per_rev = (uint8_t)params.magnets;
+    header.moment_of_inertia = (float)params.inertia;
+    header.drag_coefficient = (float)params.drag;
+    strncpy(header.firmware_version, "synth", sizeof(header.firmware_version) - 1);
+    header.start_time_us = FLYWHEEL_SIM_START_TIME_US;
+    fwrite(&header, sizeof(header), 1, out);
+
+    const double duration_s = minutes * 60.0;
+
+    flywheel_sim_t sim;
+    flywheel_sim_init(&sim, &params);
+    flywheel_sim_event_t event;
+    int64_t last_event_us = FLYWHEEL_SIM_START_TIME_US;
+    uint32_t event_count = 0;
+    uint32_t data_bytes = 0;
+
+    while (flywheel_sim_next(&sim, duration_s, &event)) {
+        uint8_t encoded[TRACE_MAX_EVENT_BYTES];
+        size_t len = trace_encode_event(encoded, event.timestamp_us - last_event_us, event.channel);
+        fwrite(encoded, 1, len, out);
+        last_event_us = event.timestamp_us;
+        event_count++;
+        data_bytes += (uint32_t)len;
+    }
+
+    header.event_count = event_count;
+    header.data_bytes = data_bytes;
+    fseek(out, 0, SEEK_SET);
+    fwrite(&header, sizeof(header), 1, out);
+    fclose(out);
+
+    if (sim.debounced > 0) {
+        fprintf(stderr, "warning: %ld flywheel pulses fell inside the %d us debounce\n",
+                sim.debounced, FLYWHEEL_DEBOUNCE_US);
+    }
+    fprintf(stderr, "wrote %lu events (%lu bytes) covering %.1f s to %s\n",
+            (unsigned long)event_count, (unsigned long)data_bytes, duration_s, path);
+    return 0;
+}
@@ -53,6 +53,11 @@
 // Maximum expected flywheel frequency (Hz)
 #define MAX_FLYWHEEL_FREQ_HZ    200     // Very fast rowing limit
 
+// ISR -> sensor task pulse rings (power of two, see pulse_ring.h)
+// 64 slots hold 320ms of pulses at MAX_FLYWHEEL_FREQ_HZ before overflowing
+#define FLYWHEEL_PULSE_RING_SIZE    64
+#define SEAT_PULSE_RING_SIZE        16
+
 // ============================================================================
 // PHYSICS CONSTANTS
 // ============================================================================
@@ -66,6 +71,20 @@
 #define DEFAULT_DISTANCE_PER_REV    2.8f        // meters per flywheel revolution
 #define DEFAULT_MAGNETS_PER_REV     4           // Number of magnets on flywheel (1-16)
 
+// Flywheel speed/acceleration are fitted over the last N pulses (3-32).
+// Larger windows smooth more but react slower; ~1.5 revolutions works well.
+#define FLYWHEEL_REGRESSION_WINDOW  6
+
+// Drag estimate: weight kept by past recoveries each time one is added
+// (memory of about 1 / (1 - λ) strokes), and the confidence at which the
+// drag calibration counts as complete
+#define DRAG_FORGETTING_FACTOR      0.85f
+#define DRAG_CALIBRATED_CONFIDENCE  0.8f
+
+// Current pace is the distance covered over this trailing window
+#define PACE_WINDOW_MS              10000   // ~4 strokes at 24 spm
+#define PACE_WINDOW_RESOLUTION_MS   250     // Spacing of stored distance points
+
 // ============================================================================
 // STROKE DETECTION THRESHOLDS
 // ============================================================================
@@ -113,6 +132,10 @@
 // ============================================================================
 #define WEB_SERVER_PORT                 80
 #define WS_BROADCAST_INTERVAL_MS        200     // WebSocket update rate
+#define METRICS_KEYFRAME_INTERVAL       25      // Broadcasts between full frames to each streaming client (~5s)
+#define STREAM_QUEUE_BYTES              1024    // Outbound queue per streaming client (a keyframe + deltas)
+#define STREAM_STALL_EVICT_BROADCASTS   50      // Evict a client whose queue stayed non-empty this long (~10s)
+#define EVENT_BUS_MIN_INTERVAL_MS       50      // Broadcast task rate limit (event-driven pushes, max 20/s)
 
 // ============================================================================
 // NVS STORAGE CONFIGURATION
@@ -132,6 +155,11 @@
 #define DEFAULT_USER_WEIGHT_KG          75.0f
 #define CALORIES_PER_WATT_MINUTE        0.01433f    // kcal per watt-minute
 
+// ============================================================================
+// HEART RATE
+// ============================================================================
+#define DEFAULT_MAX_HEART_RATE          190         // bpm, basis of the HR zones
+
 // ============================================================================
 // TASK CONFIGURATION
 // ============================================================================
@@ -147,6 +175,29 @@
 #define WEB_TASK_STACK_SIZE             8192
 #define WEB_TASK_PRIORITY               3
 
+#define STORAGE_TASK_STACK_SIZE         4096
+#define STORAGE_TASK_PRIORITY           2       // Flash writes can wait for everything else
+
+// ============================================================================
+// SESSION STORAGE
+// ============================================================================
+#define SESSION_FLUSH_INTERVAL_MS       10000   // Storage task wake-up period
+#define SESSION_FLUSH_PAGE_SAMPLES      64      // Samples flushed per page (512 bytes)
+#define SESSION_DETAIL_RING_RECORDS     4096    // 10 Hz / per-pulse records awaiting the storage task (power of two)
+#define SESSION_DETAIL_PAGE_RECORDS     128     // Records per 10 Hz / per-pulse page
+#define SESSION_STROKE_RING_RECORDS     64      // Stroke records awaiting the storage task (power of two)
+#define SESSION_STROKE_PAGE_RECORDS     32      // Stroke records per page
+
+// Recording cost model (session_manager_estimate_recording): compressed
+// bits per record until this device has flushed pages of the profile
+#define RECORDING_PLANNED_MINUTES       120     // Session length checked against free space at start
+#define RECORDING_SAMPLE_BITS           24      // Per-second sample
+#define RECORDING_10HZ_BITS             32      // sample_10hz_t
+#define RECORDING_PULSE_BITS            12      // sample_pulse_t
+#define RECORDING_REVS_PER_MINUTE       1200    // Flywheel revolutions per minute rowed (pulses = revs * magnets)
+#define RECORDING_STROKE_BITS           256     // stroke_record_t
+#define RECORDING_STROKES_PER_MINUTE    30      // Until saved sessions tell the rower's rate
+
 // ============================================================================
 // BUFFER SIZES
 // ============================================================================
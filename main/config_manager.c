@@ -48,6 +48,7 @@ void config_manager_get_defaults(config_t *config) {
     // Calibration settings
     config->auto_calibrate_drag = true;
     config->calibration_row_count = 50;
+    config->drag_forgetting_factor = DRAG_FORGETTING_FACTOR;
     
     // User settings
     config->user_weight_kg = DEFAULT_USER_WEIGHT_KG;
@@ -79,7 +80,10 @@ void config_manager_get_defaults(config_t *config) {
     config->auto_pause_seconds = 5;
     
     // Heart rate settings (default max HR = 190)
-    config->max_heart_rate = 190;
+    config->max_heart_rate = DEFAULT_MAX_HEART_RATE;
+    
+    // Recording settings (per-second samples only)
+    config->recording_profile = RECORDING_PROFILE_1HZ;
 }
 
 /**
@@ -109,6 +113,7 @@ esp_err_t config_manager_load(config_t *config) {
     nvs_get_u32(handle, "moi_u32", (uint32_t*)&config->moment_of_inertia);
     nvs_get_u32(handle, "drag_u32", (uint32_t*)&config->initial_drag_coefficient);
     nvs_get_u32(handle, "dist_cal", (uint32_t*)&config->distance_calibration_factor);
+    nvs_get_u32(handle, "drag_ff", (uint32_t*)&config->drag_forgetting_factor);
     
     // User settings
     nvs_get_u32(handle, "weight_u32", (uint32_t*)&config->user_weight_kg);
@@ -177,6 +182,12 @@ esp_err_t config_manager_load(config_t *config) {
     // Heart rate settings
     nvs_get_u8(handle, "max_hr", &config->max_heart_rate);
     
+    // Recording settings
+    nvs_get_u8(handle, "rec_prof", &config->recording_profile);
+    if (config->recording_profile >= RECORDING_PROFILE_COUNT) {
+        config->recording_profile = RECORDING_PROFILE_1HZ;
+    }
+    
     nvs_close(handle);
     
     ESP_LOGI(TAG, "Configuration loaded from NVS (STA configured: %s)", 
@@ -209,6 +220,9 @@ esp_err_t config_manager_save(const config_t *config) {
     conv.f = config->distance_calibration_factor;
     nvs_set_u32(handle, "dist_cal", conv.u);
     
+    conv.f = config->drag_forgetting_factor;
+    nvs_set_u32(handle, "drag_ff", conv.u);
+    
     // Save user settings
     conv.f = config->user_weight_kg;
     nvs_set_u32(handle, "weight_u32", conv.u);
@@ -240,6 +254,9 @@ esp_err_t config_manager_save(const config_t *config) {
     // Save heart rate settings
     nvs_set_u8(handle, "max_hr", config->max_heart_rate);
     
+    // Save recording settings
+    nvs_set_u8(handle, "rec_prof", config->recording_profile);
+    
     // Commit changes
     ret = nvs_commit(handle);
     if (ret != ESP_OK) {
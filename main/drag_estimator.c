@@ -0,0 +1,204 @@
+/**
+ * @file drag_estimator.c
+ * @brief Drag estimate from recovery spin-down with a forgetting factor
+ */
+
+#include "drag_estimator.h"
+#include <math.h>
+#include <string.h>
+
+// A recovery needs this many fitted intervals to count
+#define DRAG_MIN_RECOVERY_POINTS    8
+
+// Fits explaining less of the 1/ω variation than this are not spin-downs
+#define DRAG_MIN_FIT_R2             0.5f
+
+// Floor on a recovery's relative slope error, so one near-perfect fit
+// cannot outweigh everything else
+#define DRAG_MIN_RELATIVE_ERROR     0.002f
+
+// A recovery further than this (relative, and in standard errors) from the
+// estimate is a suspected damper change; two in a row in the same direction
+// restart the estimate from the newest recovery instead of waiting for the
+// forgetting factor to wash the old damper out
+#define DRAG_CHANGE_RELATIVE        0.05f
+#define DRAG_CHANGE_SIGMAS          4.0f
+
+// Confidence drops by this much per 1% relative standard error
+#define DRAG_CONFIDENCE_PER_PERCENT 0.1f
+
+static void clear_recovery(drag_estimator_t *est) {
+    est->pending_head = 0;
+    est->pending_count = 0;
+    est->intervals = 0;
+    est->first_time_us = 0;
+    est->first_y = 0;
+    est->points = 0;
+    est->sum_t = 0;
+    est->sum_y = 0;
+    est->sum_tt = 0;
+    est->sum_ty = 0;
+    est->sum_yy = 0;
+}
+
+void drag_estimator_init(drag_estimator_t *est, float forgetting_factor) {
+    memset(est, 0, sizeof(*est));
+    if (forgetting_factor <= 0.0f || forgetting_factor > 1.0f) {
+        forgetting_factor = 1.0f;
+    }
+    est->forgetting_factor = forgetting_factor;
+}
+
+void drag_estimator_reset(drag_estimator_t *est) {
+    drag_estimator_init(est, est->forgetting_factor);
+}
+
+static void fit_point(drag_estimator_t *est, int64_t time_us, float y) {
+    if (est->points == 0) {
+        est->first_time_us = time_us;
+        est->first_y = y;
+    }
+
+    float t = (float)(time_us - est->first_time_us) / 1000000.0f;
+    y -= est->first_y;
+
+    est->points++;
+    est->sum_t += t;
+    est->sum_y += y;
+    est->sum_tt += t * t;
+    est->sum_ty += t * y;
+    est->sum_yy += y * y;
+}
+
+void drag_estimator_add(drag_estimator_t *est, int64_t start_us, int64_t end_us, float radians) {
+    if (end_us <= start_us || radians <= 0.0f) {
+        return;
+    }
+    if (est->intervals < UINT16_MAX) {
+        est->intervals++;
+    }
+
+    // Mean 1/ω over the interval, which for a linear 1/ω(t) is its value at
+    // the interval midpoint
+    int64_t mid_us = start_us + (end_us - start_us) / 2;
+    float y = (float)(end_us - start_us) / 1000000.0f / radians;
+
+    if (est->pending_count == DRAG_ESTIMATOR_TRAILING_POINTS) {
+        fit_point(est, est->pending_time_us[est->pending_head], est->pending_y[est->pending_head]);
+        est->pending_time_us[est->pending_head] = mid_us;
+        est->pending_y[est->pending_head] = y;
+        est->pending_head = (uint8_t)((est->pending_head + 1) % DRAG_ESTIMATOR_TRAILING_POINTS);
+        return;
+    }
+    uint8_t slot = (uint8_t)((est->pending_head + est->pending_count) % DRAG_ESTIMATOR_TRAILING_POINTS);
+    est->pending_time_us[slot] = mid_us;
+    est->pending_y[slot] = y;
+    est->pending_count++;
+}
+
+bool drag_estimator_end_recovery(drag_estimator_t *est) {
+    uint16_t n = est->points;
+    if (n < DRAG_MIN_RECOVERY_POINTS) {
+        clear_recovery(est);
+        return false;
+    }
+
+    float mean_t = est->sum_t / n;
+    float mean_y = est->sum_y / n;
+    float stt = est->sum_tt - n * mean_t * mean_t;
+    float sty = est->sum_ty - n * mean_t * mean_y;
+    float syy = est->sum_yy - n * mean_y * mean_y;
+    clear_recovery(est);
+
+    if (stt <= 0.0f || syy <= 0.0f || sty <= 0.0f) {
+        return false;
+    }
+
+    float slope = sty / stt;
+    float explained = slope * sty;
+    if (explained < DRAG_MIN_FIT_R2 * syy) {
+        return false;
+    }
+
+    // Standard error of the slope from the fit residuals
+    float residual_ss = syy - explained;
+    float variance = residual_ss > 0.0f ? residual_ss / (float)(n - 2) / stt : 0.0f;
+    float min_error = DRAG_MIN_RELATIVE_ERROR * slope;
+    if (variance < min_error * min_error) {
+        variance = min_error * min_error;
+    }
+    float weight = 1.0f / variance;
+
+    // Damper change check
+    int8_t change = 0;
+    if (est->accepted > 0) {
+        float deviation = slope - est->slope;
+        float sigma = sqrtf(variance + 1.0f / est->information);
+        if (fabsf(deviation) > DRAG_CHANGE_RELATIVE * est->slope &&
+            fabsf(deviation) > DRAG_CHANGE_SIGMAS * sigma) {
+            change = deviation > 0 ? 1 : -1;
+        }
+    }
+    bool restart = change != 0 && change == est->last_change;
+    est->last_change = change;
+
+    // Scalar recursive least squares with exponential forgetting
+    if (est->accepted == 0 || restart) {
+        est->slope = slope;
+        est->information = weight;
+        est->residual = 0.0f;
+        est->recoveries = 1.0f;
+    } else {
+        float lambda = est->forgetting_factor;
+        float previous = est->slope;
+        est->information = lambda * est->information + weight;
+        est->slope = previous + (weight / est->information) * (slope - previous);
+        est->residual = lambda * est->residual + weight * (slope - previous) * (slope - est->slope);
+        est->recoveries = lambda * est->recoveries + 1.0f;
+    }
+    est->accepted++;
+    if (restart) {
+        est->last_change = 0;
+        est->restarts++;
+    }
+    return true;
+}
+
+void drag_estimator_cancel_recovery(drag_estimator_t *est) {
+    clear_recovery(est);
+}
+
+bool drag_estimator_in_recovery(const drag_estimator_t *est) {
+    return est->intervals > 0;
+}
+
+bool drag_estimator_get(const drag_estimator_t *est, float *slope) {
+    if (est->accepted == 0) {
+        return false;
+    }
+    *slope = est->slope;
+    return true;
+}
+
+float drag_estimator_confidence(const drag_estimator_t *est) {
+    if (est->accepted == 0 || est->slope <= 0.0f || est->information <= 0.0f) {
+        return 0.0f;
+    }
+
+    // Scale the fit-based variance up when recoveries scatter more than
+    // their fit errors predict
+    float variance = 1.0f / est->information;
+    if (est->recoveries > 1.0f) {
+        float scatter = est->residual / (est->recoveries - 1.0f);
+        if (scatter > 1.0f) {
+            variance *= scatter;
+        }
+    }
+
+    float relative_error_pct = 100.0f * sqrtf(variance) / est->slope;
+    float confidence = 1.0f - DRAG_CONFIDENCE_PER_PERCENT * relative_error_pct;
+    if (confidence < 0.0f) {
+        confidence = 0.0f;
+    }
+    return confidence;
+}
@@ -0,0 +1,125 @@
+/**
+ * @file drag_estimator.h
+ * @brief Drag estimate from recovery spin-down with a forgetting factor
+ *
+ * With no torque applied the flywheel obeys I*dω/dt = -k*ω², so
+ *
+ *   d(1/ω)/dt = k / I
+ *
+ * and 1/ω rises linearly with time during every recovery. 1/ω is measured
+ * directly as interval / angle between pulses (the mean of a linear 1/ω over
+ * the interval is its value at the midpoint, so no smoothing lag), and each
+ * recovery is fitted with a straight line (running least-squares sums, O(1)
+ * per pulse). Its slope gives one measurement of k/I together with the
+ * slope's standard error.
+ *
+ * Recoveries are combined by recursive least squares on that single
+ * parameter: each is weighted by its inverse variance and older information
+ * decays by the forgetting factor per recovery. The first recovery gives a
+ * usable estimate; slow drift is followed within about 1/(1 - λ) strokes,
+ * and a damper change (two recoveries in a row clearly off the estimate on
+ * the same side) restarts the estimate from the newest recovery.
+ *
+ * The confidence (0..1) is derived from the standard error of the combined
+ * estimate, inflated when recoveries disagree more than their own fit errors
+ * explain (noise, model mismatch or a changed damper).
+ *
+ * Plain C without ESP-IDF dependencies so the host benchmark can use it.
+ */
+
+#ifndef DRAG_ESTIMATOR_H
+#define DRAG_ESTIMATOR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Newest intervals of a recovery held back from the fit; whatever is still
+// held when the recovery ends is dropped, since the next drive had usually
+// begun before it was detected
+#define DRAG_ESTIMATOR_TRAILING_POINTS  4
+
+/**
+ * Estimator state (one per flywheel)
+ */
+typedef struct {
+    // Intervals not yet in the fit
+    int64_t pending_time_us[DRAG_ESTIMATOR_TRAILING_POINTS];
+    float pending_y[DRAG_ESTIMATOR_TRAILING_POINTS];
+    uint8_t pending_head;
+    uint8_t pending_count;
+    uint16_t intervals;             // Intervals seen in this recovery
+
+
+    // Recovery in progress: sums of y = 1/ω against t (seconds), both
+    // relative to the first point of the recovery to keep float precision
+    int64_t first_time_us;
+    float first_y;
+    uint16_t points;
+    float sum_t;
+    float sum_y;
+    float sum_tt;
+    float sum_ty;
+    float sum_yy;
+
+    // Combined estimate of k/I over past recoveries
+    float forgetting_factor;        // λ, applied once per accepted recovery
+    float slope;                    // k/I (1/rad)
+    float information;              // Σ λ^age / var(slope_i)
+    float residual;                 // Σ λ^age * weighted disagreement
+    float recoveries;               // Σ λ^age (effective recovery count)
+    int8_t last_change;             // Direction of a suspected damper change (0 = none)
+    uint32_t accepted;              // Recoveries used since reset
+    uint32_t restarts;              // Damper changes detected
+} drag_estimator_t;
+
+/**
+ * Initialize an estimator without history
+ * @param est Estimator state
+ * @param forgetting_factor Weight kept by past recoveries each time a new one
+ *        is added (0 < λ <= 1; 1 = never forget)
+ */
+void drag_estimator_init(drag_estimator_t *est, float forgetting_factor);
+
+/**
+ * Forget all recoveries (keeps the forgetting factor)
+ */
+void drag_estimator_reset(drag_estimator_t *est);
+
+/**
+ * Add a pulse interval of the recovery in progress
+ * @param est Estimator state
+ * @param start_us Time of the pulse starting the interval
+ * @param end_us Time of the pulse ending it
+ * @param radians Flywheel angle turned in between
+ */
+void drag_estimator_add(drag_estimator_t *est, int64_t start_us, int64_t end_us, float radians);
+
+/**
+ * Close the recovery in progress and fold it into the estimate
+ * @param est Estimator state
+ * @return true if the recovery had enough points and a usable fit
+ */
+bool drag_estimator_end_recovery(drag_estimator_t *est);
+
+/**
+ * Drop the recovery in progress without using it (e.g. after a pulse gap)
+ */
+void drag_estimator_cancel_recovery(drag_estimator_t *est);
+
+/**
+ * Whether a recovery is being collected
+ */
+bool drag_estimator_in_recovery(const drag_estimator_t *est);
+
+/**
+ * Current estimate of k/I (multiply by the moment of inertia for k)
+ * @return false until a recovery has been accepted
+ */
+bool drag_estimator_get(const drag_estimator_t *est, float *slope);
+
+/**
+ * Confidence in the current estimate, 0 (none) to 1
+ */
+float drag_estimator_confidence(const drag_estimator_t *est);
+
+#endif // DRAG_ESTIMATOR_H
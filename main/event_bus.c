@@ -0,0 +1,189 @@
+/**
+ * @file event_bus.c
+ * @brief Publish/subscribe wake-ups for stroke boundaries and metrics ticks
+ */
+
+#include "event_bus.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/task.h"
+#include <string.h>
+
+static const char *TAG = "EVENT_BUS";
+
+/**
+ * One subscribing task
+ */
+typedef struct {
+    TaskHandle_t task;
+    uint32_t mask;
+    int64_t min_interval_us;
+    int64_t last_delivery_us;
+    uint32_t pending;               // Undelivered events
+    int64_t pending_pulse_us;       // Oldest undelivered stroke event, 0 if none
+} subscriber_t;
+
+static const uint32_t s_bucket_limit_ms[EVENT_BUS_LATENCY_BUCKETS - 1] = {
+    1, 2, 5, 10, 20, 50, 100, 200, 500
+};
+
+// Subscribers, counters and histograms. Held only for a few loads and
+// stores, so a spinlock is cheaper than a mutex for the sensor task.
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static subscriber_t s_subscribers[EVENT_BUS_MAX_SUBSCRIBERS];
+static int s_subscriber_count = 0;
+static event_bus_stats_t s_stats;
+static event_bus_latency_t s_latency[EVENT_BUS_SINK_COUNT];
+
+int event_bus_subscribe(uint32_t event_mask, uint32_t min_interval_ms) {
+    int id = -1;
+    portENTER_CRITICAL(&s_lock);
+    if (s_subscriber_count < EVENT_BUS_MAX_SUBSCRIBERS) {
+        id = s_subscriber_count;
+        subscriber_t *sub = &s_subscribers[id];
+        memset(sub, 0, sizeof(*sub));
+        sub->task = xTaskGetCurrentTaskHandle();
+        sub->mask = event_mask;
+        sub->min_interval_us = (int64_t)min_interval_ms * 1000;
+        s_subscriber_count++;
+    }
+    portEXIT_CRITICAL(&s_lock);
+
+    if (id < 0) {
+        ESP_LOGE(TAG, "No free subscriber slot");
+    }
+    return id;
+}
+
+void event_bus_publish(uint32_t events, int64_t timestamp_us) {
+    if (events == 0) {
+        return;
+    }
+
+    TaskHandle_t wake[EVENT_BUS_MAX_SUBSCRIBERS];
+    int wake_count = 0;
+
+    portENTER_CRITICAL(&s_lock);
+    for (int i = 0; i < s_subscriber_count; i++) {
+        subscriber_t *sub = &s_subscribers[i];
+        uint32_t matched = events & sub->mask;
+        if (matched == 0) {
+            continue;
+        }
+        if (sub->pending & matched) {
+            s_stats.coalesced++;
+        }
+        if ((matched & EVENT_BUS_STROKE_EVENTS) && sub->pending_pulse_us == 0) {
+            sub->pending_pulse_us = timestamp_us;
+        }
+        sub->pending |= matched;
+        wake[wake_count++] = sub->task;
+    }
+    if (wake_count > 0) {
+        s_stats.published++;
+    }
+    portEXIT_CRITICAL(&s_lock);
+
+    for (int i = 0; i < wake_count; i++) {
+        xTaskNotifyGive(wake[i]);
+    }
+}
+
+uint32_t event_bus_wait(int subscriber, TickType_t timeout, int64_t *pulse_time_us) {
+    *pulse_time_us = 0;
+    if (subscriber < 0 || subscriber >= s_subscriber_count) {
+        vTaskDelay(timeout);
+        return 0;
+    }
+    subscriber_t *sub = &s_subscribers[subscriber];
+
+    // Rate limit: events arriving meanwhile stay pending and coalesce
+    int64_t hold_us = sub->last_delivery_us + sub->min_interval_us - esp_timer_get_time();
+    if (hold_us > 0) {
+        TickType_t ticks = pdMS_TO_TICKS((uint32_t)((hold_us + 999) / 1000));
+        vTaskDelay(ticks > 0 ? ticks : 1);
+    }
+
+    // Events published before the wait are already counted in the
+    // notification, so this returns at once if any are pending
+    ulTaskNotifyTake(pdTRUE, timeout);
+
+    portENTER_CRITICAL(&s_lock);
+    uint32_t events = sub->pending;
+    *pulse_time_us = sub->pending_pulse_us;
+    sub->pending = 0;
+    sub->pending_pulse_us = 0;
+    if (events != 0) {
+        s_stats.deliveries++;
+        if (hold_us > 0) {
+            s_stats.rate_limited++;
+        }
+    }
+    portEXIT_CRITICAL(&s_lock);
+
+    if (events != 0) {
+        sub->last_delivery_us = esp_timer_get_time();
+    }
+    return events;
+}
+
+void event_bus_record_latency(event_bus_sink_t sink, int64_t pulse_time_us) {
+    if (sink >= EVENT_BUS_SINK_COUNT || pulse_time_us <= 0) {
+        return;
+    }
+    int64_t latency_us = esp_timer_get_time() - pulse_time_us;
+    if (latency_us < 0) {
+        latency_us = 0;
+    }
+
+    int bucket = 0;
+    while (bucket < EVENT_BUS_LATENCY_BUCKETS - 1 &&
+           latency_us >= (int64_t)s_bucket_limit_ms[bucket] * 1000) {
+        bucket++;
+    }
+
+    portENTER_CRITICAL(&s_lock);
+    event_bus_latency_t *latency = &s_latency[sink];
+    latency->count++;
+    latency->buckets[bucket]++;
+    if (latency_us > latency->max_us) {
+        latency->max_us = latency_us > UINT32_MAX ? UINT32_MAX : (uint32_t)latency_us;
+    }
+    portEXIT_CRITICAL(&s_lock);
+}
+
+uint32_t event_bus_latency_percentile_ms(const event_bus_latency_t *latency, uint32_t percentile) {
+    if (latency->count == 0) {
+        return 0;
+    }
+    // Rank of the sample at the percentile (1-based, rounded up)
+    uint64_t rank = ((uint64_t)latency->count * percentile + 99) / 100;
+    if (rank == 0) {
+        rank = 1;
+    }
+
+    uint64_t seen = 0;
+    for (int i = 0; i < EVENT_BUS_LATENCY_BUCKETS - 1; i++) {
+        seen += latency->buckets[i];
+        if (seen >= rank) {
+            return s_bucket_limit_ms[i];
+        }
+    }
+    return (latency->max_us + 999) / 1000;
+}
+
+void event_bus_get_latency(event_bus_sink_t sink, event_bus_latency_t *latency) {
+    if (sink >= EVENT_BUS_SINK_COUNT) {
+        memset(latency, 0, sizeof(*latency));
+        return;
+    }
+    portENTER_CRITICAL(&s_lock);
+    *latency = s_latency[sink];
+    portEXIT_CRITICAL(&s_lock);
+}
+
+void event_bus_get_stats(event_bus_stats_t *stats) {
+    portENTER_CRITICAL(&s_lock);
+    *stats = s_stats;
+    portEXIT_CRITICAL(&s_lock);
+}
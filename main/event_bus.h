@@ -0,0 +1,118 @@
+/**
+ * @file event_bus.h
+ * @brief Publish/subscribe wake-ups for stroke boundaries and metrics ticks
+ *
+ * Publishers (the sensor task at catch / finish / stroke completion, the
+ * metrics task after each tick) set event bits on every subscriber whose
+ * mask includes them and wake it with a task notification. Publishing
+ * never blocks. Events that arrive before the subscriber runs coalesce into
+ * one delivery.
+ *
+ * Each subscriber has a minimum interval between deliveries (the rate
+ * limiter), so a burst of events cannot drive sends faster than that.
+ *
+ * Stroke events carry the ISR timestamp of the pulse that caused them.
+ * Subscribers report when they have pushed the result to a sink
+ * (event_bus_record_latency()), which builds a pulse-to-send latency
+ * histogram per sink.
+ */
+
+#ifndef EVENT_BUS_H
+#define EVENT_BUS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+
+// Event bits
+#define EVENT_BUS_CATCH             (1u << 0)   // Drive started
+#define EVENT_BUS_FINISH            (1u << 1)   // Drive ended (recovery started)
+#define EVENT_BUS_STROKE            (1u << 2)   // Stroke counted (at the finish)
+#define EVENT_BUS_METRICS           (1u << 3)   // Metrics task published derived metrics
+
+// Events stamped with a pulse time
+#define EVENT_BUS_STROKE_EVENTS     (EVENT_BUS_CATCH | EVENT_BUS_FINISH | EVENT_BUS_STROKE)
+
+#define EVENT_BUS_MAX_SUBSCRIBERS   4
+
+// Latency histogram bucket upper bounds (ms); the last bucket is open
+#define EVENT_BUS_LATENCY_BUCKETS   10
+
+/**
+ * Where a subscriber pushes results (one latency histogram each)
+ */
+typedef enum {
+    EVENT_BUS_SINK_WEB = 0,         // WebSocket / SSE broadcast
+    EVENT_BUS_SINK_BLE,             // BLE FTMS notification
+    EVENT_BUS_SINK_COUNT
+} event_bus_sink_t;
+
+/**
+ * Pulse-to-send latency of one sink
+ */
+typedef struct {
+    uint32_t count;
+    uint32_t max_us;
+    uint32_t buckets[EVENT_BUS_LATENCY_BUCKETS];
+} event_bus_latency_t;
+
+/**
+ * Bus counters
+ */
+typedef struct {
+    uint32_t published;             // Events published to at least one subscriber
+    uint32_t coalesced;             // Events merged into an undelivered one
+    uint32_t deliveries;            // Wake-ups that returned events
+    uint32_t rate_limited;          // Deliveries held back by the rate limiter
+} event_bus_stats_t;
+
+/**
+ * Subscribe the calling task
+ * @param event_mask Events to receive
+ * @param min_interval_ms Minimum time between deliveries (rate limit)
+ * @return Subscriber id, -1 if the bus is full
+ */
+int event_bus_subscribe(uint32_t event_mask, uint32_t min_interval_ms);
+
+/**
+ * Publish events from task context (never blocks)
+ * @param events Event bits (0 is a no-op)
+ * @param timestamp_us Pulse time for stroke events, else the current time
+ */
+void event_bus_publish(uint32_t events, int64_t timestamp_us);
+
+/**
+ * Wait for events (called by the subscribing task)
+ * Returns no sooner than the subscriber's minimum interval after the
+ * previous delivery.
+ * @param subscriber Id from event_bus_subscribe()
+ * @param timeout Longest wait
+ * @param pulse_time_us Out: pulse time of the oldest stroke event delivered, 0 if none
+ * @return Event bits, 0 on timeout
+ */
+uint32_t event_bus_wait(int subscriber, TickType_t timeout, int64_t *pulse_time_us);
+
+/**
+ * Record that a stroke event has been pushed to a sink
+ * @param pulse_time_us Pulse time returned by event_bus_wait()
+ */
+void event_bus_record_latency(event_bus_sink_t sink, int64_t pulse_time_us);
+
+/**
+ * Latency at a percentile, as the upper bound of its bucket
+ * @param percentile 0-100
+ * @return Milliseconds, the maximum seen if it falls in the open bucket
+ */
+uint32_t event_bus_latency_percentile_ms(const event_bus_latency_t *latency, uint32_t percentile);
+
+/**
+ * Get the latency histogram of a sink
+ */
+void event_bus_get_latency(event_bus_sink_t sink, event_bus_latency_t *latency);
+
+/**
+ * Get bus counters
+ */
+void event_bus_get_stats(event_bus_stats_t *stats);
+
+#endif // EVENT_BUS_H
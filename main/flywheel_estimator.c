@@ -0,0 +1,158 @@
+/**
+ * @file flywheel_estimator.c
+ * @brief Sliding-window quadratic fit of flywheel pulse times
+ *
+ * Pulse index j runs from 0 (newest) down to -(n-1) (oldest), u_j is the
+ * pulse time minus the newest pulse time. When a pulse arrives:
+ *   1. every index shifts by -1:  Σju -> Σju - Σu,  Σj²u -> Σj²u - 2Σju + Σu
+ *   2. the oldest pulse drops out if the window is full
+ *   3. the new pulse enters at j = 0
+ *   4. all u are re-based to the new pulse: Σj^m u -> Σj^m u - d * Σj^m
+ * All of it is exact integer arithmetic; only the final 3x3 solve is floating.
+ */
+
+#include "flywheel_estimator.h"
+#include <string.h>
+
+/**
+ * Σj and Σj² for j = 0 .. -(n-1)
+ */
+static inline int64_t index_sum(int64_t n) {
+    return -n * (n - 1) / 2;
+}
+
+static inline int64_t index_sum_sq(int64_t n) {
+    return (n - 1) * n * (2 * n - 1) / 6;
+}
+
+/**
+ * Invert the normal matrix of the basis (1, j, j²) for n points and keep
+ * the rows that produce c1 and c2
+ */
+static void compute_inverse_rows(int n, double row_c1[3], double row_c2[3]) {
+    double p[5] = {0};
+    for (int i = 0; i < n; i++) {
+        double j = -(double)i;
+        double jm = 1.0;
+        for (int m = 0; m < 5; m++) {
+            p[m] += jm;
+            jm *= j;
+        }
+    }
+
+    // Symmetric matrix [[p0 p1 p2] [p1 p2 p3] [p2 p3 p4]]
+    double a = p[0], b = p[1], c = p[2], e = p[3], f = p[4];
+    double cof00 = c * f - e * e;
+    double cof01 = -(b * f - c * e);
+    double cof02 = b * e - c * c;
+    double cof11 = a * f - c * c;
+    double cof12 = -(a * e - b * c);
+    double cof22 = a * c - b * b;
+    double det = a * cof00 + b * cof01 + c * cof02;
+
+    row_c1[0] = cof01 / det;
+    row_c1[1] = cof11 / det;
+    row_c1[2] = cof12 / det;
+    row_c2[0] = cof02 / det;
+    row_c2[1] = cof12 / det;
+    row_c2[2] = cof22 / det;
+}
+
+void flywheel_estimator_init(flywheel_estimator_t *est, int window, float radians_per_pulse) {
+    memset(est, 0, sizeof(*est));
+
+    if (window < 3) window = 3;
+    if (window > FLYWHEEL_ESTIMATOR_MAX_WINDOW) window = FLYWHEEL_ESTIMATOR_MAX_WINDOW;
+
+    est->window = (uint8_t)window;
+    est->radians_per_pulse = radians_per_pulse;
+
+    for (int n = 3; n <= window; n++) {
+        compute_inverse_rows(n, est->inv_c1[n], est->inv_c2[n]);
+    }
+}
+
+void flywheel_estimator_reset(flywheel_estimator_t *est) {
+    est->head = 0;
+    est->count = 0;
+    est->sum_u = 0;
+    est->sum_ju = 0;
+    est->sum_jju = 0;
+}
+
+void flywheel_estimator_push(flywheel_estimator_t *est, int64_t timestamp_us) {
+    if (est->count == 0) {
+        est->head = 0;
+        est->times_us[0] = timestamp_us;
+        est->count = 1;
+        est->sum_u = 0;
+        est->sum_ju = 0;
+        est->sum_jju = 0;
+        return;
+    }
+
+    int64_t ref = est->times_us[est->head];
+    int64_t d = timestamp_us - ref;
+    int64_t n = est->count;
+
+    // 1. Shift indices by -1
+    est->sum_jju += est->sum_u - 2 * est->sum_ju;
+    est->sum_ju -= est->sum_u;
+
+    // 2. Drop the oldest pulse, now at j = -n
+    if (n == est->window) {
+        uint8_t oldest = (uint8_t)((est->head + est->window - (n - 1)) % est->window);
+        int64_t u_old = est->times_us[oldest] - ref;
+        est->sum_u -= u_old;
+        est->sum_ju += n * u_old;
+        est->sum_jju -= n * n * u_old;
+        n--;
+    }
+
+    // 3. New pulse at j = 0
+    est->head = (uint8_t)((est->head + 1) % est->window);
+    est->times_us[est->head] = timestamp_us;
+    est->sum_u += d;
+    n++;
+
+    // 4. Re-base u to the new pulse
+    est->sum_u -= n * d;
+    est->sum_ju -= d * index_sum(n);
+    est->sum_jju -= d * index_sum_sq(n);
+
+    est->count = (uint8_t)n;
+}
+
+bool flywheel_estimator_get(const flywheel_estimator_t *est, float *omega, float *alpha) {
+    if (est->count < 2) {
+        return false;
+    }
+
+    if (est->count == 2) {
+        uint8_t prev = (uint8_t)((est->head + est->window - 1) % est->window);
+        int64_t dt_us = est->times_us[est->head] - est->times_us[prev];
+        if (dt_us <= 0) {
+            return false;
+        }
+        *omega = est->radians_per_pulse * 1e6f / (float)dt_us;
+        *alpha = 0.0f;
+        return true;
+    }
+
+    const double *r1 = est->inv_c1[est->count];
+    const double *r2 = est->inv_c2[est->count];
+    double s0 = (double)est->sum_u;
+    double s1 = (double)est->sum_ju;
+    double s2 = (double)est->sum_jju;
+
+    // t(j) in µs: t'(0) = c1, t''(0) = 2*c2
+    double c1 = r1[0] * s0 + r1[1] * s1 + r1[2] * s2;
+    double c2 = r2[0] * s0 + r2[1] * s1 + r2[2] * s2;
+    if (c1 <= 0.0) {
+        return false;
+    }
+
+    *omega = (float)(est->radians_per_pulse * 1e6 / c1);
+    *alpha = (float)(-est->radians_per_pulse * 2.0 * c2 * 1e12 / (c1 * c1 * c1));
+    return true;
+}
@@ -0,0 +1,84 @@
+/**
+ * @file flywheel_estimator.h
+ * @brief Sliding-window regression estimate of flywheel speed and acceleration
+ *
+ * Instead of differencing the last two or three pulse intervals, the pulse
+ * times of the last N magnets are fitted with a quadratic t(j) = c0 + c1*j +
+ * c2*j² over pulse index j (the flywheel angle in magnet spacings), in the
+ * style of OpenRowingMonitor's flank fit. ω and α are evaluated at the newest
+ * pulse from the fitted derivatives:
+ *
+ *   ω = Δθ / t'(0)          α = -Δθ * t''(0) / t'(0)³
+ *
+ * Because j takes fixed values, the normal matrix depends only on N and is
+ * inverted once. The three moment sums Σu, Σj*u, Σj²*u (u = pulse time
+ * relative to the newest pulse, in µs) are kept exactly in int64 and slid /
+ * re-based in O(1) per pulse, so there is no floating point drift however
+ * long the session runs.
+ *
+ * Plain C without ESP-IDF dependencies so the host benchmark can use it.
+ */
+
+#ifndef FLYWHEEL_ESTIMATOR_H
+#define FLYWHEEL_ESTIMATOR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Largest supported window (pulses)
+#define FLYWHEEL_ESTIMATOR_MAX_WINDOW   32
+
+/**
+ * Estimator state (one per flywheel)
+ */
+typedef struct {
+    int64_t times_us[FLYWHEEL_ESTIMATOR_MAX_WINDOW];  // Ring of pulse timestamps
+    uint8_t head;                   // Slot of the newest timestamp
+    uint8_t count;                  // Timestamps in the window
+    uint8_t window;                 // Configured window size N
+    float radians_per_pulse;        // Angle between magnets (Δθ)
+
+    // Moment sums over j = 0 (newest) .. -(count-1), u relative to newest
+    int64_t sum_u;
+    int64_t sum_ju;
+    int64_t sum_jju;
+
+    // Rows 1 and 2 of the inverted normal matrix, per window fill level
+    double inv_c1[FLYWHEEL_ESTIMATOR_MAX_WINDOW + 1][3];
+    double inv_c2[FLYWHEEL_ESTIMATOR_MAX_WINDOW + 1][3];
+} flywheel_estimator_t;
+
+/**
+ * Initialize estimator
+ * @param est Estimator state
+ * @param window Pulses per fit (clamped to 3..FLYWHEEL_ESTIMATOR_MAX_WINDOW)
+ * @param radians_per_pulse Flywheel angle between two pulses
+ */
+void flywheel_estimator_init(flywheel_estimator_t *est, int window, float radians_per_pulse);
+
+/**
+ * Forget all pulses (after a stop or an implausible gap)
+ */
+void flywheel_estimator_reset(flywheel_estimator_t *est);
+
+/**
+ * Add the newest pulse timestamp
+ * @param est Estimator state
+ * @param timestamp_us Pulse time (must not be earlier than the previous one)
+ */
+void flywheel_estimator_push(flywheel_estimator_t *est, int64_t timestamp_us);
+
+/**
+ * Evaluate the fit at the newest pulse
+ *
+ * With two pulses in the window this falls back to a single interval
+ * (α = 0); with three or more it uses the quadratic fit.
+ *
+ * @param est Estimator state
+ * @param omega Output: angular velocity (rad/s)
+ * @param alpha Output: angular acceleration (rad/s²)
+ * @return false if fewer than two pulses are available or the fit is degenerate
+ */
+bool flywheel_estimator_get(const flywheel_estimator_t *est, float *omega, float *alpha);
+
+#endif // FLYWHEEL_ESTIMATOR_H
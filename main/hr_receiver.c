@@ -11,6 +11,7 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
 
+#include <stdatomic.h>
 #include <string.h>
 
 static const char *TAG = "HR_RECV";
@@ -18,21 +19,25 @@ static const char *TAG = "HR_RECV";
 // Heart rate stale timeout (5 seconds)
 #define HR_STALE_TIMEOUT_MS     5000
 
-// Maximum HR samples to store (2 hours at 1Hz)
-#define MAX_HR_SAMPLES          7200
-
-// Current heart rate state
-static volatile uint8_t s_current_hr = 0;
-static volatile int64_t s_last_update_time_ms = 0;
-
-// HR sample buffer for recording
-static hr_sample_t *s_hr_buffer = NULL;
-static volatile int s_buffer_index = 0;
-static volatile bool s_recording = false;
+/**
+ * Current value
+ */
+typedef struct {
+    uint8_t current_hr;
+    int64_t last_update_time_ms;
+} hr_state_t;
 
-// Mutex for thread safety
+// Serializes writers (BLE client, HTTP POST). Readers never take it.
 static SemaphoreHandle_t s_hr_mutex = NULL;
 
+// Writer's copy of the state (guarded by s_hr_mutex) and the published copy.
+// The sequence is odd while a publish is in progress; publishing runs in a
+// critical section so a reader on the same core cannot preempt it and spin.
+static hr_state_t s_state;
+static hr_state_t s_published;
+static atomic_uint_fast32_t s_sequence;
+static portMUX_TYPE s_publish_lock = portMUX_INITIALIZER_UNLOCKED;
+
 /**
  * Get current time in milliseconds
  */
@@ -40,6 +45,35 @@ static int64_t get_time_ms(void) {
     return esp_timer_get_time() / 1000;
 }
 
+/**
+ * Publish the writer's state to readers (caller holds s_hr_mutex)
+ */
+static void publish_state(void) {
+    portENTER_CRITICAL(&s_publish_lock);
+    uint32_t sequence = (uint32_t)atomic_load_explicit(&s_sequence, memory_order_relaxed);
+    atomic_store_explicit(&s_sequence, sequence + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    memcpy(&s_published, &s_state, sizeof(s_published));
+    atomic_store_explicit(&s_sequence, sequence + 2, memory_order_release);
+    portEXIT_CRITICAL(&s_publish_lock);
+}
+
+/**
+ * Copy out the latest published state, retrying while a publish overlaps
+ */
+static void read_state(hr_state_t *out) {
+    while (true) {
+        uint32_t begin = (uint32_t)atomic_load_explicit(&s_sequence, memory_order_acquire);
+        if ((begin & 1) == 0) {
+            memcpy(out, &s_published, sizeof(*out));
+            atomic_thread_fence(memory_order_acquire);
+            if ((uint32_t)atomic_load_explicit(&s_sequence, memory_order_relaxed) == begin) {
+                return;
+            }
+        }
+    }
+}
+
 /**
  * Initialize heart rate receiver
  */
@@ -53,20 +87,10 @@ esp_err_t hr_receiver_init(void) {
         }
     }
     
-    // Allocate sample buffer (uses PSRAM if available)
-    if (s_hr_buffer == NULL) {
-        s_hr_buffer = heap_caps_malloc(MAX_HR_SAMPLES * sizeof(hr_sample_t), 
-                                        MALLOC_CAP_DEFAULT);
-        if (s_hr_buffer == NULL) {
-            ESP_LOGE(TAG, "Failed to allocate HR buffer");
-            return ESP_ERR_NO_MEM;
-        }
-    }
-    
-    s_current_hr = 0;
-    s_last_update_time_ms = 0;
-    s_buffer_index = 0;
-    s_recording = false;
+    xSemaphoreTake(s_hr_mutex, portMAX_DELAY);
+    memset(&s_state, 0, sizeof(s_state));
+    publish_state();
+    xSemaphoreGive(s_hr_mutex);
     
     ESP_LOGI(TAG, "Heart rate receiver initialized");
     return ESP_OK;
@@ -76,11 +100,6 @@ esp_err_t hr_receiver_init(void) {
  * Deinitialize heart rate receiver
  */
 void hr_receiver_deinit(void) {
-    if (s_hr_buffer != NULL) {
-        free(s_hr_buffer);
-        s_hr_buffer = NULL;
-    }
-    
     if (s_hr_mutex != NULL) {
         vSemaphoreDelete(s_hr_mutex);
         s_hr_mutex = NULL;
@@ -98,16 +117,9 @@ esp_err_t hr_receiver_update(uint8_t bpm) {
     int64_t now = get_time_ms();
     
     xSemaphoreTake(s_hr_mutex, portMAX_DELAY);
-    
-    s_current_hr = bpm;
-    s_last_update_time_ms = now;
-    
-    // Record sample if recording is active
-    if (s_recording && s_buffer_index < MAX_HR_SAMPLES) {
-        s_hr_buffer[s_buffer_index].timestamp_ms = now;
-        s_hr_buffer[s_buffer_index].bpm = bpm;
-        s_buffer_index++;
-    }
+    s_state.current_hr = bpm;
+    s_state.last_update_time_ms = now;
+    publish_state();
     
     xSemaphoreGive(s_hr_mutex);
     
@@ -117,131 +129,38 @@ esp_err_t hr_receiver_update(uint8_t bpm) {
 }
 
 /**
- * Get current heart rate
- * Note: For simplicity, reads s_current_hr without mutex since uint8_t read is atomic
- * on most platforms. If stricter thread safety is needed, add mutex protection.
+ * Check whether a state's heart rate is still fresh
  */
-uint8_t hr_receiver_get_current(void) {
-    if (!hr_receiver_is_valid()) {
-        return 0;
-    }
-    
-    uint8_t hr;
-    xSemaphoreTake(s_hr_mutex, portMAX_DELAY);
-    hr = s_current_hr;
-    xSemaphoreGive(s_hr_mutex);
-    
-    return hr;
-}
-
-/**
- * Check if current heart rate is valid (not stale)
- */
-bool hr_receiver_is_valid(void) {
-    int64_t last_update;
-    
-    xSemaphoreTake(s_hr_mutex, portMAX_DELAY);
-    last_update = s_last_update_time_ms;
-    xSemaphoreGive(s_hr_mutex);
-    
-    if (last_update == 0) {
+static bool state_is_valid(const hr_state_t *state) {
+    if (state->last_update_time_ms == 0) {
         return false;
     }
-    
-    int64_t now = get_time_ms();
-    return (now - last_update) < HR_STALE_TIMEOUT_MS;
+    return (get_time_ms() - state->last_update_time_ms) < HR_STALE_TIMEOUT_MS;
 }
 
 /**
- * Get timestamp of last heart rate update
- */
-int64_t hr_receiver_get_last_update_time(void) {
-    return s_last_update_time_ms;
-}
-
-/**
- * Start recording HR samples
- */
-void hr_receiver_start_recording(void) {
-    xSemaphoreTake(s_hr_mutex, portMAX_DELAY);
-    s_buffer_index = 0;
-    s_recording = true;
-    xSemaphoreGive(s_hr_mutex);
-    
-    ESP_LOGI(TAG, "HR recording started");
-}
-
-/**
- * Stop recording HR samples
- */
-void hr_receiver_stop_recording(void) {
-    xSemaphoreTake(s_hr_mutex, portMAX_DELAY);
-    s_recording = false;
-    xSemaphoreGive(s_hr_mutex);
-    
-    ESP_LOGI(TAG, "HR recording stopped, %d samples collected", s_buffer_index);
-}
-
-/**
- * Get recorded HR samples
- * @param samples Output array for samples (must not be NULL)
- * @param max_samples Maximum samples to return (must be > 0)
- * @return Number of samples copied
+ * Get current heart rate
  */
-int hr_receiver_get_samples(hr_sample_t *samples, int max_samples) {
-    if (samples == NULL || max_samples <= 0 || s_hr_buffer == NULL) {
-        return 0;
-    }
-    
-    int count = 0;
-    
-    xSemaphoreTake(s_hr_mutex, portMAX_DELAY);
-    count = (s_buffer_index < max_samples) ? s_buffer_index : max_samples;
-    if (count > 0) {
-        memcpy(samples, s_hr_buffer, count * sizeof(hr_sample_t));
-    }
-    xSemaphoreGive(s_hr_mutex);
-    
-    return count;
+uint8_t hr_receiver_get_current(void) {
+    hr_state_t state;
+    read_state(&state);
+    return state_is_valid(&state) ? state.current_hr : 0;
 }
 
 /**
- * Get HR statistics from current recording
+ * Check if current heart rate is valid (not stale)
  */
-void hr_receiver_get_stats(uint8_t *avg_hr, uint8_t *max_hr, uint16_t *sample_count) {
-    uint32_t sum = 0;
-    uint8_t max = 0;
-    int count = 0;
-    
-    xSemaphoreTake(s_hr_mutex, portMAX_DELAY);
-    
-    count = s_buffer_index;
-    
-    for (int i = 0; i < count; i++) {
-        sum += s_hr_buffer[i].bpm;
-        if (s_hr_buffer[i].bpm > max) {
-            max = s_hr_buffer[i].bpm;
-        }
-    }
-    
-    xSemaphoreGive(s_hr_mutex);
-    
-    if (avg_hr) {
-        *avg_hr = (count > 0) ? (uint8_t)(sum / count) : 0;
-    }
-    if (max_hr) {
-        *max_hr = max;
-    }
-    if (sample_count) {
-        *sample_count = (uint16_t)count;
-    }
+bool hr_receiver_is_valid(void) {
+    hr_state_t state;
+    read_state(&state);
+    return state_is_valid(&state);
 }
 
 /**
- * Clear HR sample buffer
+ * Get timestamp of last heart rate update
  */
-void hr_receiver_clear_samples(void) {
-    xSemaphoreTake(s_hr_mutex, portMAX_DELAY);
-    s_buffer_index = 0;
-    xSemaphoreGive(s_hr_mutex);
+int64_t hr_receiver_get_last_update_time(void) {
+    hr_state_t state;
+    read_state(&state);
+    return state.last_update_time_ms;
 }
@@ -0,0 +1,177 @@
+/**
+ * @file json_writer.c
+ * @brief Streaming JSON emitter over a fixed scratch buffer
+ */
+
+#include "json_writer.h"
+#include <float.h>
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+void json_writer_init(json_writer_t *writer, char *buffer, size_t size,
+                      json_writer_sink_t sink, void *ctx) {
+    memset(writer, 0, sizeof(*writer));
+    writer->buffer = buffer;
+    writer->size = size;
+    writer->sink = sink;
+    writer->ctx = ctx;
+}
+
+/**
+ * Pass the buffered bytes to the sink
+ */
+static void flush(json_writer_t *writer) {
+    if (writer->len == 0 || writer->failed) {
+        writer->len = 0;
+        return;
+    }
+    if (!writer->sink(writer->ctx, writer->buffer, writer->len)) {
+        writer->failed = true;
+    }
+    writer->total += (uint32_t)writer->len;
+    writer->len = 0;
+}
+
+static void put(json_writer_t *writer, const char *data, size_t len) {
+    while (len > 0 && !writer->failed) {
+        if (writer->len == writer->size) {
+            flush(writer);
+        }
+        size_t room = writer->size - writer->len;
+        size_t n = len < room ? len : room;
+        memcpy(writer->buffer + writer->len, data, n);
+        writer->len += n;
+        data += n;
+        len -= n;
+    }
+}
+
+static void put_char(json_writer_t *writer, char c) {
+    put(writer, &c, 1);
+}
+
+static void put_string(json_writer_t *writer, const char *value) {
+    static const char hex[] = "0123456789abcdef";
+    put_char(writer, '"');
+    for (const unsigned char *p = (const unsigned char *)value; *p != '\0'; p++) {
+        char escaped[6];
+        switch (*p) {
+            case '"':  put(writer, "\\\"", 2); break;
+            case '\\': put(writer, "\\\\", 2); break;
+            case '\b': put(writer, "\\b", 2); break;
+            case '\f': put(writer, "\\f", 2); break;
+            case '\n': put(writer, "\\n", 2); break;
+            case '\r': put(writer, "\\r", 2); break;
+            case '\t': put(writer, "\\t", 2); break;
+            default:
+                if (*p < 0x20) {
+                    memcpy(escaped, "\\u00", 4);
+                    escaped[4] = hex[*p >> 4];
+                    escaped[5] = hex[*p & 0x0F];
+                    put(writer, escaped, sizeof(escaped));
+                } else {
+                    put_char(writer, (char)*p);
+                }
+                break;
+        }
+    }
+    put_char(writer, '"');
+}
+
+/**
+ * Comma and member name in front of a value
+ */
+static void begin_value(json_writer_t *writer, const char *key) {
+    uint32_t bit = 1UL << writer->depth;
+    if (writer->has_member & bit) {
+        put_char(writer, ',');
+    }
+    writer->has_member |= bit;
+    if (key != NULL) {
+        put_string(writer, key);
+        put_char(writer, ':');
+    }
+}
+
+static void open_container(json_writer_t *writer, const char *key, char bracket) {
+    begin_value(writer, key);
+    put_char(writer, bracket);
+    if (writer->depth + 1 >= JSON_WRITER_MAX_DEPTH) {
+        writer->failed = true;
+        return;
+    }
+    writer->depth++;
+    writer->has_member &= ~(1UL << writer->depth);
+}
+
+static void close_container(json_writer_t *writer, char bracket) {
+    if (writer->depth == 0) {
+        writer->failed = true;
+        return;
+    }
+    writer->depth--;
+    put_char(writer, bracket);
+}
+
+void json_writer_begin_object(json_writer_t *writer, const char *key) {
+    open_container(writer, key, '{');
+}
+
+void json_writer_end_object(json_writer_t *writer) {
+    close_container(writer, '}');
+}
+
+void json_writer_begin_array(json_writer_t *writer, const char *key) {
+    open_container(writer, key, '[');
+}
+
+void json_writer_end_array(json_writer_t *writer) {
+    close_container(writer, ']');
+}
+
+void json_writer_number(json_writer_t *writer, const char *key, double value) {
+    char text[32];
+    int len;
+
+    // Same rules as cJSON's print_number()
+    if (isnan(value) || isinf(value)) {
+        len = snprintf(text, sizeof(text), "null");
+    } else if (value >= INT_MIN && value <= INT_MAX && value == (double)(int)value) {
+        len = snprintf(text, sizeof(text), "%d", (int)value);
+    } else {
+        len = snprintf(text, sizeof(text), "%1.15g", value);
+        double check;
+        if (sscanf(text, "%lg", &check) != 1 ||
+            fabs(check - value) > fmax(fabs(check), fabs(value)) * DBL_EPSILON) {
+            len = snprintf(text, sizeof(text), "%1.17g", value);
+        }
+    }
+
+    begin_value(writer, key);
+    put(writer, text, (size_t)len);
+}
+
+void json_writer_bool(json_writer_t *writer, const char *key, bool value) {
+    begin_value(writer, key);
+    if (value) {
+        put(writer, "true", 4);
+    } else {
+        put(writer, "false", 5);
+    }
+}
+
+void json_writer_string(json_writer_t *writer, const char *key, const char *value) {
+    begin_value(writer, key);
+    put_string(writer, value);
+}
+
+bool json_writer_ok(const json_writer_t *writer) {
+    return !writer->failed;
+}
+
+bool json_writer_finish(json_writer_t *writer) {
+    flush(writer);
+    return !writer->failed && writer->depth == 0;
+}
@@ -0,0 +1,82 @@
+/**
+ * @file json_writer.h
+ * @brief Streaming JSON emitter over a fixed scratch buffer
+ *
+ * Writes JSON text into a caller-provided buffer and hands it to a sink
+ * (e.g. httpd_resp_send_chunk()) whenever the buffer fills, so documents of
+ * any length are produced in constant memory and without allocations.
+ * Nesting and commas are tracked by the writer; callers only open and close
+ * containers and add members.
+ *
+ * Numbers are printed the way cJSON_PrintUnformatted() prints them, so
+ * responses are unchanged for clients that were written against cJSON.
+ *
+ * Plain C without ESP-IDF dependencies so the host benchmark can use it.
+ */
+
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Deepest container nesting
+#define JSON_WRITER_MAX_DEPTH   32
+
+/**
+ * Receives the output in pieces
+ * @return false to abort (the writer stops emitting and reports failure)
+ */
+typedef bool (*json_writer_sink_t)(void *ctx, const char *data, size_t len);
+
+/**
+ * Writer state (treat as opaque)
+ */
+typedef struct {
+    char *buffer;
+    size_t size;
+    size_t len;
+    json_writer_sink_t sink;
+    void *ctx;
+    uint32_t has_member;            // Bit per depth: a value was written at that level
+    uint8_t depth;
+    bool failed;
+    uint32_t total;                 // Bytes handed to the sink
+} json_writer_t;
+
+/**
+ * Start a document
+ * @param buffer Scratch buffer (a few hundred bytes is enough)
+ * @param size Its size
+ * @param sink Output function
+ * @param ctx Passed to the sink
+ */
+void json_writer_init(json_writer_t *writer, char *buffer, size_t size,
+                      json_writer_sink_t sink, void *ctx);
+
+// Containers. key is the member name inside an object, NULL inside an array
+// or for the root.
+void json_writer_begin_object(json_writer_t *writer, const char *key);
+void json_writer_end_object(json_writer_t *writer);
+void json_writer_begin_array(json_writer_t *writer, const char *key);
+void json_writer_end_array(json_writer_t *writer);
+
+// Values
+void json_writer_number(json_writer_t *writer, const char *key, double value);
+void json_writer_bool(json_writer_t *writer, const char *key, bool value);
+void json_writer_string(json_writer_t *writer, const char *key, const char *value);
+
+/**
+ * Whether every chunk so far reached the sink
+ * @return false once the sink failed (later output is dropped)
+ */
+bool json_writer_ok(const json_writer_t *writer);
+
+/**
+ * Hand the rest of the buffer to the sink
+ * @return false if the sink failed or containers are still open
+ */
+bool json_writer_finish(json_writer_t *writer);
+
+#endif // JSON_WRITER_H
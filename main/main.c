@@ -33,13 +33,16 @@
 #include "sensor_manager.h"
 #include "stroke_detector.h"
 #include "metrics_calculator.h"
+#include "event_bus.h"
 #include "ble_ftms_server.h"
 #include "ble_hr_client.h"
 #include "wifi_manager.h"
 #include "web_server.h"
 #include "config_manager.h"
 #include "session_manager.h"
+#include "session_series.h"
 #include "hr_receiver.h"
+#include "trace_recorder.h"
 #include "dns_server.h"
 #include "utils.h"
 
@@ -75,9 +78,10 @@ static void metrics_update_task(void *arg) {
     
     TickType_t last_wake_time = xTaskGetTickCount();
     const TickType_t update_period = pdMS_TO_TICKS(100);  // 10Hz update rate
-    uint32_t sample_counter = 0;  // Counter for 1-second sample recording
     
     while (g_running) {
+        metrics_calculator_begin_update();
+        
         // Update derived metrics
         metrics_calculator_update(&g_metrics, &g_config);
         
@@ -87,15 +91,15 @@ static void metrics_update_task(void *arg) {
         // Check for auto-start/pause based on flywheel activity
         session_manager_check_activity(&g_metrics, &g_config);
         
-        // Record per-second sample for graphs (every 10 updates = 1 second)
-        sample_counter++;
-        if (sample_counter >= 10) {
-            sample_counter = 0;
-            // Only record if session is active and not paused
-            if (session_manager_get_current_session_id() > 0 && !g_metrics.is_paused) {
-                uint8_t hr = hr_receiver_get_current();
-                session_manager_record_sample(&g_metrics, hr);
-            }
+        metrics_calculator_end_update(&g_metrics);
+        event_bus_publish(EVENT_BUS_METRICS, esp_timer_get_time());
+        
+        // Per-second samples for graphs: the sampler cuts rows at whole
+        // seconds of session time, so it sees every update (paused too)
+        if (session_manager_get_current_session_id() > 0) {
+            rowing_metrics_t snapshot;
+            metrics_calculator_get_snapshot(&snapshot);
+            session_manager_record_sample(&snapshot, hr_receiver_get_current());
         }
         
         vTaskDelayUntil(&last_wake_time, update_period);
@@ -107,37 +111,58 @@ static void metrics_update_task(void *arg) {
 
 /**
  * Broadcast task
- * Sends metrics to BLE and WebSocket clients
+ * Sends metrics to BLE and WebSocket clients, and each stroke's record to
+ * WebSocket subscribers. Woken by the event bus: stroke
+ * boundaries (catch, finish) are pushed as soon as the sensor task has
+ * published them, everything else at the regular intervals, driven by the
+ * metrics task ticks. The bus rate limit caps the sends.
  */
 static void broadcast_task(void *arg) {
     ESP_LOGI(TAG, "Broadcast task started");
     
-    uint32_t ble_counter = 0;
-    uint32_t ws_counter = 0;
-    const uint32_t ble_divisor = BLE_NOTIFY_INTERVAL_MS / 100;
-    const uint32_t ws_divisor = WS_BROADCAST_INTERVAL_MS / 100;
+    int subscriber = event_bus_subscribe(EVENT_BUS_STROKE_EVENTS | EVENT_BUS_METRICS,
+                                         EVENT_BUS_MIN_INTERVAL_MS);
+    int64_t last_ble_us = 0;
+    int64_t last_ws_us = 0;
+    
+    // Static: the task stack is sized for the BLE/HTTP calls, not for a
+    // second copy of the metrics
+    static rowing_metrics_t snapshot;
     
     while (g_running) {
-        ble_counter++;
-        ws_counter++;
+        int64_t pulse_time_us;
+        uint32_t events = event_bus_wait(subscriber, pdMS_TO_TICKS(WS_BROADCAST_INTERVAL_MS),
+                                         &pulse_time_us);
+        int64_t now = esp_timer_get_time();
+        bool stroke_boundary = (events & (EVENT_BUS_CATCH | EVENT_BUS_FINISH)) != 0;
         
-        // Send BLE notification
-        if (ble_counter >= ble_divisor && g_config.ble_enabled) {
-            ble_counter = 0;
+        // Send BLE notification (FTMS rower data changes per stroke)
+        if (g_config.ble_enabled &&
+            ((events & EVENT_BUS_STROKE) || now - last_ble_us >= BLE_NOTIFY_INTERVAL_MS * 1000LL)) {
+            last_ble_us = now;
             if (ble_ftms_is_connected()) {
-                ble_ftms_notify_metrics(&g_metrics);
+                metrics_calculator_get_snapshot(&snapshot);
+                ble_ftms_notify_metrics(&snapshot);
+                if (events & EVENT_BUS_STROKE) {
+                    event_bus_record_latency(EVENT_BUS_SINK_BLE, pulse_time_us);
+                }
             }
         }
         
-        // Send WebSocket broadcast
-        if (ws_counter >= ws_divisor && g_config.wifi_enabled) {
-            ws_counter = 0;
-            if (web_server_has_ws_clients()) {
-                web_server_broadcast_metrics(&g_metrics);
+        // Send WebSocket/SSE broadcast (encodes from the latest snapshot itself)
+        if (g_config.wifi_enabled &&
+            (stroke_boundary || now - last_ws_us >= WS_BROADCAST_INTERVAL_MS * 1000LL)) {
+            last_ws_us = now;
+            if (web_server_has_ws_clients() && web_server_broadcast_metrics() == ESP_OK &&
+                stroke_boundary) {
+                event_bus_record_latency(EVENT_BUS_SINK_WEB, pulse_time_us);
             }
         }
         
-        vTaskDelay(pdMS_TO_TICKS(100));
+        // Stroke record of a finished stroke, behind the metrics of its finish
+        if (g_config.wifi_enabled && (events & EVENT_BUS_STROKE) && web_server_has_ws_clients()) {
+            web_server_broadcast_stroke();
+        }
     }
     
     ESP_LOGI(TAG, "Broadcast task stopped");
@@ -171,6 +196,15 @@ static esp_err_t init_subsystems(void) {
     if (ret != ESP_OK) {
         ESP_LOGW(TAG, "Failed to initialize session manager");
     }
+    session_series_set_max_heart_rate(g_config.max_heart_rate);
+    session_manager_set_recording_profile((recording_profile_t)g_config.recording_profile);
+    
+    // Initialize raw pulse trace recorder
+    ESP_LOGI(TAG, "Initializing trace recorder...");
+    ret = trace_recorder_init();
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Trace recording unavailable");
+    }
     
     // Initialize heart rate receiver
     ESP_LOGI(TAG, "Initializing heart rate receiver...");
@@ -344,6 +378,9 @@ static void start_tasks(void) {
         BLE_TASK_PRIORITY,
         &broadcast_task_handle
     );
+    
+    // Session samples go to flash in the background
+    session_manager_start_storage_task();
 }
 
 /**
@@ -375,12 +412,14 @@ void app_main(void) {
         loop_counter++;
         
         // Log status
-        if (g_metrics.is_active) {
+        rowing_metrics_t snapshot;
+        metrics_calculator_get_snapshot(&snapshot);
+        if (snapshot.is_active) {
             ESP_LOGI(TAG, "Active: %lu strokes, %.1fm, SPM=%.1f, Power=%.0fW",
-                     (unsigned long)g_metrics.stroke_count,
-                     g_metrics.total_distance_meters,
-                     g_metrics.stroke_rate_spm,
-                     g_metrics.instantaneous_power_watts);
+                     (unsigned long)snapshot.stroke_count,
+                     snapshot.total_distance_meters,
+                     snapshot.stroke_rate_spm,
+                     snapshot.instantaneous_power_watts);
         } else {
             ESP_LOGD(TAG, "Idle (heap: %lu, min: %lu)",
                      (unsigned long)utils_get_free_heap(),
@@ -396,7 +435,13 @@ void app_main(void) {
     g_running = false;
     
     // End session
+    metrics_calculator_begin_update();
     session_manager_end_session(&g_metrics);
+    metrics_calculator_end_update(&g_metrics);
+    if (trace_recorder_is_recording()) {
+        trace_recorder_stop();
+    }
+    session_manager_flush();
     
     // Stop tasks
     vTaskDelay(pdMS_TO_TICKS(500));
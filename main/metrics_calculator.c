@@ -4,12 +4,16 @@
  */
 
 #include "metrics_calculator.h"
+#include "metrics_snapshot.h"
 #include "app_config.h"
 #include "hr_receiver.h"
 #include "ble_hr_client.h"
 #include "session_manager.h"
+#include "session_series.h"
 #include "esp_log.h"
 #include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 #include <stdio.h>
 #include <string.h>
 
@@ -17,6 +21,15 @@ static const char *TAG = "METRICS";
 
 static float g_user_weight_kg = DEFAULT_USER_WEIGHT_KG;
 
+// Serializes tasks that modify the live metrics (sensor task, metrics task,
+// HTTP handlers). Readers never take it; they use the snapshot.
+static SemaphoreHandle_t s_update_mutex = NULL;
+
+// Latest published metrics. Publishing runs in a critical section so a
+// reader on the same core cannot preempt a half-written copy and spin.
+static metrics_snapshot_t s_snapshot;
+static portMUX_TYPE s_publish_lock = portMUX_INITIALIZER_UNLOCKED;
+
 /**
  * Initialize metrics calculator
  */
@@ -25,7 +38,13 @@ void metrics_calculator_init(rowing_metrics_t *metrics, const config_t *config)
         g_user_weight_kg = config->user_weight_kg;
     }
     
+    if (s_update_mutex == NULL) {
+        s_update_mutex = xSemaphoreCreateMutex();
+    }
+    
     rowing_physics_init(metrics, config);
+    metrics_snapshot_init(&s_snapshot);
+    metrics_calculator_publish(metrics);
     
     ESP_LOGI(TAG, "Metrics calculator initialized");
     ESP_LOGI(TAG, "User weight: %.1f kg", g_user_weight_kg);
@@ -48,11 +67,125 @@ void metrics_calculator_update(rowing_metrics_t *metrics, const config_t *config
 }
 
 /**
- * Get metrics as a thread-safe snapshot
+ * Start modifying the live metrics
+ */
+void metrics_calculator_begin_update(void) {
+    if (s_update_mutex != NULL) {
+        xSemaphoreTake(s_update_mutex, portMAX_DELAY);
+    }
+}
+
+/**
+ * Publish the modified metrics and release them
+ */
+void metrics_calculator_end_update(const rowing_metrics_t *metrics) {
+    metrics_calculator_publish(metrics);
+    if (s_update_mutex != NULL) {
+        xSemaphoreGive(s_update_mutex);
+    }
+}
+
+/**
+ * Publish the current metrics to readers
+ */
+void metrics_calculator_publish(const rowing_metrics_t *metrics) {
+    portENTER_CRITICAL(&s_publish_lock);
+    metrics_snapshot_publish(&s_snapshot, metrics);
+    portEXIT_CRITICAL(&s_publish_lock);
+}
+
+/**
+ * Get the last published metrics as a consistent snapshot
+ */
+uint32_t metrics_calculator_get_snapshot(rowing_metrics_t *snapshot) {
+    return metrics_snapshot_read(&s_snapshot, snapshot);
+}
+
+/**
+ * Get the sequence number of the last publish
+ */
+uint32_t metrics_calculator_get_sequence(void) {
+    return metrics_snapshot_sequence(&s_snapshot);
+}
+
+static void put_u16(uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void put_u32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+/**
+ * Round a scaled value into a u16 field
+ */
+static uint16_t to_u16(float value, float scale) {
+    float scaled = value * scale + 0.5f;
+    if (!(scaled > 0.0f)) {
+        return 0;
+    }
+    return scaled >= 65535.0f ? 65535 : (uint16_t)scaled;
+}
+
+/**
+ * Pace field: 0.1 s/500m, 0 when there is no pace to show
+ */
+static uint16_t pace_to_u16(float pace_seconds) {
+    if (pace_seconds >= 6553.4f) {
+        return 0;
+    }
+    return to_u16(pace_seconds, 10.0f);
+}
+
+/**
+ * Format metrics as a binary frame
  */
-void metrics_calculator_get_snapshot(const rowing_metrics_t *metrics, rowing_metrics_t *snapshot) {
-    // Simple copy - in a multi-threaded environment, this should use a mutex
-    memcpy(snapshot, metrics, sizeof(rowing_metrics_t));
+void metrics_calculator_to_binary(const rowing_metrics_t *metrics, uint16_t sequence, uint8_t *buffer) {
+    session_series_stats_t hr_stats;
+    session_series_get_stats(&hr_stats);
+    
+    uint8_t phase = metrics->current_phase == STROKE_PHASE_DRIVE ? 1 :
+                    (metrics->current_phase == STROKE_PHASE_RECOVERY ? 2 : 0);
+    uint8_t flags = (metrics->is_active ? 0x01 : 0) |
+                    (metrics->is_paused ? 0x02 : 0) |
+                    (hr_receiver_is_valid() ? 0x04 : 0) |
+                    (uint8_t)(phase << 3) |
+                    (uint8_t)((ble_hr_client_get_state() & 0x07) << 5);
+    
+    // Same power the JSON shows
+    float display_power = metrics->display_power_watts;
+    if (display_power <= 0 && metrics->instantaneous_power_watts > 0) {
+        display_power = metrics->instantaneous_power_watts;
+    }
+    
+    float distance_dm = metrics->total_distance_meters * 10.0f + 0.5f;
+    float confidence = metrics->drag_confidence * 100.0f + 0.5f;
+    
+    buffer[0] = METRICS_BINARY_VERSION;
+    buffer[1] = flags;
+    put_u16(&buffer[2], sequence);
+    put_u32(&buffer[4], session_manager_get_current_session_id());
+    put_u32(&buffer[8], distance_dm > 0.0f ? (uint32_t)distance_dm : 0);
+    put_u32(&buffer[12], metrics->elapsed_time_ms / 1000);
+    put_u32(&buffer[16], metrics->stroke_count);
+    put_u16(&buffer[20], pace_to_u16(metrics->instantaneous_pace_sec_500m));
+    put_u16(&buffer[22], pace_to_u16(metrics->average_pace_sec_500m));
+    put_u16(&buffer[24], to_u16(display_power, 1.0f));
+    put_u16(&buffer[26], to_u16(metrics->average_power_watts, 1.0f));
+    put_u16(&buffer[28], to_u16(metrics->peak_power_watts, 1.0f));
+    put_u16(&buffer[30], to_u16(metrics->stroke_rate_spm, 10.0f));
+    put_u16(&buffer[32], to_u16(metrics->avg_stroke_rate_spm, 10.0f));
+    put_u16(&buffer[34], metrics->total_calories > 65535 ? 65535 : (uint16_t)metrics->total_calories);
+    put_u16(&buffer[36], to_u16(metrics->calories_per_hour, 1.0f));
+    put_u16(&buffer[38], to_u16(metrics->drag_factor, 10.0f));
+    buffer[40] = confidence > 0.0f ? (confidence >= 100.0f ? 100 : (uint8_t)confidence) : 0;
+    buffer[41] = hr_receiver_get_current();
+    buffer[42] = hr_stats.avg_hr;
+    buffer[43] = 0;
 }
 
 /**
@@ -77,10 +210,9 @@ int metrics_calculator_to_json(const rowing_metrics_t *metrics, char *buffer, si
     uint8_t heart_rate = hr_receiver_get_current();
     bool hr_valid = hr_receiver_is_valid();
     
-    // Get HR statistics
-    uint8_t avg_hr = 0, max_hr = 0;
-    uint16_t hr_count = 0;
-    hr_receiver_get_stats(&avg_hr, &max_hr, &hr_count);
+    // Get HR statistics of the session's samples
+    session_series_stats_t hr_stats;
+    session_series_get_stats(&hr_stats);
     
     // Get BLE HR client state
     ble_hr_state_t hr_state = ble_hr_client_get_state();
@@ -130,6 +262,7 @@ int metrics_calculator_to_json(const rowing_metrics_t *metrics, char *buffer, si
         "\"caloriesPerHour\":%.0f,"
         "\"elapsedTime\":%lu,"
         "\"dragFactor\":%.1f,"
+        "\"dragConfidence\":%.2f,"
         "\"isActive\":%s,"
         "\"isPaused\":%s,"
         "\"phase\":\"%s\","
@@ -154,12 +287,13 @@ int metrics_calculator_to_json(const rowing_metrics_t *metrics, char *buffer, si
         metrics->calories_per_hour,
         (unsigned long)(metrics->elapsed_time_ms / 1000),
         metrics->drag_factor,
+        metrics->drag_confidence,
         metrics->is_active ? "true" : "false",
         metrics->is_paused ? "true" : "false",
         metrics->current_phase == STROKE_PHASE_IDLE ? "idle" : 
             (metrics->current_phase == STROKE_PHASE_DRIVE ? "drive" : "recovery"),
         (unsigned int)heart_rate,
-        (unsigned int)avg_hr,
+        (unsigned int)hr_stats.avg_hr,
         hr_valid ? "true" : "false",
         hr_status
     );
@@ -24,11 +24,39 @@ void metrics_calculator_init(rowing_metrics_t *metrics, const config_t *config);
 void metrics_calculator_update(rowing_metrics_t *metrics, const config_t *config);
 
 /**
- * Get metrics as a snapshot (thread-safe copy)
- * @param metrics Source metrics
+ * Start modifying the live metrics
+ * Takes the update mutex shared by every task that writes the metrics.
+ * Must be paired with metrics_calculator_end_update().
+ */
+void metrics_calculator_begin_update(void);
+
+/**
+ * Publish the modified metrics and release the update mutex
+ * @param metrics Live metrics structure
+ */
+void metrics_calculator_end_update(const rowing_metrics_t *metrics);
+
+/**
+ * Publish the current metrics to readers without releasing the update mutex
+ * (e.g. after every flywheel pulse of a batch)
+ * @param metrics Live metrics structure (caller holds the update mutex)
+ */
+void metrics_calculator_publish(const rowing_metrics_t *metrics);
+
+/**
+ * Get the last published metrics (thread-safe copy)
+ * Never blocks; any task or core may call it at any rate.
  * @param snapshot Destination snapshot
+ * @return Sequence number of the copied publish
  */
-void metrics_calculator_get_snapshot(const rowing_metrics_t *metrics, rowing_metrics_t *snapshot);
+uint32_t metrics_calculator_get_snapshot(rowing_metrics_t *snapshot);
+
+/**
+ * Get the sequence number of the last publish without copying
+ * Equal sequence numbers mean nothing was published in between.
+ * @return Sequence number (even, advances with every publish)
+ */
+uint32_t metrics_calculator_get_sequence(void);
 
 /**
  * Format metrics as JSON string
@@ -39,6 +67,52 @@ void metrics_calculator_get_snapshot(const rowing_metrics_t *metrics, rowing_met
  */
 int metrics_calculator_to_json(const rowing_metrics_t *metrics, char *buffer, size_t buf_len);
 
+/**
+ * Binary metrics frame ("rowing.bin.v1" WebSocket subprotocol)
+ *
+ * Packed, little-endian, METRICS_BINARY_SIZE bytes:
+ *
+ *   off  type  field
+ *     0  u8    version (METRICS_BINARY_VERSION)
+ *     1  u8    flags: bit0 active, bit1 paused, bit2 HR valid,
+ *              bits3-4 phase (0 idle, 1 drive, 2 recovery),
+ *              bits5-7 HR monitor state (ble_hr_state_t)
+ *     2  u16   frame sequence number (wraps)
+ *     4  u32   session id
+ *     8  u32   distance (0.1 m)
+ *    12  u32   elapsed time (s)
+ *    16  u32   stroke count
+ *    20  u16   current pace (0.1 s/500m, 0 = none)
+ *    22  u16   average pace (0.1 s/500m, 0 = none)
+ *    24  u16   power (W, display power as in the JSON)
+ *    26  u16   average power (W)
+ *    28  u16   peak power (W)
+ *    30  u16   stroke rate (0.1 spm)
+ *    32  u16   average stroke rate (0.1 spm)
+ *    34  u16   calories (kcal)
+ *    36  u16   calories per hour
+ *    38  u16   drag factor (0.1)
+ *    40  u8    drag confidence (%)
+ *    41  u8    heart rate (bpm)
+ *    42  u8    average heart rate (bpm)
+ *    43  u8    reserved (0)
+ *
+ * Values are rounded and clamped to their field. Fields are only ever
+ * appended; a layout change that breaks old decoders bumps the version and
+ * the subprotocol name.
+ */
+#define METRICS_BINARY_VERSION      1
+#define METRICS_BINARY_SIZE         44
+#define METRICS_WS_SUBPROTOCOL      "rowing.bin.v1"
+
+/**
+ * Encode metrics as a binary frame (layout above)
+ * @param metrics Pointer to metrics structure
+ * @param sequence Frame sequence number
+ * @param buffer Output buffer of at least METRICS_BINARY_SIZE bytes
+ */
+void metrics_calculator_to_binary(const rowing_metrics_t *metrics, uint16_t sequence, uint8_t *buffer);
+
 /**
  * Reset all metrics for new session
  * @param metrics Pointer to metrics structure
@@ -0,0 +1,167 @@
+/**
+ * @file metrics_delta.c
+ * @brief Changed-field updates between two encoded metrics frames
+ */
+
+#include "metrics_delta.h"
+#include <string.h>
+
+/**
+ * Binary keyframe fields in delta mask order (offset, size)
+ */
+static const uint8_t s_field_offset[] = { 1, 4, 8, 12, 16, 20, 22, 24, 26, 28, 30, 32, 34, 36, 38, 40, 41, 42 };
+static const uint8_t s_field_size[]   = { 1, 4, 4,  4,  4,  2,  2,  2,  2,  2,  2,  2,  2,  2,  2,  1,  1,  1 };
+
+#define BINARY_FIELDS   (sizeof(s_field_offset) / sizeof(s_field_offset[0]))
+
+size_t metrics_delta_binary(const uint8_t *prev, const uint8_t *cur, uint8_t *out) {
+    uint32_t mask = 0;
+    size_t len = METRICS_BINARY_DELTA_HEADER;
+
+    for (size_t i = 0; i < BINARY_FIELDS; i++) {
+        const uint8_t offset = s_field_offset[i];
+        const uint8_t size = s_field_size[i];
+        if (memcmp(prev + offset, cur + offset, size) != 0) {
+            mask |= 1UL << i;
+            memcpy(out + len, cur + offset, size);
+            len += size;
+        }
+    }
+    if (mask == 0) {
+        return 0;
+    }
+
+    out[0] = METRICS_BINARY_VERSION | METRICS_BINARY_DELTA_FLAG;
+    out[1] = (uint8_t)mask;
+    out[2] = (uint8_t)(mask >> 8);
+    out[3] = (uint8_t)(mask >> 16);
+    return len;
+}
+
+bool metrics_delta_apply_binary(uint8_t *frame, const uint8_t *delta, size_t len) {
+    if (len < METRICS_BINARY_DELTA_HEADER ||
+        delta[0] != (METRICS_BINARY_VERSION | METRICS_BINARY_DELTA_FLAG)) {
+        return false;
+    }
+    uint32_t mask = delta[1] | ((uint32_t)delta[2] << 8) | ((uint32_t)delta[3] << 16);
+    if (mask >> BINARY_FIELDS) {
+        return false;
+    }
+
+    size_t pos = METRICS_BINARY_DELTA_HEADER;
+    for (size_t i = 0; i < BINARY_FIELDS; i++) {
+        if ((mask & (1UL << i)) == 0) {
+            continue;
+        }
+        if (pos + s_field_size[i] > len) {
+            return false;
+        }
+        memcpy(frame + s_field_offset[i], delta + pos, s_field_size[i]);
+        pos += s_field_size[i];
+    }
+    return pos == len;
+}
+
+/**
+ * Find the next "key":value member of a flat JSON object
+ * @param json Object text
+ * @param len Its length
+ * @param pos In: position after '{' or the previous member's ','; out: same for the next member
+ * @param start Member start
+ * @param end Member end (exclusive)
+ * @return false at the end of the object
+ */
+static bool next_member(const char *json, size_t len, size_t *pos, size_t *start, size_t *end) {
+    size_t i = *pos;
+    if (i >= len || json[i] == '}') {
+        return false;
+    }
+
+    *start = i;
+    bool in_string = false;
+    for (; i < len; i++) {
+        char c = json[i];
+        if (in_string) {
+            if (c == '\\') {
+                i++;
+            } else if (c == '"') {
+                in_string = false;
+            }
+        } else if (c == '"') {
+            in_string = true;
+        } else if (c == ',' || c == '}') {
+            break;
+        }
+    }
+
+    *end = i;
+    *pos = i < len && json[i] == ',' ? i + 1 : i;
+    return *end > *start;
+}
+
+/**
+ * Length of a member's "key" including the quotes
+ */
+static size_t key_length(const char *member, size_t len) {
+    for (size_t i = 1; i < len; i++) {
+        if (member[i] == '"') {
+            return i + 1;
+        }
+    }
+    return len;
+}
+
+int metrics_delta_json(const char *prev, size_t prev_len, const char *cur, size_t cur_len,
+                       char *out, size_t out_len) {
+    static const char header[] = "{\"delta\":true";
+    if (prev_len < 2 || cur_len < 2 || prev[0] != '{' || cur[0] != '{' ||
+        out_len < sizeof(header) + 1) {
+        return -1;
+    }
+
+    size_t len = sizeof(header) - 1;
+    memcpy(out, header, len);
+    bool changed = false;
+
+    size_t prev_pos = 1;
+    size_t cur_pos = 1;
+    size_t prev_start, prev_end, cur_start, cur_end;
+    while (true) {
+        bool have_prev = next_member(prev, prev_len, &prev_pos, &prev_start, &prev_end);
+        bool have_cur = next_member(cur, cur_len, &cur_pos, &cur_start, &cur_end);
+        if (have_prev != have_cur) {
+            return -1;
+        }
+        if (!have_cur) {
+            break;
+        }
+
+        const char *prev_member = prev + prev_start;
+        const char *cur_member = cur + cur_start;
+        size_t prev_size = prev_end - prev_start;
+        size_t cur_size = cur_end - cur_start;
+        size_t key = key_length(cur_member, cur_size);
+        if (key_length(prev_member, prev_size) != key || memcmp(prev_member, cur_member, key) != 0) {
+            return -1;
+        }
+        if (prev_size == cur_size && memcmp(prev_member, cur_member, cur_size) == 0) {
+            continue;
+        }
+
+        // ",<member>" and room for the closing brace
+        if (len + 1 + cur_size + 1 >= out_len) {
+            return -1;
+        }
+        out[len++] = ',';
+        memcpy(out + len, cur_member, cur_size);
+        len += cur_size;
+        changed = true;
+    }
+
+    if (!changed) {
+        return 0;
+    }
+    out[len++] = '}';
+    out[len] = '\0';
+    return (int)len;
+}
@@ -0,0 +1,81 @@
+/**
+ * @file metrics_delta.h
+ * @brief Changed-field updates between two encoded metrics frames
+ *
+ * Streaming clients get a full frame (keyframe) first and then only the
+ * fields that changed since the frame they last received. Both encodings
+ * are diffed field by field:
+ *
+ * - JSON: the metrics JSON is a flat object whose fields always come in the
+ *   same order, so the delta is the object of fields whose text differs,
+ *   marked with "delta":true, e.g. {"delta":true,"distance":812.4}.
+ *   Clients merge it into the last state they have.
+ * - Binary ("rowing.bin.v1"): byte 0 is METRICS_BINARY_VERSION |
+ *   METRICS_BINARY_DELTA_FLAG, bytes 1-3 a little-endian mask of changed
+ *   fields (bit i = field i below), then the changed fields' bytes in field
+ *   order, in the keyframe's encoding:
+ *
+ *     0 flags, 1 session id, 2 distance, 3 elapsed time, 4 stroke count,
+ *     5 pace, 6 average pace, 7 power, 8 average power, 9 peak power,
+ *     10 stroke rate, 11 average stroke rate, 12 calories,
+ *     13 calories per hour, 14 drag factor, 15 drag confidence,
+ *     16 heart rate, 17 average heart rate
+ *
+ *   The keyframe's sequence number is not part of deltas.
+ *
+ * An empty delta (nothing changed) is not sent at all, so an idle or paused
+ * session costs only the periodic keyframes.
+ *
+ * Plain C without ESP-IDF dependencies so the host benchmark can use it.
+ */
+
+#ifndef METRICS_DELTA_H
+#define METRICS_DELTA_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "metrics_calculator.h"
+
+// Byte 0 of a binary delta: version | this flag
+#define METRICS_BINARY_DELTA_FLAG       0x80
+
+// Binary delta header (type byte + 24-bit field mask)
+#define METRICS_BINARY_DELTA_HEADER     4
+
+// Largest binary delta (every field changed)
+#define METRICS_BINARY_DELTA_MAX        (METRICS_BINARY_DELTA_HEADER + METRICS_BINARY_SIZE)
+
+/**
+ * Binary delta between two keyframes
+ * @param prev Keyframe the client has (METRICS_BINARY_SIZE bytes)
+ * @param cur New keyframe
+ * @param out Output of at least METRICS_BINARY_DELTA_MAX bytes
+ * @return Delta length, 0 if no field changed
+ */
+size_t metrics_delta_binary(const uint8_t *prev, const uint8_t *cur, uint8_t *out);
+
+/**
+ * Apply a binary delta to a keyframe (inverse of metrics_delta_binary())
+ * @param frame Keyframe to update in place
+ * @param delta Delta message
+ * @param len Delta length
+ * @return false if the message is not a valid delta
+ */
+bool metrics_delta_apply_binary(uint8_t *frame, const uint8_t *delta, size_t len);
+
+/**
+ * JSON delta between two metrics JSON objects
+ * @param prev JSON the client has
+ * @param prev_len Its length
+ * @param cur New JSON
+ * @param cur_len Its length
+ * @param out Output buffer
+ * @param out_len Output buffer size
+ * @return Delta length, 0 if no field changed, -1 if the two objects do not
+ *         have the same fields (send a keyframe instead) or out is too small
+ */
+int metrics_delta_json(const char *prev, size_t prev_len, const char *cur, size_t cur_len,
+                       char *out, size_t out_len);
+
+#endif // METRICS_DELTA_H
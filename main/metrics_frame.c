@@ -0,0 +1,108 @@
+/**
+ * @file metrics_frame.c
+ * @brief Encode-once metrics frame shared by every streaming client and poller
+ */
+
+#include "metrics_frame.h"
+#include "app_config.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "METRICS_FRAME";
+
+// Room for the prefix, the JSON and "\n\n" + NUL
+#define FRAME_ALLOC_SIZE    (sizeof(metrics_frame_t) + METRICS_FRAME_SSE_PREFIX_LEN + JSON_BUFFER_SIZE + 3)
+
+// Current frame (the cache holds one reference) and counters, under s_mutex.
+// Encoding happens under the mutex too, so concurrent callers wait for one
+// encode instead of each doing their own.
+static SemaphoreHandle_t s_mutex = NULL;
+static metrics_frame_t *s_current = NULL;
+static bool s_valid = false;
+static metrics_frame_stats_t s_stats;
+
+void metrics_frame_init(void) {
+    if (s_mutex == NULL) {
+        s_mutex = xSemaphoreCreateMutex();
+    }
+}
+
+/**
+ * Encode the latest metrics into a frame
+ */
+static bool encode(metrics_frame_t *frame) {
+    rowing_metrics_t snapshot;
+    frame->sequence = metrics_calculator_get_snapshot(&snapshot);
+
+    memcpy(frame->sse, "data: ", METRICS_FRAME_SSE_PREFIX_LEN);
+    char *json = frame->sse + METRICS_FRAME_SSE_PREFIX_LEN;
+    int len = metrics_calculator_to_json(&snapshot, json, JSON_BUFFER_SIZE);
+    if (len <= 0 || len >= JSON_BUFFER_SIZE) {
+        ESP_LOGE(TAG, "Metrics JSON does not fit (%d bytes)", len);
+        return false;
+    }
+    memcpy(json + len, "\n\n", 3);
+
+    frame->json_len = (uint16_t)len;
+    frame->sse_len = (uint16_t)(METRICS_FRAME_SSE_PREFIX_LEN + len + 2);
+    
+    s_stats.encodes++;
+    metrics_calculator_to_binary(&snapshot, (uint16_t)s_stats.encodes, frame->binary);
+    return true;
+}
+
+metrics_frame_t *metrics_frame_acquire(void) {
+    if (s_mutex == NULL) {
+        return NULL;
+    }
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+
+    if (!s_valid || s_current->sequence != metrics_calculator_get_sequence()) {
+        // Nobody else holds the cached frame: encode over it in place.
+        // Otherwise its holders keep the old bytes and the cache moves on.
+        if (s_current != NULL && atomic_load(&s_current->refs) != 1) {
+            metrics_frame_release(s_current);
+            s_current = NULL;
+        }
+        if (s_current == NULL) {
+            s_current = malloc(FRAME_ALLOC_SIZE);
+            if (s_current == NULL) {
+                s_valid = false;
+                xSemaphoreGive(s_mutex);
+                return NULL;
+            }
+            atomic_init(&s_current->refs, 1);
+        }
+        s_valid = encode(s_current);
+        if (!s_valid) {
+            xSemaphoreGive(s_mutex);
+            return NULL;
+        }
+    }
+
+    atomic_fetch_add(&s_current->refs, 1);
+    s_stats.acquires++;
+    metrics_frame_t *frame = s_current;
+
+    xSemaphoreGive(s_mutex);
+    return frame;
+}
+
+void metrics_frame_release(metrics_frame_t *frame) {
+    if (frame != NULL && atomic_fetch_sub(&frame->refs, 1) == 1) {
+        free(frame);
+    }
+}
+
+void metrics_frame_get_stats(metrics_frame_stats_t *stats) {
+    if (s_mutex == NULL) {
+        memset(stats, 0, sizeof(*stats));
+        return;
+    }
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    *stats = s_stats;
+    xSemaphoreGive(s_mutex);
+}
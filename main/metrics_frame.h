@@ -0,0 +1,79 @@
+/**
+ * @file metrics_frame.h
+ * @brief Encode-once metrics frame shared by every streaming client and poller
+ *
+ * The metrics are encoded once per published metrics state into an
+ * immutable, reference-counted frame that holds the SSE event
+ * ("data: <json>\n\n") and the binary frame of the "rowing.bin.v1"
+ * WebSocket subprotocol. The JSON alone (text WebSocket payload,
+ * /api/metrics and /live body) is a slice of the SSE bytes. WebSocket, SSE
+ * and HTTP pollers all send from the current frame, so the encode cost per
+ * broadcast does not depend on the number of clients.
+ *
+ * A frame is re-encoded only when the metrics snapshot has been published
+ * since (metrics_calculator_get_sequence()). Heart rate and session fields in
+ * the JSON are read at encode time, so they may lag by up to one metrics
+ * tick (100ms).
+ */
+
+#ifndef METRICS_FRAME_H
+#define METRICS_FRAME_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include "metrics_calculator.h"
+
+// Length of the "data: " prefix in front of the JSON
+#define METRICS_FRAME_SSE_PREFIX_LEN    6
+
+/**
+ * Encoded metrics (read-only once returned by metrics_frame_acquire())
+ */
+typedef struct {
+    atomic_uint refs;               // Holders, including the cache
+    uint32_t sequence;              // Metrics publish it was encoded from
+    uint8_t binary[METRICS_BINARY_SIZE];    // metrics_calculator_to_binary() frame
+    uint16_t json_len;              // Bytes of JSON
+    uint16_t sse_len;               // Bytes of the whole SSE event
+    char sse[];                     // "data: <json>\n\n", NUL terminated
+} metrics_frame_t;
+
+/**
+ * Frame cache counters
+ */
+typedef struct {
+    uint32_t encodes;               // Times the JSON was encoded
+    uint32_t acquires;              // Frames handed out (each encode serves many)
+} metrics_frame_stats_t;
+
+/**
+ * Initialize the frame cache (call once before the web server starts)
+ */
+void metrics_frame_init(void);
+
+/**
+ * Get the frame for the latest published metrics
+ * Encodes a new frame only if the metrics changed since the cached one.
+ * @return Frame holding a reference the caller must release, NULL if out of memory
+ */
+metrics_frame_t *metrics_frame_acquire(void);
+
+/**
+ * Drop a reference obtained from metrics_frame_acquire()
+ */
+void metrics_frame_release(metrics_frame_t *frame);
+
+/**
+ * JSON body of a frame (not NUL terminated; use frame->json_len)
+ */
+static inline const char *metrics_frame_json(const metrics_frame_t *frame) {
+    return frame->sse + METRICS_FRAME_SSE_PREFIX_LEN;
+}
+
+/**
+ * Get cache counters
+ */
+void metrics_frame_get_stats(metrics_frame_stats_t *stats);
+
+#endif // METRICS_FRAME_H
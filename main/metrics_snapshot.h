@@ -0,0 +1,92 @@
+/**
+ * @file metrics_snapshot.h
+ * @brief Sequence-locked copy of rowing_metrics_t for readers on other tasks
+ *
+ * The writer copies the whole metrics structure into the snapshot between
+ * two increments of a sequence counter (odd while a copy is in progress).
+ * Readers copy it out and retry if the counter was odd or changed meanwhile,
+ * so every snapshot a reader returns is one the writer published as a
+ * whole: no torn 64-bit timestamps, no distance from one pulse paired with
+ * a pace from another.
+ *
+ * Rules:
+ * - One publish at a time (callers serialize publishers)
+ * - A publisher must not be preempted by a reader on the same core while
+ *   the counter is odd, or that reader spins (see metrics_calculator.c)
+ * - Readers never block the writer and need no lock; they retry only when
+ *   a publish overlaps their copy (publishes are ~10ms apart, a copy is
+ *   well under 1µs)
+ *
+ * All functions are static inline and free of ESP-IDF dependencies so the
+ * host torture test exercises the same code.
+ */
+
+#ifndef METRICS_SNAPSHOT_H
+#define METRICS_SNAPSHOT_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include <string.h>
+#include "rowing_physics.h"
+
+typedef struct {
+    atomic_uint_fast32_t sequence;      // Odd while a publish is in progress
+    rowing_metrics_t metrics;
+} metrics_snapshot_t;
+
+/**
+ * Initialize an empty (all-zero) snapshot
+ */
+static inline void metrics_snapshot_init(metrics_snapshot_t *snapshot) {
+    memset(&snapshot->metrics, 0, sizeof(snapshot->metrics));
+    atomic_store_explicit(&snapshot->sequence, 0, memory_order_release);
+}
+
+/**
+ * Publish a new state (writer side)
+ * @param snapshot Snapshot to update
+ * @param metrics State to copy
+ */
+static inline void metrics_snapshot_publish(metrics_snapshot_t *snapshot, const rowing_metrics_t *metrics) {
+    uint32_t sequence = (uint32_t)atomic_load_explicit(&snapshot->sequence, memory_order_relaxed);
+
+    atomic_store_explicit(&snapshot->sequence, sequence + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    memcpy(&snapshot->metrics, metrics, sizeof(snapshot->metrics));
+
+    atomic_store_explicit(&snapshot->sequence, sequence + 2, memory_order_release);
+}
+
+/**
+ * Sequence number of the latest completed publish
+ * Changes (by 2) with every publish, so callers can tell whether anything
+ * was published since they last read.
+ */
+static inline uint32_t metrics_snapshot_sequence(metrics_snapshot_t *snapshot) {
+    return (uint32_t)atomic_load_explicit(&snapshot->sequence, memory_order_acquire) & ~1u;
+}
+
+/**
+ * Copy out the latest published state (reader side)
+ * Retries while a publish overlaps the copy.
+ * @param snapshot Snapshot to read
+ * @param out Destination
+ * @return Sequence number of the publish that was copied
+ */
+static inline uint32_t metrics_snapshot_read(metrics_snapshot_t *snapshot, rowing_metrics_t *out) {
+    while (true) {
+        uint32_t begin = (uint32_t)atomic_load_explicit(&snapshot->sequence, memory_order_acquire);
+        if ((begin & 1) == 0) {
+            memcpy(out, &snapshot->metrics, sizeof(*out));
+            atomic_thread_fence(memory_order_acquire);
+
+            uint32_t end = (uint32_t)atomic_load_explicit(&snapshot->sequence, memory_order_relaxed);
+            if (end == begin) {
+                return begin;
+            }
+        }
+    }
+}
+
+#endif // METRICS_SNAPSHOT_H
@@ -0,0 +1,136 @@
+/**
+ * @file pulse_ring.h
+ * @brief Lock-free single-producer/single-consumer ring of pulse timestamps
+ *
+ * Used to hand debounced sensor timestamps from the GPIO ISR (producer) to
+ * the sensor processing task (consumer) without losing pulses when several
+ * edges arrive before the task gets scheduled.
+ *
+ * Rules:
+ * - Exactly one producer (the ISR) calls pulse_ring_push()
+ * - Exactly one consumer (the sensor task) calls pulse_ring_pop()
+ * - Capacity must be a power of two
+ *
+ * All functions are static inline so they are compiled straight into the
+ * IRAM-resident ISR and carry no call overhead. The file has no ESP-IDF
+ * dependencies so it can also be used from host builds.
+ */
+
+#ifndef PULSE_RING_H
+#define PULSE_RING_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+// Maximum ring capacity (slots are allocated statically inside the struct)
+#define PULSE_RING_MAX_CAPACITY     64
+
+/**
+ * Pulse ring structure
+ * head is only written by the producer, tail only by the consumer.
+ * overflow_count and high_watermark are producer-owned statistics.
+ */
+typedef struct {
+    int64_t slots[PULSE_RING_MAX_CAPACITY];
+    uint32_t mask;                      // capacity - 1
+    atomic_uint_fast32_t head;          // Next slot to write (producer)
+    atomic_uint_fast32_t tail;          // Next slot to read (consumer)
+    volatile uint32_t overflow_count;   // Pushes dropped because the ring was full
+    volatile uint32_t high_watermark;   // Maximum fill level observed
+} pulse_ring_t;
+
+/**
+ * Initialize (or reset) a ring
+ * Must not be called while the producer or consumer is active.
+ * @param ring Pointer to ring
+ * @param capacity Number of slots (power of two, <= PULSE_RING_MAX_CAPACITY)
+ * @return true on success, false if capacity is invalid
+ */
+static inline bool pulse_ring_init(pulse_ring_t *ring, uint32_t capacity) {
+    if (capacity < 2 || capacity > PULSE_RING_MAX_CAPACITY ||
+        (capacity & (capacity - 1)) != 0) {
+        return false;
+    }
+    ring->mask = capacity - 1;
+    atomic_store_explicit(&ring->head, 0, memory_order_relaxed);
+    atomic_store_explicit(&ring->tail, 0, memory_order_relaxed);
+    ring->overflow_count = 0;
+    ring->high_watermark = 0;
+    return true;
+}
+
+/**
+ * Push a timestamp (producer side, ISR safe)
+ * @param ring Pointer to ring
+ * @param timestamp_us Timestamp to store
+ * @return true if stored, false if the ring was full (overflow counted)
+ */
+static inline bool pulse_ring_push(pulse_ring_t *ring, int64_t timestamp_us) {
+    uint32_t head = (uint32_t)atomic_load_explicit(&ring->head, memory_order_relaxed);
+    uint32_t tail = (uint32_t)atomic_load_explicit(&ring->tail, memory_order_acquire);
+    uint32_t used = head - tail;
+
+    if (used > ring->mask) {
+        ring->overflow_count++;
+        return false;
+    }
+
+    ring->slots[head & ring->mask] = timestamp_us;
+
+    if (used + 1 > ring->high_watermark) {
+        ring->high_watermark = used + 1;
+    }
+
+    // Release: slot contents become visible before the new head
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+    return true;
+}
+
+/**
+ * Peek at the oldest timestamp without removing it (consumer side)
+ * @param ring Pointer to ring
+ * @param timestamp_us Output: oldest timestamp
+ * @return true if a timestamp was available
+ */
+static inline bool pulse_ring_peek(pulse_ring_t *ring, int64_t *timestamp_us) {
+    uint32_t tail = (uint32_t)atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    uint32_t head = (uint32_t)atomic_load_explicit(&ring->head, memory_order_acquire);
+
+    if (tail == head) {
+        return false;
+    }
+
+    *timestamp_us = ring->slots[tail & ring->mask];
+    return true;
+}
+
+/**
+ * Pop the oldest timestamp (consumer side)
+ * @param ring Pointer to ring
+ * @param timestamp_us Output: oldest timestamp
+ * @return true if a timestamp was returned, false if the ring was empty
+ */
+static inline bool pulse_ring_pop(pulse_ring_t *ring, int64_t *timestamp_us) {
+    if (!pulse_ring_peek(ring, timestamp_us)) {
+        return false;
+    }
+
+    uint32_t tail = (uint32_t)atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    // Release: slot is read before it is handed back to the producer
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+    return true;
+}
+
+/**
+ * Get number of timestamps waiting to be consumed
+ * @param ring Pointer to ring
+ * @return Fill level
+ */
+static inline uint32_t pulse_ring_count(pulse_ring_t *ring) {
+    uint32_t head = (uint32_t)atomic_load_explicit(&ring->head, memory_order_acquire);
+    uint32_t tail = (uint32_t)atomic_load_explicit(&ring->tail, memory_order_acquire);
+    return head - tail;
+}
+
+#endif // PULSE_RING_H
@@ -0,0 +1,144 @@
+/**
+ * @file record_ring.h
+ * @brief Lock-free single-producer/single-consumer ring of fixed-size records
+ *
+ * Hands the records of the running session from the sensor task (producer,
+ * under the metrics update lock) to the storage task (consumer), which
+ * copies a page worth out with record_ring_peek() and only calls
+ * record_ring_consume() once it is on flash. Used by session_detail and
+ * stroke_record.
+ *
+ * Rules:
+ * - Exactly one producer calls record_ring_push()
+ * - Exactly one consumer calls record_ring_peek() / record_ring_consume()
+ * - Capacity must be a power of two
+ * - The owner provides the slots (capacity * record_size bytes)
+ *
+ * A full ring drops the new record and counts it instead of blocking the
+ * producer. Like pulse_ring.h the file has no ESP-IDF dependencies so it can
+ * also be used from host builds.
+ */
+
+#ifndef RECORD_RING_H
+#define RECORD_RING_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <string.h>
+
+/**
+ * Record ring structure
+ * head is only written by the producer, tail only by the consumer.
+ * records, dropped and high_watermark are producer-owned statistics.
+ */
+typedef struct {
+    uint8_t *slots;                     // capacity * record_size bytes
+    uint32_t record_size;               // Bytes per record
+    uint32_t mask;                      // capacity - 1
+    atomic_uint_fast32_t head;          // Next slot to write (producer)
+    atomic_uint_fast32_t tail;          // Next slot to read (consumer)
+    uint32_t records;                   // Records stored
+    uint32_t dropped;                   // Records lost to a full ring
+    uint32_t high_watermark;            // Most records waiting at once
+} record_ring_t;
+
+/**
+ * Initialize (or reset) a ring, clearing its statistics
+ * Must not be called while the producer or consumer is active.
+ * @param ring Pointer to ring
+ * @param slots Storage for capacity * record_size bytes (NULL: every push is dropped)
+ * @param capacity Number of records (power of two)
+ * @param record_size Bytes per record
+ * @return true on success, false if capacity is invalid
+ */
+static inline bool record_ring_init(record_ring_t *ring, void *slots, uint32_t capacity, uint32_t record_size) {
+    if (capacity < 2 || (capacity & (capacity - 1)) != 0) {
+        return false;
+    }
+    ring->slots = slots;
+    ring->record_size = record_size;
+    ring->mask = capacity - 1;
+    atomic_store_explicit(&ring->head, 0, memory_order_relaxed);
+    atomic_store_explicit(&ring->tail, 0, memory_order_relaxed);
+    ring->records = 0;
+    ring->dropped = 0;
+    ring->high_watermark = 0;
+    return true;
+}
+
+/**
+ * Append a record (producer side)
+ * @param ring Pointer to ring
+ * @param record record_size bytes to copy in
+ * @return false if the ring was full (the record is dropped and counted)
+ */
+static inline bool record_ring_push(record_ring_t *ring, const void *record) {
+    uint32_t head = (uint32_t)atomic_load_explicit(&ring->head, memory_order_relaxed);
+    uint32_t tail = (uint32_t)atomic_load_explicit(&ring->tail, memory_order_acquire);
+    uint32_t used = head - tail;
+    if (used > ring->mask || ring->slots == NULL) {
+        ring->dropped++;
+        return false;
+    }
+
+    memcpy(ring->slots + (head & ring->mask) * ring->record_size, record, ring->record_size);
+    // Release: slot contents become visible before the new head
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+
+    ring->records++;
+    if (used + 1 > ring->high_watermark) {
+        ring->high_watermark = used + 1;
+    }
+    return true;
+}
+
+/**
+ * Records waiting for the consumer
+ * @param ring Pointer to ring
+ * @return Fill level
+ */
+static inline uint32_t record_ring_pending(record_ring_t *ring) {
+    uint32_t head = (uint32_t)atomic_load_explicit(&ring->head, memory_order_acquire);
+    uint32_t tail = (uint32_t)atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    return head - tail;
+}
+
+/**
+ * Copy the oldest waiting records without taking them (consumer side)
+ * @param ring Pointer to ring
+ * @param records Output: up to max_records records
+ * @param max_records Capacity of records
+ * @return Number of records copied
+ */
+static inline uint32_t record_ring_peek(record_ring_t *ring, void *records, uint32_t max_records) {
+    uint32_t tail = (uint32_t)atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    uint32_t n = record_ring_pending(ring);
+    if (n > max_records) {
+        n = max_records;
+    }
+    if (n == 0) {
+        return 0;
+    }
+
+    // At most two pieces: up to the end of the ring, then from its start
+    uint32_t capacity = ring->mask + 1;
+    uint32_t index = tail & ring->mask;
+    uint32_t first = capacity - index < n ? capacity - index : n;
+    memcpy(records, ring->slots + index * ring->record_size, first * ring->record_size);
+    memcpy((uint8_t *)records + first * ring->record_size, ring->slots, (n - first) * ring->record_size);
+    return n;
+}
+
+/**
+ * Take records seen with record_ring_peek() (consumer side)
+ * @param ring Pointer to ring
+ * @param count Number of records (at most record_ring_pending())
+ */
+static inline void record_ring_consume(record_ring_t *ring, uint32_t count) {
+    uint32_t tail = (uint32_t)atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    // Release: the slots are read before the producer may reuse them
+    atomic_store_explicit(&ring->tail, tail + count, memory_order_release);
+}
+
+#endif // RECORD_RING_H
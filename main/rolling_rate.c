@@ -0,0 +1,94 @@
+/**
+ * @file rolling_rate.c
+ * @brief Rate of change of a cumulative value over a trailing time window
+ */
+
+#include "rolling_rate.h"
+#include <string.h>
+
+static inline uint8_t point_index(const rolling_rate_t *rate, uint8_t n) {
+    return (uint8_t)((rate->head + n) % ROLLING_RATE_MAX_POINTS);
+}
+
+void rolling_rate_init(rolling_rate_t *rate, uint32_t window_ms, uint32_t resolution_ms) {
+    memset(rate, 0, sizeof(*rate));
+    rate->window_us = (int64_t)window_ms * 1000;
+
+    // One point per resolution step across the window, plus the point
+    // straddling the window start and the newest one
+    int64_t min_resolution_us = rate->window_us / (ROLLING_RATE_MAX_POINTS - 2) + 1;
+    rate->resolution_us = (int64_t)resolution_ms * 1000;
+    if (rate->resolution_us < min_resolution_us) {
+        rate->resolution_us = min_resolution_us;
+    }
+}
+
+void rolling_rate_reset(rolling_rate_t *rate) {
+    rate->head = 0;
+    rate->count = 0;
+}
+
+void rolling_rate_push(rolling_rate_t *rate, int64_t time_us, float value) {
+    // Refresh the newest point while it is closer than one resolution step
+    // to the one before it, so the stored points stay evenly spread
+    rolling_rate_point_t *point = NULL;
+    if (rate->count >= 2) {
+        rolling_rate_point_t *prev = &rate->points[point_index(rate, rate->count - 2)];
+        if (time_us - prev->time_us < rate->resolution_us) {
+            point = &rate->points[point_index(rate, rate->count - 1)];
+        }
+    }
+
+    if (point == NULL) {
+        if (rate->count == ROLLING_RATE_MAX_POINTS) {
+            rate->head = point_index(rate, 1);
+            rate->count--;
+        }
+        point = &rate->points[point_index(rate, rate->count)];
+        rate->count++;
+    }
+    point->time_us = time_us;
+    point->value = value;
+
+    // Keep exactly one point at or before the window start (a refresh moves
+    // the window too)
+    int64_t window_start = time_us - rate->window_us;
+    while (rate->count >= 2 && rate->points[point_index(rate, 1)].time_us <= window_start) {
+        rate->head = point_index(rate, 1);
+        rate->count--;
+    }
+}
+
+bool rolling_rate_get(const rolling_rate_t *rate, float *rate_per_s) {
+    if (rate->count < 2) {
+        return false;
+    }
+
+    const rolling_rate_point_t *first = &rate->points[rate->head];
+    const rolling_rate_point_t *second = &rate->points[point_index(rate, 1)];
+    const rolling_rate_point_t *last = &rate->points[point_index(rate, rate->count - 1)];
+
+    int64_t start_us = last->time_us - rate->window_us;
+    float start_value = first->value;
+    if (first->time_us < start_us && second->time_us > first->time_us) {
+        float f = (float)(start_us - first->time_us) / (float)(second->time_us - first->time_us);
+        start_value = first->value + f * (second->value - first->value);
+    } else {
+        start_us = first->time_us;     // Less history than one window
+    }
+
+    int64_t span_us = last->time_us - start_us;
+    if (span_us <= 0) {
+        return false;
+    }
+
+    *rate_per_s = (last->value - start_value) * 1000000.0f / (float)span_us;
+    return true;
+}
+
+int64_t rolling_rate_newest_time_us(const rolling_rate_t *rate) {
+    if (rate->count == 0) {
+        return 0;
+    }
+    return rate->points[point_index(rate, rate->count - 1)].time_us;
+}
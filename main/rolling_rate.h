@@ -0,0 +1,73 @@
+/**
+ * @file rolling_rate.h
+ * @brief Rate of change of a cumulative value over a trailing time window
+ *
+ * Keeps (time, value) points of a non-decreasing cumulative quantity such
+ * as total distance, at most one per resolution step, and reports
+ * (value_newest - value(newest - window)) / window. The value at the window
+ * start is interpolated linearly between the two points that straddle it,
+ * so the rate moves smoothly as old data leaves the window instead of
+ * jumping whenever a sample expires.
+ *
+ * Push and expire are O(1) (amortized); memory is fixed.
+ * Plain C without ESP-IDF dependencies.
+ */
+
+#ifndef ROLLING_RATE_H
+#define ROLLING_RATE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Point capacity; window / resolution must stay below this
+#define ROLLING_RATE_MAX_POINTS     48
+
+typedef struct {
+    int64_t time_us;
+    float value;
+} rolling_rate_point_t;
+
+typedef struct {
+    rolling_rate_point_t points[ROLLING_RATE_MAX_POINTS];
+    uint8_t head;               // Index of the oldest point
+    uint8_t count;              // Points held
+    int64_t window_us;
+    int64_t resolution_us;
+} rolling_rate_t;
+
+/**
+ * Initialize an empty window
+ * @param rate Window state
+ * @param window_ms Trailing window length
+ * @param resolution_ms Minimum spacing between stored points (raised if
+ *        the window would need more than ROLLING_RATE_MAX_POINTS)
+ */
+void rolling_rate_init(rolling_rate_t *rate, uint32_t window_ms, uint32_t resolution_ms);
+
+/**
+ * Drop all points
+ */
+void rolling_rate_reset(rolling_rate_t *rate);
+
+/**
+ * Add the current cumulative value
+ * @param rate Window state
+ * @param time_us Sample time (not earlier than the previous push)
+ * @param value Cumulative value at time_us
+ */
+void rolling_rate_push(rolling_rate_t *rate, int64_t time_us, float value);
+
+/**
+ * Rate over the window ending at the newest point
+ * @param rate Window state
+ * @param rate_per_s Output: value units per second
+ * @return false if fewer than two points span a non-zero time
+ */
+bool rolling_rate_get(const rolling_rate_t *rate, float *rate_per_s);
+
+/**
+ * Time of the newest point (0 if empty)
+ */
+int64_t rolling_rate_newest_time_us(const rolling_rate_t *rate);
+
+#endif // ROLLING_RATE_H
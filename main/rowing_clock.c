@@ -0,0 +1,19 @@
+/**
+ * @file rowing_clock.c
+ * @brief Pluggable time source for the rowing pipeline
+ */
+
+#include "rowing_clock.h"
+#include "esp_timer.h"
+
+#include <stddef.h>
+
+static rowing_clock_source_t s_source = esp_timer_get_time;
+
+void rowing_clock_set_source(rowing_clock_source_t source) {
+    s_source = source != NULL ? source : esp_timer_get_time;
+}
+
+int64_t rowing_clock_now_us(void) {
+    return s_source();
+}
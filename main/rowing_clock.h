@@ -0,0 +1,38 @@
+/**
+ * @file rowing_clock.h
+ * @brief Pluggable time source for the rowing pipeline
+ *
+ * Pulse-driven code (physics, stroke detection) uses the ISR timestamp of
+ * the event being processed. Periodic code that has no event timestamp
+ * (elapsed time, idle/auto-pause checks, session start) asks this clock
+ * instead of calling esp_timer_get_time() directly, so offline replays can
+ * substitute trace time and run faster than real time.
+ *
+ * On the device the clock is esp_timer_get_time(), the same timebase the
+ * ISRs stamp pulses with.
+ */
+
+#ifndef ROWING_CLOCK_H
+#define ROWING_CLOCK_H
+
+#include <stdint.h>
+
+/**
+ * Clock source: returns the current time in microseconds
+ */
+typedef int64_t (*rowing_clock_source_t)(void);
+
+/**
+ * Replace the clock source
+ * Must be called before the pipeline tasks start (not thread-safe).
+ * @param source New source, or NULL to restore esp_timer_get_time()
+ */
+void rowing_clock_set_source(rowing_clock_source_t source);
+
+/**
+ * Get current pipeline time
+ * @return Microseconds in the ISR timestamp timebase
+ */
+int64_t rowing_clock_now_us(void);
+
+#endif // ROWING_CLOCK_H
@@ -12,7 +12,11 @@
 
 #include "rowing_physics.h"
 #include "app_config.h"
+#include "flywheel_estimator.h"
+#include "drag_estimator.h"
+#include "rolling_rate.h"
 #include "esp_log.h"
+#include "rowing_clock.h"
 #include "esp_timer.h"
 #include <string.h>
 #include <math.h>
@@ -20,6 +24,20 @@
 
 static const char *TAG = "PHYSICS";
 
+// Regression over the last FLYWHEEL_REGRESSION_WINDOW flywheel pulses
+static flywheel_estimator_t s_flywheel_estimator;
+static uint8_t s_magnets_per_rev = DEFAULT_MAGNETS_PER_REV;
+
+// Spin-down fit of every recovery, combined with a forgetting factor
+static drag_estimator_t s_drag_estimator;
+
+// Distance over the last PACE_WINDOW_MS, for the current pace
+static rolling_rate_t s_pace_window;
+
+// Flywheel-linked distance per radian, cached for the drag coefficient it was computed from
+static float s_linked_drag_coefficient = 0.0f;
+static float s_meters_per_radian = 0.0f;
+
 /**
  * Initialize physics engine with default values
  */
@@ -38,10 +56,36 @@ void rowing_physics_init(rowing_metrics_t *metrics, const config_t *config) {
     metrics->is_paused = true;  // Start in paused state until session starts
     metrics->calibration_complete = false;
     
+    flywheel_estimator_init(&s_flywheel_estimator, FLYWHEEL_REGRESSION_WINDOW,
+                            TWO_PI / (float)s_magnets_per_rev);
+    drag_estimator_init(&s_drag_estimator, config->drag_forgetting_factor);
+    rolling_rate_init(&s_pace_window, PACE_WINDOW_MS, PACE_WINDOW_RESOLUTION_MS);
+    
     ESP_LOGI(TAG, "Physics engine initialized");
     ESP_LOGI(TAG, "Moment of inertia: %.4f kg⋅m²", metrics->moment_of_inertia);
     ESP_LOGI(TAG, "Initial drag coefficient: %.6f", metrics->drag_coefficient);
-    ESP_LOGI(TAG, "Magnets per revolution: %d (compile-time)", DEFAULT_MAGNETS_PER_REV);
+    ESP_LOGI(TAG, "Magnets per revolution: %d", s_magnets_per_rev);
+    ESP_LOGI(TAG, "Regression window: %d pulses", FLYWHEEL_REGRESSION_WINDOW);
+    ESP_LOGI(TAG, "Drag forgetting factor: %.2f", s_drag_estimator.forgetting_factor);
+}
+
+/**
+ * Set the number of flywheel magnets
+ */
+void rowing_physics_set_magnets_per_rev(uint8_t magnets) {
+    if (magnets == 0) {
+        return;
+    }
+    s_magnets_per_rev = magnets;
+    flywheel_estimator_init(&s_flywheel_estimator, FLYWHEEL_REGRESSION_WINDOW,
+                            TWO_PI / (float)s_magnets_per_rev);
+}
+
+/**
+ * Get the number of flywheel magnets
+ */
+uint8_t rowing_physics_get_magnets_per_rev(void) {
+    return s_magnets_per_rev;
 }
 
 /**
@@ -50,13 +94,20 @@ void rowing_physics_init(rowing_metrics_t *metrics, const config_t *config) {
 void rowing_physics_reset(rowing_metrics_t *metrics) {
     float moi = metrics->moment_of_inertia;
     float drag = metrics->drag_coefficient;
+    float drag_factor = metrics->drag_factor;
+    float drag_confidence = metrics->drag_confidence;
+    uint32_t drag_samples = metrics->drag_calibration_samples;
     bool cal_complete = metrics->calibration_complete;
     
     memset(metrics, 0, sizeof(rowing_metrics_t));
     
-    // Preserve calibration data
+    // Preserve calibration data (the drag estimate carries over between
+    // sessions; the damper is rarely touched in between)
     metrics->moment_of_inertia = moi;
     metrics->drag_coefficient = drag;
+    metrics->drag_factor = drag_factor;
+    metrics->drag_confidence = drag_confidence;
+    metrics->drag_calibration_samples = drag_samples;
     metrics->calibration_complete = cal_complete;
     
     // Don't set session_start_time_us - keep at 0 so timer stays at 0 until session starts
@@ -65,6 +116,10 @@ void rowing_physics_reset(rowing_metrics_t *metrics) {
     metrics->best_pace_sec_500m = 999999.0f;
     metrics->is_paused = true;  // Start in paused state until rowing detected
     
+    flywheel_estimator_reset(&s_flywheel_estimator);
+    drag_estimator_cancel_recovery(&s_drag_estimator);
+    rolling_rate_reset(&s_pace_window);
+    
     ESP_LOGI(TAG, "Session reset - metrics cleared, timer at 0");
 }
 
@@ -84,7 +139,7 @@ void rowing_physics_update_elapsed_time(rowing_metrics_t *metrics) {
         return;
     }
     
-    int64_t now = esp_timer_get_time();
+    int64_t now = rowing_clock_now_us();
     // Subtract total paused time from elapsed
     uint32_t raw_elapsed_ms = (uint32_t)((now - metrics->session_start_time_us) / 1000);
     // Prevent underflow
@@ -95,6 +150,63 @@ void rowing_physics_update_elapsed_time(rowing_metrics_t *metrics) {
     }
 }
 
+/**
+ * Accumulate the work done on the flywheel over one pulse interval
+ * 
+ * Energy balance between two pulses, using the real interval dt:
+ *   ΔE = ½I(ω₂² - ω₁²) + ∫ k×ω³ dt
+ * The drag integral uses the trapezoid rule. The kinetic term telescopes, so
+ * the sum over a stroke is ½I(ω_end² - ω_start²) plus drag losses no matter
+ * how many pulses it spans, i.e. independent of the magnet count.
+ * 
+ * Work is summed over drive AND recovery: with no torque applied the
+ * recovery balance is ~0, so including it makes the per-stroke total
+ * insensitive to where the detector places the phase boundaries.
+ */
+static void accumulate_pulse_work(rowing_metrics_t *metrics, float omega_prev,
+                                  float omega, float delta_time_s) {
+    if (metrics->current_phase == STROKE_PHASE_IDLE) {
+        return;
+    }
+    
+    float I = metrics->moment_of_inertia;
+    float k = metrics->drag_coefficient;
+    float kinetic = 0.5f * I * (omega * omega - omega_prev * omega_prev);
+    float drag = k * 0.5f * (omega_prev * omega_prev * omega_prev + omega * omega * omega) * delta_time_s;
+    float work = kinetic + drag;
+    
+    metrics->drive_phase_work_joules += work;
+    metrics->total_work_joules += work;
+}
+
+/**
+ * Advance distance by one pulse of flywheel rotation
+ * 
+ * Concept2 relates boat speed to power as P = 2.80 × v³. The flywheel
+ * dissipates P = k × ω³, so the equivalent boat speed is v = ∛(k/2.80) × ω
+ * and every radian of flywheel rotation moves the boat ∛(k/2.80) meters.
+ * Distance therefore grows smoothly with each pulse instead of in one step
+ * per stroke.
+ */
+static void accumulate_pulse_distance(rowing_metrics_t *metrics, int64_t current_time_us) {
+    if (metrics->current_phase == STROKE_PHASE_IDLE || metrics->drag_coefficient <= 0) {
+        return;
+    }
+    
+    if (metrics->drag_coefficient != s_linked_drag_coefficient) {
+        s_linked_drag_coefficient = metrics->drag_coefficient;
+        s_meters_per_radian = cbrtf(s_linked_drag_coefficient / 2.80f);
+    }
+    
+    // Summed within the stroke (a small float) and added to the stroke's start,
+    // so rounding does not build up over a long session
+    metrics->stroke_distance_meters += s_meters_per_radian * (TWO_PI / (float)s_magnets_per_rev);
+    metrics->total_distance_meters = metrics->stroke_start_distance_meters
+                                   + metrics->stroke_distance_meters;
+    
+    rolling_rate_push(&s_pace_window, current_time_us, metrics->total_distance_meters);
+}
+
 /**
  * Process new flywheel pulse
  * Called from sensor task when pulse detected
@@ -107,6 +219,9 @@ void rowing_physics_process_flywheel_pulse(rowing_metrics_t *metrics, int64_t cu
     
     // Skip first pulse (no delta time yet)
     if (previous_time_us == 0) {
+        flywheel_estimator_reset(&s_flywheel_estimator);
+        drag_estimator_cancel_recovery(&s_drag_estimator);
+        flywheel_estimator_push(&s_flywheel_estimator, current_time_us);
         metrics->last_flywheel_time_us = current_time_us;
         return;
     }
@@ -115,23 +230,25 @@ void rowing_physics_process_flywheel_pulse(rowing_metrics_t *metrics, int64_t cu
     float delta_time_s = (float)(current_time_us - previous_time_us) / 1000000.0f;
     
     // Sanity check: ignore if delta time too short or too long
+    // A long gap also means the window no longer describes one motion - start over
     if (delta_time_s < 0.001f || delta_time_s > 10.0f) {
         ESP_LOGW(TAG, "Invalid delta time: %.6f s", delta_time_s);
+        flywheel_estimator_reset(&s_flywheel_estimator);
+        drag_estimator_cancel_recovery(&s_drag_estimator);
+        flywheel_estimator_push(&s_flywheel_estimator, current_time_us);
+        metrics->angular_velocity_rad_s = 0;    // Flywheel restarts from rest
         metrics->last_flywheel_time_us = current_time_us;
         return;
     }
     
-    // Calculate angular velocity (rad/s)
-    // With multiple magnets: each pulse = 2π/magnets radians
-    // MAGNETS_PER_REV is configured at compile time in app_config.h
-    float radians_per_pulse = TWO_PI / (float)DEFAULT_MAGNETS_PER_REV;
-    float angular_velocity = radians_per_pulse / delta_time_s;
-    
-    // Calculate angular acceleration (rad/s²)
-    float angular_acceleration = 0.0f;
-    if (metrics->prev_angular_velocity_rad_s > 0) {
-        angular_acceleration = (angular_velocity - metrics->prev_angular_velocity_rad_s) 
-                             / delta_time_s;
+    // Angular velocity (rad/s) and acceleration (rad/s²) at this pulse from
+    // a quadratic fit over the last pulses (each pulse = 2π/magnets radians)
+    flywheel_estimator_push(&s_flywheel_estimator, current_time_us);
+    float angular_velocity;
+    float angular_acceleration;
+    if (!flywheel_estimator_get(&s_flywheel_estimator, &angular_velocity, &angular_acceleration)) {
+        metrics->last_flywheel_time_us = current_time_us;
+        return;
     }
     
     // Update metrics
@@ -140,7 +257,7 @@ void rowing_physics_process_flywheel_pulse(rowing_metrics_t *metrics, int64_t cu
     metrics->angular_acceleration_rad_s2 = angular_acceleration;
     metrics->prev_flywheel_time_us = previous_time_us;
     metrics->last_flywheel_time_us = current_time_us;
-    metrics->last_update_time_us = esp_timer_get_time();
+    metrics->last_update_time_us = current_time_us;
     
     // Track peak velocity in current stroke
     if (angular_velocity > metrics->peak_velocity_in_stroke) {
@@ -152,15 +269,17 @@ void rowing_physics_process_flywheel_pulse(rowing_metrics_t *metrics, int64_t cu
         metrics->valid_data = true;
     }
     
-    // Update drag calibration if in recovery phase
-    if (metrics->current_phase == STROKE_PHASE_RECOVERY && 
-        angular_acceleration < 0) {
-        rowing_physics_calibrate_drag(metrics, angular_velocity, angular_acceleration);
-    }
+    // Collect recovery spin-down points, fold each finished recovery into the drag estimate
+    rowing_physics_calibrate_drag(metrics, current_time_us, angular_velocity, angular_acceleration);
     
     // Calculate instantaneous power
     rowing_physics_calculate_power(metrics);
     
+    // Energy put into the flywheel since the previous pulse
+    accumulate_pulse_work(metrics, metrics->prev_angular_velocity_rad_s,
+                          angular_velocity, delta_time_s);
+    accumulate_pulse_distance(metrics, current_time_us);
+    
     // Log for debugging (only every N pulses to avoid spam)
     if (metrics->flywheel_pulse_count % DEBUG_LOG_EVERY_N_PULSES == 0) {
         ESP_LOGD(TAG, "ω=%.2f rad/s, α=%.2f rad/s², P=%.1f W", 
@@ -173,43 +292,50 @@ void rowing_physics_process_flywheel_pulse(rowing_metrics_t *metrics, int64_t cu
  * Auto-calibrate drag coefficient during recovery phases
  * 
  * During recovery (when no power applied):
- *   τ_drag = I × α = -k × ω²
- *   Solving for k: k = -I × α / ω²
+ *   I × dω/dt = -k × ω²   →   d(1/ω)/dt = k / I
+ * so 1/ω rises linearly through every recovery. The slope of each recovery
+ * is fitted and combined with past ones (see drag_estimator.h).
  */
-void rowing_physics_calibrate_drag(rowing_metrics_t *metrics, float omega, float alpha) {
-    // Avoid division by very small values
-    if (fabsf(omega) < 1.0f) {
+void rowing_physics_calibrate_drag(rowing_metrics_t *metrics, int64_t pulse_time_us,
+                                   float omega, float alpha) {
+    if (metrics->current_phase == STROKE_PHASE_RECOVERY) {
+        // Skip intervals where the flywheel is not decelerating (catch, noise)
+        if (alpha < 0 && omega >= 1.0f) {
+            drag_estimator_add(&s_drag_estimator, metrics->prev_flywheel_time_us, pulse_time_us,
+                               TWO_PI / (float)s_magnets_per_rev);
+        }
         return;
     }
     
-    // Calculate instantaneous drag coefficient
-    float measured_k = -metrics->moment_of_inertia * alpha / (omega * omega);
+    // Recovery over: fit it
+    if (!drag_estimator_in_recovery(&s_drag_estimator) ||
+        !drag_estimator_end_recovery(&s_drag_estimator)) {
+        return;
+    }
     
-    // Sanity check - drag coefficient should be positive and reasonable
-    if (measured_k < 0 || measured_k > 0.01f) {
+    float slope;
+    if (!drag_estimator_get(&s_drag_estimator, &slope)) {
         return;
     }
+    float measured_k = metrics->moment_of_inertia * slope;
     
-    // Exponential moving average filter
-    float alpha_filter = 0.05f;  // 5% new, 95% old
-    if (metrics->drag_calibration_samples == 0) {
-        // First sample
-        metrics->drag_coefficient = measured_k;
-    } else {
-        metrics->drag_coefficient = (1.0f - alpha_filter) * metrics->drag_coefficient 
-                                   + alpha_filter * measured_k;
+    // Sanity check - drag coefficient should be positive and reasonable
+    if (measured_k <= 0 || measured_k > 0.01f) {
+        return;
     }
     
+    metrics->drag_coefficient = measured_k;
+    metrics->drag_confidence = drag_estimator_confidence(&s_drag_estimator);
     metrics->drag_calibration_samples++;
     
     // Convert to Concept2-style drag factor (typically 100-200 range)
     // Drag factor = 1e6 * k (approximately)
     metrics->drag_factor = metrics->drag_coefficient * 1000000.0f;
     
-    // Mark calibration complete after sufficient samples
-    if (metrics->drag_calibration_samples >= 50 && !metrics->calibration_complete) {
+    if (metrics->drag_confidence >= DRAG_CALIBRATED_CONFIDENCE && !metrics->calibration_complete) {
         metrics->calibration_complete = true;
-        ESP_LOGI(TAG, "Drag calibration complete: k=%.6f, DF=%.1f", 
+        ESP_LOGI(TAG, "Drag calibration complete after %lu recoveries: k=%.6f, DF=%.1f",
+                 (unsigned long)metrics->drag_calibration_samples,
                  metrics->drag_coefficient, metrics->drag_factor);
     }
 }
@@ -222,7 +348,7 @@ void rowing_physics_calibrate_drag(rowing_metrics_t *metrics, float omega, float
  * Second term: power to overcome drag
  * 
  * For DISPLAY, we use Concept2-style stroke-averaged power which is smoother.
- * The instantaneous calculation is used internally for work/energy tracking.
+ * Work/energy is integrated per pulse interval in accumulate_pulse_work().
  */
 void rowing_physics_calculate_power(rowing_metrics_t *metrics) {
     float omega = metrics->angular_velocity_rad_s;
@@ -246,14 +372,6 @@ void rowing_physics_calculate_power(rowing_metrics_t *metrics) {
         metrics->peak_power_watts = total_power;
     }
     
-    // Accumulate work during drive phase (for energy calculations)
-    if (metrics->current_phase == STROKE_PHASE_DRIVE && total_power > 0) {
-        // Approximate time step (assume 50ms between updates for simplicity)
-        float dt = 0.05f;
-        metrics->drive_phase_work_joules += total_power * dt;
-        metrics->total_work_joules += total_power * dt;
-    }
-    
     // Display power is calculated using Concept2-style formula based on pace
     // This gives smooth, stable readings that match expected rowing power output
     // Formula: Watts = 2.80 / (pace_per_meter)³
@@ -280,47 +398,21 @@ void rowing_physics_calculate_power(rowing_metrics_t *metrics) {
 }
 
 /**
- * Calculate distance using Concept2-derived physics
- * 
- * Physics basis:
- * - Boat drag: F = ½ρCdAv² → Power = ½ρCdAv³ = k×v³
- * - Concept2 defines k = 2.80 for a standard racing shell
- * - Therefore: P = 2.80 × v³, where v is boat speed in m/s
- * - Rearranging: v = ³√(P / 2.80)
- * - Distance = v × time = ³√(P / 2.80) × t = ³√(P×t³ / 2.80) = ³√(Energy×t² / 2.80)
- * 
- * For incremental calculation:
- * - Each stroke, we have work done in joules (drive_phase_work_joules)
- * - Distance for this stroke = ³√(work / 2.80)
+ * Close the distance of a completed stroke
  * 
- * Note: The 2.80 constant IS physics-based - it represents the combined
- * drag parameters of a standard racing shell: k = ½ρCdA
+ * Distance advances on every pulse (accumulate_pulse_distance), so the
+ * per-stroke distance is simply what accumulated since the previous stroke
+ * ended. Over a stroke it equals ∛(k/2.80) × flywheel angle, the same
+ * P = 2.80 × v³ relation Concept2 uses.
  */
 void rowing_physics_calculate_distance(rowing_metrics_t *metrics, float calibration_factor) {
     (void)calibration_factor;  // No longer used - pure physics calculation
     
-    // Use accumulated work from drive phase
-    float work_joules = metrics->drive_phase_work_joules;
-    
-    // Calculate distance using Concept2 physics formula
-    // Distance = ³√(Energy / 2.80)
-    // Note: This directly derives from P = 2.80/pace³ where pace = time/distance
-    float distance_this_stroke = 0.0f;
-    
-    if (work_joules > 0.1f) {  // Minimum threshold to avoid noise
-        // Pure physics: distance = cube_root(work / 2.80)
-        distance_this_stroke = cbrtf(work_joules / 2.80f);
-        
-        // Clamp to reasonable range (2-20 meters per stroke)
-        // Elite rowers do ~10m/stroke at racing pace
-        if (distance_this_stroke < 2.0f) distance_this_stroke = 2.0f;
-        if (distance_this_stroke > 20.0f) distance_this_stroke = 20.0f;
-    }
-    
-    metrics->total_distance_meters += distance_this_stroke;
-    metrics->distance_per_stroke_meters = distance_this_stroke;
+    metrics->distance_per_stroke_meters = metrics->stroke_distance_meters;
+    metrics->stroke_start_distance_meters = metrics->total_distance_meters;
+    metrics->stroke_distance_meters = 0;
     
-    // Reset drive phase work for next stroke
+    // Reset stroke work for next stroke
     metrics->drive_phase_work_joules = 0;
     
     // Update pace calculations
@@ -329,6 +421,10 @@ void rowing_physics_calculate_distance(rowing_metrics_t *metrics, float calibrat
 
 /**
  * Calculate pace (time per 500m)
+ * 
+ * Average pace covers the whole session. Current pace is the distance over
+ * the last PACE_WINDOW_MS (rolling_rate.c, O(1) per update), so it follows
+ * speed changes from one stroke to the next.
  */
 void rowing_physics_calculate_pace(rowing_metrics_t *metrics) {
     // Use elapsed_time_ms which already accounts for pause time
@@ -344,9 +440,22 @@ void rowing_physics_calculate_pace(rowing_metrics_t *metrics) {
     // Average pace for entire session: (time / distance) * 500
     metrics->average_pace_sec_500m = (elapsed_s / metrics->total_distance_meters) * 500.0f;
     
-    // Instantaneous pace - use average for now
-    // TODO: Implement rolling window for instantaneous pace
-    metrics->instantaneous_pace_sec_500m = metrics->average_pace_sec_500m;
+    if (metrics->is_paused) {
+        return;     // Keep the last current pace while paused
+    }
+    
+    // Current pace from the rolling window; no new distance for a whole
+    // window means the rower has stopped
+    float speed_m_s = 0.0f;
+    int64_t since_last_us = rowing_clock_now_us() - rolling_rate_newest_time_us(&s_pace_window);
+    if (!rolling_rate_get(&s_pace_window, &speed_m_s)) {
+        // Not enough history yet (first stroke) - use the session average
+        metrics->instantaneous_pace_sec_500m = metrics->average_pace_sec_500m;
+    } else if (since_last_us > (int64_t)PACE_WINDOW_MS * 1000 || speed_m_s <= 0.0f) {
+        metrics->instantaneous_pace_sec_500m = 999999.0f;
+    } else {
+        metrics->instantaneous_pace_sec_500m = 500.0f / speed_m_s;
+    }
     
     // Update best pace
     if (metrics->instantaneous_pace_sec_500m < metrics->best_pace_sec_500m && 
@@ -517,7 +626,7 @@ static void finalize_inertia_calibration(inertia_calibration_t *cal)
 void rowing_physics_start_inertia_calibration(inertia_calibration_t *calibration, rowing_metrics_t *metrics) {
     memset(calibration, 0, sizeof(inertia_calibration_t));
     
-    calibration->start_time_us = esp_timer_get_time();
+    calibration->start_time_us = rowing_clock_now_us();
     calibration->drag_coefficient_used = metrics->drag_coefficient;
     calibration->peak_velocity_rad_s = 0;
     calibration->final_velocity_rad_s = 0;
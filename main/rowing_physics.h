@@ -62,7 +62,9 @@ typedef struct {
 
 /**
  * Main rowing metrics structure
- * All fields should be protected by metrics_mutex when accessed from multiple tasks
+ * Written by the sensor and metrics tasks between metrics_calculator_begin_update()
+ * and metrics_calculator_end_update(); other tasks read published copies through
+ * metrics_calculator_get_snapshot()
  */
 typedef struct {
     // ============ Timing ============
@@ -88,7 +90,8 @@ typedef struct {
     float drag_coefficient;             // k value (auto-calibrated)
     float moment_of_inertia;            // I (kg⋅m²), configurable
     float drag_factor;                  // Concept2-style drag factor (100-200 range)
-    uint32_t drag_calibration_samples;  // Number of calibration samples collected
+    float drag_confidence;              // Confidence in the drag estimate (0-1)
+    uint32_t drag_calibration_samples;  // Number of recoveries used for the drag estimate
     
     // ============ Stroke Detection ============
     stroke_phase_t current_phase;       // Current stroke phase
@@ -106,14 +109,16 @@ typedef struct {
     float peak_power_watts;             // Peak power achieved
     float display_power_watts;          // Power for display (smoothed, holds peak during recovery)
     float total_work_joules;            // Total work done (cumulative)
-    float drive_phase_work_joules;      // Work in current/last drive phase
+    float drive_phase_work_joules;      // Work in the stroke in progress (since last drive ended)
     
     // ============ Distance & Pace ============
     float total_distance_meters;        // Total distance rowed
     float instantaneous_pace_sec_500m;  // Current pace (seconds per 500m)
     float average_pace_sec_500m;        // Average pace for session
     float best_pace_sec_500m;           // Best pace achieved
-    float distance_per_stroke_meters;   // Average distance per stroke
+    float distance_per_stroke_meters;   // Distance of the last completed stroke
+    float stroke_distance_meters;       // Distance in the stroke in progress
+    float stroke_start_distance_meters; // Total distance when the stroke in progress began
     
     // ============ Calories ============
     uint32_t total_calories;            // Total energy expenditure (kcal)
@@ -142,6 +147,7 @@ typedef struct {
     // ============ Calibration Settings ============
     bool auto_calibrate_drag;           // Enable automatic drag calibration
     uint32_t calibration_row_count;     // Strokes before calibration locked
+    float drag_forgetting_factor;       // Weight kept by past recoveries per new one (0-1]
     
     // ============ User Settings ============
     float user_weight_kg;               // User weight for calorie calculation
@@ -174,21 +180,83 @@ typedef struct {
     // ============ Heart Rate Settings ============
     uint8_t max_heart_rate;             // User's maximum heart rate (for HR zone calculations)
     
+    // ============ Recording Settings ============
+    uint8_t recording_profile;          // recording_profile_t of new sessions
+    
 } config_t;
 
 /**
  * Per-second sample data for graphs (8 bytes per sample)
+ * One second of session time (session_sampler.h): averages and the distance
+ * over that second, not point samples.
  * Stores velocity (m/s) instead of pace for Health Connect compatibility
  * Stroke rate removed - not needed per-second for Health Connect
  */
 typedef struct __attribute__((packed)) {
-    uint16_t power_watts;           // 0-65535 W
-    uint16_t velocity_cm_s;         // Velocity in cm/s (0-655.35 m/s)
+    uint16_t power_watts;           // Average power, 0-65535 W
+    uint16_t velocity_cm_s;         // Average velocity in cm/s (0-655.35 m/s)
     uint8_t  heart_rate;            // 0-255 bpm
     uint8_t  reserved;              // Reserved for alignment (was stroke_rate)
     uint16_t distance_dm;           // Distance delta in decimeters (0-6553.5m)
 } sample_data_t;
 
+/**
+ * What a session records besides its per-second samples
+ */
+typedef enum {
+    RECORDING_PROFILE_1HZ = 0,          // Per-second samples only (summary)
+    RECORDING_PROFILE_10HZ,             // Plus sample_10hz_t every 100 ms of session time
+    RECORDING_PROFILE_PULSE,            // Plus sample_pulse_t for every flywheel pulse
+    RECORDING_PROFILE_COUNT
+} recording_profile_t;
+
+/**
+ * 100 ms of session time (7 bytes), RECORDING_PROFILE_10HZ
+ * Power and distance are integrated over the 100 ms like sample_data_t.
+ */
+typedef struct __attribute__((packed)) {
+    uint16_t power_watts;           // Average power over the 100 ms
+    uint16_t omega_crad_s;          // Flywheel angular velocity at its end (0.01 rad/s)
+    uint16_t distance_cm;           // Distance over the 100 ms (cm)
+    uint8_t  phase;                 // stroke_phase_t at its end
+} sample_10hz_t;
+
+/**
+ * One flywheel pulse (4 bytes), RECORDING_PROFILE_PULSE
+ * Intervals add up to the time since the session started (pauses included).
+ */
+typedef struct __attribute__((packed)) {
+    uint16_t interval_us;           // Low 16 bits of the time since the previous pulse
+    uint8_t  interval_us_high;      // Bits 16-23 (the interval saturates at 16.7 s)
+    uint8_t  phase;                 // stroke_phase_t after the pulse
+} sample_pulse_t;
+
+// Points of a stroke's force curve
+#define STROKE_CURVE_POINTS         32
+
+/**
+ * One completed stroke (54 bytes), recorded for every session
+ * Work and average power cover the stroke cycle ending at this finish: the
+ * recovery before the drive, then the drive. The force curve is the
+ * flywheel torque I×α + k×ω² over the drive, resampled to evenly spaced
+ * points from catch to finish and scaled to the stroke's peak torque.
+ */
+typedef struct __attribute__((packed)) {
+    uint16_t stroke;                // Stroke count at this stroke (low 16 bits)
+    uint16_t finish_ms;             // Low 16 bits of the session clock at the finish
+    uint8_t  finish_ms_high;        // Bits 16-23 (0 before the session clock started)
+    uint16_t drive_ms;              // Catch to finish
+    uint16_t recovery_ms;           // Previous stroke's finish to this catch (0 for the first)
+    uint16_t work_dj;               // Work over the stroke cycle (0.1 J)
+    uint16_t peak_power_watts;      // Highest instantaneous power in the drive
+    uint16_t avg_power_watts;       // Work / (recovery + drive)
+    uint16_t distance_cm;           // Distance of the stroke
+    uint8_t  drag_factor;           // Drag factor at the finish
+    uint16_t peak_omega_crad_s;     // Highest flywheel angular velocity in the drive (0.01 rad/s)
+    uint16_t peak_torque_cnm;       // Highest torque in the drive (0.01 N·m)
+    uint8_t  curve[STROKE_CURVE_POINTS];    // Torque / peak torque × 255, catch to finish
+} stroke_record_t;
+
 // Maximum samples per session (7200 = 2 hours at 1 sample/sec)
 // 8 bytes * 7200 = 57.6KB per session
 #define MAX_SAMPLES_PER_SESSION     7200
@@ -211,7 +279,8 @@ typedef struct {
     uint32_t sample_count;              // Number of per-second samples
     uint8_t max_heart_rate;             // Maximum heart rate during session
     uint8_t synced;                     // Whether session has been synced to companion app
-    uint8_t reserved[2];                // Reserved for future use (alignment)
+    uint8_t recording_profile;          // recording_profile_t (0 in sessions of older firmware)
+    uint8_t reserved;                   // Reserved for future use (alignment)
 } session_record_t;
 
 // ============================================================================
@@ -225,6 +294,20 @@ typedef struct {
  */
 void rowing_physics_init(rowing_metrics_t *metrics, const config_t *config);
 
+/**
+ * Set the number of flywheel magnets
+ * The firmware uses DEFAULT_MAGNETS_PER_REV; trace replay applies the value
+ * recorded in the trace header. Restarts the speed estimate.
+ * @param magnets Magnets per revolution (1-255)
+ */
+void rowing_physics_set_magnets_per_rev(uint8_t magnets);
+
+/**
+ * Get the number of flywheel magnets in use
+ * @return Magnets per revolution
+ */
+uint8_t rowing_physics_get_magnets_per_rev(void);
+
 /**
  * Process a new flywheel pulse event
  * @param metrics Pointer to metrics structure
@@ -233,12 +316,16 @@ void rowing_physics_init(rowing_metrics_t *metrics, const config_t *config);
 void rowing_physics_process_flywheel_pulse(rowing_metrics_t *metrics, int64_t pulse_time_us);
 
 /**
- * Auto-calibrate drag coefficient during recovery phases
+ * Auto-calibrate drag coefficient from recovery spin-down
+ * Collects points while in recovery and updates the drag estimate when the
+ * recovery ends; called for every flywheel pulse
  * @param metrics Pointer to metrics structure
+ * @param pulse_time_us Timestamp of the pulse
  * @param omega Current angular velocity (rad/s)
  * @param alpha Current angular acceleration (rad/s²)
  */
-void rowing_physics_calibrate_drag(rowing_metrics_t *metrics, float omega, float alpha);
+void rowing_physics_calibrate_drag(rowing_metrics_t *metrics, int64_t pulse_time_us,
+                                   float omega, float alpha);
 
 /**
  * Calculate instantaneous power output
@@ -247,9 +334,11 @@ void rowing_physics_calibrate_drag(rowing_metrics_t *metrics, float omega, float
 void rowing_physics_calculate_power(rowing_metrics_t *metrics);
 
 /**
- * Calculate distance for completed stroke
+ * Close the distance of a completed stroke
+ * Distance itself advances on every pulse; this records the stroke's share
+ * and updates pace.
  * @param metrics Pointer to metrics structure
- * @param calibration_factor Distance calibration factor
+ * @param calibration_factor Distance calibration factor (unused)
  */
 void rowing_physics_calculate_distance(rowing_metrics_t *metrics, float calibration_factor);
 
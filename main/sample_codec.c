@@ -0,0 +1,266 @@
+/**
+ * @file sample_codec.c
+ * @brief Compressed pages of per-second samples
+ */
+
+#include "sample_codec.h"
+#include <string.h>
+
+/**
+ * Record fields in page order (byte offset, size)
+ */
+const sample_codec_layout_t sample_codec_layout_samples = {
+    .record_size = sizeof(sample_data_t), .fields = 5,
+    .offset = { 0, 2, 4, 5, 6 }, .size = { 2, 2, 1, 1, 2 },    // power, velocity, HR, reserved, distance
+};
+
+const sample_codec_layout_t sample_codec_layout_10hz = {
+    .record_size = sizeof(sample_10hz_t), .fields = 4,
+    .offset = { 0, 2, 4, 6 }, .size = { 2, 2, 2, 1 },          // power, omega, distance, phase
+};
+
+const sample_codec_layout_t sample_codec_layout_pulse = {
+    .record_size = sizeof(sample_pulse_t), .fields = 3,
+    .offset = { 0, 2, 3 }, .size = { 2, 1, 1 },                // interval low, interval high, phase
+};
+
+// Stroke, finish low, finish high, drive, recovery, work, peak power, average
+// power, distance, drag factor, peak omega, peak torque, then the curve
+const sample_codec_layout_t sample_codec_layout_strokes = {
+    .record_size = sizeof(stroke_record_t), .fields = 12 + STROKE_CURVE_POINTS,
+    .offset = { 0, 2, 4, 5, 7, 9, 11, 13, 15, 17, 18, 20,
+                22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37,
+                38, 39, 40, 41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, 52, 53 },
+    .size = { 2, 2, 1, 2, 2, 2, 2, 2, 2, 1, 2, 2,
+              1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+              1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1 },
+};
+
+_Static_assert(sizeof(stroke_record_t) == 22 + STROKE_CURVE_POINTS && STROKE_CURVE_POINTS == 32,
+               "sample_codec_layout_strokes does not match stroke_record_t");
+
+// Widest residual: zig-zag delta of a 16-bit field
+#define MAX_WIDTH       17
+
+static inline uint32_t get_field(const sample_codec_layout_t *layout, const void *records,
+                                 uint32_t index, size_t field) {
+    const uint8_t *p = (const uint8_t *)records + index * layout->record_size + layout->offset[field];
+    return layout->size[field] == 2 ? (uint32_t)(p[0] | (p[1] << 8)) : p[0];
+}
+
+static inline void set_field(const sample_codec_layout_t *layout, void *records,
+                             uint32_t index, size_t field, uint32_t value) {
+    uint8_t *p = (uint8_t *)records + index * layout->record_size + layout->offset[field];
+    p[0] = (uint8_t)value;
+    if (layout->size[field] == 2) {
+        p[1] = (uint8_t)(value >> 8);
+    }
+}
+
+static inline uint32_t zigzag(int32_t value) {
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static inline int32_t unzigzag(uint32_t value) {
+    return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+static inline uint8_t bit_width(uint32_t value) {
+    uint8_t width = 0;
+    while (value != 0) {
+        width++;
+        value >>= 1;
+    }
+    return width;
+}
+
+/**
+ * LSB-first bit stream
+ */
+typedef struct {
+    uint8_t *out;
+    size_t len;
+    uint64_t bits;
+    uint32_t count;
+} bit_writer_t;
+
+static inline void put_bits(bit_writer_t *w, uint32_t value, uint8_t width) {
+    w->bits |= (uint64_t)value << w->count;
+    w->count += width;
+    while (w->count >= 8) {
+        w->out[w->len++] = (uint8_t)w->bits;
+        w->bits >>= 8;
+        w->count -= 8;
+    }
+}
+
+typedef struct {
+    const uint8_t *in;
+    size_t pos;
+    uint64_t bits;
+    uint32_t count;
+} bit_reader_t;
+
+static inline uint32_t get_bits(bit_reader_t *r, uint8_t width) {
+    while (r->count < width) {
+        r->bits |= (uint64_t)r->in[r->pos++] << r->count;
+        r->count += 8;
+    }
+    uint32_t value = (uint32_t)(r->bits & ((1ULL << width) - 1));
+    r->bits >>= width;
+    r->count -= width;
+    return value;
+}
+
+size_t sample_codec_encode(const sample_data_t *samples, uint32_t count, uint8_t *out) {
+    return sample_codec_encode_records(&sample_codec_layout_samples, samples, count, out);
+}
+
+size_t sample_codec_encode_records(const sample_codec_layout_t *layout, const void *records,
+                                   uint32_t count, uint8_t *out) {
+    if (count == 0 || count > SAMPLE_CODEC_MAX_SAMPLES) {
+        return 0;
+    }
+
+    uint8_t mode[SAMPLE_CODEC_MAX_FIELDS];
+    uint32_t base[SAMPLE_CODEC_MAX_FIELDS];
+    size_t len = SAMPLE_CODEC_PAGE_HEADER;
+
+    for (size_t f = 0; f < layout->fields; f++) {
+        uint32_t first = get_field(layout, records, 0, f);
+        uint32_t min = first;
+        uint32_t max = first;
+        uint32_t max_delta = 0;
+        uint32_t prev = first;
+        for (uint32_t i = 1; i < count; i++) {
+            uint32_t value = get_field(layout, records, i, f);
+            if (value < min) min = value;
+            if (value > max) max = value;
+            uint32_t delta = zigzag((int32_t)value - (int32_t)prev);
+            if (delta > max_delta) max_delta = delta;
+            prev = value;
+        }
+
+        uint8_t offset_width = bit_width(max - min);
+        uint8_t delta_width = bit_width(max_delta);
+        if ((count - 1) * delta_width < count * offset_width) {
+            mode[f] = delta_width | SAMPLE_CODEC_DELTA;
+            base[f] = first;
+        } else {
+            mode[f] = offset_width;
+            base[f] = min;
+        }
+
+        out[len++] = mode[f];
+        uint32_t value = base[f];
+        while (value >= 0x80) {
+            out[len++] = (uint8_t)(value | 0x80);
+            value >>= 7;
+        }
+        out[len++] = (uint8_t)value;
+    }
+
+    bit_writer_t w = { .out = out, .len = len };
+    for (size_t f = 0; f < layout->fields; f++) {
+        uint8_t width = mode[f] & ~SAMPLE_CODEC_DELTA;
+        if (width == 0) {
+            continue;
+        }
+        if (mode[f] & SAMPLE_CODEC_DELTA) {
+            uint32_t prev = base[f];
+            for (uint32_t i = 1; i < count; i++) {
+                uint32_t value = get_field(layout, records, i, f);
+                put_bits(&w, zigzag((int32_t)value - (int32_t)prev), width);
+                prev = value;
+            }
+        } else {
+            for (uint32_t i = 0; i < count; i++) {
+                put_bits(&w, get_field(layout, records, i, f) - base[f], width);
+            }
+        }
+    }
+    if (w.count > 0) {
+        w.out[w.len++] = (uint8_t)w.bits;
+    }
+
+    out[0] = (uint8_t)w.len;
+    out[1] = (uint8_t)(w.len >> 8);
+    out[2] = (uint8_t)count;
+    out[3] = SAMPLE_CODEC_VERSION;
+    return w.len;
+}
+
+bool sample_codec_page_info(const uint8_t *in, uint16_t *length, uint8_t *count) {
+    *length = (uint16_t)(in[0] | (in[1] << 8));
+    *count = in[2];
+    return in[3] == SAMPLE_CODEC_VERSION && *count > 0 && *length > SAMPLE_CODEC_PAGE_HEADER &&
+           *length <= SAMPLE_CODEC_RECORD_MAX_BYTES(SAMPLE_CODEC_MAX_FIELDS, *count);
+}
+
+uint32_t sample_codec_decode(const uint8_t *in, size_t len, sample_data_t *out, uint32_t max_samples) {
+    return sample_codec_decode_records(&sample_codec_layout_samples, in, len, out, max_samples);
+}
+
+uint32_t sample_codec_decode_records(const sample_codec_layout_t *layout, const uint8_t *in, size_t len,
+                                     void *out, uint32_t max_records) {
+    uint16_t length;
+    uint8_t count;
+    if (len < SAMPLE_CODEC_PAGE_HEADER || !sample_codec_page_info(in, &length, &count) ||
+        length > len || count > max_records) {
+        return 0;
+    }
+
+    uint8_t mode[SAMPLE_CODEC_MAX_FIELDS];
+    uint32_t base[SAMPLE_CODEC_MAX_FIELDS];
+    size_t pos = SAMPLE_CODEC_PAGE_HEADER;
+    uint32_t residual_bits = 0;
+
+    for (size_t f = 0; f < layout->fields; f++) {
+        if (pos >= length) {
+            return 0;
+        }
+        mode[f] = in[pos++];
+        uint8_t width = mode[f] & ~SAMPLE_CODEC_DELTA;
+        if (width > MAX_WIDTH) {
+            return 0;
+        }
+        residual_bits += width * ((mode[f] & SAMPLE_CODEC_DELTA) ? count - 1u : count);
+
+        uint32_t value = 0;
+        for (int shift = 0; ; shift += 7) {
+            if (pos >= length || shift > 14) {
+                return 0;
+            }
+            uint8_t byte = in[pos++];
+            value |= (uint32_t)(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0) {
+                break;
+            }
+        }
+        base[f] = value;
+    }
+    if (pos + (residual_bits + 7) / 8 != length) {
+        return 0;
+    }
+
+    memset(out, 0, count * layout->record_size);
+    bit_reader_t r = { .in = in, .pos = pos };
+    for (size_t f = 0; f < layout->fields; f++) {
+        uint8_t width = mode[f] & ~SAMPLE_CODEC_DELTA;
+        uint32_t value = base[f];
+        if (mode[f] & SAMPLE_CODEC_DELTA) {
+            set_field(layout, out, 0, f, value);
+            for (uint32_t i = 1; i < count; i++) {
+                if (width > 0) {
+                    value += (uint32_t)unzigzag(get_bits(&r, width));
+                }
+                set_field(layout, out, i, f, value);
+            }
+        } else {
+            for (uint32_t i = 0; i < count; i++) {
+                set_field(layout, out, i, f, width > 0 ? base[f] + get_bits(&r, width) : base[f]);
+            }
+        }
+    }
+    return count;
+}
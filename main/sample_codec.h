@@ -0,0 +1,128 @@
+/**
+ * @file sample_codec.h
+ * @brief Compressed pages of per-second samples
+ *
+ * Session samples are flushed to flash in pages (SESSION_FLUSH_PAGE_SAMPLES
+ * at a time) and each page is encoded on its own, so any page can be
+ * decoded without the ones before it. Consecutive samples are strongly
+ * correlated (heart rate and distance per second barely move, power and
+ * velocity swing within a bounded range), so every field of a page is
+ * stored as a base value plus fixed-width residuals:
+ *
+ *   header   length (u16, whole page), sample count (u8), SAMPLE_CODEC_VERSION
+ *   fields   per field: mode byte, then the base as an unsigned LEB128 varint
+ *              mode = width | SAMPLE_CODEC_DELTA if delta coded
+ *   residuals bit-packed LSB first, field after field:
+ *              delta coded: count - 1 zig-zag deltas, base = first value
+ *              otherwise:   count offsets from base = smallest value
+ *
+ * Fields, in order: power, velocity, heart rate, reserved, distance. The
+ * encoder picks the mode needing fewer bits per field and page. A field
+ * that does not change (heart rate without a strap, the reserved byte)
+ * costs two bytes per page.
+ *
+ * The high-resolution records of the recording profiles (sample_10hz_t,
+ * sample_pulse_t) and the per-stroke records (stroke_record_t, one field
+ * per force curve point) use the same page format with their own field
+ * layout (sample_codec_encode_records()); the stream a page is stored in
+ * tells which layout it has.
+ *
+ * Plain C without ESP-IDF dependencies so the host benchmark can use it.
+ */
+
+#ifndef SAMPLE_CODEC_H
+#define SAMPLE_CODEC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "rowing_physics.h"
+
+#define SAMPLE_CODEC_VERSION        1
+
+// Page header (length, count, version)
+#define SAMPLE_CODEC_PAGE_HEADER    4
+
+// Most samples in one page
+#define SAMPLE_CODEC_MAX_SAMPLES    255
+
+// Mode byte flag: residuals are deltas from the previous sample
+#define SAMPLE_CODEC_DELTA          0x80
+
+// Most fields in a record layout (stroke_record_t: 12 + the curve points)
+#define SAMPLE_CODEC_MAX_FIELDS     (12 + STROKE_CURVE_POINTS)
+
+// Largest encoded page of n records of f fields (mode + 3-byte base, 17-bit residuals)
+#define SAMPLE_CODEC_RECORD_MAX_BYTES(f, n) (SAMPLE_CODEC_PAGE_HEADER + (f) * 4 + ((f) * 17 * (n) + 7) / 8)
+
+// Largest encoded page of n samples (5 fields)
+#define SAMPLE_CODEC_MAX_BYTES(n)   SAMPLE_CODEC_RECORD_MAX_BYTES(5, n)
+
+/**
+ * Fields of a packed record type, in page order
+ */
+typedef struct {
+    uint8_t record_size;                        // Bytes per record
+    uint8_t fields;                             // 1 to SAMPLE_CODEC_MAX_FIELDS
+    uint8_t offset[SAMPLE_CODEC_MAX_FIELDS];    // Byte offset of each field
+    uint8_t size[SAMPLE_CODEC_MAX_FIELDS];      // 1 or 2 bytes (little-endian)
+} sample_codec_layout_t;
+
+// sample_data_t, sample_10hz_t, sample_pulse_t and stroke_record_t
+extern const sample_codec_layout_t sample_codec_layout_samples;
+extern const sample_codec_layout_t sample_codec_layout_10hz;
+extern const sample_codec_layout_t sample_codec_layout_pulse;
+extern const sample_codec_layout_t sample_codec_layout_strokes;
+
+/**
+ * Encode a page of samples
+ * @param samples Samples to encode
+ * @param count 1 to SAMPLE_CODEC_MAX_SAMPLES
+ * @param out Output of at least SAMPLE_CODEC_MAX_BYTES(count) bytes
+ * @return Page length, 0 if count is out of range
+ */
+size_t sample_codec_encode(const sample_data_t *samples, uint32_t count, uint8_t *out);
+
+/**
+ * Encode a page of records of any layout
+ * @param layout Record layout
+ * @param records Records to encode
+ * @param count 1 to SAMPLE_CODEC_MAX_SAMPLES
+ * @param out Output of at least SAMPLE_CODEC_RECORD_MAX_BYTES(layout->fields, count) bytes
+ * @return Page length, 0 if count is out of range
+ */
+size_t sample_codec_encode_records(const sample_codec_layout_t *layout, const void *records,
+                                   uint32_t count, uint8_t *out);
+
+/**
+ * Read the header of a page
+ * @param in Page bytes (at least SAMPLE_CODEC_PAGE_HEADER)
+ * @param length Out: page length
+ * @param count Out: samples in the page
+ * @return false if this is not a page header
+ */
+bool sample_codec_page_info(const uint8_t *in, uint16_t *length, uint8_t *count);
+
+/**
+ * Decode a page
+ * @param in Page bytes
+ * @param len Bytes available (at least the page length)
+ * @param out Output samples
+ * @param max_samples Capacity of out
+ * @return Samples decoded, 0 if the page is invalid or does not fit
+ */
+uint32_t sample_codec_decode(const uint8_t *in, size_t len, sample_data_t *out, uint32_t max_samples);
+
+/**
+ * Decode a page of records of any layout
+ * @param layout Layout the page was encoded with
+ * @param in Page bytes
+ * @param len Bytes available (at least the page length)
+ * @param out Output records
+ * @param max_records Capacity of out
+ * @return Records decoded, 0 if the page is invalid or does not fit
+ */
+uint32_t sample_codec_decode_records(const sample_codec_layout_t *layout, const uint8_t *in, size_t len,
+                                     void *out, uint32_t max_records);
+
+#endif // SAMPLE_CODEC_H
@@ -0,0 +1,82 @@
+/**
+ * @file send_queue.c
+ * @brief Bounded, non-blocking outbound queue of one streaming client
+ */
+
+#include "send_queue.h"
+#include <string.h>
+#include <errno.h>
+#include <sys/socket.h>
+
+void send_queue_reset(send_queue_t *queue, int fd) {
+    queue->fd = fd;
+    queue->head = 0;
+    queue->tail = 0;
+    queue->stalled = 0;
+    queue->frames_queued = 0;
+    queue->frames_dropped = 0;
+    queue->bytes_sent = 0;
+}
+
+bool send_queue_push(send_queue_t *queue, const void *header, size_t header_len,
+                     const void *payload, size_t payload_len) {
+    size_t pending = send_queue_pending(queue);
+    size_t len = header_len + payload_len;
+    if (pending + len > sizeof(queue->data)) {
+        queue->frames_dropped++;
+        return false;
+    }
+
+    // Move the unsent bytes to the front if the message does not fit behind them
+    if (queue->tail + len > sizeof(queue->data)) {
+        memmove(queue->data, queue->data + queue->head, pending);
+        queue->head = 0;
+        queue->tail = (uint16_t)pending;
+    }
+
+    if (header_len > 0) {
+        memcpy(queue->data + queue->tail, header, header_len);
+    }
+    memcpy(queue->data + queue->tail + header_len, payload, payload_len);
+    queue->tail = (uint16_t)(queue->tail + len);
+    queue->frames_queued++;
+    return true;
+}
+
+int send_queue_flush(send_queue_t *queue) {
+    while (queue->head < queue->tail) {
+        ssize_t written = send(queue->fd, queue->data + queue->head,
+                               queue->tail - queue->head, MSG_DONTWAIT);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            return -1;
+        }
+        if (written == 0) {
+            break;
+        }
+        queue->head = (uint16_t)(queue->head + written);
+        queue->bytes_sent += (uint32_t)written;
+    }
+
+    if (queue->head == queue->tail) {
+        queue->head = 0;
+        queue->tail = 0;
+    }
+    return (int)send_queue_pending(queue);
+}
+
+bool send_queue_end_broadcast(send_queue_t *queue, uint16_t stall_limit) {
+    if (send_queue_pending(queue) == 0) {
+        queue->stalled = 0;
+        return false;
+    }
+    if (queue->stalled < UINT16_MAX) {
+        queue->stalled++;
+    }
+    return queue->stalled >= stall_limit;
+}
@@ -0,0 +1,76 @@
+/**
+ * @file send_queue.h
+ * @brief Bounded, non-blocking outbound queue of one streaming client
+ *
+ * The broadcast task never waits for a client: messages are appended to the
+ * client's queue and written with non-blocking send() calls, and whatever
+ * the socket does not take stays queued for the next broadcast. Messages
+ * are only queued whole, so a partial write never truncates one.
+ *
+ * When a message does not fit, it is dropped and counted, and the caller
+ * resyncs the client with a keyframe of the latest state once there is room
+ * (latest wins; the stale messages in between are never sent). A client
+ * whose queue has not drained for a number of consecutive broadcasts is
+ * persistently slower than the stream and should be evicted.
+ *
+ * A queue is owned by the task that broadcasts; it is not thread-safe.
+ * Plain C on POSIX sockets so the host benchmark can use it.
+ */
+
+#ifndef SEND_QUEUE_H
+#define SEND_QUEUE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "app_config.h"
+
+/**
+ * Outbound queue of one client
+ */
+typedef struct {
+    int fd;                         // Socket the queue writes to, -1 = unused
+    uint16_t head;                  // First unsent byte
+    uint16_t tail;                  // End of queued bytes
+    uint16_t stalled;               // Consecutive broadcasts that ended with bytes queued
+    uint32_t frames_queued;         // Messages accepted
+    uint32_t frames_dropped;        // Messages that did not fit
+    uint32_t bytes_sent;            // Bytes the socket took
+    uint8_t data[STREAM_QUEUE_BYTES];
+} send_queue_t;
+
+/**
+ * Empty a queue and bind it to a socket (counters restart)
+ */
+void send_queue_reset(send_queue_t *queue, int fd);
+
+/**
+ * Queue one message made of a header and a payload, written back to back
+ * @param header Header bytes (may be NULL if header_len is 0)
+ * @param payload Payload bytes
+ * @return false if the message does not fit (counted as dropped, nothing queued)
+ */
+bool send_queue_push(send_queue_t *queue, const void *header, size_t header_len,
+                     const void *payload, size_t payload_len);
+
+/**
+ * Write as much of the queue as the socket takes without blocking
+ * @return Bytes still queued, -1 if the socket failed (client is gone)
+ */
+int send_queue_flush(send_queue_t *queue);
+
+/**
+ * Bytes queued and not yet taken by the socket
+ */
+static inline size_t send_queue_pending(const send_queue_t *queue) {
+    return (size_t)(queue->tail - queue->head);
+}
+
+/**
+ * End a broadcast for this client
+ * @param stall_limit Consecutive broadcasts a queue may stay non-empty
+ * @return true if the client has been behind for stall_limit broadcasts
+ */
+bool send_queue_end_broadcast(send_queue_t *queue, uint16_t stall_limit);
+
+#endif // SEND_QUEUE_H
@@ -13,7 +13,14 @@
 
 #include "sensor_manager.h"
 #include "app_config.h"
+#include "event_bus.h"
+#include "metrics_calculator.h"
+#include "pulse_ring.h"
+#include "rowing_clock.h"
+#include "session_detail.h"
+#include "stroke_record.h"
 #include "stroke_detector.h"
+#include "trace_recorder.h"
 #include "web_server.h"
 #include "driver/gpio.h"
 #include "esp_timer.h"
@@ -36,6 +43,12 @@ static volatile int64_t g_last_flywheel_time_us = 0;
 static volatile uint32_t g_seat_trigger_count = 0;
 static volatile int64_t g_last_seat_time_us = 0;
 
+// ISR -> task timestamp rings. Each ISR is the single producer of its ring and
+// the sensor task is the single consumer, so several pulses arriving before
+// the task wakes up are queued instead of being merged into one event.
+static pulse_ring_t g_flywheel_ring;
+static pulse_ring_t g_seat_ring;
+
 // Event group for signaling tasks
 static EventGroupHandle_t sensor_event_group = NULL;
 
@@ -52,6 +65,7 @@ static volatile bool task_running = false;
  * - Read timestamp
  * - Simple debounce check
  * - Increment counter
+ * - Queue timestamp in the pulse ring
  * - Set event bit
  * - NO logging, NO complex math
  */
@@ -62,6 +76,7 @@ static void IRAM_ATTR flywheel_isr_handler(void* arg) {
     if ((now - g_last_flywheel_time_us) > FLYWHEEL_DEBOUNCE_US) {
         g_last_flywheel_time_us = now;
         g_flywheel_pulse_count++;
+        pulse_ring_push(&g_flywheel_ring, now);  // Overflow is counted by the ring
         
         // Signal processing task (non-blocking)
         if (sensor_event_group != NULL) {
@@ -86,6 +101,7 @@ static void IRAM_ATTR seat_isr_handler(void* arg) {
     if ((now - g_last_seat_time_us) > SEAT_DEBOUNCE_US) {
         g_last_seat_time_us = now;
         g_seat_trigger_count++;
+        pulse_ring_push(&g_seat_ring, now);
         
         // Signal processing task (non-blocking)
         if (sensor_event_group != NULL) {
@@ -100,9 +116,75 @@ static void IRAM_ATTR seat_isr_handler(void* arg) {
     }
 }
 
+/**
+ * Process one queued flywheel pulse
+ */
+static void process_flywheel_pulse(rowing_metrics_t *metrics, int64_t pulse_time, bool is_calibrating) {
+    rowing_physics_process_flywheel_pulse(metrics, pulse_time);
+    uint32_t events = 0;
+    
+    // Update inertia calibration if active
+    if (is_calibrating) {
+        web_server_update_inertia_calibration(metrics->angular_velocity_rad_s, pulse_time);
+    } else {
+        // Update stroke detection (skip during calibration)
+        events = stroke_detector_update(metrics);
+        
+        // Force curve point, and the stroke record at a finish
+        stroke_record_on_pulse(metrics, events);
+        
+        // Per-pulse recording sees the phase this pulse produced
+        session_detail_on_pulse(metrics, pulse_time);
+    }
+    
+    // Readers on other tasks see every pulse's result as a whole
+    metrics_calculator_publish(metrics);
+    
+    // Stroke boundaries wake the broadcast task only now, so it sends the
+    // snapshot that already holds them
+    event_bus_publish(events, pulse_time);
+}
+
+/**
+ * Drain both pulse rings in timestamp order
+ * Flywheel and seat events are merged so the stroke detector sees them in
+ * the same order the ISRs recorded them.
+ */
+static void drain_pulse_rings(rowing_metrics_t *metrics, bool is_calibrating) {
+    int64_t flywheel_time;
+    int64_t seat_time;
+    
+    while (true) {
+        bool have_flywheel = pulse_ring_peek(&g_flywheel_ring, &flywheel_time);
+        bool have_seat = pulse_ring_peek(&g_seat_ring, &seat_time);
+        
+        if (!have_flywheel && !have_seat) {
+            break;
+        }
+        
+        if (have_flywheel && (!have_seat || flywheel_time <= seat_time)) {
+            pulse_ring_pop(&g_flywheel_ring, &flywheel_time);
+            trace_recorder_log(TRACE_CHANNEL_FLYWHEEL, flywheel_time);
+            process_flywheel_pulse(metrics, flywheel_time, is_calibrating);
+        } else {
+            pulse_ring_pop(&g_seat_ring, &seat_time);
+            trace_recorder_log(TRACE_CHANNEL_SEAT, seat_time);
+            // Seat trigger detected (skip during calibration)
+            if (!is_calibrating) {
+                uint32_t events = stroke_detector_process_seat_trigger(metrics, seat_time);
+                stroke_record_on_seat(metrics, events);
+                if (events != 0) {
+                    metrics_calculator_publish(metrics);
+                    event_bus_publish(events, seat_time);
+                }
+            }
+        }
+    }
+}
+
 /**
  * Sensor processing task
- * Waits for events from ISR, performs detailed processing
+ * Waits for events from ISR, drains queued timestamps and performs detailed processing
  */
 static void sensor_processing_task(void *arg) {
     rowing_metrics_t *metrics = (rowing_metrics_t*)arg;
@@ -112,7 +194,9 @@ static void sensor_processing_task(void *arg) {
     
     while (task_running) {
         // Wait for sensor events (block until event or timeout)
-        EventBits_t bits = xEventGroupWaitBits(
+        // The bits only wake the task; the rings carry the actual timestamps,
+        // so several pulses behind one wake-up are all processed.
+        xEventGroupWaitBits(
             sensor_event_group,
             FLYWHEEL_EVENT_BIT | SEAT_EVENT_BIT,
             pdTRUE,  // Clear bits on exit
@@ -123,37 +207,20 @@ static void sensor_processing_task(void *arg) {
         // Check calibration state once per iteration
         bool is_calibrating = web_server_is_calibrating_inertia();
         
-        if (bits & FLYWHEEL_EVENT_BIT) {
-            // Flywheel pulse detected - process physics
-            int64_t pulse_time = g_last_flywheel_time_us;
-            rowing_physics_process_flywheel_pulse(metrics, pulse_time);
-            
-            // Update inertia calibration if active
-            if (is_calibrating) {
-                web_server_update_inertia_calibration(metrics->angular_velocity_rad_s, pulse_time);
-            } else {
-                // Update stroke detection (skip during calibration)
-                stroke_detector_update(metrics);
-            }
-        }
+        metrics_calculator_begin_update();
         
-        if (bits & SEAT_EVENT_BIT) {
-            // Seat trigger detected (skip during calibration)
-            if (!is_calibrating) {
-                stroke_detector_process_seat_trigger(metrics);
-            }
-        }
+        drain_pulse_rings(metrics, is_calibrating);
 
         // Drive the calibration state machine on a timer too, so SPINDOWN can
         // complete after the flywheel has fully stopped (and thus no more
         // FLYWHEEL_EVENT_BITs are arriving). Safe & cheap when idle.
         if (is_calibrating) {
-            web_server_tick_inertia_calibration(esp_timer_get_time());
+            web_server_tick_inertia_calibration(rowing_clock_now_us());
         }
         
         // Check for idle timeout (skip during calibration)
         if (!is_calibrating) {
-            int64_t now = esp_timer_get_time();
+            int64_t now = rowing_clock_now_us();
             int64_t time_since_last_pulse = now - g_last_flywheel_time_us;
             
             if (time_since_last_pulse > (IDLE_TIMEOUT_MS * 1000LL)) {
@@ -173,6 +240,11 @@ static void sensor_processing_task(void *arg) {
         
         // Update elapsed time
         rowing_physics_update_elapsed_time(metrics);
+        
+        // 10 Hz recording cuts its records from the session clock
+        session_detail_update(metrics);
+        
+        metrics_calculator_end_update(metrics);
     }
     
     ESP_LOGI(TAG, "Sensor processing task stopped");
@@ -185,6 +257,13 @@ static void sensor_processing_task(void *arg) {
 esp_err_t sensor_manager_init(void) {
     esp_err_t ret;
     
+    // Reset pulse rings before the ISRs can run
+    if (!pulse_ring_init(&g_flywheel_ring, FLYWHEEL_PULSE_RING_SIZE) ||
+        !pulse_ring_init(&g_seat_ring, SEAT_PULSE_RING_SIZE)) {
+        ESP_LOGE(TAG, "Invalid pulse ring size");
+        return ESP_ERR_INVALID_SIZE;
+    }
+    
     // Create event group
     sensor_event_group = xEventGroupCreate();
     if (sensor_event_group == NULL) {
@@ -324,8 +403,18 @@ int64_t sensor_get_last_seat_time(void) {
     return g_last_seat_time_us;
 }
 
+void sensor_manager_get_ring_stats(sensor_ring_stats_t *stats) {
+    if (stats == NULL) {
+        return;
+    }
+    stats->flywheel_overflows = g_flywheel_ring.overflow_count;
+    stats->flywheel_high_watermark = g_flywheel_ring.high_watermark;
+    stats->seat_overflows = g_seat_ring.overflow_count;
+    stats->seat_high_watermark = g_seat_ring.high_watermark;
+}
+
 bool sensor_manager_is_active(void) {
-    int64_t now = esp_timer_get_time();
+    int64_t now = rowing_clock_now_us();
     return (now - g_last_flywheel_time_us) < (IDLE_TIMEOUT_MS * 1000LL);
 }
 
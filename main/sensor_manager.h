@@ -9,6 +9,16 @@
 #include "esp_err.h"
 #include "rowing_physics.h"
 
+/**
+ * ISR -> task pulse ring statistics
+ */
+typedef struct {
+    uint32_t flywheel_overflows;        // Flywheel pulses dropped (ring full)
+    uint32_t flywheel_high_watermark;   // Max queued flywheel pulses
+    uint32_t seat_overflows;            // Seat triggers dropped (ring full)
+    uint32_t seat_high_watermark;       // Max queued seat triggers
+} sensor_ring_stats_t;
+
 /**
  * Initialize sensor GPIO and interrupts
  * @return ESP_OK on success
@@ -44,6 +54,12 @@ uint32_t sensor_get_seat_count(void);
  */
 int64_t sensor_get_last_seat_time(void);
 
+/**
+ * Get pulse ring overflow and high-watermark counters
+ * @param stats Output statistics
+ */
+void sensor_manager_get_ring_stats(sensor_ring_stats_t *stats);
+
 /**
  * Start sensor processing task
  * @param metrics Pointer to metrics structure for updates
@@ -0,0 +1,248 @@
+/**
+ * @file session_detail.c
+ * @brief High-resolution records of the running session (recording profiles)
+ */
+
+#include "session_detail.h"
+#include "session_sampler.h"
+#include "record_ring.h"
+#include "app_config.h"
+
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "DETAIL";
+
+// Largest record of any profile
+#define MAX_RECORD_BYTES        (sizeof(sample_10hz_t) > sizeof(sample_pulse_t) ? \
+                                 sizeof(sample_10hz_t) : sizeof(sample_pulse_t))
+
+// Longest pulse interval a record holds (24 bits)
+#define MAX_INTERVAL_US         0xFFFFFF
+
+_Static_assert((SESSION_DETAIL_RING_RECORDS & (SESSION_DETAIL_RING_RECORDS - 1)) == 0,
+               "SESSION_DETAIL_RING_RECORDS must be a power of two");
+
+static const char *const s_profile_names[RECORDING_PROFILE_COUNT] = { "1hz", "10hz", "pulse" };
+
+// Ring of records: the sensor task writes at head, the storage task reads at tail
+static uint8_t *s_slots = NULL;
+static bool s_psram = false;
+static record_ring_t s_ring;
+
+// Producer state (metrics update lock)
+static bool s_recording = false;
+static recording_profile_t s_profile = RECORDING_PROFILE_1HZ;
+
+// 10 Hz: buckets cut from the session clock, totals handed out so far
+static session_sampler_t s_sampler;
+static uint32_t s_emitted_work_dj;          // 0.1 J: over 100 ms, one unit is 1 W
+static uint32_t s_emitted_distance_cm;
+
+// Per pulse: time of the last pulse stored
+static int64_t s_last_pulse_us;
+
+/**
+ * Store a 10 Hz record; on a full ring its work and distance go to the next one
+ */
+static void push_10hz(sample_10hz_t *record, uint32_t work_before, uint32_t distance_before) {
+    if (!record_ring_push(&s_ring, record)) {
+        s_emitted_work_dj = work_before;
+        s_emitted_distance_cm = distance_before;
+    }
+}
+
+/**
+ * Allocate the ring
+ */
+esp_err_t session_detail_init(void) {
+    if (s_slots != NULL) {
+        return ESP_OK;
+    }
+
+    size_t bytes = SESSION_DETAIL_RING_RECORDS * MAX_RECORD_BYTES;
+#ifdef CONFIG_SPIRAM
+    s_slots = heap_caps_malloc(bytes, MALLOC_CAP_SPIRAM);
+    s_psram = s_slots != NULL;
+#endif
+    if (s_slots == NULL) {
+        s_slots = malloc(bytes);
+    }
+    if (s_slots == NULL) {
+        ESP_LOGE(TAG, "Failed to allocate detail ring (%u bytes)", (unsigned int)bytes);
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(TAG, "Detail ring allocated in %s (%u bytes, %d records)",
+             s_psram ? "PSRAM" : "heap", (unsigned int)bytes, SESSION_DETAIL_RING_RECORDS);
+    return ESP_OK;
+}
+
+/**
+ * Start recording a session
+ */
+void session_detail_begin(recording_profile_t profile, int64_t start_time_us) {
+    const sample_codec_layout_t *layout = session_detail_layout(profile);
+
+    record_ring_init(&s_ring, s_slots, SESSION_DETAIL_RING_RECORDS, layout != NULL ? layout->record_size : 0);
+    s_profile = profile;
+    s_recording = layout != NULL && s_slots != NULL;
+
+    session_sampler_reset(&s_sampler, SESSION_DETAIL_10HZ_MS);
+    s_emitted_work_dj = 0;
+    s_emitted_distance_cm = 0;
+    s_last_pulse_us = start_time_us;
+}
+
+/**
+ * Feed the 10 Hz records
+ */
+void session_detail_update(const rowing_metrics_t *metrics) {
+    if (!s_recording || s_profile != RECORDING_PROFILE_10HZ) {
+        return;
+    }
+
+    session_sampler_update(&s_sampler, metrics->elapsed_time_ms, metrics->total_work_joules,
+                           metrics->total_distance_meters, 0);
+
+    float work;
+    float distance;
+    while (session_sampler_next_boundary(&s_sampler, &work, &distance)) {
+        uint32_t work_before = s_emitted_work_dj;
+        uint32_t distance_before = s_emitted_distance_cm;
+        sample_10hz_t record = {
+            .power_watts = session_sampler_take(session_sampler_round_total(work * 10.0f), &s_emitted_work_dj),
+            .omega_crad_s = session_sampler_to_u16(metrics->angular_velocity_rad_s * 100.0f),
+            .distance_cm = session_sampler_take(session_sampler_round_total(distance * 100.0f),
+                                                &s_emitted_distance_cm),
+            .phase = (uint8_t)metrics->current_phase,
+        };
+        push_10hz(&record, work_before, distance_before);
+    }
+}
+
+/**
+ * Record a flywheel pulse
+ */
+void session_detail_on_pulse(const rowing_metrics_t *metrics, int64_t pulse_time_us) {
+    if (!s_recording || s_profile != RECORDING_PROFILE_PULSE) {
+        return;
+    }
+
+    int64_t interval = pulse_time_us - s_last_pulse_us;
+    if (interval < 0) {
+        interval = 0;               // Queued before the session started
+    } else if (interval > MAX_INTERVAL_US) {
+        interval = MAX_INTERVAL_US;
+    }
+
+    sample_pulse_t record = {
+        .interval_us = (uint16_t)interval,
+        .interval_us_high = (uint8_t)(interval >> 16),
+        .phase = (uint8_t)metrics->current_phase,
+    };
+    // A dropped pulse's interval goes into the next one stored
+    if (record_ring_push(&s_ring, &record) && pulse_time_us > s_last_pulse_us) {
+        s_last_pulse_us = pulse_time_us;
+    }
+}
+
+/**
+ * Stop recording
+ */
+void session_detail_end(const rowing_metrics_t *metrics) {
+    if (!s_recording) {
+        return;
+    }
+
+    if (s_profile == RECORDING_PROFILE_10HZ) {
+        session_detail_update(metrics);
+
+        // Partial bucket: power over the part rowed, the rest of the distance
+        uint32_t duration_ms = s_sampler.cur_ms - s_sampler.boundary_ms;
+        uint32_t distance_cm = session_sampler_round_total(s_sampler.cur_distance_m * 100.0f);
+        if (duration_ms > 0 || distance_cm > s_emitted_distance_cm) {
+            float per_second = duration_ms > 0 ? 1000.0f / (float)duration_ms : 0;
+            uint32_t work_before = s_emitted_work_dj;
+            uint32_t distance_before = s_emitted_distance_cm;
+            sample_10hz_t record = {
+                .power_watts = session_sampler_to_u16((s_sampler.cur_work_j - s_sampler.boundary_work_j) * per_second),
+                .omega_crad_s = session_sampler_to_u16(metrics->angular_velocity_rad_s * 100.0f),
+                .distance_cm = session_sampler_take(distance_cm, &s_emitted_distance_cm),
+                .phase = (uint8_t)metrics->current_phase,
+            };
+            push_10hz(&record, work_before, distance_before);
+        }
+    }
+    s_recording = false;
+}
+
+/**
+ * Records waiting for the storage task
+ */
+uint32_t session_detail_pending(void) {
+    return record_ring_pending(&s_ring);
+}
+
+/**
+ * Copy the oldest waiting records
+ */
+uint32_t session_detail_peek(void *records, uint32_t max_records) {
+    return record_ring_peek(&s_ring, records, max_records);
+}
+
+/**
+ * Take stored records
+ */
+void session_detail_consume(uint32_t count) {
+    record_ring_consume(&s_ring, count);
+}
+
+/**
+ * Get the ring counters
+ */
+void session_detail_get_stats(session_detail_stats_t *stats) {
+    stats->profile = (uint8_t)s_profile;
+    stats->records = s_ring.records;
+    stats->dropped = s_ring.dropped;
+    stats->capacity = SESSION_DETAIL_RING_RECORDS;
+    stats->high_watermark = s_ring.high_watermark;
+    stats->bytes = s_slots != NULL ? SESSION_DETAIL_RING_RECORDS * MAX_RECORD_BYTES : 0;
+    stats->psram = s_psram;
+}
+
+/**
+ * Record layout of a profile
+ */
+const sample_codec_layout_t *session_detail_layout(recording_profile_t profile) {
+    switch (profile) {
+        case RECORDING_PROFILE_10HZ:
+            return &sample_codec_layout_10hz;
+        case RECORDING_PROFILE_PULSE:
+            return &sample_codec_layout_pulse;
+        default:
+            return NULL;
+    }
+}
+
+/**
+ * Name of a profile
+ */
+const char *session_detail_profile_name(recording_profile_t profile) {
+    return (unsigned int)profile < RECORDING_PROFILE_COUNT ? s_profile_names[profile] : "1hz";
+}
+
+/**
+ * Parse a profile name
+ */
+bool session_detail_parse_profile(const char *name, recording_profile_t *profile) {
+    for (int i = 0; i < RECORDING_PROFILE_COUNT; i++) {
+        if (strcmp(name, s_profile_names[i]) == 0) {
+            *profile = (recording_profile_t)i;
+            return true;
+        }
+    }
+    return false;
+}
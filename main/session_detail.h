@@ -0,0 +1,119 @@
+/**
+ * @file session_detail.h
+ * @brief High-resolution records of the running session (recording profiles)
+ *
+ * Every session records its per-second samples (session_series.h). A
+ * session started with RECORDING_PROFILE_10HZ or RECORDING_PROFILE_PULSE
+ * also records, on the sensor task:
+ * - 10 Hz: a sample_10hz_t per 100 ms of session time, cut like the
+ *   per-second rows (session_sampler.h with 100 ms buckets), so power and
+ *   distance are integrated over their 100 ms and add up to the totals.
+ *   Fed on every sensor task wake-up, after the elapsed time update.
+ * - Per pulse: a sample_pulse_t per flywheel pulse, fed right after the
+ *   pulse went through physics and stroke detection. The intervals add up
+ *   to the pulse time relative to the session start.
+ *
+ * Records go into a single-producer/single-consumer ring (PSRAM when
+ * available) that the storage task drains into compressed pages
+ * (sample_codec.h). When the ring is full a record is dropped, and what it
+ * held (distance, work, pulse time) is carried into the next record that
+ * fits, so the sums stay right even across a long flash stall.
+ *
+ * Producer calls (begin, update, on_pulse, end) are made with the metrics
+ * update lock held; begin also with the storage task excluded, since it
+ * empties the ring.
+ */
+
+#ifndef SESSION_DETAIL_H
+#define SESSION_DETAIL_H
+
+#include "esp_err.h"
+#include "rowing_physics.h"
+#include "sample_codec.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+// Bucket length of the 10 Hz records
+#define SESSION_DETAIL_10HZ_MS      100
+
+/**
+ * Ring counters of the current (or last) session
+ */
+typedef struct {
+    uint8_t profile;                    // recording_profile_t
+    uint32_t records;                   // Records produced
+    uint32_t dropped;                   // Records lost to a full ring
+    uint32_t capacity;                  // Ring size in records
+    uint32_t high_watermark;            // Most records waiting at once
+    uint32_t bytes;                     // Ring memory
+    bool psram;
+} session_detail_stats_t;
+
+/**
+ * Allocate the ring (SESSION_DETAIL_RING_RECORDS of the largest record)
+ * @return ESP_OK, ESP_ERR_NO_MEM
+ */
+esp_err_t session_detail_init(void);
+
+/**
+ * Start recording a session (empties the ring)
+ * @param profile RECORDING_PROFILE_1HZ records nothing here
+ * @param start_time_us Session start (rowing_clock), origin of the pulse intervals
+ */
+void session_detail_begin(recording_profile_t profile, int64_t start_time_us);
+
+/**
+ * Feed the 10 Hz records (every sensor task wake-up)
+ */
+void session_detail_update(const rowing_metrics_t *metrics);
+
+/**
+ * Record a flywheel pulse
+ * @param pulse_time_us Its timestamp
+ */
+void session_detail_on_pulse(const rowing_metrics_t *metrics, int64_t pulse_time_us);
+
+/**
+ * Stop recording: closes the last (partial) 10 Hz bucket
+ */
+void session_detail_end(const rowing_metrics_t *metrics);
+
+/**
+ * Records waiting for the storage task
+ */
+uint32_t session_detail_pending(void);
+
+/**
+ * Copy the oldest waiting records without taking them (storage task)
+ * @param records Output, max_records of the profile's record type
+ * @return Records copied
+ */
+uint32_t session_detail_peek(void *records, uint32_t max_records);
+
+/**
+ * Take records copied by session_detail_peek() once they are stored
+ */
+void session_detail_consume(uint32_t count);
+
+/**
+ * Get the ring counters
+ */
+void session_detail_get_stats(session_detail_stats_t *stats);
+
+/**
+ * Record layout of a profile (NULL for RECORDING_PROFILE_1HZ)
+ */
+const sample_codec_layout_t *session_detail_layout(recording_profile_t profile);
+
+/**
+ * Name of a profile ("1hz", "10hz", "pulse")
+ */
+const char *session_detail_profile_name(recording_profile_t profile);
+
+/**
+ * Parse a profile name
+ * @return false if unknown
+ */
+bool session_detail_parse_profile(const char *name, recording_profile_t *profile);
+
+#endif // SESSION_DETAIL_H
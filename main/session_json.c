@@ -0,0 +1,111 @@
+/**
+ * @file session_json.c
+ * @brief Session history JSON (list entries and per-second detail)
+ */
+
+#include "session_json.h"
+#include "session_manager.h"
+#include "session_detail.h"
+
+/**
+ * Which per-second array a pass over the samples writes
+ */
+typedef enum {
+    SAMPLE_ARRAY_HEART_RATE = 0,
+    SAMPLE_ARRAY_POWER,
+    SAMPLE_ARRAY_SPEED,
+} sample_array_t;
+
+void session_json_write_summary(json_writer_t *writer, const session_record_t *record) {
+    json_writer_number(writer, "id", record->session_id);
+    json_writer_number(writer, "startTime", (double)record->start_timestamp);
+    json_writer_number(writer, "duration", record->duration_seconds);
+    json_writer_number(writer, "distance", record->total_distance_meters);
+    json_writer_number(writer, "strokes", record->stroke_count);
+    json_writer_number(writer, "calories", record->total_calories);
+    json_writer_number(writer, "avgPower", record->average_power_watts);
+    json_writer_number(writer, "avgPace", record->average_pace_sec_500m);
+    json_writer_number(writer, "dragFactor", record->drag_factor);
+    json_writer_number(writer, "avgHeartRate", record->average_heart_rate);
+    json_writer_number(writer, "maxHeartRate", record->max_heart_rate);
+    json_writer_bool(writer, "synced", record->synced);
+    json_writer_string(writer, "recordingProfile",
+                       session_detail_profile_name((recording_profile_t)record->recording_profile));
+}
+
+/**
+ * Write one sample array, reading the session slice by slice
+ */
+static bool write_sample_array(json_writer_t *writer, const session_record_t *record,
+                               sample_data_t *slice, sample_array_t which, const char *key) {
+    // start_timestamp is Unix epoch milliseconds (when SNTP is synced) or
+    // milliseconds since boot; samples are one second apart
+    int64_t base_time_ms = record->start_timestamp;
+    bool ok = true;
+
+    json_writer_begin_array(writer, key);
+    uint32_t index = 0;
+    // Once the sink has failed the rest of the output is dropped, so stop
+    // reading flash for it
+    while (index < record->sample_count && json_writer_ok(writer)) {
+        uint32_t count = 0;
+        if (session_manager_read_samples(record->session_id, index, slice,
+                                         SESSION_JSON_SLICE_SAMPLES, &count) != ESP_OK) {
+            ok = false;
+            break;
+        }
+        if (count == 0) {
+            break;
+        }
+
+        for (uint32_t i = 0; i < count; i++) {
+            const sample_data_t *sample = &slice[i];
+            double time_ms = (double)(base_time_ms + (int64_t)(index + i) * 1000);
+
+            switch (which) {
+                case SAMPLE_ARRAY_HEART_RATE:
+                    if (sample->heart_rate == 0) {
+                        continue;
+                    }
+                    json_writer_begin_object(writer, NULL);
+                    json_writer_number(writer, "time", time_ms);
+                    json_writer_number(writer, "bpm", sample->heart_rate);
+                    json_writer_end_object(writer);
+                    break;
+                case SAMPLE_ARRAY_POWER:
+                    json_writer_begin_object(writer, NULL);
+                    json_writer_number(writer, "time", time_ms);
+                    json_writer_number(writer, "watts", sample->power_watts);
+                    json_writer_end_object(writer);
+                    break;
+                case SAMPLE_ARRAY_SPEED:
+                    // Velocity is stored in cm/s
+                    json_writer_begin_object(writer, NULL);
+                    json_writer_number(writer, "time", time_ms);
+                    json_writer_number(writer, "metersPerSecond", sample->velocity_cm_s / 100.0f);
+                    json_writer_end_object(writer);
+                    break;
+            }
+        }
+        index += count;
+    }
+    json_writer_end_array(writer);
+    return ok && json_writer_ok(writer);
+}
+
+bool session_json_write_detail(json_writer_t *writer, const session_record_t *record,
+                               sample_data_t *slice) {
+    json_writer_begin_object(writer, NULL);
+    session_json_write_summary(writer, record);
+
+    // One pass per array keeps the output in the order clients expect; the
+    // samples of a stored session stay in the read cache between passes.
+    // Every array is written even if a read fails, so no key goes missing.
+    bool ok = true;
+    ok &= write_sample_array(writer, record, slice, SAMPLE_ARRAY_HEART_RATE, "heartRateSamples");
+    ok &= write_sample_array(writer, record, slice, SAMPLE_ARRAY_POWER, "powerSamples");
+    ok &= write_sample_array(writer, record, slice, SAMPLE_ARRAY_SPEED, "speedSamples");
+
+    json_writer_end_object(writer);
+    return ok;
+}
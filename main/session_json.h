@@ -0,0 +1,34 @@
+/**
+ * @file session_json.h
+ * @brief Session history JSON (list entries and per-second detail)
+ *
+ * Emits the /api/sessions and /api/sessions/{id} documents through a
+ * json_writer, reading samples in slices so sessions of any length are
+ * exported in constant memory.
+ */
+
+#ifndef SESSION_JSON_H
+#define SESSION_JSON_H
+
+#include <stdbool.h>
+#include "json_writer.h"
+#include "rowing_physics.h"
+
+// Samples read per slice while writing the detail arrays
+#define SESSION_JSON_SLICE_SAMPLES  128
+
+/**
+ * Write the summary fields of a session (inside an open object)
+ */
+void session_json_write_summary(json_writer_t *writer, const session_record_t *record);
+
+/**
+ * Write a session detail document: the summary fields followed by the
+ * Health Connect sample arrays (heartRateSamples, powerSamples, speedSamples)
+ * @param slice Scratch for SESSION_JSON_SLICE_SAMPLES samples
+ * @return false if samples could not be read or the writer failed
+ */
+bool session_json_write_detail(json_writer_t *writer, const session_record_t *record,
+                               sample_data_t *slice);
+
+#endif // SESSION_JSON_H
@@ -1,33 +1,63 @@
 /**
  * @file session_manager.c
  * @brief Session tracking and history management
+ *
+ * Samples of the running session are kept in RAM (session_series) and
+ * flushed to the session store in fixed pages of SESSION_FLUSH_PAGE_SAMPLES by the low-priority
+ * storage task, each page compressed with sample_codec and each flush
+ * followed by a checkpoint of the summary so far. Reads of stored sessions
+ * decode the pages again.
+ * Sessions recorded with a high-resolution profile also flush the records
+ * of session_detail into a stream of their own, in pages of
+ * SESSION_DETAIL_PAGE_RECORDS. Every session flushes its stroke records
+ * (stroke_record) the same way, in pages of SESSION_STROKE_PAGE_RECORDS.
+ * Ending a session only hands the final record to the storage task. After a
+ * reset, sessions left open in the store are committed from their last
+ * checkpoint at boot.
  */
 
 #include "session_manager.h"
+#include "session_store.h"
+#include "session_series.h"
+#include "session_sampler.h"
+#include "session_detail.h"
+#include "stroke_record.h"
+#include "sample_codec.h"
 #include "app_config.h"
 #include "web_server.h"
 #include "wifi_manager.h"
+#include "rowing_clock.h"
 
 #include "nvs_flash.h"
 #include "nvs.h"
 #include "esp_log.h"
 #include "esp_timer.h"
 #include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
 
 #include <string.h>
 #include <time.h>
 
 static const char *TAG = "SESSION";
 
-// NVS namespace for sessions
+// NVS namespace of sessions saved by older firmware (migrated on boot)
 #define SESSION_NVS_NAMESPACE   "sessions"
 
-// Maximum number of sessions to store
-#define MAX_STORED_SESSIONS     20
+// Slots used by the NVS layout (slot = session_id % LEGACY_NVS_SLOTS)
+#define LEGACY_NVS_SLOTS        20
 
-// Sample buffer size - allocate in PSRAM if available
-// 7200 samples = 2 hours at 1 sample/sec, 8 bytes each = 57.6KB
-#define SAMPLE_BUFFER_SIZE      7200
+#define MAX_OF(a, b)            ((a) > (b) ? (a) : (b))
+
+// Decoded and encoded size of the largest page of any stream
+#define PAGE_RECORD_BYTES       MAX_OF(MAX_OF(SESSION_FLUSH_PAGE_SAMPLES * sizeof(sample_data_t), \
+                                              SESSION_DETAIL_PAGE_RECORDS * sizeof(sample_10hz_t)), \
+                                       SESSION_STROKE_PAGE_RECORDS * sizeof(stroke_record_t))
+#define PAGE_MAX_BYTES          MAX_OF(MAX_OF(SAMPLE_CODEC_MAX_BYTES(SESSION_FLUSH_PAGE_SAMPLES), \
+                                              SAMPLE_CODEC_RECORD_MAX_BYTES(4, SESSION_DETAIL_PAGE_RECORDS)), \
+                                       SAMPLE_CODEC_RECORD_MAX_BYTES(SAMPLE_CODEC_MAX_FIELDS, \
+                                                                     SESSION_STROKE_PAGE_RECORDS))
 
 // Current session state
 static uint32_t s_current_session_id = 0;
@@ -35,63 +65,731 @@ static int64_t s_session_start_time = 0;         // esp_timer value for elapsed
 static int64_t s_session_start_unix_ms = 0;      // Unix epoch timestamp in milliseconds
 static uint32_t s_session_count = 0;
 static uint32_t s_stroke_count_at_resume = 0;    // Stroke count when session started/resumed (for auto-pause)
+static recording_profile_t s_recording_profile = RECORDING_PROFILE_1HZ;    // For sessions started from now
+static recording_profile_t s_session_profile = RECORDING_PROFILE_1HZ;      // Of the current session
 
-// Sample buffer for current session
-static sample_data_t *s_sample_buffer = NULL;
-static uint32_t s_sample_count = 0;
-static float s_last_distance = 0;
-static uint32_t s_heart_rate_sum = 0;
-static uint32_t s_heart_rate_count = 0;
-static uint8_t s_max_heart_rate = 0;
+// Per-second sampling of the current session (rows live in session_series)
+static session_sampler_t s_sampler;                 // Under s_sample_lock
 static float s_stroke_rate_sum = 0;
 static uint32_t s_stroke_rate_samples = 0;
 
+// Handed from the recording tasks to the storage task
+static portMUX_TYPE s_sample_lock = portMUX_INITIALIZER_UNLOCKED;   // Appends, progress, end
+static session_record_t s_progress;                 // Summary as of the last sample
+static bool s_end_pending = false;                  // Ended, not yet committed
+static bool s_end_save = false;                     // Commit (else drop) the ended session
+static session_record_t s_end_record;
+
+// Storage task state (under s_flush_mutex)
+static TaskHandle_t s_storage_task = NULL;
+static SemaphoreHandle_t s_flush_mutex = NULL;
+static uint32_t s_store_session_id = 0;             // Session open in the store
+static uint32_t s_flushed_samples = 0;
+static uint32_t s_flushed_bytes = 0;                // Page stream offset of the next page
+static uint32_t s_detail_records = 0;               // Detail records flushed for the open session
+static uint32_t s_detail_bytes = 0;                 // Detail stream offset of the next page
+static uint32_t s_stroke_records = 0;               // Stroke records flushed for the open session
+static uint32_t s_stroke_bytes = 0;                 // Stroke stream offset of the next page
+static session_flush_stats_t s_flush_stats;
+static uint8_t s_encode_buf[PAGE_MAX_BYTES];
+static sample_data_t s_rows[SESSION_FLUSH_PAGE_SAMPLES];   // Also used by recovery at init
+static uint8_t s_detail_rows[SESSION_DETAIL_PAGE_RECORDS * sizeof(sample_10hz_t)];
+static stroke_record_t s_stroke_rows[SESSION_STROKE_PAGE_RECORDS];
+
+// What recording costs on this device: page bytes per record flushed, and
+// records per second of session for the per-pulse profile (under s_flush_mutex)
+static struct {
+    uint32_t records;
+    uint32_t page_bytes;
+    uint32_t session_records;           // Records of ended sessions
+    uint32_t session_seconds;           // Their duration
+} s_cost[RECORDING_PROFILE_COUNT];
+static struct {
+    uint32_t records;
+    uint32_t page_bytes;
+    uint32_t session_records;
+    uint32_t session_seconds;
+} s_stroke_cost;                        // Same for the stroke records of every profile
+
+// Last page decoded from the store (under s_read_mutex)
+static SemaphoreHandle_t s_read_mutex = NULL;
+static struct {
+    uint32_t session_id;                            // 0 = empty
+    session_store_stream_t stream;
+    uint32_t first;                                 // Index of the page's first record
+    uint32_t count;
+    uint32_t next_offset;                           // Page stream offset of the next page
+    uint8_t encoded[PAGE_MAX_BYTES];
+    uint8_t records[PAGE_RECORD_BYTES];
+} s_page_cache;
+
 /**
- * Initialize session manager
+ * Sessions below this are not worth keeping
  */
-esp_err_t session_manager_init(void) {
+static bool worth_saving(uint32_t stroke_count, float distance_meters) {
+    return stroke_count >= 5 && distance_meters >= 10.0f;
+}
+
+/**
+ * Page stream of a recording profile's detail records
+ */
+static session_store_stream_t detail_stream(recording_profile_t profile) {
+    return profile == RECORDING_PROFILE_PULSE ? SESSION_STORE_STREAM_PULSE_PAGES : SESSION_STORE_STREAM_10HZ_PAGES;
+}
+
+/**
+ * Record layout of a page stream
+ */
+static const sample_codec_layout_t *stream_layout(session_store_stream_t stream) {
+    switch (stream) {
+    case SESSION_STORE_STREAM_10HZ_PAGES:
+        return &sample_codec_layout_10hz;
+    case SESSION_STORE_STREAM_PULSE_PAGES:
+        return &sample_codec_layout_pulse;
+    case SESSION_STORE_STREAM_STROKE_PAGES:
+        return &sample_codec_layout_strokes;
+    default:
+        return &sample_codec_layout_samples;
+    }
+}
+
+/**
+ * Most records in a page of a stream
+ */
+static uint32_t stream_page_records(session_store_stream_t stream) {
+    switch (stream) {
+    case SESSION_STORE_STREAM_SAMPLE_PAGES:
+        return SESSION_FLUSH_PAGE_SAMPLES;
+    case SESSION_STORE_STREAM_STROKE_PAGES:
+        return SESSION_STROKE_PAGE_RECORDS;
+    default:
+        return SESSION_DETAIL_PAGE_RECORDS;
+    }
+}
+
+/**
+ * Write records as compressed pages of at most stream_page_records()
+ * @param offset In/out: page stream offset
+ * @param written Out: page bytes appended
+ */
+static esp_err_t append_pages(uint32_t session_id, session_store_stream_t stream, const void *records,
+                              uint32_t count, uint32_t *offset, uint32_t *written) {
+    const sample_codec_layout_t *layout = stream_layout(stream);
+    uint32_t page_records = stream_page_records(stream);
+    *written = 0;
+    for (uint32_t i = 0; i < count; i += page_records) {
+        uint32_t n = count - i < page_records ? count - i : page_records;
+        size_t len = sample_codec_encode_records(layout, (const uint8_t *)records + i * layout->record_size,
+                                                 n, s_encode_buf);
+        esp_err_t ret = session_store_append(session_id, stream, *offset, s_encode_buf, len);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        *offset += len;
+        *written += len;
+    }
+    return ESP_OK;
+}
+
+/**
+ * Read the header of the stored page at a page stream offset
+ * @param count Out: records in the page, 0 past the last page
+ */
+static esp_err_t read_page_header(uint32_t session_id, session_store_stream_t stream, uint32_t offset,
+                                  uint16_t *length, uint8_t *count) {
+    uint8_t header[SAMPLE_CODEC_PAGE_HEADER];
+    uint32_t n = 0;
+    esp_err_t ret = session_store_read(session_id, stream, offset, header, sizeof(header), &n);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    if (n < sizeof(header)) {
+        *length = 0;
+        *count = 0;
+        return ESP_OK;
+    }
+    // The length bound of the stream's layout keeps a damaged header within the page buffers
+    if (!sample_codec_page_info(header, length, count) || *count > stream_page_records(stream) ||
+        *length > SAMPLE_CODEC_RECORD_MAX_BYTES(stream_layout(stream)->fields, *count)) {
+        return ESP_ERR_INVALID_VERSION;
+    }
+    return ESP_OK;
+}
+
+/**
+ * Decode the stored page holding a record into s_page_cache (s_read_mutex
+ * held). Walks the page headers from the cached page, or from the start
+ * for an earlier record.
+ * @param found Out: false past the last record
+ */
+static esp_err_t load_page(uint32_t session_id, session_store_stream_t stream, uint32_t sample, bool *found) {
+    uint32_t first = 0;
+    uint32_t offset = 0;
+    if (s_page_cache.session_id == session_id && s_page_cache.stream == stream && sample >= s_page_cache.first) {
+        first = s_page_cache.first + s_page_cache.count;
+        offset = s_page_cache.next_offset;
+    }
+    
+    while (true) {
+        uint16_t length;
+        uint8_t count;
+        esp_err_t ret = read_page_header(session_id, stream, offset, &length, &count);
+        if (ret != ESP_OK || count == 0) {
+            *found = false;
+            return ret;
+        }
+        if (sample < first + count) {
+            uint32_t n = 0;
+            s_page_cache.session_id = 0;
+            ret = session_store_read(session_id, stream, offset, s_page_cache.encoded, length, &n);
+            if (ret != ESP_OK) {
+                return ret;
+            }
+            if (sample_codec_decode_records(stream_layout(stream), s_page_cache.encoded, n,
+                                            s_page_cache.records, stream_page_records(stream)) != count) {
+                return ESP_ERR_INVALID_VERSION;
+            }
+            s_page_cache.session_id = session_id;
+            s_page_cache.stream = stream;
+            s_page_cache.first = first;
+            s_page_cache.count = count;
+            s_page_cache.next_offset = offset + length;
+            *found = true;
+            return ESP_OK;
+        }
+        first += count;
+        offset += length;
+    }
+}
+
+/**
+ * Forget the decoded page (its session was deleted or the store reformatted,
+ * and session ids restart after a clear)
+ */
+static void invalidate_page_cache(void) {
+    if (s_read_mutex != NULL) {
+        xSemaphoreTake(s_read_mutex, portMAX_DELAY);
+        s_page_cache.session_id = 0;
+        xSemaphoreGive(s_read_mutex);
+    }
+}
+
+/**
+ * Read decoded record bytes of a stored session's page stream
+ */
+static esp_err_t read_stored_bytes(uint32_t session_id, session_store_stream_t stream, uint32_t offset,
+                                   uint8_t *buffer, uint32_t length, uint32_t *bytes_read) {
+    uint32_t record_size = stream_layout(stream)->record_size;
+    xSemaphoreTake(s_read_mutex, portMAX_DELAY);
+    
+    esp_err_t ret = ESP_OK;
+    while (length > 0) {
+        uint32_t sample = offset / record_size;
+        if (s_page_cache.session_id != session_id || s_page_cache.stream != stream ||
+            sample < s_page_cache.first || sample >= s_page_cache.first + s_page_cache.count) {
+            bool found = false;
+            ret = load_page(session_id, stream, sample, &found);
+            if (ret != ESP_OK || !found) {
+                break;
+            }
+        }
+        
+        uint32_t page_offset = offset - s_page_cache.first * record_size;
+        uint32_t n = s_page_cache.count * record_size - page_offset;
+        if (n > length) {
+            n = length;
+        }
+        memcpy(buffer, s_page_cache.records + page_offset, n);
+        buffer += n;
+        offset += n;
+        length -= n;
+        *bytes_read += n;
+    }
+    
+    xSemaphoreGive(s_read_mutex);
+    return ret;
+}
+
+/**
+ * Summary of the running session from the current metrics
+ */
+static void fill_record(session_record_t *record, const rowing_metrics_t *metrics) {
+    memset(record, 0, sizeof(*record));
+    
+    record->session_id = s_current_session_id;
+    // Use Unix epoch milliseconds if available, otherwise fall back to esp_timer value
+    // The companion app expects Unix epoch milliseconds for startTime
+    if (s_session_start_unix_ms > 0) {
+        record->start_timestamp = s_session_start_unix_ms;
+    } else {
+        // Fallback: use microseconds since boot / 1000 to get ms (for legacy compatibility)
+        // This will result in a small timestamp that the app can detect as invalid
+        record->start_timestamp = s_session_start_time / 1000;
+    }
+    record->duration_seconds = metrics->elapsed_time_ms / 1000;
+    record->total_distance_meters = metrics->total_distance_meters;
+    record->average_pace_sec_500m = metrics->average_pace_sec_500m;
+    record->average_power_watts = metrics->average_power_watts;
+    record->stroke_count = metrics->stroke_count;
+    record->total_calories = metrics->total_calories;
+    record->drag_factor = metrics->drag_factor;
+    record->synced = 0;  // Not synced initially
+    record->recording_profile = (uint8_t)s_session_profile;
+    
+    // Sample count and heart rate from the recorded rows
+    session_series_stats_t stats;
+    session_series_get_stats(&stats);
+    record->sample_count = stats.samples;
+    record->max_heart_rate = stats.max_hr;
+    if (stats.hr_samples > 0) {
+        record->average_heart_rate = (float)stats.hr_sum / (float)stats.hr_samples;
+    }
+    
+    // Calculate average stroke rate from samples
+    if (s_stroke_rate_samples > 0) {
+        record->average_stroke_rate = s_stroke_rate_sum / (float)s_stroke_rate_samples;
+    } else {
+        record->average_stroke_rate = metrics->avg_stroke_rate_spm;
+    }
+}
+
+/**
+ * Move sessions saved as NVS blobs by older firmware into the session store,
+ * then drop the blobs
+ */
+static void migrate_nvs_sessions(void) {
     nvs_handle_t handle;
-    esp_err_t ret;
+    if (nvs_open(SESSION_NVS_NAMESPACE, NVS_READONLY, &handle) != ESP_OK) {
+        return;
+    }
     
-    ret = nvs_open(SESSION_NVS_NAMESPACE, NVS_READONLY, &handle);
-    if (ret == ESP_OK) {
-        // Load session count
-        nvs_get_u32(handle, "count", &s_session_count);
+    uint32_t migrated = 0;
+    for (uint32_t slot = 0; slot < LEGACY_NVS_SLOTS; slot++) {
+        char key[16];
+        snprintf(key, sizeof(key), "s%lu", (unsigned long)slot);
+        
+        session_record_t record;
+        size_t len = sizeof(record);
+        if (nvs_get_blob(handle, key, &record, &len) != ESP_OK || len != sizeof(record) ||
+            record.session_id == 0 || session_store_begin(record.session_id) != ESP_OK) {
+            continue;
+        }
+        
+        esp_err_t ret = ESP_OK;
+        snprintf(key, sizeof(key), "d%lu", (unsigned long)slot);
+        sample_data_t *samples = NULL;
+        if (nvs_get_blob(handle, key, NULL, &len) == ESP_OK && len > 0 &&
+            (samples = malloc(len)) != NULL && nvs_get_blob(handle, key, samples, &len) == ESP_OK) {
+            record.sample_count = len / sizeof(sample_data_t);
+            uint32_t offset = 0;
+            uint32_t written = 0;
+            ret = append_pages(record.session_id, SESSION_STORE_STREAM_SAMPLE_PAGES, samples,
+                               record.sample_count, &offset, &written);
+        } else {
+            record.sample_count = 0;
+        }
+        free(samples);
+        if (ret == ESP_OK) {
+            ret = session_store_commit(&record);
+        }
+        if (ret != ESP_OK) {
+            session_store_abandon(record.session_id);
+            ESP_LOGE(TAG, "Migrating session #%lu failed: %s, keeping NVS copy",
+                     (unsigned long)record.session_id, esp_err_to_name(ret));
+            nvs_close(handle);
+            return;
+        }
+        migrated++;
+    }
+    nvs_close(handle);
+    
+    if (nvs_open(SESSION_NVS_NAMESPACE, NVS_READWRITE, &handle) == ESP_OK) {
+        nvs_erase_all(handle);
+        nvs_commit(handle);
         nvs_close(handle);
-    } else if (ret == ESP_ERR_NVS_NOT_FOUND) {
-        s_session_count = 0;
-    }
-    
-    // Allocate sample buffer (try PSRAM first, fallback to regular heap)
-#ifdef CONFIG_SPIRAM
-    s_sample_buffer = heap_caps_malloc(SAMPLE_BUFFER_SIZE * sizeof(sample_data_t), MALLOC_CAP_SPIRAM);
-    if (s_sample_buffer) {
-        ESP_LOGI(TAG, "Sample buffer allocated in PSRAM (%u bytes)", 
-                 SAMPLE_BUFFER_SIZE * sizeof(sample_data_t));
-    }
-#endif
-    if (s_sample_buffer == NULL) {
-        s_sample_buffer = malloc(SAMPLE_BUFFER_SIZE * sizeof(sample_data_t));
-        if (s_sample_buffer) {
-            ESP_LOGI(TAG, "Sample buffer allocated in heap (%u bytes)", 
-                     (unsigned int)(SAMPLE_BUFFER_SIZE * sizeof(sample_data_t)));
+    }
+    if (migrated > 0) {
+        ESP_LOGI(TAG, "Migrated %lu sessions from NVS", (unsigned long)migrated);
+    }
+}
+
+/**
+ * Commit sessions a reset left open in the store, from their last checkpoint
+ * plus any pages flushed after it
+ */
+static void recover_sessions(void) {
+    uint32_t ids[SESSION_STORE_MAX_SESSIONS];
+    uint32_t count = session_store_list_open(ids, SESSION_STORE_MAX_SESSIONS);
+    
+    for (uint32_t i = 0; i < count; i++) {
+        session_record_t record;
+        if (session_store_get_checkpoint(ids[i], &record) != ESP_OK) {
+            session_store_abandon(ids[i]);
+            continue;
+        }
+        
+        // Pages written between the last checkpoint and the reset
+        uint32_t n = 0;
+        while (session_manager_read_samples(ids[i], record.sample_count, s_rows,
+                                            SESSION_FLUSH_PAGE_SAMPLES, &n) == ESP_OK && n > 0) {
+            for (uint32_t j = 0; j < n; j++) {
+                record.total_distance_meters += s_rows[j].distance_dm / 10.0f;
+                if (s_rows[j].heart_rate > record.max_heart_rate) {
+                    record.max_heart_rate = s_rows[j].heart_rate;
+                }
+            }
+            record.sample_count += n;
+        }
+        if (record.duration_seconds < record.sample_count) {
+            record.duration_seconds = record.sample_count;
+        }
+        
+        if (!worth_saving(record.stroke_count, record.total_distance_meters)) {
+            session_store_abandon(ids[i]);
+            continue;
+        }
+        esp_err_t ret = session_store_commit(&record);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Recovering session #%lu failed: %s", (unsigned long)ids[i], esp_err_to_name(ret));
+            continue;
+        }
+        s_flush_stats.sessions_recovered++;
+        ESP_LOGW(TAG, "Session #%lu recovered after reset: %.1fm, %lu samples",
+                 (unsigned long)ids[i], record.total_distance_meters, (unsigned long)record.sample_count);
+    }
+}
+
+/**
+ * Write the detail records waiting in the ring as pages (s_flush_mutex
+ * held): whole pages while running, everything once ended
+ * @param written In/out: bytes handed to the store
+ */
+static esp_err_t flush_detail_locked(uint32_t session_id, recording_profile_t profile, bool final,
+                                     uint32_t *written) {
+    session_store_stream_t stream = detail_stream(profile);
+    uint32_t record_size = session_detail_layout(profile)->record_size;
+    esp_err_t ret = ESP_OK;
+    
+    uint32_t pending;
+    while (ret == ESP_OK && (pending = session_detail_pending()) > 0 &&
+           (final || pending >= SESSION_DETAIL_PAGE_RECORDS)) {
+        uint32_t n = session_detail_peek(s_detail_rows, sizeof(s_detail_rows) / record_size);
+        uint32_t page_bytes = 0;
+        ret = append_pages(session_id, stream, s_detail_rows, n, &s_detail_bytes, &page_bytes);
+        if (ret == ESP_OK) {
+            // Taken only once stored, so a failed flush is retried
+            session_detail_consume(n);
+            s_detail_records += n;
+            *written += page_bytes;
+            s_flush_stats.detail_records_flushed += n;
+            s_flush_stats.detail_page_bytes += page_bytes;
+            s_cost[profile].records += n;
+            s_cost[profile].page_bytes += page_bytes;
+        }
+    }
+    return ret;
+}
+
+/**
+ * Write the stroke records waiting in the ring as pages, like
+ * flush_detail_locked()
+ */
+static esp_err_t flush_strokes_locked(uint32_t session_id, bool final, uint32_t *written) {
+    esp_err_t ret = ESP_OK;
+    
+    uint32_t pending;
+    while (ret == ESP_OK && (pending = stroke_record_pending()) > 0 &&
+           (final || pending >= SESSION_STROKE_PAGE_RECORDS)) {
+        uint32_t n = stroke_record_peek(s_stroke_rows, SESSION_STROKE_PAGE_RECORDS);
+        uint32_t page_bytes = 0;
+        ret = append_pages(session_id, SESSION_STORE_STREAM_STROKE_PAGES, s_stroke_rows, n,
+                           &s_stroke_bytes, &page_bytes);
+        if (ret == ESP_OK) {
+            stroke_record_consume(n);
+            s_stroke_records += n;
+            *written += page_bytes;
+            s_flush_stats.stroke_records_flushed += n;
+            s_flush_stats.stroke_page_bytes += page_bytes;
+            s_stroke_cost.records += n;
+            s_stroke_cost.page_bytes += page_bytes;
+        }
+    }
+    return ret;
+}
+
+/**
+ * Drop the detail and stroke records of a session that is not saved
+ */
+static void discard_detail(void) {
+    session_detail_consume(session_detail_pending());
+    stroke_record_consume(stroke_record_pending());
+}
+
+/**
+ * One storage pass (s_flush_mutex held): open the running session in the
+ * store, write its complete pages and a checkpoint, or finish an ended one
+ */
+static esp_err_t flush_locked(void) {
+    portENTER_CRITICAL(&s_sample_lock);
+    bool end_pending = s_end_pending;
+    bool save = s_end_save;
+    session_record_t summary = end_pending ? s_end_record : s_progress;
+    uint32_t session_id = end_pending ? s_end_record.session_id : s_current_session_id;
+    uint32_t count = end_pending ? s_end_record.sample_count : session_series_count();
+    portEXIT_CRITICAL(&s_sample_lock);
+    
+    if (session_id == 0 || (end_pending && !save && s_store_session_id != session_id)) {
+        // Nothing running, or an ended session that never reached the store
+        if (end_pending) {
+            discard_detail();
+            portENTER_CRITICAL(&s_sample_lock);
+            s_end_pending = false;
+            portEXIT_CRITICAL(&s_sample_lock);
+        }
+        return ESP_OK;
+    }
+    
+    int64_t start = esp_timer_get_time();
+    uint32_t written = 0;
+    esp_err_t ret = ESP_OK;
+    
+    if (s_store_session_id != session_id) {
+        // Checkpointed right away so a reset from here on is recoverable
+        session_record_t initial = summary;
+        initial.sample_count = 0;
+        s_flushed_samples = 0;
+        s_flushed_bytes = 0;
+        s_detail_records = 0;
+        s_detail_bytes = 0;
+        s_stroke_records = 0;
+        s_stroke_bytes = 0;
+        ret = session_store_begin(session_id);
+        if (ret == ESP_OK) {
+            ret = session_store_checkpoint(&initial);
+            written += sizeof(initial);
+        }
+        if (ret == ESP_OK) {
+            s_store_session_id = session_id;
         } else {
-            ESP_LOGE(TAG, "Failed to allocate sample buffer!");
+            session_store_abandon(session_id);
+        }
+    }
+    
+    // Whole pages while running, everything once ended
+    uint32_t target = end_pending ? count : count - count % SESSION_FLUSH_PAGE_SAMPLES;
+    uint32_t flushed_before = s_flushed_samples;
+    while (ret == ESP_OK && s_flushed_samples < target) {
+        uint32_t n = target - s_flushed_samples;
+        if (n > SESSION_FLUSH_PAGE_SAMPLES) {
+            n = SESSION_FLUSH_PAGE_SAMPLES;
+        }
+        uint32_t page_bytes = 0;
+        n = session_series_read(s_flushed_samples, s_rows, n);
+        ret = append_pages(session_id, SESSION_STORE_STREAM_SAMPLE_PAGES, s_rows, n,
+                           &s_flushed_bytes, &page_bytes);
+        if (ret == ESP_OK) {
+            s_flushed_samples += n;
+            written += page_bytes;
+            s_flush_stats.samples_flushed += n;
+            s_flush_stats.page_bytes += page_bytes;
+            s_cost[RECORDING_PROFILE_1HZ].records += n;
+            s_cost[RECORDING_PROFILE_1HZ].page_bytes += page_bytes;
+        }
+    }
+    
+    // 10 Hz or per-pulse records of the same session
+    recording_profile_t profile = (recording_profile_t)summary.recording_profile;
+    if (ret == ESP_OK && session_detail_layout(profile) != NULL && (save || !end_pending)) {
+        ret = flush_detail_locked(session_id, profile, end_pending, &written);
+    }
+    if (ret == ESP_OK && (save || !end_pending)) {
+        ret = flush_strokes_locked(session_id, end_pending, &written);
+    }
+    
+    if (end_pending) {
+        if (!save) {
+            discard_detail();
+            session_store_abandon(session_id);
+        } else if (ret == ESP_OK) {
+            ret = session_store_commit(&summary);
+            written += sizeof(summary);
+        }
+        if (save && ret == ESP_OK) {
+            s_session_count = session_id;
+            s_cost[profile].session_records += s_detail_records;
+            s_cost[profile].session_seconds += summary.duration_seconds;
+            s_stroke_cost.session_records += s_stroke_records;
+            s_stroke_cost.session_seconds += summary.duration_seconds;
+            ESP_LOGI(TAG, "Session #%lu saved: %.1fm, %lu strokes, %lu cal",
+                     (unsigned long)session_id, summary.total_distance_meters,
+                     (unsigned long)summary.stroke_count, (unsigned long)summary.total_calories);
+        } else if (save) {
+            // Left open: committed from its checkpoint at the next boot
+            ESP_LOGE(TAG, "Failed to save session #%lu: %s", (unsigned long)session_id, esp_err_to_name(ret));
+        }
+        s_store_session_id = 0;
+        portENTER_CRITICAL(&s_sample_lock);
+        s_end_pending = false;
+        portEXIT_CRITICAL(&s_sample_lock);
+    } else if (ret == ESP_OK && s_flushed_samples > flushed_before) {
+        summary.sample_count = s_flushed_samples;
+        ret = session_store_checkpoint(&summary);
+        written += sizeof(summary);
+    }
+    
+    if (ret != ESP_OK) {
+        s_flush_stats.errors++;
+        ESP_LOGW(TAG, "Flushing session #%lu failed: %s", (unsigned long)session_id, esp_err_to_name(ret));
+    }
+    if (written > 0) {
+        uint32_t elapsed_us = (uint32_t)(esp_timer_get_time() - start);
+        s_flush_stats.flushes++;
+        s_flush_stats.bytes_written += written;
+        s_flush_stats.last_flush_us = elapsed_us;
+        if (elapsed_us > s_flush_stats.max_flush_us) {
+            s_flush_stats.max_flush_us = elapsed_us;
+        }
+    }
+    return ret;
+}
+
+/**
+ * Storage task: flushes on a timer, and right away when a session ends
+ */
+static void storage_task(void *arg) {
+    (void)arg;
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(SESSION_FLUSH_INTERVAL_MS));
+        session_manager_flush();
+    }
+}
+
+/**
+ * Initialize session manager
+ */
+esp_err_t session_manager_init(void) {
+    // Per-second rows of the running session (PSRAM if available)
+    if (session_series_init() != ESP_OK) {
+        ESP_LOGE(TAG, "No session series, samples will not be recorded");
+    }
+    if (session_detail_init() != ESP_OK) {
+        ESP_LOGE(TAG, "No detail ring, sessions are recorded at 1 Hz only");
+    }
+    
+    // Nothing is running after a boot (host tools call init again to
+    // simulate one)
+    s_current_session_id = 0;
+    s_store_session_id = 0;
+    s_end_pending = false;
+    
+    if (s_flush_mutex == NULL) {
+        s_flush_mutex = xSemaphoreCreateMutex();
+        s_read_mutex = xSemaphoreCreateMutex();
+        if (s_flush_mutex == NULL || s_read_mutex == NULL) {
+            return ESP_ERR_NO_MEM;
         }
     }
+    invalidate_page_cache();
+    
+    esp_err_t ret = session_store_init();
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Session store unavailable (%s), history will not be saved", esp_err_to_name(ret));
+    } else {
+        migrate_nvs_sessions();
+        recover_sessions();
+    }
+    s_session_count = session_store_latest_id();
     
-    ESP_LOGI(TAG, "Session manager initialized, %lu sessions in history", 
+    ESP_LOGI(TAG, "Session manager initialized, last session #%lu", 
              (unsigned long)s_session_count);
     
     return ESP_OK;
 }
 
+/**
+ * Start the storage task
+ */
+esp_err_t session_manager_start_storage_task(void) {
+    if (s_storage_task != NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    
+    BaseType_t result = xTaskCreate(storage_task, "storage_task", STORAGE_TASK_STACK_SIZE, NULL,
+                                    STORAGE_TASK_PRIORITY, &s_storage_task);
+    if (result != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create storage task");
+        return ESP_FAIL;
+    }
+    
+    ESP_LOGI(TAG, "Storage task started (flush every %d ms, %d-sample pages)",
+             SESSION_FLUSH_INTERVAL_MS, SESSION_FLUSH_PAGE_SAMPLES);
+    return ESP_OK;
+}
+
+/**
+ * Flush pending samples now
+ */
+esp_err_t session_manager_flush(void) {
+    if (s_flush_mutex == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    xSemaphoreTake(s_flush_mutex, portMAX_DELAY);
+    esp_err_t ret = flush_locked();
+    xSemaphoreGive(s_flush_mutex);
+    return ret;
+}
+
+/**
+ * Append the rows the sampler closed at this update (inside s_sample_lock)
+ * @return Rows appended
+ */
+static uint32_t sample_rows_locked(const rowing_metrics_t *metrics, uint8_t heart_rate) {
+    session_sampler_update(&s_sampler, metrics->elapsed_time_ms, metrics->total_work_joules,
+                           metrics->total_distance_meters, heart_rate);
+    
+    uint32_t appended = 0;
+    sample_data_t row;
+    while (session_sampler_next_row(&s_sampler, &row)) {
+        if (session_series_append(&row) != ESP_OK) {
+            // Series full: the rest of the session is not recorded
+            continue;
+        }
+        appended++;
+        
+        // Stroke rate average over recorded seconds (heart rate statistics are kept by the series)
+        if (metrics->stroke_rate_spm > 0) {
+            s_stroke_rate_sum += metrics->stroke_rate_spm;
+            s_stroke_rate_samples++;
+        }
+    }
+    return appended;
+}
+
 /**
  * Start a new session
  */
 esp_err_t session_manager_start_session(rowing_metrics_t *metrics) {
-    s_current_session_id = s_session_count + 1;
-    s_session_start_time = esp_timer_get_time();
+    // The series is reused: a session that just ended must reach the store
+    // first. Callers hold the metrics update lock, so leave that to the
+    // storage task (normally it has long done so) instead of waiting here.
+    if (s_flush_mutex == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (xSemaphoreTake(s_flush_mutex, 0) != pdTRUE) {
+        return ESP_ERR_NOT_FINISHED;
+    }
+    if (s_end_pending) {
+        xSemaphoreGive(s_flush_mutex);
+        if (s_storage_task != NULL) {
+            xTaskNotifyGive(s_storage_task);
+        }
+        return ESP_ERR_NOT_FINISHED;
+    }
+    
+    // Ids are never reused, not even those of sessions that were dropped
+    uint32_t latest = session_store_latest_id();
+    s_current_session_id = (latest > s_session_count ? latest : s_session_count) + 1;
+    s_session_start_time = rowing_clock_now_us();
     
     // Capture Unix epoch time in milliseconds for companion app compatibility
     // If SNTP time is not synced, this will be 0 and will be populated later or default to uptime
@@ -102,12 +800,23 @@ esp_err_t session_manager_start_session(rowing_metrics_t *metrics) {
         ESP_LOGW(TAG, "SNTP time not synced, session will use uptime-based timestamp");
     }
     
-    // Reset sample buffer for new session
-    s_sample_count = 0;
-    s_last_distance = 0;
-    s_heart_rate_sum = 0;
-    s_heart_rate_count = 0;
-    s_max_heart_rate = 0;
+    // Reset the series for the new session
+    portENTER_CRITICAL(&s_sample_lock);
+    session_series_reset();
+    session_sampler_reset(&s_sampler, SESSION_SAMPLER_BUCKET_MS);
+    portEXIT_CRITICAL(&s_sample_lock);
+    s_flushed_samples = 0;
+    s_flushed_bytes = 0;
+    s_detail_records = 0;
+    s_detail_bytes = 0;
+    s_stroke_records = 0;
+    s_stroke_bytes = 0;
+    
+    // High-resolution records, if the profile asks for them (the ring is
+    // empty: the last session has been flushed)
+    s_session_profile = s_recording_profile;
+    session_detail_begin(s_session_profile, s_session_start_time);
+    stroke_record_begin();
     s_stroke_rate_sum = 0;
     s_stroke_rate_samples = 0;
     
@@ -121,7 +830,28 @@ esp_err_t session_manager_start_session(rowing_metrics_t *metrics) {
     metrics->total_paused_time_ms = 0;
     metrics->last_resume_time_us = s_session_start_time;  // Track when session started/resumed
     
-    ESP_LOGI(TAG, "Session #%lu started", (unsigned long)s_current_session_id);
+    portENTER_CRITICAL(&s_sample_lock);
+    fill_record(&s_progress, metrics);
+    portEXIT_CRITICAL(&s_sample_lock);
+    xSemaphoreGive(s_flush_mutex);
+    
+    ESP_LOGI(TAG, "Session #%lu started (%s recording)", (unsigned long)s_current_session_id,
+             session_detail_profile_name(s_session_profile));
+    
+    // Warn while there is still time to pick a cheaper profile
+    recording_estimate_t estimate;
+    if (session_manager_estimate_recording(s_session_profile, RECORDING_PLANNED_MINUTES, &estimate) == ESP_OK &&
+        !estimate.fits) {
+        if (estimate.max_minutes < RECORDING_PLANNED_MINUTES) {
+            ESP_LOGW(TAG, "%s recording holds %lu min even with all history dropped (%lu B/min)",
+                     session_detail_profile_name(s_session_profile), (unsigned long)estimate.max_minutes,
+                     (unsigned long)estimate.bytes_per_minute);
+        } else {
+            ESP_LOGW(TAG, "%s recording: %lu min fit in free space (%lu B/min), older sessions are dropped after that",
+                     session_detail_profile_name(s_session_profile), (unsigned long)estimate.free_minutes,
+                     (unsigned long)estimate.bytes_per_minute);
+        }
+    }
     
     return ESP_OK;
 }
@@ -136,110 +866,43 @@ esp_err_t session_manager_end_session(rowing_metrics_t *metrics) {
     }
     
     // Only save if meaningful activity occurred
-    if (metrics->stroke_count < 5 || metrics->total_distance_meters < 10.0f) {
-        ESP_LOGI(TAG, "Session too short, not saving");
-        s_current_session_id = 0;
-        return ESP_OK;
-    }
-    
-    // Create session record
+    bool save = worth_saving(metrics->stroke_count, metrics->total_distance_meters);
     session_record_t record;
-    memset(&record, 0, sizeof(record));
-    
-    record.session_id = s_current_session_id;
-    // Use Unix epoch milliseconds if available, otherwise fall back to esp_timer value
-    // The companion app expects Unix epoch milliseconds for startTime
-    if (s_session_start_unix_ms > 0) {
-        record.start_timestamp = s_session_start_unix_ms;
+    fill_record(&record, metrics);
+    if (!save) {
+        ESP_LOGI(TAG, "Session too short, not saving");
+    } else if (s_session_start_unix_ms > 0) {
         ESP_LOGI(TAG, "Saving session with Unix timestamp: %lld ms", (long long)s_session_start_unix_ms);
     } else {
-        // Fallback: use microseconds since boot / 1000 to get ms (for legacy compatibility)
-        // This will result in a small timestamp that the app can detect as invalid
-        record.start_timestamp = s_session_start_time / 1000;
         ESP_LOGW(TAG, "Saving session with uptime-based timestamp (SNTP not synced)");
     }
-    record.duration_seconds = metrics->elapsed_time_ms / 1000;
-    record.total_distance_meters = metrics->total_distance_meters;
-    record.average_pace_sec_500m = metrics->average_pace_sec_500m;
-    record.average_power_watts = metrics->average_power_watts;
-    record.stroke_count = metrics->stroke_count;
-    record.total_calories = metrics->total_calories;
-    record.drag_factor = metrics->drag_factor;
-    record.sample_count = s_sample_count;
-    record.max_heart_rate = s_max_heart_rate;
-    record.synced = 0;  // Not synced initially
-    
-    // Calculate average heart rate from samples
-    if (s_heart_rate_count > 0) {
-        record.average_heart_rate = (float)s_heart_rate_sum / (float)s_heart_rate_count;
-    } else {
-        record.average_heart_rate = 0;
-    }
     
-    // Calculate average stroke rate from samples
-    if (s_stroke_rate_samples > 0) {
-        record.average_stroke_rate = s_stroke_rate_sum / (float)s_stroke_rate_samples;
-    } else {
-        record.average_stroke_rate = metrics->avg_stroke_rate_spm;
+    // Close the last (partial) second, then the storage task writes the
+    // remaining samples and the record
+    session_detail_end(metrics);
+    stroke_record_end();
+    portENTER_CRITICAL(&s_sample_lock);
+    sample_rows_locked(metrics, s_sampler.heart_rate);
+    sample_data_t row;
+    if (session_sampler_finish(&s_sampler, &row)) {
+        session_series_append(&row);
     }
-    
-    // Save to NVS
-    nvs_handle_t handle;
-    esp_err_t ret = nvs_open(SESSION_NVS_NAMESPACE, NVS_READWRITE, &handle);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to open NVS: %s", esp_err_to_name(ret));
-        return ret;
-    }
-    
-    // Create key for this session
-    char key[16];
-    snprintf(key, sizeof(key), "s%lu", (unsigned long)(s_current_session_id % MAX_STORED_SESSIONS));
-    
-    // Save record
-    ret = nvs_set_blob(handle, key, &record, sizeof(record));
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to save session: %s", esp_err_to_name(ret));
-        nvs_close(handle);
-        return ret;
+    record.sample_count = session_series_count();
+    s_end_record = record;
+    s_end_save = save;
+    s_end_pending = true;
+    portEXIT_CRITICAL(&s_sample_lock);
+    s_current_session_id = 0;
+    if (s_storage_task != NULL) {
+        xTaskNotifyGive(s_storage_task);
     }
     
-    // Save sample data if we have samples
-    if (s_sample_count > 0 && s_sample_buffer != NULL) {
-        char samples_key[16];
-        snprintf(samples_key, sizeof(samples_key), "d%lu", (unsigned long)(s_current_session_id % MAX_STORED_SESSIONS));
-        
-        // Save all samples - NVS will return error if storage is full
-        // With 8 bytes per sample, a 2-hour session is ~57KB
-        ret = nvs_set_blob(handle, samples_key, s_sample_buffer, s_sample_count * sizeof(sample_data_t));
-        if (ret != ESP_OK) {
-            ESP_LOGW(TAG, "Failed to save samples: %s", esp_err_to_name(ret));
-            // Continue anyway - session record is saved
-        } else {
-            ESP_LOGI(TAG, "Saved %lu samples for session (%lu bytes)", 
-                     (unsigned long)s_sample_count,
-                     (unsigned long)(s_sample_count * sizeof(sample_data_t)));
-        }
+    if (save) {
+        // Reset session_start_time to stop timer from counting
+        metrics->session_start_time_us = 0;
+        metrics->elapsed_time_ms = 0;
     }
     
-    // Update session count
-    s_session_count = s_current_session_id;
-    nvs_set_u32(handle, "count", s_session_count);
-    
-    nvs_commit(handle);
-    nvs_close(handle);
-    
-    ESP_LOGI(TAG, "Session #%lu saved: %.1fm, %lu strokes, %lu cal",
-             (unsigned long)s_current_session_id,
-             record.total_distance_meters,
-             (unsigned long)record.stroke_count,
-             (unsigned long)record.total_calories);
-    
-    s_current_session_id = 0;
-    
-    // Reset session_start_time to stop timer from counting
-    metrics->session_start_time_us = 0;
-    metrics->elapsed_time_ms = 0;
-    
     return ESP_OK;
 }
 
@@ -247,53 +910,42 @@ esp_err_t session_manager_end_session(rowing_metrics_t *metrics) {
  * Get session record by ID
  */
 esp_err_t session_manager_get_session(uint32_t session_id, session_record_t *record) {
-    nvs_handle_t handle;
-    esp_err_t ret;
-    
-    ret = nvs_open(SESSION_NVS_NAMESPACE, NVS_READONLY, &handle);
-    if (ret != ESP_OK) {
-        return ret;
-    }
-    
-    char key[16];
-    snprintf(key, sizeof(key), "s%lu", (unsigned long)(session_id % MAX_STORED_SESSIONS));
-    
-    size_t len = sizeof(session_record_t);
-    ret = nvs_get_blob(handle, key, record, &len);
-    
-    nvs_close(handle);
-    
-    if (ret == ESP_OK && record->session_id != session_id) {
-        // Slot has been overwritten with a newer session
-        return ESP_ERR_NOT_FOUND;
-    }
-    
-    return ret;
+    return session_store_get(session_id, record);
 }
 
 /**
- * Get number of stored sessions
+ * Get the highest session ID saved so far
  */
 uint32_t session_manager_get_session_count(void) {
     return s_session_count;
 }
 
+/**
+ * List stored session IDs, oldest first
+ */
+uint32_t session_manager_list_sessions(uint32_t *ids, uint32_t max_ids) {
+    return session_store_list(ids, max_ids);
+}
+
 /**
  * Clear all session history
  */
 esp_err_t session_manager_clear_history(void) {
-    nvs_handle_t handle;
-    esp_err_t ret;
-    
-    ret = nvs_open(SESSION_NVS_NAMESPACE, NVS_READWRITE, &handle);
+    xSemaphoreTake(s_flush_mutex, portMAX_DELAY);
+    esp_err_t ret = session_store_format();
+    // A running session is written again from its first sample (detail
+    // records already flushed are gone)
+    s_store_session_id = 0;
+    s_flushed_samples = 0;
+    s_flushed_bytes = 0;
+    s_detail_records = 0;
+    s_detail_bytes = 0;
+    xSemaphoreGive(s_flush_mutex);
+    invalidate_page_cache();
     if (ret != ESP_OK) {
         return ret;
     }
     
-    nvs_erase_all(handle);
-    nvs_commit(handle);
-    nvs_close(handle);
-    
     s_session_count = 0;
     
     ESP_LOGI(TAG, "Session history cleared");
@@ -312,44 +964,12 @@ uint32_t session_manager_get_current_session_id(void) {
  * Delete a specific session from history
  */
 esp_err_t session_manager_delete_session(uint32_t session_id) {
-    if (session_id == 0 || session_id > s_session_count) {
-        return ESP_ERR_NOT_FOUND;
-    }
-    
-    // First verify the session exists
-    session_record_t record;
-    esp_err_t ret = session_manager_get_session(session_id, &record);
+    esp_err_t ret = session_store_delete(session_id);
+    invalidate_page_cache();
     if (ret != ESP_OK) {
-        return ESP_ERR_NOT_FOUND;
-    }
-    
-    nvs_handle_t handle;
-    ret = nvs_open(SESSION_NVS_NAMESPACE, NVS_READWRITE, &handle);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to open NVS for delete: %s", esp_err_to_name(ret));
-        return ret;
-    }
-    
-    // Create key for this session
-    char key[16];
-    snprintf(key, sizeof(key), "s%lu", (unsigned long)(session_id % MAX_STORED_SESSIONS));
-    
-    // Erase the session entry
-    ret = nvs_erase_key(handle, key);
-    if (ret != ESP_OK && ret != ESP_ERR_NVS_NOT_FOUND) {
-        ESP_LOGE(TAG, "Failed to erase session: %s", esp_err_to_name(ret));
-        nvs_close(handle);
         return ret;
     }
     
-    // Also erase sample data
-    char samples_key[16];
-    snprintf(samples_key, sizeof(samples_key), "d%lu", (unsigned long)(session_id % MAX_STORED_SESSIONS));
-    nvs_erase_key(handle, samples_key);  // Ignore error if not found
-    
-    nvs_commit(handle);
-    nvs_close(handle);
-    
     ESP_LOGI(TAG, "Session #%lu deleted", (unsigned long)session_id);
     
     return ESP_OK;
@@ -359,41 +979,11 @@ esp_err_t session_manager_delete_session(uint32_t session_id) {
  * Mark a session as synced
  */
 esp_err_t session_manager_set_synced(uint32_t session_id) {
-    if (session_id == 0 || session_id > s_session_count) {
-        return ESP_ERR_NOT_FOUND;
-    }
-    
-    // First get the session
-    session_record_t record;
-    esp_err_t ret = session_manager_get_session(session_id, &record);
-    if (ret != ESP_OK) {
-        return ESP_ERR_NOT_FOUND;
-    }
-    
-    // Update synced flag
-    record.synced = 1;
-    
-    // Save back to NVS
-    nvs_handle_t handle;
-    ret = nvs_open(SESSION_NVS_NAMESPACE, NVS_READWRITE, &handle);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to open NVS for sync update: %s", esp_err_to_name(ret));
-        return ret;
-    }
-    
-    char key[16];
-    snprintf(key, sizeof(key), "s%lu", (unsigned long)(session_id % MAX_STORED_SESSIONS));
-    
-    ret = nvs_set_blob(handle, key, &record, sizeof(record));
+    esp_err_t ret = session_store_set_synced(session_id);
     if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to update session sync status: %s", esp_err_to_name(ret));
-        nvs_close(handle);
         return ret;
     }
     
-    nvs_commit(handle);
-    nvs_close(handle);
-    
     ESP_LOGI(TAG, "Session #%lu marked as synced", (unsigned long)session_id);
     
     return ESP_OK;
@@ -401,35 +991,20 @@ esp_err_t session_manager_set_synced(uint32_t session_id) {
 
 /**
  * Delete all sessions that have been synced
- * Iterates through all possible session slots since sessions use modulo storage
  */
 esp_err_t session_manager_delete_synced(void) {
+    uint32_t ids[SESSION_STORE_MAX_SESSIONS];
+    uint32_t count = session_store_list(ids, SESSION_STORE_MAX_SESSIONS);
     uint32_t deleted_count = 0;
     
-    // Iterate through all possible session slots
-    // Sessions are stored at slot = session_id % MAX_STORED_SESSIONS
-    // So we need to check each slot, not just session IDs up to count
-    for (uint32_t slot = 0; slot < MAX_STORED_SESSIONS; slot++) {
-        nvs_handle_t handle;
-        esp_err_t ret = nvs_open(SESSION_NVS_NAMESPACE, NVS_READONLY, &handle);
-        if (ret != ESP_OK) {
-            continue;
-        }
-        
-        char key[16];
-        snprintf(key, sizeof(key), "s%lu", (unsigned long)slot);
-        
+    for (uint32_t i = 0; i < count; i++) {
         session_record_t record;
-        size_t len = sizeof(session_record_t);
-        ret = nvs_get_blob(handle, key, &record, &len);
-        nvs_close(handle);
-        
-        if (ret == ESP_OK && record.synced) {
-            if (session_manager_delete_session(record.session_id) == ESP_OK) {
-                deleted_count++;
-            }
+        if (session_store_get(ids[i], &record) == ESP_OK && record.synced &&
+            session_store_delete(ids[i]) == ESP_OK) {
+            deleted_count++;
         }
     }
+    invalidate_page_cache();
     
     ESP_LOGI(TAG, "Deleted %lu synced sessions", (unsigned long)deleted_count);
     
@@ -437,105 +1012,349 @@ esp_err_t session_manager_delete_synced(void) {
 }
 
 /**
- * Record a per-second sample during active workout
- * Stores velocity (m/s) instead of pace for Health Connect compatibility
+ * Feed the per-second sampler during active workout
+ * Rows hold velocity (cm/s) instead of pace for Health Connect compatibility
  */
-esp_err_t session_manager_record_sample(rowing_metrics_t *metrics, uint8_t heart_rate) {
-    if (s_current_session_id == 0 || s_sample_buffer == NULL) {
+esp_err_t session_manager_record_sample(const rowing_metrics_t *metrics, uint8_t heart_rate) {
+    if (s_current_session_id == 0) {
         return ESP_ERR_INVALID_STATE;
     }
     
-    if (s_sample_count >= SAMPLE_BUFFER_SIZE) {
-        // Buffer full - could implement circular buffer or stop recording
-        return ESP_ERR_NO_MEM;
+    // Publish the rows and the summary for the storage task together
+    portENTER_CRITICAL(&s_sample_lock);
+    if (sample_rows_locked(metrics, heart_rate) > 0) {
+        fill_record(&s_progress, metrics);
     }
+    bool full = session_series_count() >= SESSION_SERIES_CAPACITY;
+    portEXIT_CRITICAL(&s_sample_lock);
     
-    sample_data_t *sample = &s_sample_buffer[s_sample_count];
-    
-    // Convert values to packed format with proper clamping before cast
-    float power = metrics->instantaneous_power_watts;
-    if (power < 0) power = 0;
-    if (power > 65535) power = 65535;
-    sample->power_watts = (uint16_t)power;
-    
-    // Store velocity in cm/s (convert from pace sec/500m)
-    // velocity (m/s) = 500 / pace (sec/500m)
-    // velocity (cm/s) = 50000 / pace (sec/500m)
-    float pace = metrics->instantaneous_pace_sec_500m;
-    float velocity_cm_s = 0;
-    if (pace > 0 && pace < 9999) {
-        velocity_cm_s = 50000.0f / pace;
+    return full ? ESP_ERR_NO_MEM : ESP_OK;
+}
+
+/**
+ * Read a byte range of the running session's rows as packed samples
+ */
+static void read_current_bytes(uint32_t offset, uint8_t *buffer, uint32_t length, uint32_t *bytes_read) {
+    uint32_t total = session_series_count() * sizeof(sample_data_t);
+    uint32_t end = offset < total ? (total - offset < length ? total : offset + length) : offset;
+    
+    while (offset < end) {
+        uint32_t row = offset / sizeof(sample_data_t);
+        uint32_t skip = offset % sizeof(sample_data_t);
+        uint32_t n;
+        if (skip == 0 && end - offset >= sizeof(sample_data_t)) {
+            // Whole rows straight into the output (sample_data_t is packed)
+            n = session_series_read(row, (sample_data_t *)(buffer + *bytes_read),
+                                    (end - offset) / sizeof(sample_data_t)) * sizeof(sample_data_t);
+        } else {
+            sample_data_t sample;
+            if (session_series_read(row, &sample, 1) == 0) {
+                break;
+            }
+            n = sizeof(sample) - skip < end - offset ? sizeof(sample) - skip : end - offset;
+            memcpy(buffer + *bytes_read, (const uint8_t *)&sample + skip, n);
+        }
+        if (n == 0) {
+            break;
+        }
+        offset += n;
+        *bytes_read += n;
+    }
+}
+
+/**
+ * Read a byte range of a session's packed samples
+ */
+esp_err_t session_manager_read_sample_bytes(uint32_t session_id, uint32_t offset, void *buffer,
+                                             uint32_t length, uint32_t *bytes_read) {
+    if (buffer == NULL || bytes_read == NULL) {
+        return ESP_ERR_INVALID_ARG;
     }
-    if (velocity_cm_s > 65535) velocity_cm_s = 65535;
-    sample->velocity_cm_s = (uint16_t)velocity_cm_s;
-    
-    sample->heart_rate = heart_rate;
-    sample->reserved = 0;  // Reserved field (was stroke_rate)
     
-    // Calculate distance delta since last sample
-    float distance_delta = metrics->total_distance_meters - s_last_distance;
-    if (distance_delta < 0) distance_delta = 0;  // Handle reset
-    s_last_distance = metrics->total_distance_meters;
-    float distance_dm = distance_delta * 10.0f;
-    if (distance_dm > 65535) distance_dm = 65535;
-    sample->distance_dm = (uint16_t)distance_dm;
+    *bytes_read = 0;
     
-    s_sample_count++;
+    // If requesting current session, return from the series
+    if (session_id != 0 && session_id == s_current_session_id) {
+        read_current_bytes(offset, buffer, length, bytes_read);
+        return ESP_OK;
+    }
     
-    // Accumulate for averages and track max
-    if (heart_rate > 0) {
-        s_heart_rate_sum += heart_rate;
-        s_heart_rate_count++;
-        if (heart_rate > s_max_heart_rate) {
-            s_max_heart_rate = heart_rate;
+    // Stored sessions are decoded page by page
+    if (s_read_mutex == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    return read_stored_bytes(session_id, SESSION_STORE_STREAM_SAMPLE_PAGES, offset, buffer, length, bytes_read);
+}
+
+/**
+ * Size of a stored session's compressed sample pages
+ */
+esp_err_t session_manager_get_sample_pages_size(uint32_t session_id, uint32_t *bytes) {
+    *bytes = 0;
+    session_record_t record;
+    esp_err_t ret = session_store_get(session_id, &record);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    uint32_t samples = 0;
+    while (samples < record.sample_count) {
+        uint16_t length;
+        uint8_t count;
+        ret = read_page_header(session_id, SESSION_STORE_STREAM_SAMPLE_PAGES, *bytes, &length, &count);
+        if (ret != ESP_OK || count == 0) {
+            break;
         }
+        *bytes += length;
+        samples += count;
     }
-    if (metrics->stroke_rate_spm > 0) {
-        s_stroke_rate_sum += metrics->stroke_rate_spm;
-        s_stroke_rate_samples++;
+    return ret;
+}
+
+/**
+ * Read a byte range of a stored session's compressed sample pages
+ */
+esp_err_t session_manager_read_sample_pages(uint32_t session_id, uint32_t offset, void *buffer,
+                                             uint32_t length, uint32_t *bytes_read) {
+    if (buffer == NULL || bytes_read == NULL) {
+        return ESP_ERR_INVALID_ARG;
     }
-    
-    return ESP_OK;
+    return session_store_read(session_id, SESSION_STORE_STREAM_SAMPLE_PAGES, offset, buffer, length, bytes_read);
 }
 
 /**
- * Get sample data for a session
+ * Check that a stored session was recorded with a high-resolution profile
  */
-esp_err_t session_manager_get_samples(uint32_t session_id, sample_data_t *buffer, 
-                                       uint32_t buffer_size, uint32_t *sample_count) {
-    if (buffer == NULL || sample_count == NULL) {
+static esp_err_t check_detail(uint32_t session_id, recording_profile_t profile) {
+    if (session_detail_layout(profile) == NULL) {
         return ESP_ERR_INVALID_ARG;
     }
-    
-    *sample_count = 0;
-    
-    // If requesting current session, return from buffer
-    if (session_id == s_current_session_id && s_sample_buffer != NULL) {
-        uint32_t count = s_sample_count < buffer_size ? s_sample_count : buffer_size;
-        memcpy(buffer, s_sample_buffer, count * sizeof(sample_data_t));
-        *sample_count = count;
-        return ESP_OK;
+    session_record_t record;
+    esp_err_t ret = session_store_get(session_id, &record);
+    if (ret != ESP_OK) {
+        return ret;
     }
-    
-    // Load from NVS
-    nvs_handle_t handle;
-    esp_err_t ret = nvs_open(SESSION_NVS_NAMESPACE, NVS_READONLY, &handle);
+    return record.recording_profile == profile ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+/**
+ * Records and bytes of a stored page stream (walks the page headers; a
+ * page cut short by a reset ends the stream)
+ */
+static esp_err_t get_stream_size(uint32_t session_id, session_store_stream_t stream,
+                                 uint32_t *records, uint32_t *page_bytes) {
+    esp_err_t ret = ESP_OK;
+    while (true) {
+        uint16_t length;
+        uint8_t count;
+        ret = read_page_header(session_id, stream, *page_bytes, &length, &count);
+        if (ret != ESP_OK || count == 0) {
+            break;
+        }
+        uint8_t last;
+        uint32_t n = 0;
+        ret = session_store_read(session_id, stream, *page_bytes + length - 1, &last, 1, &n);
+        if (ret != ESP_OK || n == 0) {
+            break;
+        }
+        *page_bytes += length;
+        *records += count;
+    }
+    return ret;
+}
+
+/**
+ * Size of a stored session's high-resolution records
+ */
+esp_err_t session_manager_get_detail_size(uint32_t session_id, recording_profile_t profile,
+                                          uint32_t *records, uint32_t *page_bytes) {
+    *records = 0;
+    *page_bytes = 0;
+    esp_err_t ret = check_detail(session_id, profile);
     if (ret != ESP_OK) {
         return ret;
     }
+    return get_stream_size(session_id, detail_stream(profile), records, page_bytes);
+}
+
+/**
+ * Read a byte range of a stored session's decoded high-resolution records
+ */
+esp_err_t session_manager_read_detail_bytes(uint32_t session_id, recording_profile_t profile, uint32_t offset,
+                                            void *buffer, uint32_t length, uint32_t *bytes_read) {
+    if (buffer == NULL || bytes_read == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *bytes_read = 0;
+    if (session_detail_layout(profile) == NULL || s_read_mutex == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return read_stored_bytes(session_id, detail_stream(profile), offset, buffer, length, bytes_read);
+}
+
+/**
+ * Read a byte range of a stored session's high-resolution pages
+ */
+esp_err_t session_manager_read_detail_pages(uint32_t session_id, recording_profile_t profile, uint32_t offset,
+                                            void *buffer, uint32_t length, uint32_t *bytes_read) {
+    if (buffer == NULL || bytes_read == NULL || session_detail_layout(profile) == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return session_store_read(session_id, detail_stream(profile), offset, buffer, length, bytes_read);
+}
+
+/**
+ * Size of a stored session's stroke records
+ */
+esp_err_t session_manager_get_stroke_size(uint32_t session_id, uint32_t *records, uint32_t *page_bytes) {
+    *records = 0;
+    *page_bytes = 0;
+    session_record_t record;
+    esp_err_t ret = session_store_get(session_id, &record);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    return get_stream_size(session_id, SESSION_STORE_STREAM_STROKE_PAGES, records, page_bytes);
+}
+
+/**
+ * Read a byte range of a stored session's decoded stroke records
+ */
+esp_err_t session_manager_read_stroke_bytes(uint32_t session_id, uint32_t offset, void *buffer,
+                                            uint32_t length, uint32_t *bytes_read) {
+    if (buffer == NULL || bytes_read == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *bytes_read = 0;
+    if (s_read_mutex == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    return read_stored_bytes(session_id, SESSION_STORE_STREAM_STROKE_PAGES, offset, buffer, length, bytes_read);
+}
+
+/**
+ * Read a byte range of a stored session's stroke pages
+ */
+esp_err_t session_manager_read_stroke_pages(uint32_t session_id, uint32_t offset, void *buffer,
+                                            uint32_t length, uint32_t *bytes_read) {
+    if (buffer == NULL || bytes_read == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return session_store_read(session_id, SESSION_STORE_STREAM_STROKE_PAGES, offset, buffer, length, bytes_read);
+}
+
+/**
+ * Set the recording profile of sessions started from now
+ */
+esp_err_t session_manager_set_recording_profile(recording_profile_t profile) {
+    if ((unsigned int)profile >= RECORDING_PROFILE_COUNT) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_recording_profile = profile;
+    ESP_LOGI(TAG, "Recording profile: %s", session_detail_profile_name(profile));
+    return ESP_OK;
+}
+
+/**
+ * Get the recording profile of sessions started from now
+ */
+recording_profile_t session_manager_get_recording_profile(void) {
+    return s_recording_profile;
+}
+
+/**
+ * Estimate what recording a profile costs
+ */
+esp_err_t session_manager_estimate_recording(recording_profile_t profile, uint32_t minutes,
+                                             recording_estimate_t *estimate) {
+    if ((unsigned int)profile >= RECORDING_PROFILE_COUNT || estimate == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!session_store_is_ready()) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    memset(estimate, 0, sizeof(*estimate));
+    estimate->profile = (uint8_t)profile;
+    estimate->minutes = minutes;
     
-    char samples_key[16];
-    snprintf(samples_key, sizeof(samples_key), "d%lu", (unsigned long)(session_id % MAX_STORED_SESSIONS));
-    
-    size_t len = buffer_size * sizeof(sample_data_t);
-    ret = nvs_get_blob(handle, samples_key, buffer, &len);
+    // Bits per record: measured once a few pages were flushed, else the defaults
+    if (s_flush_mutex != NULL) {
+        xSemaphoreTake(s_flush_mutex, portMAX_DELAY);
+    }
+    uint32_t sample_bits = RECORDING_SAMPLE_BITS;
+    if (s_cost[RECORDING_PROFILE_1HZ].records >= 4 * SESSION_FLUSH_PAGE_SAMPLES) {
+        sample_bits = (uint32_t)(8ull * s_cost[RECORDING_PROFILE_1HZ].page_bytes /
+                                 s_cost[RECORDING_PROFILE_1HZ].records) + 1;
+        estimate->measured = true;
+    }
+    uint32_t detail_bits = profile == RECORDING_PROFILE_PULSE ? RECORDING_PULSE_BITS : RECORDING_10HZ_BITS;
+    uint32_t detail_per_minute = profile == RECORDING_PROFILE_10HZ ? 60000 / SESSION_DETAIL_10HZ_MS :
+                                 RECORDING_REVS_PER_MINUTE * rowing_physics_get_magnets_per_rev();
+    if (session_detail_layout(profile) != NULL) {
+        if (s_cost[profile].records >= 4 * SESSION_DETAIL_PAGE_RECORDS) {
+            detail_bits = (uint32_t)(8ull * s_cost[profile].page_bytes / s_cost[profile].records) + 1;
+        } else {
+            estimate->measured = false;
+        }
+        // Pulses per minute depend on the rower: learned from saved sessions
+        if (profile == RECORDING_PROFILE_PULSE && s_cost[profile].session_seconds >= 60) {
+            detail_per_minute = (uint32_t)(60ull * s_cost[profile].session_records /
+                                           s_cost[profile].session_seconds);
+        }
+        estimate->records_per_minute = detail_per_minute;
+    }
     
-    nvs_close(handle);
+    // Stroke records of every profile, at the rate of the saved sessions
+    uint32_t stroke_bits = RECORDING_STROKE_BITS;
+    if (s_stroke_cost.records >= 4 * SESSION_STROKE_PAGE_RECORDS) {
+        stroke_bits = (uint32_t)(8ull * s_stroke_cost.page_bytes / s_stroke_cost.records) + 1;
+    } else {
+        estimate->measured = false;
+    }
+    estimate->strokes_per_minute = RECORDING_STROKES_PER_MINUTE;
+    if (s_stroke_cost.session_seconds >= 60) {
+        estimate->strokes_per_minute = (uint32_t)((60ull * s_stroke_cost.session_records +
+                                                   s_stroke_cost.session_seconds - 1) /
+                                                  s_stroke_cost.session_seconds);
+    }
+    if (s_flush_mutex != NULL) {
+        xSemaphoreGive(s_flush_mutex);
+    }
     
-    if (ret == ESP_OK) {
-        *sample_count = len / sizeof(sample_data_t);
+    // Pages and the store's per-append overhead, rounded up
+    uint32_t bytes = (60 * sample_bits + 7) / 8 +
+                     (60 * SESSION_STORE_APPEND_OVERHEAD + SESSION_FLUSH_PAGE_SAMPLES - 1) / SESSION_FLUSH_PAGE_SAMPLES;
+    if (estimate->records_per_minute > 0) {
+        bytes += (estimate->records_per_minute * detail_bits + 7) / 8 +
+                 (estimate->records_per_minute * SESSION_STORE_APPEND_OVERHEAD + SESSION_DETAIL_PAGE_RECORDS - 1) /
+                 SESSION_DETAIL_PAGE_RECORDS;
+    }
+    bytes += (estimate->strokes_per_minute * stroke_bits + 7) / 8 +
+             (estimate->strokes_per_minute * SESSION_STORE_APPEND_OVERHEAD + SESSION_STROKE_PAGE_RECORDS - 1) /
+             SESSION_STROKE_PAGE_RECORDS;
+    estimate->bytes_per_minute = bytes;
+    estimate->bytes = bytes * minutes;
+    
+    session_store_stats_t store;
+    session_store_get_stats(&store);
+    estimate->free_minutes = store.bytes_free / bytes;
+    estimate->max_minutes = store.bytes_capacity / bytes;
+    estimate->fits = estimate->free_minutes >= minutes;
+    return ESP_OK;
+}
+
+/**
+ * Read a slice of a session's samples
+ */
+esp_err_t session_manager_read_samples(uint32_t session_id, uint32_t first, sample_data_t *buffer,
+                                        uint32_t buffer_size, uint32_t *sample_count) {
+    if (buffer == NULL || sample_count == NULL) {
+        return ESP_ERR_INVALID_ARG;
     }
     
+    uint32_t bytes = 0;
+    esp_err_t ret = session_manager_read_sample_bytes(session_id, first * sizeof(sample_data_t), buffer,
+                                                      buffer_size * sizeof(sample_data_t), &bytes);
+    *sample_count = bytes / sizeof(sample_data_t);
     return ret;
 }
 
@@ -543,7 +1362,29 @@ esp_err_t session_manager_get_samples(uint32_t session_id, sample_data_t *buffer
  * Get sample count for current session
  */
 uint32_t session_manager_get_current_sample_count(void) {
-    return s_sample_count;
+    return session_series_count();
+}
+
+/**
+ * Get storage task counters
+ */
+void session_manager_get_flush_stats(session_flush_stats_t *stats) {
+    *stats = s_flush_stats;
+    portENTER_CRITICAL(&s_sample_lock);
+    uint32_t count = s_current_session_id != 0 ? session_series_count() : 0;
+    portEXIT_CRITICAL(&s_sample_lock);
+    stats->pending_samples = count > s_flushed_samples ? count - s_flushed_samples : 0;
+    stats->pending_detail_records = session_detail_pending();
+    stats->pending_stroke_records = stroke_record_pending();
+}
+
+/**
+ * Get the sampler timing of the current (or last) session
+ */
+void session_manager_get_sampler_stats(session_sampler_stats_t *stats) {
+    portENTER_CRITICAL(&s_sample_lock);
+    *stats = s_sampler.stats;
+    portEXIT_CRITICAL(&s_sample_lock);
 }
 
 /**
@@ -571,7 +1412,7 @@ esp_err_t session_manager_check_activity(rowing_metrics_t *metrics, const config
         return ESP_OK;
     }
     
-    int64_t now = esp_timer_get_time();
+    int64_t now = rowing_clock_now_us();
     int32_t auto_pause_timeout_ms = (int32_t)config->auto_pause_seconds * 1000;
     
     // Use last stroke start time for detecting activity
@@ -598,11 +1439,13 @@ esp_err_t session_manager_check_activity(rowing_metrics_t *metrics, const config
     if (has_recent_activity && has_completed_stroke) {
         // Genuine rowing activity detected (completed stroke + recent activity)
         if (!session_active) {
-            // No session yet - auto-start a new session
-            ESP_LOGI(TAG, "Auto-starting session (stroke #%lu detected)", (unsigned long)metrics->stroke_count);
-            session_manager_start_session(metrics);
-            s_stroke_count_at_resume = metrics->stroke_count;  // Track stroke count at start
-            metrics->is_paused = false;
+            // No session yet - auto-start a new session (if the last one is
+            // still being stored, the next update tries again)
+            if (session_manager_start_session(metrics) == ESP_OK) {
+                ESP_LOGI(TAG, "Auto-started session (stroke #%lu detected)", (unsigned long)metrics->stroke_count);
+                s_stroke_count_at_resume = metrics->stroke_count;  // Track stroke count at start
+                metrics->is_paused = false;
+            }
         } else if (is_paused) {
             // Session exists but is paused - auto-resume
             ESP_LOGI(TAG, "Auto-resuming session (stroke #%lu detected)", (unsigned long)metrics->stroke_count);
@@ -8,22 +8,82 @@
 
 #include "esp_err.h"
 #include "rowing_physics.h"
+#include "session_sampler.h"
+
+/**
+ * Storage task counters (samples flushed while a session runs)
+ */
+typedef struct {
+    uint32_t flushes;               // Storage passes that wrote something
+    uint32_t bytes_written;         // Sample, checkpoint and record bytes handed to the store
+    uint32_t samples_flushed;       // Samples written as compressed pages
+    uint32_t page_bytes;            // Encoded size of those samples (sample_codec)
+    uint32_t last_flush_us;         // Duration of the last flush
+    uint32_t max_flush_us;          // Longest flush so far
+    uint32_t pending_samples;       // Samples of the running session not on flash yet
+    uint32_t detail_records_flushed;    // 10 Hz / per-pulse records written as pages
+    uint32_t detail_page_bytes;         // Encoded size of those records
+    uint32_t pending_detail_records;    // Waiting in the detail ring
+    uint32_t stroke_records_flushed;    // Stroke records written as pages
+    uint32_t stroke_page_bytes;         // Encoded size of those records
+    uint32_t pending_stroke_records;    // Waiting in the stroke ring
+    uint32_t sessions_recovered;    // Unterminated sessions committed at boot
+    uint32_t errors;                // Failed flushes
+} session_flush_stats_t;
+
+/**
+ * What recording a profile costs (session_manager_estimate_recording())
+ */
+typedef struct {
+    uint8_t profile;                // recording_profile_t
+    uint32_t minutes;               // Session length asked about
+    uint32_t records_per_minute;    // 10 Hz / per-pulse records (0 for 1 Hz)
+    uint32_t strokes_per_minute;    // Stroke records (every profile)
+    uint32_t bytes_per_minute;      // Flash per minute rowed, per-second samples and strokes included
+    uint32_t bytes;                 // For the whole session
+    uint32_t free_minutes;          // Minutes that fit without dropping a stored session
+    uint32_t max_minutes;           // Minutes that fit once every stored session is dropped
+    bool fits;                      // minutes <= free_minutes
+    bool measured;                  // Bits per record measured on this device (else defaults)
+} recording_estimate_t;
 
 /**
  * Initialize session manager
+ * Commits sessions that a reset left unfinished in the session store.
  * @return ESP_OK on success
  */
 esp_err_t session_manager_init(void);
 
+/**
+ * Start the storage task, which flushes samples of the running session in
+ * pages every SESSION_FLUSH_INTERVAL_MS and saves ended sessions
+ * @return ESP_OK on success
+ */
+esp_err_t session_manager_start_storage_task(void);
+
+/**
+ * Run one storage pass now (what the storage task does when it wakes up)
+ * Host tools without the task call this themselves.
+ * @return ESP_OK on success
+ */
+esp_err_t session_manager_flush(void);
+
 /**
  * Start a new session
+ * Never waits for flash: while the last session is still being stored
+ * (or the storage task is mid-pass) nothing is started, and the caller
+ * retries later, e.g. at its next update or after session_manager_flush()
+ * outside the metrics update lock.
  * @param metrics Pointer to metrics structure
- * @return ESP_OK on success
+ * @return ESP_OK on success, ESP_ERR_NOT_FINISHED if the last session is
+ *         still being stored
  */
 esp_err_t session_manager_start_session(rowing_metrics_t *metrics);
 
 /**
  * End current session and save to history
+ * Does not wait for flash: the storage task writes the last samples and
+ * the session record (call session_manager_flush() to finish it now).
  * @param metrics Pointer to metrics structure
  * @return ESP_OK on success
  */
@@ -38,11 +98,19 @@ esp_err_t session_manager_end_session(rowing_metrics_t *metrics);
 esp_err_t session_manager_get_session(uint32_t session_id, session_record_t *record);
 
 /**
- * Get number of stored sessions
- * @return Number of sessions in history
+ * Get the highest session ID saved so far (IDs are assigned in order)
+ * @return Last session ID, 0 if none
  */
 uint32_t session_manager_get_session_count(void);
 
+/**
+ * List stored session IDs
+ * @param ids Output array
+ * @param max_ids Its size (SESSION_STORE_MAX_SESSIONS covers every session)
+ * @return Number of IDs written, oldest first
+ */
+uint32_t session_manager_list_sessions(uint32_t *ids, uint32_t max_ids);
+
 /**
  * Clear all session history
  * @return ESP_OK on success
@@ -76,23 +144,136 @@ esp_err_t session_manager_set_synced(uint32_t session_id);
 esp_err_t session_manager_delete_synced(void);
 
 /**
- * Record a per-second sample during active workout
+ * Feed the per-second sampler of the active workout
+ * Call on every metrics update, paused or not: rows are cut at whole seconds
+ * of metrics->elapsed_time_ms (session_sampler.h), not per call, and hold
+ * the work and distance of their second.
  * @param metrics Pointer to current metrics
  * @param heart_rate Current heart rate (0 if not available)
- * @return ESP_OK on success
+ * @return ESP_OK on success, ESP_ERR_NO_MEM once the series is full
  */
-esp_err_t session_manager_record_sample(rowing_metrics_t *metrics, uint8_t heart_rate);
+esp_err_t session_manager_record_sample(const rowing_metrics_t *metrics, uint8_t heart_rate);
 
 /**
- * Get sample data for a session
+ * Read a slice of a session's samples
+ * Callers walk a session of any length with a small buffer. Stored samples
+ * are decoded from the session store's compressed pages, one page at a
+ * time (the last page decoded is kept, so walking a session in order
+ * decodes every page once).
  * @param session_id Session ID to retrieve samples for
+ * @param first Index of the first sample to read
  * @param buffer Pointer to buffer to store samples
  * @param buffer_size Size of buffer in number of samples
- * @param sample_count Output: number of samples retrieved
+ * @param sample_count Output: number of samples retrieved (0 past the end)
+ * @return ESP_OK if found
+ */
+esp_err_t session_manager_read_samples(uint32_t session_id, uint32_t first, sample_data_t *buffer,
+                                        uint32_t buffer_size, uint32_t *sample_count);
+
+/**
+ * Read a byte range of a session's packed samples (sample_data_t array)
+ * Same source as session_manager_read_samples(); offsets need
+ * not be sample aligned, so HTTP Range requests map onto it directly.
+ * @param session_id Session ID to retrieve samples for
+ * @param offset Byte offset into the samples
+ * @param buffer Output buffer
+ * @param length Bytes wanted
+ * @param bytes_read Output: bytes copied (0 past the end)
  * @return ESP_OK if found
  */
-esp_err_t session_manager_get_samples(uint32_t session_id, sample_data_t *buffer, 
-                                       uint32_t buffer_size, uint32_t *sample_count);
+esp_err_t session_manager_read_sample_bytes(uint32_t session_id, uint32_t offset, void *buffer,
+                                             uint32_t length, uint32_t *bytes_read);
+
+/**
+ * Size of a stored session's compressed sample pages (sample_codec format)
+ * @param session_id Stored session
+ * @param bytes Output: total page bytes
+ * @return ESP_ERR_NOT_FOUND if it is not stored
+ */
+esp_err_t session_manager_get_sample_pages_size(uint32_t session_id, uint32_t *bytes);
+
+/**
+ * Read a byte range of a stored session's compressed sample pages as they
+ * are on flash, without decoding them
+ * @param session_id Stored session
+ * @param offset Byte offset into the pages
+ * @param buffer Output buffer
+ * @param length Bytes wanted
+ * @param bytes_read Output: bytes copied (0 past the end)
+ * @return ESP_OK if found
+ */
+esp_err_t session_manager_read_sample_pages(uint32_t session_id, uint32_t offset, void *buffer,
+                                             uint32_t length, uint32_t *bytes_read);
+
+/**
+ * Size of a stored session's high-resolution records
+ * @param profile RECORDING_PROFILE_10HZ or RECORDING_PROFILE_PULSE
+ * @param records Output: records stored
+ * @param page_bytes Output: their compressed pages (sample_codec format)
+ * @return ESP_ERR_NOT_FOUND if the session is not stored or was recorded
+ *         with another profile
+ */
+esp_err_t session_manager_get_detail_size(uint32_t session_id, recording_profile_t profile,
+                                          uint32_t *records, uint32_t *page_bytes);
+
+/**
+ * Read a byte range of a stored session's high-resolution records, decoded
+ * into an array of sample_10hz_t or sample_pulse_t
+ */
+esp_err_t session_manager_read_detail_bytes(uint32_t session_id, recording_profile_t profile, uint32_t offset,
+                                            void *buffer, uint32_t length, uint32_t *bytes_read);
+
+/**
+ * Read a byte range of a stored session's high-resolution pages as they
+ * are on flash
+ */
+esp_err_t session_manager_read_detail_pages(uint32_t session_id, recording_profile_t profile, uint32_t offset,
+                                            void *buffer, uint32_t length, uint32_t *bytes_read);
+
+/**
+ * Size of a stored session's stroke records (stroke_record.h)
+ * @param records Output: records stored (0 for sessions of older firmware)
+ * @param page_bytes Output: their compressed pages (sample_codec format)
+ * @return ESP_ERR_NOT_FOUND if the session is not stored
+ */
+esp_err_t session_manager_get_stroke_size(uint32_t session_id, uint32_t *records, uint32_t *page_bytes);
+
+/**
+ * Read a byte range of a stored session's stroke records, decoded into an
+ * array of stroke_record_t
+ */
+esp_err_t session_manager_read_stroke_bytes(uint32_t session_id, uint32_t offset, void *buffer,
+                                            uint32_t length, uint32_t *bytes_read);
+
+/**
+ * Read a byte range of a stored session's stroke pages as they are on flash
+ */
+esp_err_t session_manager_read_stroke_pages(uint32_t session_id, uint32_t offset, void *buffer,
+                                            uint32_t length, uint32_t *bytes_read);
+
+/**
+ * Set the recording profile of sessions started from now (session_detail.h)
+ * @return ESP_ERR_INVALID_ARG for an unknown profile
+ */
+esp_err_t session_manager_set_recording_profile(recording_profile_t profile);
+
+/**
+ * Get the recording profile of sessions started from now
+ */
+recording_profile_t session_manager_get_recording_profile(void);
+
+/**
+ * Estimate the flash a profile takes and how long a session fits
+ * Bits per record come from the pages this device has flushed (defaults in
+ * app_config.h until then), pulses per minute from saved per-pulse
+ * sessions (else RECORDING_REVS_PER_MINUTE times the magnets), strokes per
+ * minute likewise (else RECORDING_STROKES_PER_MINUTE). Starting a
+ * session logs a warning when RECORDING_PLANNED_MINUTES would not fit.
+ * @param minutes Planned session length
+ * @param estimate Output
+ */
+esp_err_t session_manager_estimate_recording(recording_profile_t profile, uint32_t minutes,
+                                             recording_estimate_t *estimate);
 
 /**
  * Get sample count for current session
@@ -100,6 +281,18 @@ esp_err_t session_manager_get_samples(uint32_t session_id, sample_data_t *buffer
  */
 uint32_t session_manager_get_current_sample_count(void);
 
+/**
+ * Get storage task counters
+ * @param stats Output
+ */
+void session_manager_get_flush_stats(session_flush_stats_t *stats);
+
+/**
+ * Get the sampler timing of the current (or last) session
+ * @param stats Output
+ */
+void session_manager_get_sampler_stats(session_sampler_stats_t *stats);
+
 /**
  * Handle auto-start and auto-pause based on flywheel activity
  * Call this periodically from the metrics update task
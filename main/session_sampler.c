@@ -0,0 +1,124 @@
+/**
+ * @file session_sampler.c
+ * @brief Cuts the session into fixed buckets of elapsed time
+ */
+
+#include "session_sampler.h"
+#include <string.h>
+
+/**
+ * Start a session
+ */
+void session_sampler_reset(session_sampler_t *sampler, uint32_t bucket_ms) {
+    memset(sampler, 0, sizeof(*sampler));
+    sampler->bucket_ms = bucket_ms > 0 ? bucket_ms : SESSION_SAMPLER_BUCKET_MS;
+}
+
+/**
+ * Feed one update
+ */
+void session_sampler_update(session_sampler_t *sampler, uint32_t elapsed_ms,
+                            float work_j, float distance_m, uint8_t heart_rate) {
+    session_sampler_stats_t *stats = &sampler->stats;
+    stats->updates++;
+
+    if (elapsed_ms <= sampler->cur_ms) {
+        // Clock stands still: the totals step at the current time, which
+        // puts whatever accrued into the bucket the clock moves on in
+        stats->held_updates++;
+        if (distance_m > sampler->cur_distance_m) {
+            stats->held_distance_m += distance_m - sampler->cur_distance_m;
+        }
+        elapsed_ms = sampler->cur_ms;
+    } else if (elapsed_ms - sampler->cur_ms > stats->max_interval_ms) {
+        stats->max_interval_ms = elapsed_ms - sampler->cur_ms;
+    }
+
+    sampler->prev_ms = sampler->cur_ms;
+    sampler->prev_work_j = elapsed_ms == sampler->cur_ms ? work_j : sampler->cur_work_j;
+    sampler->prev_distance_m = elapsed_ms == sampler->cur_ms ? distance_m : sampler->cur_distance_m;
+    sampler->cur_ms = elapsed_ms;
+    sampler->cur_work_j = work_j;
+    sampler->cur_distance_m = distance_m;
+    sampler->heart_rate = heart_rate;
+    stats->elapsed_ms = elapsed_ms;
+}
+
+/**
+ * Close the next bucket ended by the last update
+ */
+bool session_sampler_next_boundary(session_sampler_t *sampler, float *work_j, float *distance_m) {
+    uint32_t boundary = sampler->boundary_ms + sampler->bucket_ms;
+    if (boundary > sampler->cur_ms) {
+        return false;
+    }
+
+    // prev_ms < boundary <= cur_ms: earlier boundaries were taken after the
+    // update that reached them
+    float f = (float)(boundary - sampler->prev_ms) / (float)(sampler->cur_ms - sampler->prev_ms);
+    *work_j = sampler->prev_work_j + (sampler->cur_work_j - sampler->prev_work_j) * f;
+    *distance_m = sampler->prev_distance_m + (sampler->cur_distance_m - sampler->prev_distance_m) * f;
+
+    session_sampler_stats_t *stats = &sampler->stats;
+    uint32_t lag = sampler->cur_ms - boundary;
+    stats->rows++;
+    stats->lag_sum_ms += lag;
+    if (lag > stats->max_lag_ms) {
+        stats->max_lag_ms = lag;
+    }
+    if (lag >= sampler->bucket_ms) {
+        stats->filled_rows++;
+    }
+
+    sampler->boundary_ms = boundary;
+    sampler->boundary_work_j = *work_j;
+    sampler->boundary_distance_m = *distance_m;
+    return true;
+}
+
+/**
+ * Take the next bucket closed by the last update
+ */
+bool session_sampler_next_row(session_sampler_t *sampler, sample_data_t *row) {
+    float start_distance = sampler->boundary_distance_m;
+    float work;
+    float distance;
+    if (!session_sampler_next_boundary(sampler, &work, &distance)) {
+        return false;
+    }
+
+    // Joules over one second are watts
+    row->power_watts = session_sampler_take(session_sampler_round_total(work), &sampler->emitted_work_j);
+    row->velocity_cm_s = session_sampler_to_u16((distance - start_distance) * 100.0f);
+    row->heart_rate = sampler->heart_rate;
+    row->reserved = 0;
+    row->distance_dm = session_sampler_take(session_sampler_round_total(distance * 10.0f),
+                                            &sampler->emitted_distance_dm);
+    return true;
+}
+
+/**
+ * Close the open bucket at the end of a session
+ */
+bool session_sampler_finish(session_sampler_t *sampler, sample_data_t *row) {
+    uint32_t duration_ms = sampler->cur_ms - sampler->boundary_ms;
+    uint32_t distance_dm = session_sampler_round_total(sampler->cur_distance_m * 10.0f);
+    if (duration_ms == 0 && distance_dm <= sampler->emitted_distance_dm) {
+        return false;
+    }
+
+    float per_second = duration_ms > 0 ? 1000.0f / (float)duration_ms : 0;
+    row->power_watts = session_sampler_to_u16((sampler->cur_work_j - sampler->boundary_work_j) * per_second);
+    row->velocity_cm_s = session_sampler_to_u16((sampler->cur_distance_m - sampler->boundary_distance_m) *
+                                                100.0f * per_second);
+    row->heart_rate = sampler->heart_rate;
+    row->reserved = 0;
+    row->distance_dm = session_sampler_take(distance_dm, &sampler->emitted_distance_dm);
+    sampler->emitted_work_j = session_sampler_round_total(sampler->cur_work_j);
+
+    sampler->stats.rows++;
+    sampler->boundary_ms = sampler->cur_ms;
+    sampler->boundary_work_j = sampler->cur_work_j;
+    sampler->boundary_distance_m = sampler->cur_distance_m;
+    return true;
+}
@@ -0,0 +1,173 @@
+/**
+ * @file session_sampler.h
+ * @brief Cuts the session into fixed buckets of elapsed time
+ *
+ * The metrics task feeds the sampler on every update with the session
+ * clock (elapsed_time_ms, which stands still while paused) and the running
+ * totals of work and distance. Bucket k covers elapsed time
+ * [k * 1000, (k + 1) * 1000) ms; it is closed by the first update at or
+ * past its end, and the totals at the boundary itself are interpolated
+ * between the two updates around it. A bucket therefore holds what
+ * happened in exactly that second of rowing, whenever the task got to run:
+ *
+ *   power      energy over the bucket / 1 s (average, not a point sample)
+ *   distance   distance over the bucket
+ *   velocity   distance over the bucket / 1 s
+ *   heart rate value at the update that closed the bucket
+ *
+ * An update that closes several buckets at once (the task stalled) closes
+ * each of them with interpolated totals. Work and distance that accrue
+ * while the session clock stands still (paused, flywheel coasting) are
+ * carried forward into the bucket in which the clock moves on.
+ *
+ * Energy and distance are emitted as the difference of the rounded running
+ * totals, so rounding never accumulates: the rows of a session always sum
+ * to its totals to within one unit of the last row.
+ *
+ * The per-second rows use SESSION_SAMPLER_BUCKET_MS. Other bucket lengths
+ * (the 100 ms records of session_detail.h) take the interpolated totals
+ * at each boundary with session_sampler_next_boundary() and cut their own
+ * records from them.
+ *
+ * Plain C without ESP-IDF dependencies so the host benchmark can use it.
+ */
+
+#ifndef SESSION_SAMPLER_H
+#define SESSION_SAMPLER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "rowing_physics.h"
+
+// Bucket length of the per-second rows
+#define SESSION_SAMPLER_BUCKET_MS   1000
+
+/**
+ * Timing of the updates relative to the bucket boundaries
+ */
+typedef struct {
+    uint32_t updates;                   // Updates fed
+    uint32_t held_updates;              // Updates while the session clock stood still
+    uint32_t rows;                      // Buckets closed
+    uint32_t filled_rows;               // Buckets closed by an update that closed an earlier one too
+    uint32_t elapsed_ms;                // Session clock at the last update
+    uint32_t max_interval_ms;           // Longest session time between two updates
+    uint32_t max_lag_ms;                // Longest delay from a boundary to the update closing it
+    uint64_t lag_sum_ms;
+    float held_distance_m;              // Distance carried forward over clock stops
+} session_sampler_stats_t;
+
+/**
+ * Sampler state (one per session)
+ */
+typedef struct {
+    uint32_t bucket_ms;                 // Bucket length
+
+    uint32_t prev_ms;                   // Update before the last one
+    float prev_work_j;
+    float prev_distance_m;
+    uint32_t cur_ms;                    // Last update
+    float cur_work_j;
+    float cur_distance_m;
+    uint8_t heart_rate;
+
+    uint32_t boundary_ms;               // End of the last closed bucket
+    float boundary_work_j;              // Totals at that boundary
+    float boundary_distance_m;
+    uint32_t emitted_work_j;            // Rounded totals handed out in rows
+    uint32_t emitted_distance_dm;
+
+    session_sampler_stats_t stats;
+} session_sampler_t;
+
+/**
+ * u16 field of a record, rounded and saturated
+ */
+static inline uint16_t session_sampler_to_u16(float value) {
+    if (value <= 0) {
+        return 0;
+    }
+    if (value >= 65535.0f) {
+        return 65535;
+    }
+    return (uint16_t)(value + 0.5f);
+}
+
+/**
+ * u8 field of a record, rounded and saturated
+ */
+static inline uint8_t session_sampler_to_u8(float value) {
+    if (value <= 0) {
+        return 0;
+    }
+    if (value >= 255.0f) {
+        return 255;
+    }
+    return (uint8_t)(value + 0.5f);
+}
+
+/**
+ * Running total in whole units
+ */
+static inline uint32_t session_sampler_round_total(float value) {
+    return value > 0 ? (uint32_t)(value + 0.5f) : 0;
+}
+
+/**
+ * Part of a running total not yet handed out, at most one u16 field
+ * (the rest follows in the next records)
+ * @param emitted In/out: total handed out so far
+ */
+static inline uint16_t session_sampler_take(uint32_t total, uint32_t *emitted) {
+    if (total <= *emitted) {
+        return 0;
+    }
+    uint32_t delta = total - *emitted;
+    if (delta > 65535) {
+        delta = 65535;
+    }
+    *emitted += delta;
+    return (uint16_t)delta;
+}
+
+/**
+ * Start a session (clock and totals at zero)
+ * @param bucket_ms Bucket length (0 for SESSION_SAMPLER_BUCKET_MS)
+ */
+void session_sampler_reset(session_sampler_t *sampler, uint32_t bucket_ms);
+
+/**
+ * Feed one update; then take the rows it closed with session_sampler_next_row()
+ * @param elapsed_ms Session clock (values below the last one are taken as no change)
+ * @param work_j Total work so far
+ * @param distance_m Total distance so far
+ * @param heart_rate Current heart rate (0 if not available)
+ */
+void session_sampler_update(session_sampler_t *sampler, uint32_t elapsed_ms,
+                            float work_j, float distance_m, uint8_t heart_rate);
+
+/**
+ * Close the next bucket ended by the last update
+ * @param work_j Out: total work at its end (interpolated)
+ * @param distance_m Out: total distance at its end (interpolated)
+ * @return false when all closed buckets have been taken
+ */
+bool session_sampler_next_boundary(session_sampler_t *sampler, float *work_j, float *distance_m);
+
+/**
+ * Take the next one-second bucket closed by the last update
+ * @param row Out: the bucket (reserved is 0)
+ * @return false when all closed buckets have been taken
+ */
+bool session_sampler_next_row(session_sampler_t *sampler, sample_data_t *row);
+
+/**
+ * Close the open bucket at the end of a session
+ * The row covers the part of the second rowed (power and velocity over that
+ * part), so the rows sum to the session totals.
+ * @param row Out: the partial bucket
+ * @return false if nothing happened since the last boundary
+ */
+bool session_sampler_finish(session_sampler_t *sampler, sample_data_t *row);
+
+#endif // SESSION_SAMPLER_H
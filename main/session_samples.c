@@ -0,0 +1,228 @@
+/**
+ * @file session_samples.c
+ * @brief Binary sample downloads (/api/sessions/{id}/samples.bin, pages.bin)
+ */
+
+#include "session_samples.h"
+#include "session_manager.h"
+#include "session_detail.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+
+esp_err_t session_samples_open(uint32_t session_id, bool pages, recording_profile_t profile,
+                               session_samples_doc_t *doc) {
+    memset(doc, 0, sizeof(*doc));
+    esp_err_t ret = session_manager_get_session(session_id, &doc->record);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    doc->profile = profile;
+
+    if (profile != RECORDING_PROFILE_1HZ) {
+        // High-resolution records are only stored as pages
+        uint32_t page_bytes = 0;
+        ret = session_manager_get_detail_size(session_id, profile, &doc->record_count, &page_bytes);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        doc->version = pages ? SESSION_SAMPLES_VERSION_PAGES : SESSION_SAMPLES_VERSION;
+        doc->data_bytes = pages ? page_bytes : doc->record_count * session_detail_layout(profile)->record_size;
+        return ESP_OK;
+    }
+
+    doc->record_count = doc->record.sample_count;
+    doc->version = pages ? SESSION_SAMPLES_VERSION_PAGES : SESSION_SAMPLES_VERSION;
+    if (pages) {
+        return session_manager_get_sample_pages_size(session_id, &doc->data_bytes);
+    }
+    doc->data_bytes = doc->record.sample_count * sizeof(sample_data_t);
+    return ESP_OK;
+}
+
+esp_err_t session_samples_open_strokes(uint32_t session_id, bool pages, session_samples_doc_t *doc) {
+    memset(doc, 0, sizeof(*doc));
+    esp_err_t ret = session_manager_get_session(session_id, &doc->record);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    doc->strokes = true;
+
+    // Stroke records are only stored as pages
+    uint32_t page_bytes = 0;
+    ret = session_manager_get_stroke_size(session_id, &doc->record_count, &page_bytes);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    doc->version = pages ? SESSION_SAMPLES_VERSION_PAGES : SESSION_SAMPLES_VERSION;
+    doc->data_bytes = pages ? page_bytes : doc->record_count * sizeof(stroke_record_t);
+    return ESP_OK;
+}
+
+void session_samples_make_header(const session_samples_doc_t *doc, session_samples_header_t *header) {
+    memset(header, 0, sizeof(*header));
+    memcpy(header->magic, SESSION_SAMPLES_MAGIC, sizeof(header->magic));
+    header->version = doc->version;
+    header->header_size = sizeof(session_samples_header_t);
+    const sample_codec_layout_t *layout = session_detail_layout(doc->profile);
+    header->sample_size = layout != NULL ? layout->record_size : sizeof(sample_data_t);
+    header->sample_interval_ms = doc->profile == RECORDING_PROFILE_10HZ ? SESSION_DETAIL_10HZ_MS :
+                                 doc->profile == RECORDING_PROFILE_PULSE ? 0 : 1000;
+    if (doc->strokes) {
+        header->sample_size = sizeof(stroke_record_t);
+        header->sample_interval_ms = SESSION_SAMPLES_INTERVAL_STROKE;
+    }
+    header->session_id = doc->record.session_id;
+    header->start_timestamp = doc->record.start_timestamp;
+    header->sample_count = doc->record_count;
+    header->data_bytes = doc->data_bytes;
+}
+
+uint32_t session_samples_size(const session_samples_doc_t *doc) {
+    return sizeof(session_samples_header_t) + doc->data_bytes;
+}
+
+void session_samples_etag(const session_samples_doc_t *doc, char *out, size_t out_len) {
+    // Profile (f for strokes) in the high digit, so per-second downloads keep their tags
+    unsigned int kind = doc->strokes ? 0xF : (unsigned int)doc->profile;
+    snprintf(out, out_len, "\"%lx-%llx-%lx-%x\"", (unsigned long)doc->record.session_id,
+             (unsigned long long)doc->record.start_timestamp, (unsigned long)doc->record_count,
+             (unsigned int)doc->version | kind << 4);
+}
+
+bool session_samples_etag_matches(const char *header_value, const char *etag) {
+    size_t etag_len = strlen(etag);
+    const char *p = header_value;
+
+    while (*p != '\0') {
+        while (*p == ' ' || *p == '\t' || *p == ',') {
+            p++;
+        }
+        const char *start = p;
+        while (*p != '\0' && *p != ',') {
+            p++;
+        }
+        const char *end = p;
+        while (end > start && (end[-1] == ' ' || end[-1] == '\t')) {
+            end--;
+        }
+
+        size_t len = (size_t)(end - start);
+        if (len == 1 && *start == '*') {
+            return true;
+        }
+        if (len == etag_len && memcmp(start, etag, len) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Parse a decimal byte position, false if absent or out of range
+ */
+static bool parse_position(const char **p, uint32_t *out) {
+    if (!isdigit((unsigned char)**p)) {
+        return false;
+    }
+    uint64_t value = 0;
+    while (isdigit((unsigned char)**p)) {
+        value = value * 10 + (uint64_t)(**p - '0');
+        if (value > UINT32_MAX) {
+            return false;
+        }
+        (*p)++;
+    }
+    *out = (uint32_t)value;
+    return true;
+}
+
+session_samples_range_t session_samples_parse_range(const char *value, uint32_t size,
+                                                    uint32_t *first, uint32_t *last) {
+    if (value == NULL || strncmp(value, "bytes=", 6) != 0 || strchr(value, ',') != NULL) {
+        return SESSION_SAMPLES_RANGE_NONE;
+    }
+    const char *p = value + 6;
+    while (*p == ' ') {
+        p++;
+    }
+
+    uint32_t start = 0;
+    uint32_t end = 0;
+    bool has_start = parse_position(&p, &start);
+    if (*p++ != '-') {
+        return SESSION_SAMPLES_RANGE_NONE;
+    }
+    bool has_end = parse_position(&p, &end);
+    while (*p == ' ') {
+        p++;
+    }
+    if (*p != '\0' || (!has_start && !has_end) || (has_start && has_end && end < start)) {
+        return SESSION_SAMPLES_RANGE_NONE;
+    }
+
+    if (!has_start) {
+        // Suffix range: the last `end` bytes
+        if (end == 0 || size == 0) {
+            return SESSION_SAMPLES_RANGE_UNSATISFIABLE;
+        }
+        *first = end >= size ? 0 : size - end;
+        *last = size - 1;
+        return SESSION_SAMPLES_RANGE_OK;
+    }
+
+    if (start >= size) {
+        return SESSION_SAMPLES_RANGE_UNSATISFIABLE;
+    }
+    *first = start;
+    *last = (!has_end || end >= size) ? size - 1 : end;
+    return SESSION_SAMPLES_RANGE_OK;
+}
+
+esp_err_t session_samples_read(const session_samples_doc_t *doc, uint32_t offset,
+                               uint8_t *buffer, uint32_t length, uint32_t *bytes_read) {
+    *bytes_read = 0;
+
+    // Header part
+    if (offset < sizeof(session_samples_header_t)) {
+        session_samples_header_t header;
+        session_samples_make_header(doc, &header);
+        uint32_t n = sizeof(header) - offset;
+        if (n > length) {
+            n = length;
+        }
+        memcpy(buffer, (const uint8_t *)&header + offset, n);
+        *bytes_read = n;
+        buffer += n;
+        length -= n;
+        offset += n;
+    }
+    if (length == 0) {
+        return ESP_OK;
+    }
+
+    // Data, from the session store
+    uint32_t data_offset = offset - sizeof(session_samples_header_t);
+    if (data_offset >= doc->data_bytes) {
+        return ESP_OK;
+    }
+    if (length > doc->data_bytes - data_offset) {
+        length = doc->data_bytes - data_offset;
+    }
+    uint32_t n = 0;
+    uint32_t id = doc->record.session_id;
+    bool pages = doc->version == SESSION_SAMPLES_VERSION_PAGES;
+    esp_err_t ret;
+    if (doc->strokes) {
+        ret = pages ? session_manager_read_stroke_pages(id, data_offset, buffer, length, &n) :
+                      session_manager_read_stroke_bytes(id, data_offset, buffer, length, &n);
+    } else if (doc->profile != RECORDING_PROFILE_1HZ) {
+        ret = pages ? session_manager_read_detail_pages(id, doc->profile, data_offset, buffer, length, &n) :
+                      session_manager_read_detail_bytes(id, doc->profile, data_offset, buffer, length, &n);
+    } else {
+        ret = pages ? session_manager_read_sample_pages(id, data_offset, buffer, length, &n) :
+                      session_manager_read_sample_bytes(id, data_offset, buffer, length, &n);
+    }
+    *bytes_read += n;
+    return ret;
+}
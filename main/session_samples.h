@@ -0,0 +1,141 @@
+/**
+ * @file session_samples.h
+ * @brief Binary sample downloads (/api/sessions/{id}/samples.bin, pages.bin)
+ *
+ * A download is a small fixed header followed by the session's samples:
+ * - samples.bin: packed sample_data_t (8 bytes per second, little-endian),
+ *   decoded from flash. A 2-hour session is about 57 KB.
+ * - pages.bin: the compressed pages exactly as stored (sample_codec.h), so
+ *   the device only copies flash; a 2-hour session is about a third of
+ *   samples.bin.
+ *
+ * Both take ?profile=10hz or ?profile=pulse for the high-resolution records
+ * of a session recorded with that profile (session_detail.h): the header's
+ * sample_size is then that of sample_10hz_t or sample_pulse_t, and
+ * sample_interval_ms is 100, or 0 for one record per flywheel pulse.
+ * ?records=strokes returns the session's stroke records (stroke_record.h)
+ * with sample_interval_ms SESSION_SAMPLES_INTERVAL_STROKE.
+ *
+ * Stored sessions never change, so the document gets a strong ETag and
+ * byte ranges of it can be served for resumed transfers. The helpers here
+ * (header, ETag, Range parsing, reads at any offset) are plain C so the host
+ * benchmark can exercise them; web_server only adds the HTTP plumbing.
+ */
+
+#ifndef SESSION_SAMPLES_H
+#define SESSION_SAMPLES_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "rowing_physics.h"
+
+#define SESSION_SAMPLES_MAGIC       "RWSS"
+#define SESSION_SAMPLES_VERSION     1       // sample_data_t array
+#define SESSION_SAMPLES_VERSION_PAGES 2     // sample_codec pages
+
+// sample_interval_ms of a stroke record download (one record per stroke)
+#define SESSION_SAMPLES_INTERVAL_STROKE 0xFFFF
+
+// Longest ETag including quotes and terminator
+#define SESSION_SAMPLES_ETAG_LEN    40
+
+/**
+ * Download header (32 bytes, little-endian)
+ */
+typedef struct __attribute__((packed)) {
+    char magic[4];                  // SESSION_SAMPLES_MAGIC
+    uint16_t version;               // SESSION_SAMPLES_VERSION
+    uint16_t header_size;           // sizeof(session_samples_header_t)
+    uint16_t sample_size;           // sizeof(sample_data_t), or of the profile's record
+    uint16_t sample_interval_ms;    // Time between samples (0: one per flywheel pulse,
+                                    // SESSION_SAMPLES_INTERVAL_STROKE: one per stroke)
+    uint32_t session_id;
+    int64_t start_timestamp;        // As session_record_t.start_timestamp
+    uint32_t sample_count;          // Records
+    uint32_t data_bytes;            // Bytes after the header
+} session_samples_header_t;
+
+/**
+ * A download of one stored session
+ */
+typedef struct {
+    session_record_t record;
+    recording_profile_t profile;    // RECORDING_PROFILE_1HZ: the per-second samples
+    bool strokes;                   // The stroke records instead (profile is then unused)
+    uint16_t version;               // SESSION_SAMPLES_VERSION or SESSION_SAMPLES_VERSION_PAGES
+    uint32_t record_count;          // Records in the download
+    uint32_t data_bytes;            // Bytes after the header
+} session_samples_doc_t;
+
+/**
+ * Result of parsing a Range header
+ */
+typedef enum {
+    SESSION_SAMPLES_RANGE_NONE = 0,         // Absent, malformed or multi-range: send everything
+    SESSION_SAMPLES_RANGE_OK,               // Send [first, last]
+    SESSION_SAMPLES_RANGE_UNSATISFIABLE     // 416
+} session_samples_range_t;
+
+/**
+ * Look up a stored session's download
+ * @param pages Compressed pages if the session has them, else samples
+ * @param profile Which records: per-second samples, or the 10 Hz / per-pulse
+ *        records of a session recorded with that profile
+ * @return ESP_ERR_NOT_FOUND if the session is not stored or has no such records
+ */
+esp_err_t session_samples_open(uint32_t session_id, bool pages, recording_profile_t profile,
+                               session_samples_doc_t *doc);
+
+/**
+ * Look up a stored session's stroke records download
+ * @param pages Compressed pages as stored, else decoded stroke_record_t
+ * @return ESP_ERR_NOT_FOUND if the session is not stored
+ */
+esp_err_t session_samples_open_strokes(uint32_t session_id, bool pages, session_samples_doc_t *doc);
+
+/**
+ * Fill the download header
+ */
+void session_samples_make_header(const session_samples_doc_t *doc, session_samples_header_t *header);
+
+/**
+ * Size of the whole download (header + data)
+ */
+uint32_t session_samples_size(const session_samples_doc_t *doc);
+
+/**
+ * Strong ETag of a download (quoted)
+ * Includes the start time because session IDs restart after the history is
+ * cleared, and the version and profile (or strokes) because each is a
+ * different document.
+ * @param out At least SESSION_SAMPLES_ETAG_LEN bytes
+ */
+void session_samples_etag(const session_samples_doc_t *doc, char *out, size_t out_len);
+
+/**
+ * Check an If-None-Match / If-Range value against an ETag
+ * Accepts "*" and comma-separated lists; weak tags never match (strong comparison).
+ */
+bool session_samples_etag_matches(const char *header_value, const char *etag);
+
+/**
+ * Parse a Range header value ("bytes=a-b", "bytes=a-", "bytes=-n")
+ * @param size Size of the download
+ * @param first Out: first byte (inclusive) when RANGE_OK
+ * @param last Out: last byte (inclusive) when RANGE_OK
+ */
+session_samples_range_t session_samples_parse_range(const char *value, uint32_t size,
+                                                    uint32_t *first, uint32_t *last);
+
+/**
+ * Read bytes of the download at any offset
+ * @param offset Byte offset into the download (header included)
+ * @param bytes_read Out: bytes copied (less than length only at the end)
+ * @return ESP_OK, or the session_manager error if samples could not be read
+ */
+esp_err_t session_samples_read(const session_samples_doc_t *doc, uint32_t offset,
+                               uint8_t *buffer, uint32_t length, uint32_t *bytes_read);
+
+#endif // SESSION_SAMPLES_H
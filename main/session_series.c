@@ -0,0 +1,230 @@
+/**
+ * @file session_series.c
+ * @brief Per-second time series of the running session
+ */
+
+#include "session_series.h"
+#include "app_config.h"
+
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+
+#include <stdatomic.h>
+#include <string.h>
+
+static const char *TAG = "SERIES";
+
+// Bytes per row: power, velocity, distance (u16), heart rate (u8)
+#define ROW_BYTES               (3 * sizeof(uint16_t) + sizeof(uint8_t))
+
+// Per row before the store: an 8-byte sample_data_t in the session manager
+// and a 16-byte { int64 timestamp, u8 bpm } entry in the HR receiver
+#define REPLACED_ROW_BYTES      (8 + 16)
+
+// Columns, carved from one allocation (u16 columns first for alignment)
+static void *s_block = NULL;
+static bool s_psram = false;
+static uint16_t *s_power;
+static uint16_t *s_velocity;
+static uint16_t *s_distance;
+static uint8_t *s_heart_rate;
+
+// Rows written; published after the row itself
+static atomic_uint_fast32_t s_count;
+
+// Statistics: the writer's copy and the published one. Both, and the zone
+// floors, are only modified inside s_publish_lock, so appends and resets
+// from different tasks do not interleave and a reader on the same core
+// cannot preempt a half-written publish and spin.
+static session_series_stats_t s_stats;
+static session_series_stats_t s_published;
+static atomic_uint_fast32_t s_sequence;
+static portMUX_TYPE s_publish_lock = portMUX_INITIALIZER_UNLOCKED;
+static uint8_t s_zone_floor[HR_ZONE_COUNT];
+
+/**
+ * Publish the writer's statistics (inside s_publish_lock)
+ */
+static void publish_stats(void) {
+    uint32_t sequence = (uint32_t)atomic_load_explicit(&s_sequence, memory_order_relaxed);
+    atomic_store_explicit(&s_sequence, sequence + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    memcpy(&s_published, &s_stats, sizeof(s_published));
+    atomic_store_explicit(&s_sequence, sequence + 2, memory_order_release);
+}
+
+/**
+ * Recompute zone floors (inside s_publish_lock)
+ */
+static void set_zone_floors(uint8_t max_heart_rate) {
+    for (int zone = 0; zone < HR_ZONE_COUNT; zone++) {
+        s_zone_floor[zone] = (uint8_t)((max_heart_rate * (50 + 10 * zone) + 50) / 100);
+    }
+}
+
+/**
+ * Zone of a heart rate, -1 below zone 1 (inside s_publish_lock)
+ */
+static int zone_of(uint8_t bpm) {
+    for (int zone = HR_ZONE_COUNT - 1; zone >= 0; zone--) {
+        if (bpm >= s_zone_floor[zone]) {
+            return zone;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Allocate the columns
+ */
+esp_err_t session_series_init(void) {
+    if (s_block == NULL) {
+        size_t bytes = SESSION_SERIES_CAPACITY * ROW_BYTES;
+#ifdef CONFIG_SPIRAM
+        s_block = heap_caps_malloc(bytes, MALLOC_CAP_SPIRAM);
+        s_psram = s_block != NULL;
+#endif
+        if (s_block == NULL) {
+            s_block = malloc(bytes);
+        }
+        if (s_block == NULL) {
+            ESP_LOGE(TAG, "Failed to allocate session series (%u bytes)", (unsigned int)bytes);
+            return ESP_ERR_NO_MEM;
+        }
+        s_power = s_block;
+        s_velocity = s_power + SESSION_SERIES_CAPACITY;
+        s_distance = s_velocity + SESSION_SERIES_CAPACITY;
+        s_heart_rate = (uint8_t *)(s_distance + SESSION_SERIES_CAPACITY);
+        ESP_LOGI(TAG, "Session series allocated in %s (%u bytes, %d rows)",
+                 s_psram ? "PSRAM" : "heap", (unsigned int)bytes, SESSION_SERIES_CAPACITY);
+
+        portENTER_CRITICAL(&s_publish_lock);
+        set_zone_floors(DEFAULT_MAX_HEART_RATE);
+        portEXIT_CRITICAL(&s_publish_lock);
+    }
+
+    session_series_reset();
+    return ESP_OK;
+}
+
+/**
+ * Drop all rows and statistics
+ */
+void session_series_reset(void) {
+    atomic_store_explicit(&s_count, 0, memory_order_release);
+
+    portENTER_CRITICAL(&s_publish_lock);
+    memset(&s_stats, 0, sizeof(s_stats));
+    publish_stats();
+    portEXIT_CRITICAL(&s_publish_lock);
+}
+
+/**
+ * Append one row
+ */
+esp_err_t session_series_append(const sample_data_t *row) {
+    if (s_block == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    uint32_t index = (uint32_t)atomic_load_explicit(&s_count, memory_order_relaxed);
+    if (index >= SESSION_SERIES_CAPACITY) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Rows past the count are not read by anyone
+    s_power[index] = row->power_watts;
+    s_velocity[index] = row->velocity_cm_s;
+    s_distance[index] = row->distance_dm;
+    s_heart_rate[index] = row->heart_rate;
+    atomic_store_explicit(&s_count, index + 1, memory_order_release);
+
+    portENTER_CRITICAL(&s_publish_lock);
+    s_stats.samples = index + 1;
+    if (row->heart_rate > 0) {
+        s_stats.hr_samples++;
+        s_stats.hr_sum += row->heart_rate;
+        s_stats.avg_hr = (uint8_t)(s_stats.hr_sum / s_stats.hr_samples);
+        if (row->heart_rate > s_stats.max_hr) {
+            s_stats.max_hr = row->heart_rate;
+        }
+        int zone = zone_of(row->heart_rate);
+        if (zone >= 0) {
+            s_stats.zone_seconds[zone]++;
+        }
+    }
+    publish_stats();
+    portEXIT_CRITICAL(&s_publish_lock);
+
+    return ESP_OK;
+}
+
+/**
+ * Rows recorded so far
+ */
+uint32_t session_series_count(void) {
+    return (uint32_t)atomic_load_explicit(&s_count, memory_order_acquire);
+}
+
+/**
+ * Gather rows into packed samples
+ */
+uint32_t session_series_read(uint32_t first, sample_data_t *rows, uint32_t max_rows) {
+    uint32_t count = session_series_count();
+    if (s_block == NULL || first >= count) {
+        return 0;
+    }
+
+    uint32_t n = count - first < max_rows ? count - first : max_rows;
+    for (uint32_t i = 0; i < n; i++) {
+        rows[i].power_watts = s_power[first + i];
+        rows[i].velocity_cm_s = s_velocity[first + i];
+        rows[i].heart_rate = s_heart_rate[first + i];
+        rows[i].reserved = 0;
+        rows[i].distance_dm = s_distance[first + i];
+    }
+    return n;
+}
+
+/**
+ * Get the statistics of the rows so far
+ */
+void session_series_get_stats(session_series_stats_t *stats) {
+    while (true) {
+        uint32_t begin = (uint32_t)atomic_load_explicit(&s_sequence, memory_order_acquire);
+        if ((begin & 1) == 0) {
+            memcpy(stats, &s_published, sizeof(*stats));
+            atomic_thread_fence(memory_order_acquire);
+            if ((uint32_t)atomic_load_explicit(&s_sequence, memory_order_relaxed) == begin) {
+                return;
+            }
+        }
+    }
+}
+
+/**
+ * Set the maximum heart rate the zones are based on
+ */
+void session_series_set_max_heart_rate(uint8_t max_heart_rate) {
+    if (max_heart_rate == 0) {
+        return;
+    }
+
+    portENTER_CRITICAL(&s_publish_lock);
+    set_zone_floors(max_heart_rate);
+    portEXIT_CRITICAL(&s_publish_lock);
+
+    ESP_LOGI(TAG, "HR zones based on max %d bpm", max_heart_rate);
+}
+
+/**
+ * Get the memory held by the store
+ */
+void session_series_get_memory(session_series_memory_t *memory) {
+    memory->capacity = SESSION_SERIES_CAPACITY;
+    memory->row_bytes = ROW_BYTES;
+    memory->bytes = s_block != NULL ? SESSION_SERIES_CAPACITY * ROW_BYTES : 0;
+    memory->replaced_bytes = SESSION_SERIES_CAPACITY * REPLACED_ROW_BYTES;
+    memory->psram = s_psram;
+}
@@ -0,0 +1,104 @@
+/**
+ * @file session_series.h
+ * @brief Per-second time series of the running session
+ *
+ * The one store for everything recorded once per second during a session:
+ * power, velocity, heart rate and distance, each in its own column
+ * (structure of arrays, one allocation, PSRAM when available). The session
+ * sampler (session_sampler.h) appends a row per second of session time;
+ * the storage task reads rows to flush them, the session export and
+ * samples.bin read them while the session runs, and
+ * the heart rate statistics of every broadcast and of the session record
+ * come from running sums updated at append time.
+ *
+ * A row is written before the count that covers it is published, so rows
+ * below session_series_count() can be read without a lock. The statistics
+ * are published with a sequence counter and read lock-free in O(1).
+ */
+
+#ifndef SESSION_SERIES_H
+#define SESSION_SERIES_H
+
+#include "esp_err.h"
+#include "rowing_physics.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+// Rows per session (2 hours at 1 Hz)
+#define SESSION_SERIES_CAPACITY     MAX_SAMPLES_PER_SESSION
+
+// Heart rate zones: zone i (0-based) starts at 50 + 10 * i % of max heart rate
+#define HR_ZONE_COUNT               5
+
+/**
+ * Statistics of the rows recorded so far
+ */
+typedef struct {
+    uint32_t samples;                   // Rows
+    uint32_t hr_samples;                // Rows with a heart rate
+    uint32_t hr_sum;
+    uint8_t avg_hr;                     // Over rows with a heart rate
+    uint8_t max_hr;
+    uint32_t zone_seconds[HR_ZONE_COUNT];
+} session_series_stats_t;
+
+/**
+ * Memory held by the store
+ */
+typedef struct {
+    uint32_t capacity;                  // Rows
+    uint32_t row_bytes;                 // Bytes per row over all columns
+    uint32_t bytes;                     // Column storage
+    uint32_t replaced_bytes;            // Former sample buffer + HR buffer of the same capacity
+    bool psram;
+} session_series_memory_t;
+
+/**
+ * Allocate the columns
+ * @return ESP_OK, ESP_ERR_NO_MEM
+ */
+esp_err_t session_series_init(void);
+
+/**
+ * Drop all rows and statistics (new session)
+ */
+void session_series_reset(void);
+
+/**
+ * Append one row
+ * @param row Values of the second (reserved is not stored)
+ * @return ESP_OK, ESP_ERR_NO_MEM when full, ESP_ERR_INVALID_STATE without columns
+ */
+esp_err_t session_series_append(const sample_data_t *row);
+
+/**
+ * Rows recorded so far
+ */
+uint32_t session_series_count(void);
+
+/**
+ * Gather rows into packed samples
+ * @param first Index of the first row
+ * @param rows Output
+ * @param max_rows Capacity of rows
+ * @return Rows copied
+ */
+uint32_t session_series_read(uint32_t first, sample_data_t *rows, uint32_t max_rows);
+
+/**
+ * Get the statistics of the rows so far (constant time, lock-free)
+ */
+void session_series_get_stats(session_series_stats_t *stats);
+
+/**
+ * Set the maximum heart rate the zones are based on (config_t.max_heart_rate)
+ * Applies to rows appended from now on.
+ */
+void session_series_set_max_heart_rate(uint8_t max_heart_rate);
+
+/**
+ * Get the memory held by the store
+ */
+void session_series_get_memory(session_series_memory_t *memory);
+
+#endif // SESSION_SERIES_H
@@ -0,0 +1,1426 @@
+/**
+ * @file session_store.c
+ * @brief Log-structured session store on the `storage` flash partition
+ *
+ * On-flash layout (little-endian):
+ *
+ *   sector:  [sector_header_t 16 B][record][record]...[0xFF...]
+ *   record:  [record_header_t 16 B][payload][pad to 4 B]
+ *
+ * Writing a record programs the header with state 0xFF, then the payload,
+ * then clears STATE_COMMITTED. Later state changes only clear more bits:
+ * SUPERSEDED when GC has copied the record elsewhere (or a newer checkpoint
+ * replaced it), SYNCED and DELETED on session records, DELETED on the
+ * checkpoint of an abandoned session. A scan stops at the first erased or uncommitted header
+ * of a sector; only the last record written before a power cut can be
+ * uncommitted.
+ *
+ * Liveness is decided by the RAM index: a session or checkpoint record is
+ * live if the index points at it, an extent is live if its session is open
+ * or live. Everything else is garbage that GC drops when it reclaims the
+ * sector.
+ *
+ * An open session is known on flash by its checkpoint, so mount finds
+ * sessions that were being written when power was lost and keeps them open
+ * for session_store_list_open(). The tombstone of the newest session is
+ * kept even without extents, so its id is never handed out again.
+ */
+
+#include "session_store.h"
+
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#include <string.h>
+#include <stddef.h>
+
+static const char *TAG = "STORE";
+
+#define STORE_MAGIC                 "RWSL"
+#define STORE_FORMAT_VERSION        1
+
+// Flash erase granularity
+#define STORE_SECTOR_SIZE           4096
+
+// Sector sequence of an erased sector that is not part of the log yet
+#define SEQUENCE_FREE               0xFFFFFFFFu
+
+// Free sectors kept back for GC (normal appends never take the last one)
+#define GC_RESERVE_SECTORS          1
+
+// Smallest extent worth starting in the leftover space of a sector
+#define MIN_EXTENT_BYTES            64
+
+// Least a GC run must free (otherwise the oldest session is dropped)
+#define GC_MIN_GAIN_BYTES           512
+
+#define NO_OFFSET                   0xFFFFFFFFu
+#define NO_SECTOR                   0xFFFF
+
+// Record state bits, active low (erased flash reads 0xFF)
+#define STATE_COMMITTED             0x01
+#define STATE_SUPERSEDED            0x02
+#define STATE_SYNCED                0x04
+#define STATE_DELETED               0x08
+
+// Record types (data streams use their session_store_stream_t value)
+#define RECORD_SESSION              1
+#define RECORD_CHECKPOINT           0x81    // Summary of an open session so far
+
+/**
+ * Sector header (16 bytes)
+ */
+typedef struct __attribute__((packed)) {
+    char magic[4];                  // STORE_MAGIC
+    uint16_t version;               // STORE_FORMAT_VERSION
+    uint16_t header_size;           // sizeof(sector_header_t)
+    uint32_t sequence;              // Position in the log, SEQUENCE_FREE until opened
+    uint32_t erase_count;           // Erases of this sector so far
+} sector_header_t;
+
+/**
+ * Record header (16 bytes)
+ */
+typedef struct __attribute__((packed)) {
+    uint8_t state;                  // STATE_* bits, cleared when set
+    uint8_t type;                   // RECORD_* or a session_store_stream_t
+    uint16_t length;                // Payload bytes
+    uint32_t session_id;
+    uint32_t offset;                // Stream offset of the payload (data extents)
+    uint32_t crc;                   // CRC32 of type..offset and the payload
+} record_header_t;
+
+#define SECTOR_DATA_START           ((uint32_t)sizeof(sector_header_t))
+#define RECORD_MAX_PAYLOAD          (STORE_SECTOR_SIZE - SECTOR_DATA_START - (uint32_t)sizeof(record_header_t))
+#define RECORD_SIZE(len)            ((((uint32_t)sizeof(record_header_t) + (len)) + 3u) & ~3u)
+
+/**
+ * Sector state in RAM (12 bytes per sector)
+ */
+typedef enum {
+    SECTOR_FREE = 0,                // Erased, header written, not in the log
+    SECTOR_DIRTY,                   // Needs an erase before use
+    SECTOR_USED                     // Part of the log
+} sector_state_t;
+
+typedef struct {
+    uint32_t sequence;
+    uint32_t erase_count;
+    uint16_t write_offset;          // Next record, STORE_SECTOR_SIZE once closed
+    uint8_t state;                  // sector_state_t
+    uint8_t reserved;
+} sector_info_t;
+
+/**
+ * Session index entry
+ */
+typedef enum {
+    ENTRY_OPEN = 0,                 // Being written, no session record yet
+    ENTRY_LIVE,                     // Committed
+    ENTRY_TOMBSTONE                 // Deleted, record kept until its extents are erased
+} entry_state_t;
+
+typedef struct {
+    uint32_t session_id;
+    uint32_t record_offset;         // Session record (checkpoint while open), NO_OFFSET if none
+    uint32_t extent_bytes;          // Unerased extent record bytes (any state)
+    uint16_t first_sector;          // Sector of the first extent, NO_SECTOR if unknown
+    uint8_t state;                  // entry_state_t
+} entry_t;
+
+/**
+ * Last extent found by a read (sequential reads resume from it)
+ */
+typedef struct {
+    bool valid;
+    uint32_t session_id;
+    uint8_t type;
+    uint32_t stream_offset;
+    uint32_t length;
+    uint32_t payload_offset;        // Partition offset of the payload
+    uint32_t sector;
+    uint32_t next_record;           // Offset within the sector after the extent
+} read_cursor_t;
+
+static const esp_partition_t *s_partition = NULL;
+static SemaphoreHandle_t s_mutex = NULL;
+static bool s_ready = false;
+static bool s_moving_cold = false;          // Wear levelling: fill worn sectors
+
+static sector_info_t *s_sectors = NULL;
+static uint32_t s_sector_count = 0;
+static uint16_t *s_order = NULL;            // Used sectors, oldest first
+static uint32_t s_order_count = 0;
+static bool s_order_dirty = true;
+static int32_t s_head = -1;                 // Sector being appended to
+static uint32_t s_next_sequence = 0;
+
+static entry_t s_entries[SESSION_STORE_MAX_SESSIONS];   // Sorted by session id
+static uint32_t s_entry_count = 0;
+static uint32_t s_latest_id = 0;
+
+static read_cursor_t s_cursor;
+static session_store_stats_t s_stats;
+static uint8_t s_copy_buf[256];
+
+// ============================================================================
+// Flash access
+// ============================================================================
+
+static inline bool state_has(uint8_t state, uint8_t bit) {
+    return (state & bit) == 0;
+}
+
+static inline uint32_t sector_base(uint32_t sector) {
+    return sector * STORE_SECTOR_SIZE;
+}
+
+static inline bool is_extent(uint8_t type) {
+    return type != RECORD_SESSION && type != RECORD_CHECKPOINT;
+}
+
+static esp_err_t flash_read(uint32_t offset, void *data, size_t len) {
+    return esp_partition_read(s_partition, offset, data, len);
+}
+
+static esp_err_t flash_write(uint32_t offset, const void *data, size_t len) {
+    esp_err_t ret = esp_partition_write(s_partition, offset, data, len);
+    if (ret == ESP_OK) {
+        s_stats.bytes_programmed += (uint32_t)len;
+    }
+    return ret;
+}
+
+/**
+ * Clear state bits of a record in place
+ */
+static esp_err_t clear_state_bits(uint32_t record_offset, uint8_t bits) {
+    uint8_t state;
+    esp_err_t ret = flash_read(record_offset, &state, 1);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    state &= (uint8_t)~bits;
+    return flash_write(record_offset, &state, 1);
+}
+
+/**
+ * CRC of a record: header fields after the state byte, then the payload
+ */
+static uint32_t record_crc_start(const record_header_t *header) {
+    return esp_rom_crc32_le(0, (const uint8_t *)header + offsetof(record_header_t, type),
+                            offsetof(record_header_t, crc) - offsetof(record_header_t, type));
+}
+
+/**
+ * CRC of payload bytes already on flash
+ */
+static esp_err_t flash_crc(uint32_t crc, uint32_t offset, uint32_t len, uint32_t *out) {
+    while (len > 0) {
+        uint32_t n = len < sizeof(s_copy_buf) ? len : sizeof(s_copy_buf);
+        esp_err_t ret = flash_read(offset, s_copy_buf, n);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        crc = esp_rom_crc32_le(crc, s_copy_buf, n);
+        offset += n;
+        len -= n;
+    }
+    *out = crc;
+    return ESP_OK;
+}
+
+/**
+ * Read the committed record at pos in a sector
+ * @return false at the end of the sector's data (erased, uncommitted or torn header)
+ */
+static bool read_record(uint32_t sector, uint32_t pos, record_header_t *header) {
+    if (pos + sizeof(record_header_t) > STORE_SECTOR_SIZE) {
+        return false;
+    }
+    if (flash_read(sector_base(sector) + pos, header, sizeof(*header)) != ESP_OK) {
+        return false;
+    }
+    if (!state_has(header->state, STATE_COMMITTED) ||
+        header->length > RECORD_MAX_PAYLOAD ||
+        pos + RECORD_SIZE(header->length) > STORE_SECTOR_SIZE) {
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Whether the bytes at pos are still erased (end of data rather than a torn record)
+ */
+static bool is_erased(uint32_t sector, uint32_t pos) {
+    if (pos + sizeof(record_header_t) > STORE_SECTOR_SIZE) {
+        return false;
+    }
+    uint8_t raw[sizeof(record_header_t)];
+    if (flash_read(sector_base(sector) + pos, raw, sizeof(raw)) != ESP_OK) {
+        return false;
+    }
+    for (size_t i = 0; i < sizeof(raw); i++) {
+        if (raw[i] != 0xFF) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// ============================================================================
+// Index
+// ============================================================================
+
+static entry_t *find_entry(uint32_t session_id) {
+    int lo = 0;
+    int hi = (int)s_entry_count - 1;
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        if (s_entries[mid].session_id == session_id) {
+            return &s_entries[mid];
+        }
+        if (s_entries[mid].session_id < session_id) {
+            lo = mid + 1;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return NULL;
+}
+
+static entry_t *insert_entry(uint32_t session_id) {
+    if (s_entry_count >= SESSION_STORE_MAX_SESSIONS) {
+        return NULL;
+    }
+    uint32_t i = s_entry_count;
+    while (i > 0 && s_entries[i - 1].session_id > session_id) {
+        s_entries[i] = s_entries[i - 1];
+        i--;
+    }
+    memset(&s_entries[i], 0, sizeof(entry_t));
+    s_entries[i].session_id = session_id;
+    s_entries[i].record_offset = NO_OFFSET;
+    s_entries[i].first_sector = NO_SECTOR;
+    s_entry_count++;
+    return &s_entries[i];
+}
+
+static void remove_entry(entry_t *entry) {
+    uint32_t i = (uint32_t)(entry - s_entries);
+    memmove(&s_entries[i], &s_entries[i + 1], (s_entry_count - i - 1) * sizeof(entry_t));
+    s_entry_count--;
+}
+
+/**
+ * Make room in a full index by forgetting the oldest tombstone (its record
+ * and extents simply become garbage)
+ */
+static bool drop_oldest_tombstone(void) {
+    for (uint32_t i = 0; i < s_entry_count; i++) {
+        if (s_entries[i].state == ENTRY_TOMBSTONE && s_entries[i].session_id != s_latest_id) {
+            remove_entry(&s_entries[i]);
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Whether GC must keep a record
+ */
+static bool record_is_live(const record_header_t *header, uint32_t record_offset) {
+    if (!state_has(header->state, STATE_COMMITTED) || state_has(header->state, STATE_SUPERSEDED)) {
+        return false;
+    }
+    const entry_t *entry = find_entry(header->session_id);
+    if (entry == NULL) {
+        return false;
+    }
+    if (!is_extent(header->type)) {
+        return entry->record_offset == record_offset;
+    }
+    return entry->state == ENTRY_OPEN || entry->state == ENTRY_LIVE;
+}
+
+/**
+ * Used sectors in log order (oldest first)
+ */
+static void refresh_order(void) {
+    if (!s_order_dirty) {
+        return;
+    }
+    s_order_count = 0;
+    for (uint32_t s = 0; s < s_sector_count; s++) {
+        if (s_sectors[s].state != SECTOR_USED) {
+            continue;
+        }
+        uint32_t i = s_order_count++;
+        while (i > 0 && s_sectors[s_order[i - 1]].sequence > s_sectors[s].sequence) {
+            s_order[i] = s_order[i - 1];
+            i--;
+        }
+        s_order[i] = (uint16_t)s;
+    }
+    s_order_dirty = false;
+}
+
+// ============================================================================
+// Sectors
+// ============================================================================
+
+static uint32_t free_sector_count(void) {
+    uint32_t count = 0;
+    for (uint32_t s = 0; s < s_sector_count; s++) {
+        count += s_sectors[s].state != SECTOR_USED;
+    }
+    return count;
+}
+
+/**
+ * Erase a sector and write its free header (keeps the erase count)
+ */
+static esp_err_t erase_sector(uint32_t sector) {
+    sector_info_t *info = &s_sectors[sector];
+    esp_err_t ret = esp_partition_erase_range(s_partition, sector_base(sector), STORE_SECTOR_SIZE);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Erase of sector %lu failed: %s", (unsigned long)sector, esp_err_to_name(ret));
+        return ret;
+    }
+    info->erase_count++;
+    info->state = SECTOR_FREE;
+    info->sequence = SEQUENCE_FREE;
+    info->write_offset = SECTOR_DATA_START;
+    s_order_dirty = true;
+    if (s_cursor.valid && s_cursor.sector == sector) {
+        s_cursor.valid = false;
+    }
+    for (uint32_t i = 0; i < s_entry_count; i++) {
+        if (s_entries[i].first_sector == sector) {
+            s_entries[i].first_sector = NO_SECTOR;
+        }
+    }
+    if ((int32_t)sector == s_head) {
+        s_head = -1;
+    }
+
+    sector_header_t header;
+    memcpy(header.magic, STORE_MAGIC, sizeof(header.magic));
+    header.version = STORE_FORMAT_VERSION;
+    header.header_size = sizeof(sector_header_t);
+    header.sequence = SEQUENCE_FREE;
+    header.erase_count = info->erase_count;
+    return flash_write(sector_base(sector), &header, sizeof(header));
+}
+
+/**
+ * Start a new head sector, least worn first (most worn while moving cold
+ * data, which will sit there for a long time)
+ * @param use_reserve Allow taking the sectors kept back for GC
+ */
+static esp_err_t open_sector(bool use_reserve) {
+    if (!use_reserve && free_sector_count() <= GC_RESERVE_SECTORS) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    int32_t best = -1;
+    for (uint32_t s = 0; s < s_sector_count; s++) {
+        if (s_sectors[s].state == SECTOR_USED) {
+            continue;
+        }
+        if (best < 0 ||
+            (s_moving_cold ? s_sectors[s].erase_count > s_sectors[best].erase_count
+                           : s_sectors[s].erase_count < s_sectors[best].erase_count)) {
+            best = (int32_t)s;
+        }
+    }
+    if (best < 0) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    esp_err_t ret;
+    if (s_sectors[best].state == SECTOR_DIRTY) {
+        ret = erase_sector((uint32_t)best);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+    }
+
+    uint32_t sequence = s_next_sequence++;
+    ret = flash_write(sector_base((uint32_t)best) + offsetof(sector_header_t, sequence),
+                      &sequence, sizeof(sequence));
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    s_sectors[best].state = SECTOR_USED;
+    s_sectors[best].sequence = sequence;
+    s_sectors[best].write_offset = SECTOR_DATA_START;
+    s_order_dirty = true;
+    s_head = best;
+    return ESP_OK;
+}
+
+/**
+ * Payload bytes that fit in the head sector
+ */
+static uint32_t head_room(void) {
+    if (s_head < 0) {
+        return 0;
+    }
+    uint32_t used = s_sectors[s_head].write_offset + sizeof(record_header_t);
+    return used < STORE_SECTOR_SIZE ? STORE_SECTOR_SIZE - used : 0;
+}
+
+/**
+ * Program a record at the head: header, payload (from RAM or flash), commit
+ * @param src_offset Partition offset of the payload when payload is NULL
+ */
+static esp_err_t program_record(record_header_t *header, const void *payload, uint32_t src_offset,
+                                uint8_t final_state, uint32_t *record_offset) {
+    sector_info_t *head = &s_sectors[s_head];
+    uint32_t offset = sector_base((uint32_t)s_head) + head->write_offset;
+
+    // Close the sector if anything below fails, so nothing is appended
+    // after a half-written record
+    uint16_t next = (uint16_t)(head->write_offset + RECORD_SIZE(header->length));
+    head->write_offset = STORE_SECTOR_SIZE;
+
+    header->state = 0xFF;
+    esp_err_t ret = flash_write(offset, header, sizeof(*header));
+    if (ret == ESP_OK && header->length > 0) {
+        if (payload != NULL) {
+            ret = flash_write(offset + sizeof(*header), payload, header->length);
+        } else {
+            uint32_t done = 0;
+            while (ret == ESP_OK && done < header->length) {
+                uint32_t n = header->length - done;
+                if (n > sizeof(s_copy_buf)) {
+                    n = sizeof(s_copy_buf);
+                }
+                ret = flash_read(src_offset + done, s_copy_buf, n);
+                if (ret == ESP_OK) {
+                    ret = flash_write(offset + sizeof(*header) + done, s_copy_buf, n);
+                }
+                done += n;
+            }
+        }
+    }
+    if (ret == ESP_OK) {
+        ret = flash_write(offset, &final_state, 1);
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Record write failed: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    head->write_offset = next < STORE_SECTOR_SIZE ? next : STORE_SECTOR_SIZE;
+    if (record_offset != NULL) {
+        *record_offset = offset;
+    }
+    return ESP_OK;
+}
+
+// ============================================================================
+// Garbage collection
+// ============================================================================
+
+static uint32_t sector_live_bytes(uint32_t sector) {
+    uint32_t live = 0;
+    uint32_t pos = SECTOR_DATA_START;
+    record_header_t header;
+    while (pos < s_sectors[sector].write_offset && read_record(sector, pos, &header)) {
+        if (record_is_live(&header, sector_base(sector) + pos)) {
+            live += RECORD_SIZE(header.length);
+        }
+        pos += RECORD_SIZE(header.length);
+    }
+    return live;
+}
+
+static esp_err_t ensure_room(uint32_t min_payload, bool gc);
+
+/**
+ * Copy a sector's live records to the head of the log and erase it
+ */
+static esp_err_t relocate_sector(uint32_t victim) {
+    uint32_t pos = SECTOR_DATA_START;
+    record_header_t header;
+
+    while (pos < s_sectors[victim].write_offset && read_record(victim, pos, &header)) {
+        uint32_t old_offset = sector_base(victim) + pos;
+        uint32_t size = RECORD_SIZE(header.length);
+        if (!record_is_live(&header, old_offset)) {
+            pos += size;
+            continue;
+        }
+
+        esp_err_t ret;
+        if (!is_extent(header.type)) {
+            ret = ensure_room(header.length, true);
+            uint32_t new_offset;
+            if (ret == ESP_OK) {
+                ret = program_record(&header, NULL, old_offset + sizeof(header), header.state, &new_offset);
+            }
+            if (ret != ESP_OK) {
+                return ret;
+            }
+            find_entry(header.session_id)->record_offset = new_offset;
+            s_stats.gc_bytes_copied += size;
+        } else {
+            // Extents are split to fill the head sector (each piece is a
+            // record with its own CRC), so copies never leave slack behind
+            uint32_t done = 0;
+            while (done < header.length) {
+                uint32_t left = header.length - done;
+                ret = ensure_room(left < MIN_EXTENT_BYTES ? left : MIN_EXTENT_BYTES, true);
+                if (ret != ESP_OK) {
+                    return ret;
+                }
+                uint32_t n = head_room() < left ? head_room() : left;
+                uint32_t src = old_offset + sizeof(header) + done;
+                record_header_t piece = header;
+                piece.length = (uint16_t)n;
+                piece.offset = header.offset + done;
+                uint32_t crc;
+                ret = flash_crc(record_crc_start(&piece), src, n, &crc);
+                piece.crc = crc;
+                if (ret == ESP_OK) {
+                    ret = program_record(&piece, NULL, src, header.state, NULL);
+                }
+                if (ret != ESP_OK) {
+                    return ret;
+                }
+                entry_t *entry = find_entry(header.session_id);
+                entry->extent_bytes += RECORD_SIZE(n);
+                if (piece.offset == 0) {
+                    entry->first_sector = (uint16_t)s_head;
+                }
+                s_stats.gc_bytes_copied += RECORD_SIZE(n);
+                done += n;
+            }
+        }
+        clear_state_bits(old_offset, STATE_SUPERSEDED);
+        pos += size;
+    }
+
+    // The victim's extents are about to disappear
+    pos = SECTOR_DATA_START;
+    while (pos < s_sectors[victim].write_offset && read_record(victim, pos, &header)) {
+        entry_t *entry = find_entry(header.session_id);
+        if (entry != NULL && is_extent(header.type)) {
+            uint32_t size = RECORD_SIZE(header.length);
+            entry->extent_bytes = entry->extent_bytes > size ? entry->extent_bytes - size : 0;
+            if (entry->state == ENTRY_TOMBSTONE && entry->extent_bytes == 0 &&
+                entry->session_id != s_latest_id) {
+                remove_entry(entry);
+            }
+        }
+        pos += RECORD_SIZE(header.length);
+    }
+
+    s_stats.gc_runs++;
+    return erase_sector(victim);
+}
+
+/**
+ * Reclaim the sector with the least live data
+ * @return false if no sector has anything to reclaim
+ */
+static bool collect_one(void) {
+    int32_t victim = -1;
+    uint32_t victim_live = 0;
+    for (uint32_t s = 0; s < s_sector_count; s++) {
+        if (s_sectors[s].state != SECTOR_USED || (int32_t)s == s_head) {
+            continue;
+        }
+        uint32_t live = sector_live_bytes(s);
+        if (victim < 0 || live < victim_live ||
+            (live == victim_live && s_sectors[s].erase_count < s_sectors[victim].erase_count)) {
+            victim = (int32_t)s;
+            victim_live = live;
+        }
+    }
+    // Copying a nearly full sector frees too little to be worth it
+    if (victim < 0 || victim_live + GC_MIN_GAIN_BYTES > STORE_SECTOR_SIZE - SECTOR_DATA_START) {
+        return false;
+    }
+    return relocate_sector((uint32_t)victim) == ESP_OK;
+}
+
+/**
+ * Move cold data off the least worn sector once it lags far behind
+ */
+static void level_wear(void) {
+    int32_t coldest = -1;
+    uint32_t max_erase = 0;
+    for (uint32_t s = 0; s < s_sector_count; s++) {
+        if (s_sectors[s].erase_count > max_erase) {
+            max_erase = s_sectors[s].erase_count;
+        }
+        if (s_sectors[s].state == SECTOR_USED && (int32_t)s != s_head &&
+            (coldest < 0 || s_sectors[s].erase_count < s_sectors[coldest].erase_count)) {
+            coldest = (int32_t)s;
+        }
+    }
+    if (coldest < 0 || max_erase - s_sectors[coldest].erase_count < SESSION_STORE_WEAR_DELTA ||
+        free_sector_count() <= GC_RESERVE_SECTORS) {
+        return;
+    }
+    // Start a fresh sector so the cold data does not share the hot head
+    s_head = -1;
+    s_moving_cold = true;
+    if (relocate_sector((uint32_t)coldest) == ESP_OK) {
+        s_stats.wear_moves++;
+    }
+    s_moving_cold = false;
+}
+
+/**
+ * Mark a session deleted (the record stays as a tombstone while extents remain)
+ */
+static esp_err_t delete_entry(entry_t *entry) {
+    if (entry->record_offset != NO_OFFSET) {
+        esp_err_t ret = clear_state_bits(entry->record_offset, STATE_DELETED);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+    }
+    if (entry->extent_bytes == 0 && entry->session_id != s_latest_id) {
+        remove_entry(entry);
+    } else {
+        entry->state = ENTRY_TOMBSTONE;
+    }
+    return ESP_OK;
+}
+
+/**
+ * Drop the oldest committed session
+ */
+static bool evict_oldest(void) {
+    for (uint32_t i = 0; i < s_entry_count; i++) {
+        if (s_entries[i].state == ENTRY_LIVE) {
+            uint32_t session_id = s_entries[i].session_id;
+            if (delete_entry(&s_entries[i]) != ESP_OK) {
+                return false;
+            }
+            s_stats.sessions_evicted++;
+            ESP_LOGW(TAG, "Store full, dropped session #%lu", (unsigned long)session_id);
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Get free sectors back above the GC reserve
+ */
+static esp_err_t make_space(void) {
+    // Copies can leave slack in the sectors they fill, so GC alone is not
+    // guaranteed to make progress; give up on it after one pass
+    uint32_t collections = 0;
+    while (free_sector_count() <= GC_RESERVE_SECTORS) {
+        if (collections++ < s_sector_count && collect_one()) {
+            continue;
+        }
+        if (evict_oldest()) {
+            continue;
+        }
+        return ESP_ERR_NO_MEM;
+    }
+    level_wear();
+    return ESP_OK;
+}
+
+/**
+ * Make sure the head sector has room for a record
+ * @param gc Called from GC (may use the reserve, never collects)
+ */
+static esp_err_t ensure_room(uint32_t min_payload, bool gc) {
+    if (head_room() >= min_payload && s_head >= 0) {
+        return ESP_OK;
+    }
+    if (!gc) {
+        esp_err_t ret = make_space();
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        // GC may have left room in a new head
+        if (head_room() >= min_payload && s_head >= 0) {
+            return ESP_OK;
+        }
+    }
+    return open_sector(gc);
+}
+
+// ============================================================================
+// Mount
+// ============================================================================
+
+/**
+ * Index the checkpoint of a session that was open when the log was written
+ * (a later checkpoint or the session record replaces it)
+ */
+static void scan_checkpoint(const record_header_t *header, uint32_t record_offset) {
+    if (state_has(header->state, STATE_DELETED)) {
+        return;
+    }
+    entry_t *entry = find_entry(header->session_id);
+    if (entry == NULL) {
+        if (s_entry_count >= SESSION_STORE_MAX_SESSIONS) {
+            drop_oldest_tombstone();
+        }
+        entry = insert_entry(header->session_id);
+        if (entry == NULL) {
+            ESP_LOGW(TAG, "Index full, open session #%lu ignored", (unsigned long)header->session_id);
+            return;
+        }
+        entry->state = ENTRY_OPEN;
+    } else if (entry->state != ENTRY_OPEN) {
+        clear_state_bits(record_offset, STATE_SUPERSEDED);
+        return;
+    } else {
+        clear_state_bits(entry->record_offset, STATE_SUPERSEDED);
+    }
+    entry->record_offset = record_offset;
+}
+
+/**
+ * Scan one used sector: find its end, check CRCs, and either index session
+ * and checkpoint records (pass 0) or count extents (pass 1)
+ */
+static void scan_sector(uint32_t sector, int pass) {
+    uint32_t pos = SECTOR_DATA_START;
+    record_header_t header;
+
+    while (read_record(sector, pos, &header)) {
+        uint32_t record_offset = sector_base(sector) + pos;
+        uint32_t size = RECORD_SIZE(header.length);
+        pos += size;
+
+        if (header.session_id > s_latest_id) {
+            s_latest_id = header.session_id;
+        }
+        if (state_has(header.state, STATE_SUPERSEDED)) {
+            continue;
+        }
+
+        if (pass == 0) {
+            uint32_t crc;
+            if (flash_crc(record_crc_start(&header), record_offset + sizeof(header), header.length, &crc) != ESP_OK ||
+                crc != header.crc) {
+                ESP_LOGW(TAG, "Bad CRC at 0x%lx, record dropped", (unsigned long)record_offset);
+                clear_state_bits(record_offset, STATE_SUPERSEDED);
+                continue;
+            }
+            if (header.type == RECORD_CHECKPOINT) {
+                scan_checkpoint(&header, record_offset);
+                continue;
+            }
+            if (header.type != RECORD_SESSION) {
+                continue;
+            }
+
+            bool deleted = state_has(header.state, STATE_DELETED);
+            entry_t *entry = find_entry(header.session_id);
+            if (entry == NULL) {
+                if (s_entry_count >= SESSION_STORE_MAX_SESSIONS && !deleted) {
+                    drop_oldest_tombstone();
+                }
+                entry = insert_entry(header.session_id);
+                if (entry == NULL) {
+                    if (!deleted) {
+                        ESP_LOGW(TAG, "Index full, session #%lu ignored", (unsigned long)header.session_id);
+                    }
+                    continue;
+                }
+            } else if (entry->state == ENTRY_OPEN) {
+                // Committed after its last checkpoint
+                clear_state_bits(entry->record_offset, STATE_SUPERSEDED);
+            } else {
+                // Copy left behind by an interrupted GC: keep the newer one
+                // with the flags of both
+                uint8_t older_state;
+                flash_read(entry->record_offset, &older_state, 1);
+                clear_state_bits(record_offset, (uint8_t)(~older_state & (STATE_SYNCED | STATE_DELETED)));
+                clear_state_bits(entry->record_offset, STATE_SUPERSEDED);
+                flash_read(record_offset, &header.state, 1);
+            }
+            entry->record_offset = record_offset;
+            entry->state = state_has(header.state, STATE_DELETED) ? ENTRY_TOMBSTONE : ENTRY_LIVE;
+        } else if (is_extent(header.type)) {
+            entry_t *entry = find_entry(header.session_id);
+            if (entry != NULL) {
+                entry->extent_bytes += size;
+                if (header.offset == 0 && !state_has(header.state, STATE_SUPERSEDED)) {
+                    entry->first_sector = (uint16_t)sector;
+                }
+            }
+        }
+    }
+
+    if (pass == 0) {
+        // Data ends at an erased header; anything else is a torn write and
+        // the sector takes no more records
+        s_sectors[sector].write_offset = is_erased(sector, pos) ? (uint16_t)pos : STORE_SECTOR_SIZE;
+    }
+}
+
+static esp_err_t mount(void) {
+    s_sector_count = s_partition->size / STORE_SECTOR_SIZE;
+    if (s_sectors == NULL) {
+        s_sectors = heap_caps_calloc(s_sector_count, sizeof(sector_info_t), MALLOC_CAP_8BIT);
+        s_order = heap_caps_calloc(s_sector_count, sizeof(uint16_t), MALLOC_CAP_8BIT);
+        if (s_sectors == NULL || s_order == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    s_entry_count = 0;
+    s_latest_id = 0;
+    s_head = -1;
+    s_next_sequence = 0;
+    s_order_dirty = true;
+    memset(&s_cursor, 0, sizeof(s_cursor));
+
+    // Sector headers
+    uint32_t max_erase = 0;
+    uint32_t unknown = 0;
+    for (uint32_t s = 0; s < s_sector_count; s++) {
+        sector_header_t header;
+        sector_info_t *info = &s_sectors[s];
+        memset(info, 0, sizeof(*info));
+        if (flash_read(sector_base(s), &header, sizeof(header)) != ESP_OK ||
+            memcmp(header.magic, STORE_MAGIC, sizeof(header.magic)) != 0 ||
+            header.version != STORE_FORMAT_VERSION || header.header_size != sizeof(header)) {
+            // Blank, foreign, cleared or half-erased: erase before use
+            info->state = SECTOR_DIRTY;
+            info->erase_count = UINT32_MAX;
+            unknown++;
+            continue;
+        }
+        info->erase_count = header.erase_count;
+        if (header.erase_count > max_erase) {
+            max_erase = header.erase_count;
+        }
+        if (header.sequence == SEQUENCE_FREE) {
+            info->state = SECTOR_FREE;
+            info->write_offset = SECTOR_DATA_START;
+        } else {
+            info->state = SECTOR_USED;
+            info->sequence = header.sequence;
+            if (header.sequence >= s_next_sequence) {
+                s_next_sequence = header.sequence + 1;
+            }
+        }
+    }
+    // Assume sectors of unknown wear are as worn as the worst known one
+    for (uint32_t s = 0; s < s_sector_count; s++) {
+        if (s_sectors[s].erase_count == UINT32_MAX) {
+            s_sectors[s].erase_count = max_erase;
+        }
+    }
+
+    // Records, oldest sector first
+    refresh_order();
+    for (int pass = 0; pass < 2; pass++) {
+        for (uint32_t i = 0; i < s_order_count; i++) {
+            scan_sector(s_order[i], pass);
+        }
+    }
+
+    // Tombstones without extents left are garbage (but the newest one holds
+    // on to its id)
+    for (uint32_t i = 0; i < s_entry_count; ) {
+        if (s_entries[i].state == ENTRY_TOMBSTONE && s_entries[i].extent_bytes == 0 &&
+            s_entries[i].session_id != s_latest_id) {
+            remove_entry(&s_entries[i]);
+        } else {
+            i++;
+        }
+    }
+
+    // Keep appending to the newest sector if it has room
+    if (s_order_count > 0) {
+        uint32_t newest = s_order[s_order_count - 1];
+        if (s_sectors[newest].write_offset < STORE_SECTOR_SIZE) {
+            s_head = (int32_t)newest;
+        }
+    }
+
+    uint32_t live = 0;
+    uint32_t open = 0;
+    for (uint32_t i = 0; i < s_entry_count; i++) {
+        live += s_entries[i].state == ENTRY_LIVE;
+        open += s_entries[i].state == ENTRY_OPEN;
+    }
+    ESP_LOGI(TAG, "Mounted: %lu sectors (%lu in log, %lu free, %lu unformatted), %lu sessions, %lu open",
+             (unsigned long)s_sector_count, (unsigned long)s_order_count,
+             (unsigned long)(s_sector_count - s_order_count - unknown), (unsigned long)unknown,
+             (unsigned long)live, (unsigned long)open);
+    return ESP_OK;
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+esp_err_t session_store_init(void) {
+    s_partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY,
+                                           SESSION_STORE_PARTITION_LABEL);
+    if (s_partition == NULL) {
+        ESP_LOGE(TAG, "No '%s' partition, sessions cannot be stored", SESSION_STORE_PARTITION_LABEL);
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (s_mutex == NULL) {
+        s_mutex = xSemaphoreCreateMutex();
+        if (s_mutex == NULL) {
+            return ESP_FAIL;
+        }
+    }
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    memset(&s_stats, 0, sizeof(s_stats));
+    esp_err_t ret = mount();
+    s_ready = ret == ESP_OK;
+    xSemaphoreGive(s_mutex);
+    return ret;
+}
+
+bool session_store_is_ready(void) {
+    return s_ready;
+}
+
+esp_err_t session_store_format(void) {
+    if (!s_ready) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+
+    // Tombstone every session first, so a power cut part-way through
+    // leaves deleted sessions rather than partial ones
+    for (uint32_t i = 0; i < s_entry_count; i++) {
+        if (s_entries[i].record_offset != NO_OFFSET) {
+            clear_state_bits(s_entries[i].record_offset, STATE_DELETED);
+        }
+    }
+
+    // Invalidate the headers of used sectors (cleared bits, no erase); they
+    // are erased when next opened
+    static const char cleared_magic[4] = {0};
+    esp_err_t ret = ESP_OK;
+    for (uint32_t s = 0; s < s_sector_count && ret == ESP_OK; s++) {
+        if (s_sectors[s].state == SECTOR_USED) {
+            ret = flash_write(sector_base(s), cleared_magic, sizeof(cleared_magic));
+            s_sectors[s].state = SECTOR_DIRTY;
+        }
+    }
+
+    s_entry_count = 0;
+    s_latest_id = 0;
+    s_head = -1;
+    s_order_dirty = true;
+    s_cursor.valid = false;
+    xSemaphoreGive(s_mutex);
+
+    ESP_LOGI(TAG, "Store cleared");
+    return ret;
+}
+
+esp_err_t session_store_begin(uint32_t session_id) {
+    if (!s_ready) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+
+    esp_err_t ret = ESP_OK;
+    if (session_id == 0 || find_entry(session_id) != NULL) {
+        ret = ESP_ERR_INVALID_ARG;
+    } else {
+        // Index full: drop the oldest tombstone, else the oldest session
+        while (s_entry_count >= SESSION_STORE_MAX_SESSIONS) {
+            if (!drop_oldest_tombstone() && !evict_oldest()) {
+                ret = ESP_ERR_NO_MEM;
+                break;
+            }
+        }
+    }
+    if (ret == ESP_OK) {
+        insert_entry(session_id)->state = ENTRY_OPEN;
+        if (session_id > s_latest_id) {
+            s_latest_id = session_id;
+        }
+    }
+
+    xSemaphoreGive(s_mutex);
+    return ret;
+}
+
+esp_err_t session_store_append(uint32_t session_id, session_store_stream_t stream,
+                               uint32_t offset, const void *data, uint32_t len) {
+    if (!s_ready) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+
+    esp_err_t ret = ESP_OK;
+    const uint8_t *bytes = data;
+    while (len > 0) {
+        entry_t *entry = find_entry(session_id);
+        if (entry == NULL || entry->state != ENTRY_OPEN) {
+            ret = ESP_ERR_INVALID_STATE;
+            break;
+        }
+
+        // Fill the head sector, but start a new one rather than a tiny extent
+        uint32_t want = len < MIN_EXTENT_BYTES ? len : MIN_EXTENT_BYTES;
+        ret = ensure_room(want, false);
+        if (ret != ESP_OK) {
+            break;
+        }
+        uint32_t n = head_room();
+        if (n > len) {
+            n = len;
+        }
+
+        record_header_t header = {
+            .type = (uint8_t)stream,
+            .length = (uint16_t)n,
+            .session_id = session_id,
+            .offset = offset,
+        };
+        header.crc = esp_rom_crc32_le(record_crc_start(&header), bytes, n);
+        ret = program_record(&header, bytes, 0, (uint8_t)~STATE_COMMITTED, NULL);
+        if (ret != ESP_OK) {
+            break;
+        }
+
+        // ensure_room() may have moved entries around
+        entry = find_entry(session_id);
+        entry->extent_bytes += RECORD_SIZE(n);
+        if (offset == 0) {
+            entry->first_sector = (uint16_t)s_head;
+        }
+        s_stats.bytes_appended += n;
+        bytes += n;
+        offset += n;
+        len -= n;
+    }
+
+    xSemaphoreGive(s_mutex);
+    return ret;
+}
+
+/**
+ * Write the checkpoint or the final session record of an open session; the
+ * previous checkpoint is superseded once the new record is committed
+ */
+static esp_err_t write_summary(uint8_t type, const session_record_t *record) {
+    entry_t *entry = find_entry(record->session_id);
+    if (entry == NULL || entry->state != ENTRY_OPEN) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    esp_err_t ret = ensure_room(sizeof(*record), false);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    record_header_t header = {
+        .type = type,
+        .length = sizeof(*record),
+        .session_id = record->session_id,
+        .offset = 0,
+    };
+    header.crc = esp_rom_crc32_le(record_crc_start(&header), (const uint8_t *)record, sizeof(*record));
+    uint8_t state = (uint8_t)~STATE_COMMITTED;
+    if (type == RECORD_SESSION && record->synced) {
+        state &= (uint8_t)~STATE_SYNCED;
+    }
+    uint32_t record_offset;
+    ret = program_record(&header, record, 0, state, &record_offset);
+
+    // GC may have moved entries and the old checkpoint
+    entry = find_entry(record->session_id);
+    if (ret == ESP_OK && entry != NULL) {
+        if (entry->record_offset != NO_OFFSET) {
+            clear_state_bits(entry->record_offset, STATE_SUPERSEDED);
+        }
+        entry->record_offset = record_offset;
+        if (type == RECORD_SESSION) {
+            entry->state = ENTRY_LIVE;
+        }
+        s_stats.bytes_appended += sizeof(*record);
+    }
+    return ret;
+}
+
+esp_err_t session_store_checkpoint(const session_record_t *record) {
+    if (!s_ready) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    esp_err_t ret = write_summary(RECORD_CHECKPOINT, record);
+    if (ret == ESP_OK) {
+        s_stats.checkpoints++;
+    }
+    xSemaphoreGive(s_mutex);
+    return ret;
+}
+
+esp_err_t session_store_commit(const session_record_t *record) {
+    if (!s_ready) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    esp_err_t ret = write_summary(RECORD_SESSION, record);
+    xSemaphoreGive(s_mutex);
+    return ret;
+}
+
+void session_store_abandon(uint32_t session_id) {
+    if (!s_ready) {
+        return;
+    }
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    entry_t *entry = find_entry(session_id);
+    if (entry != NULL && entry->state == ENTRY_OPEN) {
+        // A deleted checkpoint keeps mount from reopening the session
+        if (entry->record_offset != NO_OFFSET) {
+            clear_state_bits(entry->record_offset, STATE_DELETED);
+        }
+        remove_entry(entry);
+    }
+    xSemaphoreGive(s_mutex);
+}
+
+esp_err_t session_store_get_checkpoint(uint32_t session_id, session_record_t *record) {
+    if (!s_ready) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+
+    esp_err_t ret = ESP_ERR_NOT_FOUND;
+    const entry_t *entry = find_entry(session_id);
+    if (entry != NULL && entry->state == ENTRY_OPEN && entry->record_offset != NO_OFFSET) {
+        ret = flash_read(entry->record_offset + sizeof(record_header_t), record, sizeof(*record));
+    }
+
+    xSemaphoreGive(s_mutex);
+    return ret;
+}
+
+esp_err_t session_store_get(uint32_t session_id, session_record_t *record) {
+    if (!s_ready) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+
+    esp_err_t ret = ESP_ERR_NOT_FOUND;
+    const entry_t *entry = find_entry(session_id);
+    if (entry != NULL && entry->state == ENTRY_LIVE) {
+        record_header_t header;
+        ret = flash_read(entry->record_offset, &header, sizeof(header));
+        if (ret == ESP_OK) {
+            ret = flash_read(entry->record_offset + sizeof(header), record, sizeof(*record));
+        }
+        if (ret == ESP_OK) {
+            // The in-place flag is authoritative
+            record->synced = state_has(header.state, STATE_SYNCED) ? 1 : 0;
+        }
+    }
+
+    xSemaphoreGive(s_mutex);
+    return ret;
+}
+
+/**
+ * Find the extent holding a stream offset, resuming after the last one found
+ * or else at the session's first extent
+ */
+static bool find_extent(const entry_t *entry, uint8_t type, uint32_t offset) {
+    uint32_t session_id = entry->session_id;
+    read_cursor_t *c = &s_cursor;
+    if (c->valid && c->session_id == session_id && c->type == type &&
+        offset >= c->stream_offset && offset < c->stream_offset + c->length) {
+        return true;
+    }
+
+    refresh_order();
+    if (s_order_count == 0) {
+        return false;
+    }
+
+    // Extents of a session follow each other in log order, so start right
+    // after the last one and wrap around once
+    bool resume = c->valid && c->session_id == session_id && c->type == type;
+    uint32_t start_sector = resume ? c->sector : entry->first_sector;
+    uint32_t start = 0;
+    uint32_t start_pos = SECTOR_DATA_START;
+    for (uint32_t i = 0; i < s_order_count; i++) {
+        if (s_order[i] == start_sector) {
+            start = i;
+            start_pos = resume ? c->next_record : SECTOR_DATA_START;
+            break;
+        }
+    }
+
+    for (uint32_t step = 0; step <= s_order_count; step++) {
+        uint32_t sector = s_order[(start + step) % s_order_count];
+        uint32_t pos = step == 0 ? start_pos : SECTOR_DATA_START;
+        uint32_t end = s_sectors[sector].write_offset;
+        if (step == s_order_count) {
+            end = start_pos;        // Rest of the first sector
+        }
+
+        record_header_t header;
+        while (pos < end && read_record(sector, pos, &header)) {
+            uint32_t size = RECORD_SIZE(header.length);
+            if (header.session_id == session_id && header.type == type &&
+                !state_has(header.state, STATE_SUPERSEDED) &&
+                offset >= header.offset && offset < header.offset + header.length) {
+                c->valid = true;
+                c->session_id = session_id;
+                c->type = type;
+                c->stream_offset = header.offset;
+                c->length = header.length;
+                c->payload_offset = sector_base(sector) + pos + sizeof(header);
+                c->sector = sector;
+                c->next_record = pos + size;
+                return true;
+            }
+            pos += size;
+        }
+    }
+    return false;
+}
+
+esp_err_t session_store_read(uint32_t session_id, session_store_stream_t stream, uint32_t offset,
+                             void *buffer, uint32_t len, uint32_t *bytes_read) {
+    *bytes_read = 0;
+    if (!s_ready) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+
+    esp_err_t ret = ESP_OK;
+    const entry_t *entry = find_entry(session_id);
+    if (entry == NULL || entry->state == ENTRY_TOMBSTONE) {
+        ret = ESP_ERR_NOT_FOUND;
+    }
+
+    uint8_t *out = buffer;
+    while (ret == ESP_OK && len > 0 && find_extent(entry, (uint8_t)stream, offset)) {
+        uint32_t skip = offset - s_cursor.stream_offset;
+        uint32_t n = s_cursor.length - skip;
+        if (n > len) {
+            n = len;
+        }
+        ret = flash_read(s_cursor.payload_offset + skip, out, n);
+        out += n;
+        offset += n;
+        len -= n;
+        *bytes_read += n;
+    }
+
+    xSemaphoreGive(s_mutex);
+    return ret;
+}
+
+esp_err_t session_store_set_synced(uint32_t session_id) {
+    if (!s_ready) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+
+    esp_err_t ret = ESP_ERR_NOT_FOUND;
+    const entry_t *entry = find_entry(session_id);
+    if (entry != NULL && entry->state == ENTRY_LIVE) {
+        ret = clear_state_bits(entry->record_offset, STATE_SYNCED);
+    }
+
+    xSemaphoreGive(s_mutex);
+    return ret;
+}
+
+esp_err_t session_store_delete(uint32_t session_id) {
+    if (!s_ready) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+
+    esp_err_t ret = ESP_ERR_NOT_FOUND;
+    entry_t *entry = find_entry(session_id);
+    if (entry != NULL && entry->state == ENTRY_LIVE) {
+        ret = delete_entry(entry);
+    }
+
+    xSemaphoreGive(s_mutex);
+    return ret;
+}
+
+uint32_t session_store_list(uint32_t *ids, uint32_t max_ids) {
+    if (!s_ready) {
+        return 0;
+    }
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < s_entry_count && count < max_ids; i++) {
+        if (s_entries[i].state == ENTRY_LIVE) {
+            ids[count++] = s_entries[i].session_id;
+        }
+    }
+    xSemaphoreGive(s_mutex);
+    return count;
+}
+
+uint32_t session_store_list_open(uint32_t *ids, uint32_t max_ids) {
+    if (!s_ready) {
+        return 0;
+    }
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < s_entry_count && count < max_ids; i++) {
+        if (s_entries[i].state == ENTRY_OPEN) {
+            ids[count++] = s_entries[i].session_id;
+        }
+    }
+    xSemaphoreGive(s_mutex);
+    return count;
+}
+
+uint32_t session_store_latest_id(void) {
+    return s_latest_id;
+}
+
+void session_store_get_stats(session_store_stats_t *stats) {
+    memset(stats, 0, sizeof(*stats));
+    if (!s_ready) {
+        return;
+    }
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    *stats = s_stats;
+    stats->sectors = s_sector_count;
+    stats->free_sectors = free_sector_count();
+    // Sectors GC keeps in reserve are not for appends; the head sector's
+    // free space is
+    uint32_t appendable = stats->free_sectors > GC_RESERVE_SECTORS ? stats->free_sectors - GC_RESERVE_SECTORS : 0;
+    stats->bytes_free = appendable * RECORD_MAX_PAYLOAD + head_room();
+    stats->bytes_capacity = (s_sector_count > GC_RESERVE_SECTORS ? s_sector_count - GC_RESERVE_SECTORS : 0) *
+                            RECORD_MAX_PAYLOAD;
+    stats->min_erase_count = UINT32_MAX;
+    for (uint32_t s = 0; s < s_sector_count; s++) {
+        if (s_sectors[s].erase_count < stats->min_erase_count) {
+            stats->min_erase_count = s_sectors[s].erase_count;
+        }
+        if (s_sectors[s].erase_count > stats->max_erase_count) {
+            stats->max_erase_count = s_sectors[s].erase_count;
+        }
+    }
+    for (uint32_t i = 0; i < s_entry_count; i++) {
+        stats->sessions += s_entries[i].state == ENTRY_LIVE;
+    }
+    xSemaphoreGive(s_mutex);
+}
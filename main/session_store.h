@@ -0,0 +1,179 @@
+/**
+ * @file session_store.h
+ * @brief Log-structured session store on the `storage` flash partition
+ *
+ * Sessions are appended to a log of 4 KB sectors instead of NVS blobs:
+ * - Every sector starts with a header holding its position in the log
+ *   (sequence) and how often it has been erased.
+ * - Records never span sectors. A record is a 16-byte header (type,
+ *   length, session id, stream offset, CRC) plus payload, and becomes
+ *   valid only when its state byte is programmed after the payload, so a
+ *   power cut never leaves a half-written record that reads as valid.
+ * - A session is a run of data extents (the per-second samples as a byte
+ *   stream, split across records) followed by one session record holding
+ *   the session_record_t summary. While it is being written, checkpoint
+ *   records hold the summary so far; after a power cut the session is
+ *   still open at mount and can be committed from its last checkpoint.
+ * - Delete and synced are bits cleared in place in the session record's
+ *   state byte (NOR flash can clear bits without an erase). A deleted
+ *   session record stays as a tombstone until the last of its extents has
+ *   been erased (the newest one stays for good, so its id is not reused).
+ * - Garbage collection copies the live records of the emptiest sector to
+ *   the head of the log and erases it. New sectors are taken least-worn
+ *   first, and a sector holding cold data is moved once it lags the most
+ *   worn sector by SESSION_STORE_WEAR_DELTA erases.
+ * - When the log is full, the oldest session is dropped, like the old
+ *   fixed NVS slots.
+ *
+ * RAM holds 12 bytes per sector and a small per-session index; samples are
+ * read straight from flash in slices.
+ */
+
+#ifndef SESSION_STORE_H
+#define SESSION_STORE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "rowing_physics.h"
+
+// Partition label (see partitions.csv)
+#define SESSION_STORE_PARTITION_LABEL   "storage"
+
+// Sessions tracked by the index (including tombstones awaiting collection)
+#define SESSION_STORE_MAX_SESSIONS      64
+
+// Erase count gap that triggers moving cold data off a little-worn sector
+#define SESSION_STORE_WEAR_DELTA        64
+
+/**
+ * Data streams stored per session
+ */
+typedef enum {
+    SESSION_STORE_STREAM_SAMPLE_PAGES = 3,  // sample_codec pages of sample_data_t, 1 per second
+    SESSION_STORE_STREAM_10HZ_PAGES = 4,    // sample_codec pages of sample_10hz_t
+    SESSION_STORE_STREAM_PULSE_PAGES = 5,   // sample_codec pages of sample_pulse_t
+    SESSION_STORE_STREAM_STROKE_PAGES = 6,  // sample_codec pages of stroke_record_t
+} session_store_stream_t;
+
+// Flash taken per append besides its payload (record header, alignment)
+#define SESSION_STORE_APPEND_OVERHEAD   20
+
+/**
+ * Store counters
+ */
+typedef struct {
+    uint32_t sectors;               // Sectors in the partition
+    uint32_t free_sectors;          // Erased or erasable sectors
+    uint32_t bytes_free;            // Payload that fits without dropping a session
+    uint32_t bytes_capacity;        // Payload that fits once every other session is dropped
+    uint32_t sessions;              // Live sessions
+    uint32_t bytes_appended;        // Payload bytes handed to the store
+    uint32_t bytes_programmed;      // Flash bytes programmed (headers, GC copies included)
+    uint32_t gc_runs;               // Sectors reclaimed
+    uint32_t gc_bytes_copied;       // Live record bytes moved by GC
+    uint32_t wear_moves;            // GC runs forced by wear levelling
+    uint32_t sessions_evicted;      // Oldest sessions dropped to make room
+    uint32_t checkpoints;           // Checkpoints of open sessions written
+    uint32_t min_erase_count;
+    uint32_t max_erase_count;
+} session_store_stats_t;
+
+/**
+ * Mount the store (scan the log, rebuild the index, repair interrupted GC)
+ * Can be called again to remount.
+ * @return ESP_ERR_NOT_FOUND if the partition does not exist
+ */
+esp_err_t session_store_init(void);
+
+/**
+ * Whether the store is mounted
+ */
+bool session_store_is_ready(void);
+
+/**
+ * Erase every session
+ */
+esp_err_t session_store_format(void);
+
+/**
+ * Open a session for appends (its extents are kept by GC until committed)
+ * @param session_id Newer than every id in the store
+ */
+esp_err_t session_store_begin(uint32_t session_id);
+
+/**
+ * Append bytes to a stream of the open session
+ * @param offset Stream offset of the first byte (streams are written in order)
+ */
+esp_err_t session_store_append(uint32_t session_id, session_store_stream_t stream,
+                               uint32_t offset, const void *data, uint32_t len);
+
+/**
+ * Record the summary of an open session so far (replaces the previous
+ * checkpoint). Sessions with a checkpoint survive a power cut as open.
+ */
+esp_err_t session_store_checkpoint(const session_record_t *record);
+
+/**
+ * Write the session record and close the session
+ */
+esp_err_t session_store_commit(const session_record_t *record);
+
+/**
+ * Drop an open session (its extents become garbage)
+ */
+void session_store_abandon(uint32_t session_id);
+
+/**
+ * Get the last checkpoint of an open session
+ * @return ESP_ERR_NOT_FOUND if not open or never checkpointed
+ */
+esp_err_t session_store_get_checkpoint(uint32_t session_id, session_record_t *record);
+
+/**
+ * Open sessions: being written, or interrupted by a reset (found at mount)
+ * @return Number of ids written, oldest first
+ */
+uint32_t session_store_list_open(uint32_t *ids, uint32_t max_ids);
+
+/**
+ * Get the summary of a committed session
+ * @return ESP_ERR_NOT_FOUND if unknown or deleted
+ */
+esp_err_t session_store_get(uint32_t session_id, session_record_t *record);
+
+/**
+ * Read stream bytes of a committed or open session
+ * @param bytes_read Out: bytes copied (less than len at the end of the stream)
+ */
+esp_err_t session_store_read(uint32_t session_id, session_store_stream_t stream, uint32_t offset,
+                             void *buffer, uint32_t len, uint32_t *bytes_read);
+
+/**
+ * Mark a session as synced
+ */
+esp_err_t session_store_set_synced(uint32_t session_id);
+
+/**
+ * Delete a session
+ */
+esp_err_t session_store_delete(uint32_t session_id);
+
+/**
+ * Live session ids, oldest first
+ * @return Number of ids written
+ */
+uint32_t session_store_list(uint32_t *ids, uint32_t max_ids);
+
+/**
+ * Highest session id ever seen in the log (0 if empty)
+ */
+uint32_t session_store_latest_id(void);
+
+/**
+ * Get store counters
+ */
+void session_store_get_stats(session_store_stats_t *stats);
+
+#endif // SESSION_STORE_H
@@ -11,7 +11,6 @@
 #include "stroke_detector.h"
 #include "app_config.h"
 #include "esp_log.h"
-#include "esp_timer.h"
 
 static const char *TAG = "STROKE";
 
@@ -42,11 +41,13 @@ void stroke_detector_init(const config_t *config) {
  * Update stroke phase detection
  * Called when new flywheel data is available
  */
-void stroke_detector_update(rowing_metrics_t *metrics) {
+uint32_t stroke_detector_update(rowing_metrics_t *metrics) {
+    uint32_t events = 0;
     float omega = metrics->angular_velocity_rad_s;
     float alpha = metrics->angular_acceleration_rad_s2;
     stroke_phase_t current_phase = metrics->current_phase;
-    int64_t now = esp_timer_get_time();
+    // Phase boundaries are stamped with the pulse that triggered this update
+    int64_t now = metrics->last_flywheel_time_us;
     
     switch (current_phase) {
         case STROKE_PHASE_IDLE:
@@ -56,6 +57,7 @@ void stroke_detector_update(rowing_metrics_t *metrics) {
                 metrics->current_phase = STROKE_PHASE_DRIVE;
                 metrics->last_stroke_start_time_us = now;
                 metrics->peak_velocity_in_stroke = omega;
+                events |= EVENT_BUS_CATCH;
                 metrics->drive_phase_work_joules = 0;
                 metrics->display_power_watts = 0;  // Reset display power for new stroke
                 ESP_LOGD(TAG, "Drive phase started (ω=%.1f, α=%.1f)", omega, alpha);
@@ -74,6 +76,7 @@ void stroke_detector_update(rowing_metrics_t *metrics) {
                 // Velocity peaked and now decreasing → end of drive
                 metrics->current_phase = STROKE_PHASE_RECOVERY;
                 metrics->last_stroke_end_time_us = now;
+                events |= EVENT_BUS_FINISH;
                 
                 uint32_t drive_duration_ms = (uint32_t)((now - metrics->last_stroke_start_time_us) / 1000);
                 metrics->drive_phase_duration_ms = drive_duration_ms;
@@ -81,6 +84,7 @@ void stroke_detector_update(rowing_metrics_t *metrics) {
                 // Increment stroke count if duration is valid
                 if (drive_duration_ms >= MINIMUM_STROKE_DURATION_MS) {
                     metrics->stroke_count++;
+                    events |= EVENT_BUS_STROKE;
                     
                     // Calculate stroke rate
                     stroke_detector_calculate_stroke_rate(metrics);
@@ -124,25 +128,29 @@ void stroke_detector_update(rowing_metrics_t *metrics) {
                 uint32_t recovery_duration_ms = (uint32_t)((now - metrics->last_stroke_end_time_us) / 1000);
                 metrics->recovery_phase_duration_ms = recovery_duration_ms;
                 
-                // Start new stroke
+                // Start new stroke (work keeps accumulating from the end of the
+                // last drive, see rowing_physics accumulate_pulse_work)
                 metrics->last_stroke_start_time_us = now;
                 metrics->peak_velocity_in_stroke = omega;
-                metrics->drive_phase_work_joules = 0;
                 metrics->display_power_watts = 0;  // Reset display power for new stroke
+                events |= EVENT_BUS_CATCH;
                 
                 ESP_LOGD(TAG, "New drive phase started (ω=%.1f, α=%.1f)", omega, alpha);
             }
             break;
     }
+    
+    return events;
 }
 
 /**
  * Process seat sensor trigger
  * The seat sensor triggers when the seat passes the mid-rail position
  */
-void stroke_detector_process_seat_trigger(rowing_metrics_t *metrics) {
+uint32_t stroke_detector_process_seat_trigger(rowing_metrics_t *metrics, int64_t timestamp_us) {
+    uint32_t events = 0;
     stroke_phase_t current_phase = metrics->current_phase;
-    int64_t now = esp_timer_get_time();
+    int64_t now = timestamp_us;
     
     // Seat trigger at mid-rail typically indicates drive phase
     // Use it to confirm or force drive phase detection
@@ -160,13 +168,18 @@ void stroke_detector_process_seat_trigger(rowing_metrics_t *metrics) {
             }
             
             metrics->last_stroke_start_time_us = now;
-            metrics->drive_phase_work_joules = 0;
+            if (current_phase == STROKE_PHASE_IDLE) {
+                metrics->drive_phase_work_joules = 0;
+            }
             
+            events |= EVENT_BUS_CATCH;
             ESP_LOGD(TAG, "Drive phase confirmed by seat sensor");
         }
     }
     
     metrics->seat_trigger_count++;
+    metrics->last_seat_time_us = timestamp_us;
+    return events;
 }
 
 /**
@@ -201,7 +214,7 @@ void stroke_detector_calculate_stroke_rate(rowing_metrics_t *metrics) {
     }
     
     // Calculate average stroke rate for entire session
-    int64_t elapsed_us = esp_timer_get_time() - metrics->session_start_time_us;
+    int64_t elapsed_us = metrics->last_stroke_end_time_us - metrics->session_start_time_us;
     float elapsed_min = (float)elapsed_us / 60000000.0f;
     if (elapsed_min > 0.1f) {
         metrics->avg_stroke_rate_spm = (float)metrics->stroke_count / elapsed_min;
@@ -7,6 +7,7 @@
 #define STROKE_DETECTOR_H
 
 #include "rowing_physics.h"
+#include "event_bus.h"
 
 /**
  * Initialize stroke detector with configuration
@@ -16,20 +17,27 @@ void stroke_detector_init(const config_t *config);
 
 /**
  * Update stroke phase detection
- * Called continuously from main rowing task
+ * Called from the sensor task after each flywheel pulse. Phase boundaries
+ * are timestamped with metrics->last_flywheel_time_us (the pulse's ISR time).
  * @param metrics Pointer to metrics structure
+ * @return Stroke events of this pulse (EVENT_BUS_CATCH / FINISH / STROKE);
+ *         the caller publishes them once the snapshot holds the pulse
  */
-void stroke_detector_update(rowing_metrics_t *metrics);
+uint32_t stroke_detector_update(rowing_metrics_t *metrics);
 
 /**
  * Process seat sensor trigger
  * Called from sensor task when seat sensor activates
  * @param metrics Pointer to metrics structure
+ * @param timestamp_us ISR timestamp of the trigger
+ * @return EVENT_BUS_CATCH if the trigger started a drive, else 0
  */
-void stroke_detector_process_seat_trigger(rowing_metrics_t *metrics);
+uint32_t stroke_detector_process_seat_trigger(rowing_metrics_t *metrics, int64_t timestamp_us);
 
 /**
  * Calculate stroke rate (strokes per minute)
+ * Uses the stroke timestamps in metrics, so it must be called after
+ * last_stroke_end_time_us is set for the completed stroke.
  * @param metrics Pointer to metrics structure
  */
 void stroke_detector_calculate_stroke_rate(rowing_metrics_t *metrics);
@@ -0,0 +1,338 @@
+/**
+ * @file stroke_record.c
+ * @brief Per-stroke records with the force curve of the drive
+ */
+
+#include "stroke_record.h"
+#include "record_ring.h"
+#include "session_sampler.h"
+#include "event_bus.h"
+#include "app_config.h"
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+
+// Torque points kept per drive (a drive at 4 magnets takes 40-80 pulses)
+#define MAX_POINTS              128
+
+// Longest session clock a record holds (24 bits)
+#define MAX_FINISH_MS           0xFFFFFF
+
+_Static_assert((SESSION_STROKE_RING_RECORDS & (SESSION_STROKE_RING_RECORDS - 1)) == 0,
+               "SESSION_STROKE_RING_RECORDS must be a power of two");
+
+typedef struct {
+    uint32_t time_us;                   // Since the catch
+    float torque;                       // N·m
+} curve_point_t;
+
+// Drive in progress (sensor task)
+static bool s_in_drive = false;
+static int64_t s_catch_us = 0;
+static curve_point_t s_points[MAX_POINTS];
+static uint32_t s_point_count = 0;
+static uint32_t s_stride = 1;           // Pulses per point kept
+static uint32_t s_skip = 0;             // Pulses to skip before the next point
+static float s_peak_power = 0;
+static float s_peak_torque = 0;
+
+// Stroke cycle: recovery before the drive, work since it began
+static int64_t s_last_finish_us = 0;    // Previous counted stroke (0 = none)
+static uint32_t s_recovery_ms = 0;
+static float s_work_start_j = 0;
+
+// Latest stroke, sequence locked (odd while written)
+static atomic_uint_fast32_t s_latest_sequence;
+static stroke_record_t s_latest;
+static uint32_t s_stroke_total = 0;
+
+// Ring of the session's strokes: the sensor task writes at head, the storage task reads at tail
+static stroke_record_t s_slots[SESSION_STROKE_RING_RECORDS];
+static record_ring_t s_ring;
+static bool s_recording = false;
+static bool s_latest_queued = false;    // The latest stroke is in a session
+
+/**
+ * Make a record the latest stroke (writer side of the sequence lock)
+ */
+static void publish(const stroke_record_t *record) {
+    uint32_t sequence = (uint32_t)atomic_load_explicit(&s_latest_sequence, memory_order_relaxed);
+
+    atomic_store_explicit(&s_latest_sequence, sequence + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    s_latest = *record;
+    s_stroke_total++;
+
+    atomic_store_explicit(&s_latest_sequence, sequence + 2, memory_order_release);
+}
+
+/**
+ * A catch: start collecting the drive
+ */
+static void start_drive(const rowing_metrics_t *metrics) {
+    s_in_drive = true;
+    s_catch_us = metrics->last_stroke_start_time_us;
+    s_point_count = 0;
+    s_stride = 1;
+    s_skip = 0;
+    s_peak_power = 0;
+    s_peak_torque = 0;
+
+    // After a rest (or the first stroke) the cycle is the drive alone
+    int64_t gap_us = s_catch_us - s_last_finish_us;
+    if (s_last_finish_us == 0 || gap_us < 0 || gap_us > IDLE_TIMEOUT_MS * 1000LL) {
+        s_recovery_ms = 0;
+        s_work_start_j = metrics->total_work_joules;
+    } else {
+        s_recovery_ms = (uint32_t)(gap_us / 1000);
+    }
+}
+
+/**
+ * Add the torque at a drive pulse; once the buffer is full every other
+ * point is dropped and pulses are taken half as often
+ */
+static void add_point(const rowing_metrics_t *metrics) {
+    float omega = metrics->angular_velocity_rad_s;
+    float torque = metrics->moment_of_inertia * metrics->angular_acceleration_rad_s2 +
+                   metrics->drag_coefficient * omega * omega;
+    if (torque > s_peak_torque) {
+        s_peak_torque = torque;
+    }
+    if (metrics->instantaneous_power_watts > s_peak_power) {
+        s_peak_power = metrics->instantaneous_power_watts;
+    }
+
+    if (s_skip > 0) {
+        s_skip--;
+        return;
+    }
+    if (s_point_count == MAX_POINTS) {
+        for (uint32_t i = 0; i < MAX_POINTS / 2; i++) {
+            s_points[i] = s_points[2 * i];
+        }
+        s_point_count = MAX_POINTS / 2;
+        s_stride *= 2;
+    }
+
+    int64_t time_us = metrics->last_flywheel_time_us - s_catch_us;
+    s_points[s_point_count].time_us = time_us > 0 ? (uint32_t)time_us : 0;
+    s_points[s_point_count].torque = torque;
+    s_point_count++;
+    s_skip = s_stride - 1;
+}
+
+/**
+ * Resample the drive's torque to the curve points, linear in time
+ */
+static void resample_curve(uint32_t drive_us, uint8_t *curve) {
+    float scale = s_peak_torque > 0 ? 255.0f / s_peak_torque : 0;
+    uint32_t j = 0;
+
+    for (uint32_t i = 0; i < STROKE_CURVE_POINTS; i++) {
+        float t = (float)drive_us * (float)i / (float)(STROKE_CURVE_POINTS - 1);
+        while (j + 1 < s_point_count && (float)s_points[j + 1].time_us <= t) {
+            j++;
+        }
+
+        float torque = 0;
+        if (s_point_count > 0) {
+            const curve_point_t *a = &s_points[j];
+            torque = a->torque;
+            if (j + 1 < s_point_count && t > (float)a->time_us) {
+                const curve_point_t *b = &s_points[j + 1];
+                float f = (t - (float)a->time_us) / (float)(b->time_us - a->time_us);
+                torque = a->torque + (b->torque - a->torque) * f;
+            }
+        }
+        curve[i] = session_sampler_to_u8(torque * scale);
+    }
+}
+
+/**
+ * A counted stroke's finish: build its record
+ */
+static void finish_stroke(const rowing_metrics_t *metrics) {
+    int64_t finish_us = metrics->last_stroke_end_time_us;
+    stroke_record_t record;
+    memset(&record, 0, sizeof(record));
+
+    // Session clock: stands still while paused, like elapsed_time_ms
+    uint32_t finish_ms = 0;
+    if (metrics->session_start_time_us != 0) {
+        if (metrics->is_paused) {
+            finish_ms = metrics->elapsed_time_ms;
+        } else if (finish_us > metrics->session_start_time_us) {
+            uint32_t raw_ms = (uint32_t)((finish_us - metrics->session_start_time_us) / 1000);
+            finish_ms = raw_ms > metrics->total_paused_time_ms ? raw_ms - metrics->total_paused_time_ms : 0;
+        }
+        if (finish_ms > MAX_FINISH_MS) {
+            finish_ms = MAX_FINISH_MS;
+        }
+    }
+
+    float work = metrics->total_work_joules - s_work_start_j;
+    if (work < 0) {
+        work = 0;                       // Total work dips with a flywheel slowing against the estimate
+    }
+    uint32_t cycle_ms = metrics->drive_phase_duration_ms + s_recovery_ms;
+
+    record.stroke = (uint16_t)metrics->stroke_count;
+    record.finish_ms = (uint16_t)finish_ms;
+    record.finish_ms_high = (uint8_t)(finish_ms >> 16);
+    record.drive_ms = session_sampler_to_u16((float)metrics->drive_phase_duration_ms);
+    record.recovery_ms = session_sampler_to_u16((float)s_recovery_ms);
+    record.work_dj = session_sampler_to_u16(work * 10.0f);
+    record.peak_power_watts = session_sampler_to_u16(s_peak_power);
+    record.avg_power_watts = cycle_ms > 0 ? session_sampler_to_u16(work * 1000.0f / (float)cycle_ms) : 0;
+    record.distance_cm = session_sampler_to_u16(metrics->distance_per_stroke_meters * 100.0f);
+    record.drag_factor = session_sampler_to_u8(metrics->drag_factor);
+    record.peak_omega_crad_s = session_sampler_to_u16(metrics->peak_velocity_in_stroke * 100.0f);
+    record.peak_torque_cnm = session_sampler_to_u16(s_peak_torque * 100.0f);
+    resample_curve(finish_us > s_catch_us ? (uint32_t)(finish_us - s_catch_us) : 0, record.curve);
+
+    publish(&record);
+    if (s_recording) {
+        record_ring_push(&s_ring, &record);
+    }
+    s_latest_queued = s_recording;
+
+    s_last_finish_us = finish_us;
+    s_work_start_j = metrics->total_work_joules;
+}
+
+/**
+ * Feed a flywheel pulse
+ */
+void stroke_record_on_pulse(const rowing_metrics_t *metrics, uint32_t events) {
+    if (events & EVENT_BUS_CATCH) {
+        start_drive(metrics);
+    }
+    if (s_in_drive && metrics->current_phase == STROKE_PHASE_DRIVE) {
+        add_point(metrics);
+    }
+    if (events & EVENT_BUS_FINISH) {
+        s_in_drive = false;
+        if (events & EVENT_BUS_STROKE) {
+            finish_stroke(metrics);
+        }
+    }
+}
+
+/**
+ * Feed a seat trigger
+ */
+void stroke_record_on_seat(const rowing_metrics_t *metrics, uint32_t events) {
+    if (events & EVENT_BUS_CATCH) {
+        start_drive(metrics);
+    }
+}
+
+/**
+ * Start queueing records for a session
+ */
+void stroke_record_begin(void) {
+    record_ring_init(&s_ring, s_slots, SESSION_STROKE_RING_RECORDS, sizeof(stroke_record_t));
+    s_recording = true;
+
+    // The stroke that started the session (under the same lock as the writer)
+    if (s_stroke_total > 0 && !s_latest_queued) {
+        record_ring_push(&s_ring, &s_latest);
+        s_latest_queued = true;
+    }
+}
+
+/**
+ * Stop queueing records
+ */
+void stroke_record_end(void) {
+    s_recording = false;
+}
+
+/**
+ * Copy the latest stroke (reader side of the sequence lock)
+ */
+uint32_t stroke_record_latest(stroke_record_t *record) {
+    while (true) {
+        uint32_t begin = (uint32_t)atomic_load_explicit(&s_latest_sequence, memory_order_acquire);
+        if ((begin & 1) == 0) {
+            if (begin == 0) {
+                return 0;
+            }
+            stroke_record_t copy = s_latest;
+            uint32_t total = s_stroke_total;
+            atomic_thread_fence(memory_order_acquire);
+
+            uint32_t end = (uint32_t)atomic_load_explicit(&s_latest_sequence, memory_order_relaxed);
+            if (end == begin) {
+                *record = copy;
+                return total;
+            }
+        }
+    }
+}
+
+/**
+ * Records waiting for the storage task
+ */
+uint32_t stroke_record_pending(void) {
+    return record_ring_pending(&s_ring);
+}
+
+/**
+ * Copy the oldest waiting records
+ */
+uint32_t stroke_record_peek(stroke_record_t *records, uint32_t max_records) {
+    return record_ring_peek(&s_ring, records, max_records);
+}
+
+/**
+ * Take stored records
+ */
+void stroke_record_consume(uint32_t count) {
+    record_ring_consume(&s_ring, count);
+}
+
+/**
+ * Get the ring counters
+ */
+void stroke_record_get_stats(stroke_record_stats_t *stats) {
+    stats->records = s_ring.records;
+    stats->dropped = s_ring.dropped;
+    stats->capacity = SESSION_STROKE_RING_RECORDS;
+    stats->high_watermark = s_ring.high_watermark;
+}
+
+/**
+ * Encode a record as a JSON stroke message
+ */
+int stroke_record_to_json(const stroke_record_t *record, char *buffer, size_t buf_len) {
+    uint32_t finish_ms = record->finish_ms | ((uint32_t)record->finish_ms_high << 16);
+    int len = snprintf(buffer, buf_len,
+        "{\"type\":\"stroke\",\"stroke\":%u,\"finishMs\":%lu,\"driveMs\":%u,\"recoveryMs\":%u,"
+        "\"work\":%.1f,\"peakPower\":%u,\"avgPower\":%u,\"distance\":%.2f,\"dragFactor\":%u,"
+        "\"peakOmega\":%.2f,\"peakTorque\":%.2f,\"curve\":[",
+        record->stroke, (unsigned long)finish_ms, record->drive_ms, record->recovery_ms,
+        record->work_dj / 10.0f, record->peak_power_watts, record->avg_power_watts,
+        record->distance_cm / 100.0f, record->drag_factor,
+        record->peak_omega_crad_s / 100.0f, record->peak_torque_cnm / 100.0f);
+
+    for (int i = 0; i < STROKE_CURVE_POINTS && len > 0 && (size_t)len < buf_len; i++) {
+        len += snprintf(buffer + len, buf_len - len, i == 0 ? "%u" : ",%u", record->curve[i]);
+    }
+    if (len > 0 && (size_t)len < buf_len) {
+        len += snprintf(buffer + len, buf_len - len, "]}");
+    }
+    return len > 0 && (size_t)len < buf_len ? len : -1;
+}
+
+/**
+ * Encode a record as a binary stroke message
+ */
+size_t stroke_record_to_binary(const stroke_record_t *record, uint8_t *buffer) {
+    buffer[0] = STROKE_RECORD_BINARY_TYPE;
+    memcpy(buffer + 1, record, sizeof(*record));
+    return STROKE_RECORD_BINARY_SIZE;
+}
@@ -0,0 +1,115 @@
+/**
+ * @file stroke_record.h
+ * @brief Per-stroke records with the force curve of the drive
+ *
+ * Built on the sensor task from what the stroke detector already sees:
+ * every flywheel pulse of a drive adds a point of flywheel torque
+ * I×α + k×ω² (the torque the rower applies, drag included) to a fixed
+ * buffer, and the finish of a counted stroke turns the drive into a
+ * stroke_record_t with the curve resampled to STROKE_CURVE_POINTS. A very
+ * long drive keeps every other point once the buffer is full, so the
+ * buffer always spans the whole drive. No heap is used.
+ *
+ * Each record is
+ * - published as the latest stroke for the broadcast task (a sequence
+ *   lock like metrics_snapshot.h), which pushes it to WebSocket subscribers
+ * - queued, while a session is recorded, in a single-producer/single-consumer
+ *   ring that the storage task drains into compressed pages
+ *   (sample_codec_layout_strokes). A full ring drops the record.
+ *
+ * A session starts after its first stroke, so starting one also queues the
+ * stroke that started it.
+ *
+ * Producer calls (on_pulse, on_seat, begin, end) are made with the metrics
+ * update lock held; begin also with the storage task excluded, since it
+ * empties the ring.
+ */
+
+#ifndef STROKE_RECORD_H
+#define STROKE_RECORD_H
+
+#include "rowing_physics.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Stroke message to WebSocket subscribers
+#define STROKE_RECORD_BINARY_TYPE   0x41    // Byte 0 (metrics frames use 0x01/0x81)
+#define STROKE_RECORD_BINARY_SIZE   (1 + sizeof(stroke_record_t))
+#define STROKE_RECORD_JSON_SIZE     384
+
+/**
+ * Ring counters of the current (or last) session
+ */
+typedef struct {
+    uint32_t records;                   // Records queued
+    uint32_t dropped;                   // Records lost to a full ring
+    uint32_t capacity;                  // Ring size in records
+    uint32_t high_watermark;            // Most records waiting at once
+} stroke_record_stats_t;
+
+/**
+ * Feed a flywheel pulse, right after stroke detection
+ * @param events What stroke_detector_update() returned for it
+ */
+void stroke_record_on_pulse(const rowing_metrics_t *metrics, uint32_t events);
+
+/**
+ * Feed a seat trigger (a catch it confirmed starts the drive)
+ * @param events What stroke_detector_process_seat_trigger() returned
+ */
+void stroke_record_on_seat(const rowing_metrics_t *metrics, uint32_t events);
+
+/**
+ * Start queueing records for a session (empties the ring)
+ */
+void stroke_record_begin(void);
+
+/**
+ * Stop queueing records
+ */
+void stroke_record_end(void);
+
+/**
+ * Copy the latest stroke (any task, never blocks the sensor task)
+ * @param record Output
+ * @return Strokes recorded since boot, 0 if none yet (record untouched)
+ */
+uint32_t stroke_record_latest(stroke_record_t *record);
+
+/**
+ * Records waiting for the storage task
+ */
+uint32_t stroke_record_pending(void);
+
+/**
+ * Copy the oldest waiting records without taking them (storage task)
+ * @return Records copied
+ */
+uint32_t stroke_record_peek(stroke_record_t *records, uint32_t max_records);
+
+/**
+ * Take records copied by stroke_record_peek() once they are stored
+ */
+void stroke_record_consume(uint32_t count);
+
+/**
+ * Get the ring counters
+ */
+void stroke_record_get_stats(stroke_record_stats_t *stats);
+
+/**
+ * Encode a record as a JSON stroke message
+ * @return Length written, or negative if the buffer is too small
+ */
+int stroke_record_to_json(const stroke_record_t *record, char *buffer, size_t buf_len);
+
+/**
+ * Encode a record as a binary stroke message: the type byte, then the
+ * record as stored (little-endian, packed)
+ * @param buffer At least STROKE_RECORD_BINARY_SIZE bytes
+ * @return Length written
+ */
+size_t stroke_record_to_binary(const stroke_record_t *record, uint8_t *buffer);
+
+#endif // STROKE_RECORD_H
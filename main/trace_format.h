@@ -0,0 +1,107 @@
+/**
+ * @file trace_format.h
+ * @brief Binary format for raw sensor pulse traces
+ *
+ * A trace is a fixed header followed by a stream of delta-encoded events.
+ * Every debounced flywheel pulse and seat trigger emitted by sensor_manager
+ * becomes one event, so a trace can be replayed through the physics and
+ * stroke detection pipeline offline.
+ *
+ * Event encoding (unsigned LEB128 varint):
+ *   value = (delta_us << 1) | channel
+ * where delta_us is the time since the previous event of any channel (or
+ * since header.start_time_us for the first event). Events are written in
+ * timestamp order, so deltas are never negative. A typical flywheel pulse
+ * costs 2-3 bytes.
+ *
+ * This header has no ESP-IDF dependencies and is shared with host tools.
+ */
+
+#ifndef TRACE_FORMAT_H
+#define TRACE_FORMAT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define TRACE_MAGIC                 "RWTR"
+#define TRACE_FORMAT_VERSION        1
+
+// Value of header count fields while a trace is still being recorded
+// (erased NOR flash reads as 0xFF, so the fields are programmed on finish)
+#define TRACE_UNFINISHED            0xFFFFFFFFu
+
+// Longest possible encoded event (64-bit varint)
+#define TRACE_MAX_EVENT_BYTES       10
+
+/**
+ * Event channel
+ */
+typedef enum {
+    TRACE_CHANNEL_FLYWHEEL = 0,     // Flywheel magnet pulse
+    TRACE_CHANNEL_SEAT = 1          // Seat position trigger
+} trace_channel_t;
+
+/**
+ * Trace file header (64 bytes, little-endian)
+ */
+typedef struct __attribute__((packed)) {
+    char magic[4];                  // TRACE_MAGIC
+    uint16_t version;               // TRACE_FORMAT_VERSION
+    uint16_t header_size;           // sizeof(trace_header_t)
+    uint8_t magnets_per_rev;        // Flywheel magnets at recording time
+    uint8_t reserved[3];
+    float moment_of_inertia;        // kg⋅m² at recording time
+    float drag_coefficient;         // k at recording time
+    char firmware_version[16];      // APP_VERSION_STRING, NUL padded
+    int64_t start_time_us;          // esp_timer time the deltas are relative to
+    uint32_t event_count;           // Number of events, TRACE_UNFINISHED while recording
+    uint32_t data_bytes;            // Encoded event bytes, TRACE_UNFINISHED while recording
+    uint8_t reserved2[12];
+} trace_header_t;
+
+/**
+ * Encode one event
+ * @param out Output buffer (at least TRACE_MAX_EVENT_BYTES)
+ * @param delta_us Time since previous event (>= 0)
+ * @param channel Event channel
+ * @return Number of bytes written
+ */
+static inline size_t trace_encode_event(uint8_t *out, int64_t delta_us, trace_channel_t channel) {
+    uint64_t value = ((uint64_t)(delta_us < 0 ? 0 : delta_us) << 1) | (uint64_t)(channel & 1);
+    size_t len = 0;
+
+    while (value >= 0x80) {
+        out[len++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    out[len++] = (uint8_t)value;
+    return len;
+}
+
+/**
+ * Decode one event
+ * @param in Input buffer
+ * @param avail Bytes available in input
+ * @param delta_us Output: time since previous event
+ * @param channel Output: event channel
+ * @return Number of bytes consumed, 0 if the input is truncated or invalid
+ */
+static inline size_t trace_decode_event(const uint8_t *in, size_t avail,
+                                        int64_t *delta_us, trace_channel_t *channel) {
+    uint64_t value = 0;
+    size_t len = 0;
+
+    while (len < avail && len < TRACE_MAX_EVENT_BYTES) {
+        uint8_t byte = in[len];
+        value |= (uint64_t)(byte & 0x7F) << (7 * len);
+        len++;
+        if ((byte & 0x80) == 0) {
+            *delta_us = (int64_t)(value >> 1);
+            *channel = (trace_channel_t)(value & 1);
+            return len;
+        }
+    }
+    return 0;
+}
+
+#endif // TRACE_FORMAT_H
@@ -0,0 +1,506 @@
+/**
+ * @file trace_recorder.c
+ * @brief Raw pulse trace recording to the `trace` flash partition
+ *
+ * Design:
+ * - The sensor task encodes events into one of two RAM pages (no flash I/O)
+ * - A full page is handed to a low-priority writer task through a queue
+ * - The writer erases sectors lazily, one sector ahead of the data,
+ *   programs pages, and finalizes the header count fields when recording
+ *   stops (erased flash reads 0xFF, so the fields can be programmed
+ *   exactly once)
+ * - If the writer falls two pages behind, events are dropped and counted
+ *   instead of ever blocking the sensor task
+ */
+
+#include "trace_recorder.h"
+#include "app_config.h"
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_partition.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+
+#include <string.h>
+#include <stddef.h>
+
+static const char *TAG = "TRACE";
+
+// Partition label (see partitions.csv)
+#define TRACE_PARTITION_LABEL       "trace"
+
+// RAM page size handed to the writer task (~2.5s of pulses at full speed)
+#define TRACE_PAGE_SIZE             1024
+
+// Flash erase granularity
+#define TRACE_SECTOR_SIZE           4096
+
+// Block size used when scanning for the end of an unfinished trace
+#define TRACE_SCAN_BLOCK_SIZE       256
+
+// Writer task configuration
+#define TRACE_WRITER_STACK_SIZE     3072
+#define TRACE_WRITER_PRIORITY       2
+#define TRACE_WRITER_QUEUE_LEN      4
+
+/**
+ * Writer task message
+ */
+typedef enum {
+    TRACE_MSG_START = 0,            // Erase first sector and write header
+    TRACE_MSG_PAGE,                 // Program a data page
+    TRACE_MSG_FINISH                // Program header count fields
+} trace_msg_type_t;
+
+typedef struct {
+    trace_msg_type_t type;
+    uint8_t page;                   // TRACE_MSG_PAGE: page index
+    uint16_t len;                   // TRACE_MSG_PAGE: bytes in page
+    uint32_t offset;                // TRACE_MSG_PAGE: partition offset
+    uint32_t event_count;           // TRACE_MSG_FINISH
+    uint32_t data_bytes;            // TRACE_MSG_FINISH
+} trace_msg_t;
+
+static const esp_partition_t *s_partition = NULL;
+static SemaphoreHandle_t s_mutex = NULL;
+static QueueHandle_t s_writer_queue = NULL;
+
+// Recording state (protected by s_mutex, s_recording also read lock-free)
+static volatile bool s_recording = false;
+static volatile bool s_stopping = false;    // stop() still queueing the final messages
+static trace_header_t s_header;
+static uint8_t s_pages[2][TRACE_PAGE_SIZE];
+static volatile bool s_page_busy[2] = {false, false};
+static uint8_t s_active_page = 0;
+static uint32_t s_page_fill = 0;
+static uint32_t s_queued_bytes = 0;         // Data bytes handed to the writer
+static int64_t s_last_event_us = 0;
+static uint32_t s_event_count = 0;
+static uint32_t s_data_bytes = 0;
+static uint32_t s_dropped_events = 0;
+
+// Writer-owned state
+static uint32_t s_erased_until = 0;
+
+// Stored trace info
+static volatile bool s_available = false;
+static volatile bool s_finished = false;
+static volatile uint32_t s_stored_events = 0;
+static volatile uint32_t s_stored_bytes = 0;
+
+/**
+ * Capacity available for event data
+ */
+static uint32_t data_capacity(void) {
+    if (s_partition == NULL) {
+        return 0;
+    }
+    return s_partition->size - sizeof(trace_header_t);
+}
+
+/**
+ * Erase sectors so that [0, end) is writable, and keep the sector after it
+ * erased too: recovery takes the first erased block as the end of the
+ * trace, so data must never be followed by events of an older trace, not
+ * even when it ends on a sector boundary
+ */
+static esp_err_t ensure_erased(uint32_t end) {
+    uint32_t limit = end + TRACE_SECTOR_SIZE;
+    if (limit > s_partition->size) {
+        limit = s_partition->size;
+    }
+    while (s_erased_until < limit) {
+        esp_err_t ret = esp_partition_erase_range(s_partition, s_erased_until, TRACE_SECTOR_SIZE);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        s_erased_until += TRACE_SECTOR_SIZE;
+    }
+    return ESP_OK;
+}
+
+/**
+ * Flash writer task
+ * All flash I/O happens here, in queue order.
+ */
+static void trace_writer_task(void *arg) {
+    trace_msg_t msg;
+
+    while (true) {
+        if (xQueueReceive(s_writer_queue, &msg, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+
+        esp_err_t ret = ESP_OK;
+
+        switch (msg.type) {
+            case TRACE_MSG_START:
+                s_erased_until = 0;
+                ret = ensure_erased(sizeof(trace_header_t));
+                if (ret == ESP_OK) {
+                    ret = esp_partition_write(s_partition, 0, &s_header, sizeof(s_header));
+                }
+                break;
+
+            case TRACE_MSG_PAGE:
+                ret = ensure_erased(msg.offset + msg.len);
+                if (ret == ESP_OK) {
+                    ret = esp_partition_write(s_partition, msg.offset, s_pages[msg.page], msg.len);
+                }
+                s_page_busy[msg.page] = false;
+                break;
+
+            case TRACE_MSG_FINISH: {
+                uint32_t counts[2] = { msg.event_count, msg.data_bytes };
+                ret = esp_partition_write(s_partition, offsetof(trace_header_t, event_count),
+                                          counts, sizeof(counts));
+                if (ret == ESP_OK) {
+                    s_stored_events = msg.event_count;
+                    s_stored_bytes = msg.data_bytes;
+                    s_finished = true;
+                    s_available = true;
+                    ESP_LOGI(TAG, "Trace finalized: %lu events, %lu bytes",
+                             (unsigned long)msg.event_count, (unsigned long)msg.data_bytes);
+                }
+                break;
+            }
+        }
+
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Trace flash write failed: %s", esp_err_to_name(ret));
+        }
+    }
+}
+
+/**
+ * Hand the active page to the writer task and switch pages
+ * Caller must hold s_mutex.
+ * @return false if the other page is still being written
+ */
+static bool submit_active_page(void) {
+    uint8_t next = s_active_page ^ 1;
+    if (s_page_busy[next]) {
+        return false;
+    }
+
+    trace_msg_t msg = {
+        .type = TRACE_MSG_PAGE,
+        .page = s_active_page,
+        .len = (uint16_t)s_page_fill,
+        .offset = sizeof(trace_header_t) + s_queued_bytes,
+    };
+
+    s_page_busy[s_active_page] = true;
+    if (xQueueSend(s_writer_queue, &msg, 0) != pdTRUE) {
+        s_page_busy[s_active_page] = false;
+        return false;
+    }
+
+    s_queued_bytes += s_page_fill;
+    s_active_page = next;
+    s_page_fill = 0;
+    return true;
+}
+
+/**
+ * Find the end of an unfinished trace (e.g. after a reset while recording)
+ * Data is followed by erased (0xFF) flash, so scan for the first fully
+ * erased block and trim trailing 0xFF bytes before it.
+ */
+static uint32_t scan_unfinished_length(void) {
+    uint8_t block[TRACE_SCAN_BLOCK_SIZE];
+    uint32_t capacity = data_capacity();
+    uint32_t length = 0;
+
+    for (uint32_t pos = 0; pos < capacity; pos += sizeof(block)) {
+        uint32_t chunk = capacity - pos < sizeof(block) ? capacity - pos : sizeof(block);
+        if (esp_partition_read(s_partition, sizeof(trace_header_t) + pos, block, chunk) != ESP_OK) {
+            break;
+        }
+
+        int last = -1;
+        for (int i = (int)chunk - 1; i >= 0; i--) {
+            if (block[i] != 0xFF) {
+                last = i;
+                break;
+            }
+        }
+
+        if (last < 0) {
+            break;  // Fully erased block - end of data
+        }
+        length = pos + (uint32_t)last + 1;
+    }
+
+    return length;
+}
+
+/**
+ * Initialize trace recorder
+ */
+esp_err_t trace_recorder_init(void) {
+    s_partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY,
+                                           TRACE_PARTITION_LABEL);
+    if (s_partition == NULL) {
+        ESP_LOGW(TAG, "No '%s' partition, trace recording unavailable", TRACE_PARTITION_LABEL);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    if (s_mutex == NULL) {
+        s_mutex = xSemaphoreCreateMutex();
+        if (s_mutex == NULL) {
+            ESP_LOGE(TAG, "Failed to create trace mutex");
+            return ESP_FAIL;
+        }
+    }
+
+    if (s_writer_queue == NULL) {
+        s_writer_queue = xQueueCreate(TRACE_WRITER_QUEUE_LEN, sizeof(trace_msg_t));
+        if (s_writer_queue == NULL) {
+            ESP_LOGE(TAG, "Failed to create trace writer queue");
+            return ESP_FAIL;
+        }
+
+        if (xTaskCreate(trace_writer_task, "trace_writer", TRACE_WRITER_STACK_SIZE,
+                        NULL, TRACE_WRITER_PRIORITY, NULL) != pdPASS) {
+            ESP_LOGE(TAG, "Failed to create trace writer task");
+            return ESP_FAIL;
+        }
+    }
+
+    // Look for a trace left from a previous recording
+    trace_header_t header;
+    if (esp_partition_read(s_partition, 0, &header, sizeof(header)) == ESP_OK &&
+        memcmp(header.magic, TRACE_MAGIC, 4) == 0 &&
+        header.version == TRACE_FORMAT_VERSION) {
+        s_available = true;
+        if (header.data_bytes != TRACE_UNFINISHED) {
+            s_finished = true;
+            s_stored_events = header.event_count;
+            s_stored_bytes = header.data_bytes;
+        } else {
+            // Recording was interrupted - recover what reached flash
+            s_finished = false;
+            s_stored_events = 0;
+            s_stored_bytes = scan_unfinished_length();
+            ESP_LOGW(TAG, "Recovered unfinished trace (%lu bytes)", (unsigned long)s_stored_bytes);
+        }
+    }
+
+    ESP_LOGI(TAG, "Trace recorder initialized (%lu KB partition)",
+             (unsigned long)(s_partition->size / 1024));
+    return ESP_OK;
+}
+
+/**
+ * Start recording a new trace
+ */
+esp_err_t trace_recorder_start(const rowing_metrics_t *metrics) {
+    if (s_partition == NULL || s_mutex == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+
+    if (s_recording || s_stopping) {
+        xSemaphoreGive(s_mutex);
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    memset(&s_header, 0, sizeof(s_header));
+    memcpy(s_header.magic, TRACE_MAGIC, 4);
+    s_header.version = TRACE_FORMAT_VERSION;
+    s_header.header_size = sizeof(trace_header_t);
+    s_header.magnets_per_rev = rowing_physics_get_magnets_per_rev();
+    s_header.moment_of_inertia = metrics != NULL ? metrics->moment_of_inertia : DEFAULT_MOMENT_OF_INERTIA;
+    s_header.drag_coefficient = metrics != NULL ? metrics->drag_coefficient : DEFAULT_DRAG_COEFFICIENT;
+    strncpy(s_header.firmware_version, APP_VERSION_STRING, sizeof(s_header.firmware_version) - 1);
+    s_header.start_time_us = esp_timer_get_time();
+    s_header.event_count = TRACE_UNFINISHED;
+    s_header.data_bytes = TRACE_UNFINISHED;
+
+    trace_msg_t msg = { .type = TRACE_MSG_START };
+    if (xQueueSend(s_writer_queue, &msg, pdMS_TO_TICKS(1000)) != pdTRUE) {
+        xSemaphoreGive(s_mutex);
+        ESP_LOGE(TAG, "Trace writer not responding");
+        return ESP_ERR_TIMEOUT;
+    }
+
+    s_available = false;
+    s_finished = false;
+    s_stored_events = 0;
+    s_stored_bytes = 0;
+
+    s_active_page = 0;
+    s_page_fill = 0;
+    s_queued_bytes = 0;
+    s_last_event_us = s_header.start_time_us;
+    s_event_count = 0;
+    s_data_bytes = 0;
+    s_dropped_events = 0;
+    s_recording = true;
+
+    xSemaphoreGive(s_mutex);
+
+    ESP_LOGI(TAG, "Trace recording started (magnets=%u, I=%.4f, k=%.6f)",
+             s_header.magnets_per_rev, s_header.moment_of_inertia, s_header.drag_coefficient);
+    return ESP_OK;
+}
+
+/**
+ * Stop recording and finalize the trace
+ */
+esp_err_t trace_recorder_stop(void) {
+    if (s_mutex == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+
+    if (!s_recording) {
+        xSemaphoreGive(s_mutex);
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    s_recording = false;
+    s_stopping = true;
+
+    // Nothing is logged once recording is off, so the partial page is final
+    // and can be queued without waiting for the other page to be written
+    trace_msg_t page = {
+        .type = TRACE_MSG_PAGE,
+        .page = s_active_page,
+        .len = (uint16_t)s_page_fill,
+        .offset = sizeof(trace_header_t) + s_queued_bytes,
+    };
+    if (s_page_fill > 0) {
+        s_page_busy[s_active_page] = true;
+        s_queued_bytes += s_page_fill;
+        s_active_page ^= 1;
+        s_page_fill = 0;
+    }
+
+    trace_msg_t finish = {
+        .type = TRACE_MSG_FINISH,
+        .event_count = s_event_count,
+        .data_bytes = s_queued_bytes,
+    };
+
+    xSemaphoreGive(s_mutex);
+
+    // Wait for queue space without s_mutex, so a sensor task that raced
+    // into trace_recorder_log() is not held up by the writer
+    if (page.len > 0) {
+        xQueueSend(s_writer_queue, &page, portMAX_DELAY);
+    }
+    xQueueSend(s_writer_queue, &finish, portMAX_DELAY);
+    s_stopping = false;
+
+    ESP_LOGI(TAG, "Trace recording stopped: %lu events, %lu bytes, %lu dropped",
+             (unsigned long)s_event_count, (unsigned long)s_queued_bytes,
+             (unsigned long)s_dropped_events);
+    return ESP_OK;
+}
+
+/**
+ * Record one sensor event
+ */
+void trace_recorder_log(trace_channel_t channel, int64_t timestamp_us) {
+    if (!s_recording) {
+        return;
+    }
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+
+    if (!s_recording) {
+        xSemaphoreGive(s_mutex);
+        return;
+    }
+
+    uint8_t encoded[TRACE_MAX_EVENT_BYTES];
+    size_t len = trace_encode_event(encoded, timestamp_us - s_last_event_us, channel);
+
+    // Partition full: keep the trace but stop growing it
+    if (s_data_bytes + len > data_capacity()) {
+        s_dropped_events++;
+        xSemaphoreGive(s_mutex);
+        return;
+    }
+
+    if (s_page_fill + len > TRACE_PAGE_SIZE && !submit_active_page()) {
+        // Writer is two pages behind - drop rather than block the sensor task
+        s_dropped_events++;
+        xSemaphoreGive(s_mutex);
+        return;
+    }
+
+    memcpy(&s_pages[s_active_page][s_page_fill], encoded, len);
+    s_page_fill += len;
+    s_data_bytes += len;
+    s_event_count++;
+    s_last_event_us = timestamp_us;
+
+    xSemaphoreGive(s_mutex);
+}
+
+/**
+ * Check if a trace is being recorded
+ */
+bool trace_recorder_is_recording(void) {
+    return s_recording;
+}
+
+/**
+ * Get recorder status
+ */
+void trace_recorder_get_status(trace_recorder_status_t *status) {
+    memset(status, 0, sizeof(*status));
+    status->capacity_bytes = data_capacity();
+
+    if (s_mutex == NULL) {
+        return;
+    }
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    status->recording = s_recording;
+    status->available = s_available;
+    status->finished = s_finished;
+    status->dropped_events = s_dropped_events;
+    if (s_recording) {
+        status->event_count = s_event_count;
+        status->data_bytes = s_data_bytes;
+    } else {
+        status->event_count = s_stored_events;
+        status->data_bytes = s_stored_bytes;
+    }
+    xSemaphoreGive(s_mutex);
+}
+
+/**
+ * Read bytes of the stored trace
+ */
+esp_err_t trace_recorder_read(uint32_t offset, void *buffer, size_t len) {
+    if (s_partition == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    uint32_t size = trace_recorder_get_size();
+    if (offset > size || len > size - offset) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    return esp_partition_read(s_partition, offset, buffer, len);
+}
+
+/**
+ * Get total size of the stored trace
+ */
+uint32_t trace_recorder_get_size(void) {
+    if (s_recording || !s_available) {
+        return 0;
+    }
+    return sizeof(trace_header_t) + s_stored_bytes;
+}
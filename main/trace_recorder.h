@@ -0,0 +1,88 @@
+/**
+ * @file trace_recorder.h
+ * @brief Raw pulse trace recording to the `trace` flash partition
+ *
+ * While recording, every debounced flywheel pulse and seat trigger is
+ * delta-encoded (see trace_format.h) into a RAM page and streamed to flash
+ * by a low-priority writer task. The finished trace can be downloaded over
+ * HTTP and replayed offline.
+ */
+
+#ifndef TRACE_RECORDER_H
+#define TRACE_RECORDER_H
+
+#include "esp_err.h"
+#include "rowing_physics.h"
+#include "trace_format.h"
+
+/**
+ * Trace recorder status
+ */
+typedef struct {
+    bool recording;                 // Recording in progress
+    bool available;                 // A trace is stored on flash
+    bool finished;                  // Stored trace was finalized cleanly
+    uint32_t event_count;           // Events recorded (or stored)
+    uint32_t data_bytes;            // Encoded bytes recorded (or stored)
+    uint32_t dropped_events;        // Events lost (writer behind or partition full)
+    uint32_t capacity_bytes;        // Space available for event data
+} trace_recorder_status_t;
+
+/**
+ * Initialize trace recorder and start the flash writer task
+ * @return ESP_OK on success, ESP_ERR_NOT_FOUND if the partition is missing
+ */
+esp_err_t trace_recorder_init(void);
+
+/**
+ * Start recording a new trace (overwrites the stored trace)
+ * @param metrics Current metrics (inertia and drag are stored in the header)
+ * @return ESP_OK on success
+ */
+esp_err_t trace_recorder_start(const rowing_metrics_t *metrics);
+
+/**
+ * Stop recording and finalize the trace header
+ * Waits for room in the writer queue, so never call it with the metrics
+ * update lock held.
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE if not recording
+ */
+esp_err_t trace_recorder_stop(void);
+
+/**
+ * Record one sensor event
+ * Called from the sensor task for every timestamp drained from the ISR rings.
+ * Cheap no-op when not recording.
+ * @param channel Event channel
+ * @param timestamp_us ISR timestamp
+ */
+void trace_recorder_log(trace_channel_t channel, int64_t timestamp_us);
+
+/**
+ * Check if a trace is being recorded
+ * @return true if recording
+ */
+bool trace_recorder_is_recording(void);
+
+/**
+ * Get recorder status
+ * @param status Output status
+ */
+void trace_recorder_get_status(trace_recorder_status_t *status);
+
+/**
+ * Read bytes of the stored trace (header followed by event data)
+ * @param offset Byte offset into the trace
+ * @param buffer Output buffer
+ * @param len Number of bytes to read
+ * @return ESP_OK on success
+ */
+esp_err_t trace_recorder_read(uint32_t offset, void *buffer, size_t len);
+
+/**
+ * Get total size of the stored trace in bytes (header + data)
+ * @return Size in bytes, 0 if no trace is available
+ */
+uint32_t trace_recorder_get_size(void);
+
+#endif // TRACE_RECORDER_H
@@ -7,6 +7,31 @@ let ws = null;
 let reconnectTimeout = null;
 let isConnected = false;
 
+// Binary WebSocket metrics subprotocol (see metrics_calculator.h for the layout)
+const WS_BINARY_SUBPROTOCOL = 'rowing.bin.v1';
+const WS_BINARY_VERSION = 1;
+const WS_BINARY_SIZE = 44;
+const HR_STATES = ['idle', 'scanning', 'connecting', 'connected', 'error'];
+const PHASES = ['idle', 'drive', 'recovery'];
+
+// Set when the server rejected the binary subprotocol (older firmware)
+let wsBinaryUnsupported = false;
+
+// Delta updates: byte 0 of a binary delta, and the binary fields in delta
+// mask order as [offset, size] (see metrics_delta.h)
+const WS_BINARY_DELTA_FLAG = 0x80;
+const WS_BINARY_FIELDS = [
+    [1, 1], [4, 4], [8, 4], [12, 4], [16, 4], [20, 2], [22, 2], [24, 2], [26, 2],
+    [28, 2], [30, 2], [32, 2], [34, 2], [36, 2], [38, 2], [40, 1], [41, 1], [42, 1]
+];
+
+// samples.bin header: magic, version, header size, sample size, ... count at 24
+const SESSION_SAMPLES_HEADER_MIN = 28;
+
+// Last full state of the stream, that deltas are applied to
+let lastMetrics = null;
+let lastBinaryFrame = null;
+
 // Global config object for settings like max heart rate
 let config = {
     maxHR: 190  // Default max heart rate, will be loaded from server
@@ -332,6 +357,7 @@ function connectSSE() {
         
         eventSource.onopen = () => {
             console.log('SSE connected');
+            lastMetrics = null;
             isConnected = true;
             elements.connectionStatus.textContent = 'Connected';
             
@@ -343,8 +369,9 @@ function connectSSE() {
         
         eventSource.onmessage = (event) => {
             try {
-                const data = JSON.parse(event.data);
-                updateMetrics(data);
+                // A delta before the first keyframe is dropped; the server
+                // sends a keyframe to every new client
+                applyMetricsMessage(JSON.parse(event.data));
             } catch (e) {
                 console.error('Error parsing SSE message:', e);
             }
@@ -379,8 +406,121 @@ function connectSSE() {
     }
 }
 
+/**
+ * Decode a binary metrics frame into the same object the JSON carries
+ * @param {ArrayBuffer} buffer - Frame received on the binary subprotocol
+ * @returns {object|null} Metrics, or null if the frame is not understood
+ */
+function decodeBinaryMetrics(buffer) {
+    if (buffer.byteLength < WS_BINARY_SIZE) {
+        return null;
+    }
+    const view = new DataView(buffer);
+    if (view.getUint8(0) !== WS_BINARY_VERSION) {
+        return null;
+    }
+    
+    const flags = view.getUint8(1);
+    const pace = view.getUint16(20, true) / 10;
+    const avgPace = view.getUint16(22, true) / 10;
+    return {
+        sequence: view.getUint16(2, true),
+        sessionId: view.getUint32(4, true),
+        distance: view.getUint32(8, true) / 10,
+        elapsedTime: view.getUint32(12, true),
+        strokeCount: view.getUint32(16, true),
+        pace: pace,
+        paceStr: formatPace(pace),
+        avgPace: avgPace,
+        avgPaceStr: formatPace(avgPace),
+        power: view.getUint16(24, true),
+        avgPower: view.getUint16(26, true),
+        peakPower: view.getUint16(28, true),
+        strokeRate: view.getUint16(30, true) / 10,
+        avgStrokeRate: view.getUint16(32, true) / 10,
+        calories: view.getUint16(34, true),
+        caloriesPerHour: view.getUint16(36, true),
+        dragFactor: view.getUint16(38, true) / 10,
+        dragConfidence: view.getUint8(40) / 100,
+        heartRate: view.getUint8(41),
+        avgHeartRate: view.getUint8(42),
+        isActive: (flags & 0x01) !== 0,
+        isPaused: (flags & 0x02) !== 0,
+        hrValid: (flags & 0x04) !== 0,
+        phase: PHASES[(flags >> 3) & 0x03] || 'idle',
+        hrStatus: HR_STATES[(flags >> 5) & 0x07] || 'idle'
+    };
+}
+
+/**
+ * Show a streamed metrics message: a full object, or a delta ("delta": true)
+ * holding only the fields that changed
+ * @returns {boolean} false if a delta arrived with no full state to apply it to
+ */
+function applyMetricsMessage(data) {
+    if (data.delta) {
+        if (!lastMetrics) {
+            return false;
+        }
+        delete data.delta;
+        lastMetrics = Object.assign({}, lastMetrics, data);
+    } else {
+        lastMetrics = data;
+    }
+    updateMetrics(lastMetrics);
+    return true;
+}
+
+/**
+ * Apply a binary delta to the last binary keyframe in place
+ * @returns {boolean} false if the delta does not fit the frame
+ */
+function applyBinaryDelta(frame, delta) {
+    if (delta.length < 4) {
+        return false;
+    }
+    const mask = delta[1] | (delta[2] << 8) | (delta[3] << 16);
+    let pos = 4;
+    for (let i = 0; i < WS_BINARY_FIELDS.length; i++) {
+        if (mask & (1 << i)) {
+            const [offset, size] = WS_BINARY_FIELDS[i];
+            if (pos + size > delta.length) {
+                return false;
+            }
+            frame.set(delta.subarray(pos, pos + size), offset);
+            pos += size;
+        }
+    }
+    return pos === delta.length;
+}
+
+/**
+ * Handle a binary WebSocket message (keyframe or delta)
+ * @returns {boolean} false if a keyframe is needed
+ */
+function applyBinaryMessage(buffer) {
+    const bytes = new Uint8Array(buffer);
+    if (bytes[0] === (WS_BINARY_VERSION | WS_BINARY_DELTA_FLAG)) {
+        if (!lastBinaryFrame || !applyBinaryDelta(lastBinaryFrame, bytes)) {
+            return false;
+        }
+    } else if (bytes[0] === WS_BINARY_VERSION && bytes.length >= WS_BINARY_SIZE) {
+        lastBinaryFrame = bytes.slice(0, WS_BINARY_SIZE);
+    } else {
+        return true;    // Unknown message type: ignore
+    }
+    
+    const data = decodeBinaryMetrics(lastBinaryFrame.buffer);
+    if (data) {
+        updateMetrics(data);
+    }
+    return true;
+}
+
 /**
  * Connect to WebSocket for real-time metrics (fallback)
+ * Asks for the binary subprotocol; falls back to JSON text frames if the
+ * server does not accept it.
  */
 function connectWebSocket() {
     if (ws && ws.readyState === WebSocket.OPEN) {
@@ -393,10 +533,16 @@ function connectWebSocket() {
     console.log('Connecting to WebSocket:', wsUrl);
     
     try {
-        ws = new WebSocket(wsUrl);
+        const tryBinary = !wsBinaryUnsupported;
+        ws = tryBinary ? new WebSocket(wsUrl, [WS_BINARY_SUBPROTOCOL]) : new WebSocket(wsUrl);
+        ws.binaryType = 'arraybuffer';
+        let opened = false;
         
         ws.onopen = () => {
-            console.log('WebSocket connected');
+            opened = true;
+            lastMetrics = null;
+            lastBinaryFrame = null;
+            console.log('WebSocket connected', ws.protocol ? `(${ws.protocol})` : '(JSON)');
             isConnected = true;
             elements.connectionStatus.textContent = 'Connected';
             
@@ -408,8 +554,11 @@ function connectWebSocket() {
         
         ws.onmessage = (event) => {
             try {
-                const data = JSON.parse(event.data);
-                updateMetrics(data);
+                const applied = event.data instanceof ArrayBuffer ?
+                    applyBinaryMessage(event.data) : applyMetricsMessage(JSON.parse(event.data));
+                if (!applied) {
+                    ws.send('keyframe');
+                }
             } catch (e) {
                 console.error('Error parsing message:', e);
             }
@@ -420,6 +569,11 @@ function connectWebSocket() {
             isConnected = false;
             elements.connectionStatus.textContent = 'Disconnected';
             
+            // Handshake refused with the subprotocol: retry with plain JSON
+            if (tryBinary && !opened) {
+                wsBinaryUnsupported = true;
+            }
+            
             // Attempt to reconnect after delay
             if (!reconnectTimeout) {
                 reconnectTimeout = setTimeout(() => {
@@ -1070,6 +1224,33 @@ function deleteSyncedSessions() {
     });
 }
 
+/**
+ * Decode /api/sessions/{id}/samples.bin (header + packed 8-byte samples)
+ * @returns {{power: number[], velocity: number[], heartRate: number[]}|null}
+ */
+function parseSessionSamples(buffer) {
+    const view = new DataView(buffer);
+    if (buffer.byteLength < SESSION_SAMPLES_HEADER_MIN ||
+        String.fromCharCode(view.getUint8(0), view.getUint8(1), view.getUint8(2), view.getUint8(3)) !== 'RWSS') {
+        return null;
+    }
+    const headerSize = view.getUint16(6, true);
+    const sampleSize = view.getUint16(8, true);
+    const count = view.getUint32(24, true);
+    if (sampleSize < 8 || headerSize + count * sampleSize > buffer.byteLength) {
+        return null;
+    }
+    
+    const samples = { power: [], velocity: [], heartRate: [] };
+    for (let i = 0; i < count; i++) {
+        const offset = headerSize + i * sampleSize;
+        samples.power.push(view.getUint16(offset, true));
+        samples.velocity.push(view.getUint16(offset + 2, true));
+        samples.heartRate.push(view.getUint8(offset + 4));
+    }
+    return samples;
+}
+
 /**
  * Show workout charts modal
  */
@@ -1217,25 +1398,25 @@ async function showWorkoutCharts(session) {
         ctx.fillText(`Avg: ${formatFn ? formatFn(avgValue) : avgValue}`, width - padding, avgY - 3);
     };
     
-    // Try to fetch detailed session data with samples
+    // Try to fetch the raw per-second samples (8 bytes each)
     try {
-        const response = await fetch(`/api/sessions/${session.id}`);
+        const response = await fetch(`/api/sessions/${session.id}/samples.bin`);
         if (response.ok) {
-            const data = await response.json();
+            const samples = parseSessionSamples(await response.arrayBuffer());
+            if (!samples) {
+                throw new Error('Bad samples.bin');
+            }
             
-            // Extract values from Health Connect format arrays
-            // Convert speedSamples (metersPerSecond) to pace (seconds per 500m)
-            const paceValues = (data.speedSamples || []).map(s => 
-                s.metersPerSecond > 0 ? 500 / s.metersPerSecond : 0
-            );
-            const powerValues = (data.powerSamples || []).map(s => s.watts);
-            const hrValues = (data.heartRateSamples || []).map(s => s.bpm);
+            // Velocity is stored in cm/s; pace is seconds per 500m
+            const paceValues = samples.velocity.map(v => v > 0 ? 50000 / v : 0);
+            const powerValues = samples.power;
+            const hrValues = samples.heartRate.filter(hr => hr > 0);
             
             // Draw charts with actual sample data (SPM removed - not stored per-second)
             setTimeout(() => {
-                drawSampleChart('modal-chart-pace', paceValues, data.avgPace, 'Pace', '#16d9e3', formatPace);
-                drawSampleChart('modal-chart-power', powerValues, data.avgPower, 'Power', '#96fbc4', v => Math.round(v) + ' W');
-                drawSampleChart('modal-chart-hr', hrValues, data.avgHeartRate || 0, 'HR', '#e94560', v => v > 0 ? Math.round(v) + ' bpm' : '-- bpm', true);
+                drawSampleChart('modal-chart-pace', paceValues, session.avgPace, 'Pace', '#16d9e3', formatPace);
+                drawSampleChart('modal-chart-power', powerValues, session.avgPower, 'Power', '#96fbc4', v => Math.round(v) + ' W');
+                drawSampleChart('modal-chart-hr', hrValues, session.avgHeartRate || 0, 'HR', '#e94560', v => v > 0 ? Math.round(v) + ' bpm' : '-- bpm', true);
             }, 50);
         } else {
             throw new Error('Failed to fetch session');
@@ -16,14 +16,28 @@
 #include "web_server.h"
 #include "app_config.h"
 #include "metrics_calculator.h"
+#include "metrics_frame.h"
+#include "metrics_delta.h"
+#include "send_queue.h"
+#include "event_bus.h"
 #include "config_manager.h"
 #include "hr_receiver.h"
 #include "session_manager.h"
+#include "session_json.h"
+#include "session_samples.h"
+#include "session_series.h"
+#include "session_detail.h"
+#include "stroke_record.h"
+#include "session_store.h"
+#include "json_writer.h"
+#include "sensor_manager.h"
+#include "trace_recorder.h"
 #include "wifi_manager.h"
 
 #include "esp_http_server.h"
 #include "esp_log.h"
 #include "esp_timer.h"
+#include "esp_heap_caps.h"
 #include "cJSON.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
@@ -43,13 +57,42 @@ static httpd_handle_t g_server = NULL;
 // Maximum number of streaming clients (shared for both WebSocket and SSE)
 #define MAX_STREAMING_CLIENTS 8
 
+// Tries of /workout/start while the storage task is busy with the last session
+#define WORKOUT_START_ATTEMPTS 3
+
+// What a streaming client has received (delta updates, see metrics_delta.h)
+typedef struct {
+    bool synced;                    // Has a keyframe that deltas apply to
+    bool keyframe_requested;        // Client asked for a keyframe
+    bool queued;                    // Slot's send queue belongs to this client
+    uint8_t frames_since_key;       // Frames (sent or unchanged) since that keyframe
+    uint32_t last_sequence;         // Metrics sequence of the frame it has
+} stream_state_t;
+
 // WebSocket file descriptors for connected clients
 #define MAX_WS_CLIENTS MAX_STREAMING_CLIENTS
 static int g_ws_fds[MAX_WS_CLIENTS] = {-1, -1, -1, -1, -1, -1, -1, -1};
 
+// Per slot: client negotiated the binary subprotocol (METRICS_WS_SUBPROTOCOL)
+static bool g_ws_binary[MAX_WS_CLIENTS];
+
+// Per slot: what the client has received
+static stream_state_t g_ws_state[MAX_WS_CLIENTS];
+
+// Per slot: client subscribed to stroke records ("strokes" command)
+static bool g_ws_strokes[MAX_WS_CLIENTS];
+
 // Mutex for thread-safe WebSocket client list access
 static SemaphoreHandle_t g_ws_mutex = NULL;
 
+// Streaming delivery counters (WS and SSE), under g_ws_mutex
+typedef struct {
+    uint32_t bytes_in_flight;       // Queued and not yet taken by the sockets (last broadcast)
+    uint32_t frames_dropped;        // Messages that did not fit a client's queue
+    uint32_t clients_evicted;       // Clients closed for being persistently behind
+} stream_stats_t;
+static stream_stats_t g_stream_stats = {0};
+
 // Pointers to shared data
 static rowing_metrics_t *g_metrics = NULL;
 static config_t *g_config = NULL;
@@ -298,17 +341,39 @@ static esp_err_t api_metrics_handler(httpd_req_t *req) {
         return ESP_FAIL;
     }
     
-    char buffer[JSON_BUFFER_SIZE];
-    metrics_calculator_to_json(g_metrics, buffer, sizeof(buffer));
+    metrics_frame_t *frame = metrics_frame_acquire();
+    if (frame == NULL) {
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
     
     httpd_resp_set_type(req, "application/json");
     httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
     httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
-    httpd_resp_sendstr(req, buffer);
+    httpd_resp_send(req, metrics_frame_json(frame), frame->json_len);
     
+    metrics_frame_release(frame);
     return ESP_OK;
 }
 
+/**
+ * Add a sink's pulse-to-send latency distribution to a JSON object
+ */
+static void add_push_latency(cJSON *parent, const char *name, event_bus_sink_t sink) {
+    event_bus_latency_t latency;
+    event_bus_get_latency(sink, &latency);
+    
+    cJSON *obj = cJSON_AddObjectToObject(parent, name);
+    if (obj == NULL) {
+        return;
+    }
+    cJSON_AddNumberToObject(obj, "samples", latency.count);
+    cJSON_AddNumberToObject(obj, "p50Ms", event_bus_latency_percentile_ms(&latency, 50));
+    cJSON_AddNumberToObject(obj, "p90Ms", event_bus_latency_percentile_ms(&latency, 90));
+    cJSON_AddNumberToObject(obj, "p99Ms", event_bus_latency_percentile_ms(&latency, 99));
+    cJSON_AddNumberToObject(obj, "maxMs", latency.max_us / 1000.0);
+}
+
 /**
  * API endpoint: Get device status
  */
@@ -321,6 +386,221 @@ static esp_err_t api_status_handler(httpd_req_t *req) {
     cJSON_AddNumberToObject(root, "wsClients", web_server_get_connection_count());
     cJSON_AddNumberToObject(root, "uptime", (double)(esp_timer_get_time() / 1000000));
     
+    // ISR -> sensor task pulse ring health (non-zero overflows mean lost pulses)
+    sensor_ring_stats_t ring_stats;
+    sensor_manager_get_ring_stats(&ring_stats);
+    cJSON_AddNumberToObject(root, "pulseRingOverflows", ring_stats.flywheel_overflows);
+    cJSON_AddNumberToObject(root, "pulseRingHighWater", ring_stats.flywheel_high_watermark);
+    cJSON_AddNumberToObject(root, "seatRingOverflows", ring_stats.seat_overflows);
+    
+    // Metrics JSON encodes vs frames served (streams + polls)
+    metrics_frame_stats_t frame_stats;
+    metrics_frame_get_stats(&frame_stats);
+    cJSON_AddNumberToObject(root, "metricsEncodes", frame_stats.encodes);
+    cJSON_AddNumberToObject(root, "metricsFramesServed", frame_stats.acquires);
+    
+    // Streaming client backpressure
+    WS_MUTEX_TAKE();
+    stream_stats_t stream_stats = g_stream_stats;
+    WS_MUTEX_GIVE();
+    cJSON_AddNumberToObject(root, "streamBytesInFlight", stream_stats.bytes_in_flight);
+    cJSON_AddNumberToObject(root, "streamFramesDropped", stream_stats.frames_dropped);
+    cJSON_AddNumberToObject(root, "streamClientsEvicted", stream_stats.clients_evicted);
+    
+    // Stroke event to send latency (flywheel pulse ISR time to push)
+    cJSON *push_latency = cJSON_AddObjectToObject(root, "pushLatency");
+    if (push_latency != NULL) {
+        add_push_latency(push_latency, "web", EVENT_BUS_SINK_WEB);
+        add_push_latency(push_latency, "ble", EVENT_BUS_SINK_BLE);
+    }
+    event_bus_stats_t bus_stats;
+    event_bus_get_stats(&bus_stats);
+    cJSON_AddNumberToObject(root, "eventBusCoalesced", bus_stats.coalesced);
+    cJSON_AddNumberToObject(root, "eventBusRateLimited", bus_stats.rate_limited);
+    
+    // Flash session log
+    session_store_stats_t store_stats;
+    session_store_get_stats(&store_stats);
+    cJSON *store = cJSON_AddObjectToObject(root, "sessionStore");
+    if (store != NULL) {
+        cJSON_AddNumberToObject(store, "sessions", store_stats.sessions);
+        cJSON_AddNumberToObject(store, "sectors", store_stats.sectors);
+        cJSON_AddNumberToObject(store, "freeSectors", store_stats.free_sectors);
+        cJSON_AddNumberToObject(store, "bytesAppended", store_stats.bytes_appended);
+        cJSON_AddNumberToObject(store, "bytesProgrammed", store_stats.bytes_programmed);
+        cJSON_AddNumberToObject(store, "gcRuns", store_stats.gc_runs);
+        cJSON_AddNumberToObject(store, "sessionsEvicted", store_stats.sessions_evicted);
+        cJSON_AddNumberToObject(store, "minEraseCount", store_stats.min_erase_count);
+        cJSON_AddNumberToObject(store, "maxEraseCount", store_stats.max_erase_count);
+    }
+    
+    // Storage task flushing the running session
+    session_flush_stats_t flush_stats;
+    session_manager_get_flush_stats(&flush_stats);
+    cJSON *flush = cJSON_AddObjectToObject(root, "sessionFlush");
+    if (flush != NULL) {
+        cJSON_AddNumberToObject(flush, "flushes", flush_stats.flushes);
+        cJSON_AddNumberToObject(flush, "bytesWritten", flush_stats.bytes_written);
+        cJSON_AddNumberToObject(flush, "samplesFlushed", flush_stats.samples_flushed);
+        cJSON_AddNumberToObject(flush, "pageBytes", flush_stats.page_bytes);
+        cJSON_AddNumberToObject(flush, "lastFlushUs", flush_stats.last_flush_us);
+        cJSON_AddNumberToObject(flush, "maxFlushUs", flush_stats.max_flush_us);
+        cJSON_AddNumberToObject(flush, "pendingSamples", flush_stats.pending_samples);
+        cJSON_AddNumberToObject(flush, "detailRecordsFlushed", flush_stats.detail_records_flushed);
+        cJSON_AddNumberToObject(flush, "detailPageBytes", flush_stats.detail_page_bytes);
+        cJSON_AddNumberToObject(flush, "pendingDetailRecords", flush_stats.pending_detail_records);
+        cJSON_AddNumberToObject(flush, "strokeRecordsFlushed", flush_stats.stroke_records_flushed);
+        cJSON_AddNumberToObject(flush, "strokePageBytes", flush_stats.stroke_page_bytes);
+        cJSON_AddNumberToObject(flush, "pendingStrokeRecords", flush_stats.pending_stroke_records);
+        cJSON_AddNumberToObject(flush, "sessionsRecovered", flush_stats.sessions_recovered);
+        cJSON_AddNumberToObject(flush, "errors", flush_stats.errors);
+    }
+    
+    char *json_string = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    
+    if (json_string == NULL) {
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
+    
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+    httpd_resp_sendstr(req, json_string);
+    
+    free(json_string);
+    return ESP_OK;
+}
+
+/**
+ * Add free / minimum free / largest block / total of one heap region
+ */
+static void add_heap_region(cJSON *root, const char *name, uint32_t caps) {
+    cJSON *region = cJSON_AddObjectToObject(root, name);
+    if (region != NULL) {
+        cJSON_AddNumberToObject(region, "total", heap_caps_get_total_size(caps));
+        cJSON_AddNumberToObject(region, "free", heap_caps_get_free_size(caps));
+        cJSON_AddNumberToObject(region, "minFree", heap_caps_get_minimum_free_size(caps));
+        cJSON_AddNumberToObject(region, "largestFreeBlock", heap_caps_get_largest_free_block(caps));
+    }
+}
+
+/**
+ * API endpoint: Heap telemetry
+ * Internal RAM and PSRAM usage, and what the per-second session series holds
+ */
+static esp_err_t api_heap_handler(httpd_req_t *req) {
+    cJSON *root = cJSON_CreateObject();
+    if (root == NULL) {
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
+    
+    add_heap_region(root, "internal", MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    add_heap_region(root, "psram", MALLOC_CAP_SPIRAM);
+    
+    session_series_memory_t memory;
+    session_series_get_memory(&memory);
+    cJSON *series = cJSON_AddObjectToObject(root, "sessionSeries");
+    if (series != NULL) {
+        cJSON_AddNumberToObject(series, "capacity", memory.capacity);
+        cJSON_AddNumberToObject(series, "rows", session_series_count());
+        cJSON_AddNumberToObject(series, "rowBytes", memory.row_bytes);
+        cJSON_AddNumberToObject(series, "bytes", memory.bytes);
+        cJSON_AddStringToObject(series, "location", memory.psram ? "psram" : "internal");
+        cJSON_AddNumberToObject(series, "replacedBytes", memory.replaced_bytes);
+        cJSON_AddNumberToObject(series, "savedBytes", memory.replaced_bytes - memory.bytes);
+    }
+    
+    session_detail_stats_t detail;
+    session_detail_get_stats(&detail);
+    cJSON *ring = cJSON_AddObjectToObject(root, "detailRing");
+    if (ring != NULL) {
+        cJSON_AddNumberToObject(ring, "capacity", detail.capacity);
+        cJSON_AddNumberToObject(ring, "bytes", detail.bytes);
+        cJSON_AddStringToObject(ring, "location", detail.psram ? "psram" : "internal");
+        cJSON_AddNumberToObject(ring, "pending", session_detail_pending());
+        cJSON_AddNumberToObject(ring, "highWatermark", detail.high_watermark);
+        cJSON_AddNumberToObject(ring, "dropped", detail.dropped);
+    }
+    
+    stroke_record_stats_t strokes;
+    stroke_record_get_stats(&strokes);
+    cJSON *stroke_ring = cJSON_AddObjectToObject(root, "strokeRing");
+    if (stroke_ring != NULL) {
+        cJSON_AddNumberToObject(stroke_ring, "capacity", strokes.capacity);
+        cJSON_AddNumberToObject(stroke_ring, "bytes", strokes.capacity * sizeof(stroke_record_t));
+        cJSON_AddNumberToObject(stroke_ring, "records", strokes.records);
+        cJSON_AddNumberToObject(stroke_ring, "pending", stroke_record_pending());
+        cJSON_AddNumberToObject(stroke_ring, "highWatermark", strokes.high_watermark);
+        cJSON_AddNumberToObject(stroke_ring, "dropped", strokes.dropped);
+    }
+    
+    char *json_string = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    
+    if (json_string == NULL) {
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
+    
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+    httpd_resp_sendstr(req, json_string);
+    
+    free(json_string);
+    return ESP_OK;
+}
+
+/**
+ * GET /api/recording - Recording profiles and what they cost
+ * ?minutes=N sets the session length checked (default RECORDING_PLANNED_MINUTES).
+ */
+static esp_err_t api_recording_handler(httpd_req_t *req) {
+    uint32_t minutes = RECORDING_PLANNED_MINUTES;
+    char query[32];
+    char param[8];
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+        httpd_query_key_value(query, "minutes", param, sizeof(param)) == ESP_OK) {
+        int val = atoi(param);
+        minutes = (val > 0 && val <= 24 * 60) ? (uint32_t)val : RECORDING_PLANNED_MINUTES;
+    }
+    
+    cJSON *root = cJSON_CreateObject();
+    if (root == NULL) {
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
+    cJSON_AddStringToObject(root, "profile", session_detail_profile_name(session_manager_get_recording_profile()));
+    cJSON_AddNumberToObject(root, "minutes", minutes);
+    
+    session_store_stats_t store;
+    session_store_get_stats(&store);
+    cJSON_AddNumberToObject(root, "bytesFree", store.bytes_free);
+    cJSON_AddNumberToObject(root, "bytesCapacity", store.bytes_capacity);
+    
+    cJSON *profiles = cJSON_AddArrayToObject(root, "profiles");
+    for (int p = 0; profiles != NULL && p < RECORDING_PROFILE_COUNT; p++) {
+        recording_estimate_t estimate;
+        if (session_manager_estimate_recording((recording_profile_t)p, minutes, &estimate) != ESP_OK) {
+            continue;
+        }
+        cJSON *item = cJSON_CreateObject();
+        if (item == NULL) {
+            break;
+        }
+        cJSON_AddStringToObject(item, "profile", session_detail_profile_name((recording_profile_t)p));
+        cJSON_AddNumberToObject(item, "recordsPerMinute", estimate.records_per_minute);
+        cJSON_AddNumberToObject(item, "strokesPerMinute", estimate.strokes_per_minute);
+        cJSON_AddNumberToObject(item, "bytesPerMinute", estimate.bytes_per_minute);
+        cJSON_AddNumberToObject(item, "bytes", estimate.bytes);
+        cJSON_AddNumberToObject(item, "freeMinutes", estimate.free_minutes);
+        cJSON_AddNumberToObject(item, "maxMinutes", estimate.max_minutes);
+        cJSON_AddBoolToObject(item, "fits", estimate.fits);
+        cJSON_AddBoolToObject(item, "measured", estimate.measured);
+        cJSON_AddItemToArray(profiles, item);
+    }
+    
     char *json_string = cJSON_PrintUnformatted(root);
     cJSON_Delete(root);
     
@@ -346,7 +626,9 @@ static esp_err_t api_reset_handler(httpd_req_t *req) {
         return ESP_FAIL;
     }
     
+    metrics_calculator_begin_update();
     metrics_calculator_reset(g_metrics);
+    metrics_calculator_end_update(g_metrics);
     
     cJSON *root = cJSON_CreateObject();
     cJSON_AddBoolToObject(root, "success", true);
@@ -380,11 +662,13 @@ static esp_err_t api_calibrate_inertia_start_handler(httpd_req_t *req) {
     
     bool drag_was_uncalibrated = false;
 
+    // Same lock order as the sensor task: metrics first, then calibration
+    metrics_calculator_begin_update();
     CAL_MUTEX_TAKE();
 
     // Use default drag coefficient if not yet calibrated
     // This allows inertia calibration before rowing
-    if (g_metrics->drag_calibration_samples < 10) {
+    if (!g_metrics->calibration_complete) {
         g_metrics->drag_coefficient = g_config->initial_drag_coefficient;
         drag_was_uncalibrated = true;
         ESP_LOGI(TAG, "Using default drag coefficient %.6f for inertia calibration",
@@ -400,6 +684,7 @@ static esp_err_t api_calibrate_inertia_start_handler(httpd_req_t *req) {
     message_copy[sizeof(message_copy) - 1] = '\0';
 
     CAL_MUTEX_GIVE();
+    metrics_calculator_end_update(g_metrics);
 
     cJSON *root = cJSON_CreateObject();
     cJSON_AddBoolToObject(root, "success", true);
@@ -412,7 +697,7 @@ static esp_err_t api_calibrate_inertia_start_handler(httpd_req_t *req) {
     if (drag_was_uncalibrated) {
         cJSON_AddStringToObject(root, "warning",
             "Drag coefficient has not been auto-calibrated yet. "
-            "Row at least ~50 strokes first, then re-run inertia calibration "
+            "Row a few strokes first, then re-run inertia calibration "
             "for an accurate result.");
     }
     
@@ -510,9 +795,11 @@ static esp_err_t api_calibrate_inertia_cancel_handler(httpd_req_t *req) {
  */
 static esp_err_t api_calibrate_inertia_apply_handler(httpd_req_t *req) {
     // Atomically check state and consume the calibrated value.
+    metrics_calculator_begin_update();
     CAL_MUTEX_TAKE();
     if (g_inertia_calibration.state != CALIBRATION_COMPLETE) {
         CAL_MUTEX_GIVE();
+        metrics_calculator_end_update(g_metrics);
         cJSON *root = cJSON_CreateObject();
         cJSON_AddBoolToObject(root, "success", false);
         cJSON_AddStringToObject(root, "error", "No calibration result to apply");
@@ -535,6 +822,7 @@ static esp_err_t api_calibrate_inertia_apply_handler(httpd_req_t *req) {
     // tick can never race with the apply.
     g_inertia_calibration.state = CALIBRATION_IDLE;
     CAL_MUTEX_GIVE();
+    metrics_calculator_end_update(g_metrics);
 
     // Save to NVS (outside mutex — NVS write may block)
     config_manager_save(g_config);
@@ -570,11 +858,14 @@ static esp_err_t api_config_handler(httpd_req_t *req) {
         cJSON_AddNumberToObject(root, "userWeight", g_config->user_weight_kg);
         cJSON_AddNumberToObject(root, "momentOfInertia", g_config->moment_of_inertia);
         cJSON_AddNumberToObject(root, "distanceCalibration", g_config->distance_calibration_factor);
+        cJSON_AddNumberToObject(root, "dragForgettingFactor", g_config->drag_forgetting_factor);
         cJSON_AddStringToObject(root, "units", g_config->units);
         cJSON_AddBoolToObject(root, "showPower", g_config->show_power);
         cJSON_AddBoolToObject(root, "showCalories", g_config->show_calories);
         cJSON_AddNumberToObject(root, "autoPauseSeconds", g_config->auto_pause_seconds);
         cJSON_AddNumberToObject(root, "maxHeartRate", g_config->max_heart_rate);
+        cJSON_AddStringToObject(root, "recordingProfile",
+                                session_detail_profile_name((recording_profile_t)g_config->recording_profile));
         
         char *json_string = cJSON_PrintUnformatted(root);
         cJSON_Delete(root);
@@ -610,6 +901,11 @@ static esp_err_t api_config_handler(httpd_req_t *req) {
         float val = (float)cJSON_GetNumberValue(item);
         g_config->moment_of_inertia = (val >= 0.01f && val <= 1.0f) ? val : 0.101f;
     }
+    if ((item = cJSON_GetObjectItem(root, "dragForgettingFactor")) != NULL) {
+        // Applied from the next boot
+        float val = (float)cJSON_GetNumberValue(item);
+        g_config->drag_forgetting_factor = (val >= 0.5f && val <= 1.0f) ? val : DRAG_FORGETTING_FACTOR;
+    }
     if ((item = cJSON_GetObjectItem(root, "units")) != NULL) {
         strncpy(g_config->units, cJSON_GetStringValue(item), sizeof(g_config->units) - 1);
     }
@@ -625,7 +921,17 @@ static esp_err_t api_config_handler(httpd_req_t *req) {
     }
     if ((item = cJSON_GetObjectItem(root, "maxHeartRate")) != NULL) {
         int val = (int)cJSON_GetNumberValue(item);
-        g_config->max_heart_rate = (val >= 100 && val <= 220) ? (uint8_t)val : 190;
+        g_config->max_heart_rate = (val >= 100 && val <= 220) ? (uint8_t)val : DEFAULT_MAX_HEART_RATE;
+        session_series_set_max_heart_rate(g_config->max_heart_rate);
+    }
+    if ((item = cJSON_GetObjectItem(root, "recordingProfile")) != NULL) {
+        // Applies from the next session; unknown names keep the current profile
+        recording_profile_t profile;
+        const char *name = cJSON_GetStringValue(item);
+        if (name != NULL && session_detail_parse_profile(name, &profile)) {
+            g_config->recording_profile = (uint8_t)profile;
+            session_manager_set_recording_profile(profile);
+        }
     }
     
     cJSON_Delete(root);
@@ -718,55 +1024,215 @@ static esp_err_t hr_get_handler(httpd_req_t *req) {
 // Maximum number of sessions to return per request
 #define MAX_SESSIONS_PER_PAGE 20
 
+// Scratch for streamed session responses. httpd runs handlers on one task,
+// so these are never used by two requests at once.
+static char s_session_chunk_buf[1024];
+static sample_data_t s_session_slice[SESSION_JSON_SLICE_SAMPLES];
+
+/**
+ * json_writer sink: send one HTTP chunk
+ */
+static bool http_chunk_sink(void *ctx, const char *data, size_t len) {
+    return httpd_resp_send_chunk((httpd_req_t *)ctx, data, len) == ESP_OK;
+}
+
 /**
  * GET /api/sessions - List all stored sessions
  */
 static esp_err_t api_sessions_list_handler(httpd_req_t *req) {
-    cJSON *root = cJSON_CreateObject();
-    cJSON *sessions = cJSON_CreateArray();
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
     
-    uint32_t count = session_manager_get_session_count();
+    json_writer_t writer;
+    json_writer_init(&writer, s_session_chunk_buf, sizeof(s_session_chunk_buf), http_chunk_sink, req);
+    json_writer_begin_object(&writer, NULL);
+    json_writer_begin_array(&writer, "sessions");
     
-    // Get sessions in reverse order (newest first), limit to MAX_SESSIONS_PER_PAGE
-    int start = (int)count;
-    int end = (count > MAX_SESSIONS_PER_PAGE) ? (int)(count - MAX_SESSIONS_PER_PAGE) : 0;
+    uint32_t ids[SESSION_STORE_MAX_SESSIONS];
+    uint32_t count = session_manager_list_sessions(ids, SESSION_STORE_MAX_SESSIONS);
     
-    for (int i = start; i > end; i--) {
+    // Newest first, limit to MAX_SESSIONS_PER_PAGE
+    uint32_t end = (count > MAX_SESSIONS_PER_PAGE) ? count - MAX_SESSIONS_PER_PAGE : 0;
+    
+    for (uint32_t i = count; i > end; i--) {
         session_record_t record;
-        if (session_manager_get_session((uint32_t)i, &record) == ESP_OK) {
-            cJSON *session = cJSON_CreateObject();
-            cJSON_AddNumberToObject(session, "id", record.session_id);
-            cJSON_AddNumberToObject(session, "startTime", (double)record.start_timestamp);
-            cJSON_AddNumberToObject(session, "duration", record.duration_seconds);
-            cJSON_AddNumberToObject(session, "distance", record.total_distance_meters);
-            cJSON_AddNumberToObject(session, "strokes", record.stroke_count);
-            cJSON_AddNumberToObject(session, "calories", record.total_calories);
-            cJSON_AddNumberToObject(session, "avgPower", record.average_power_watts);
-            cJSON_AddNumberToObject(session, "avgPace", record.average_pace_sec_500m);
-            cJSON_AddNumberToObject(session, "dragFactor", record.drag_factor);
-            cJSON_AddNumberToObject(session, "avgHeartRate", record.average_heart_rate);
-            cJSON_AddNumberToObject(session, "maxHeartRate", record.max_heart_rate);
-            cJSON_AddBoolToObject(session, "synced", record.synced);
-            cJSON_AddItemToArray(sessions, session);
+        if (session_manager_get_session(ids[i - 1], &record) == ESP_OK) {
+            json_writer_begin_object(&writer, NULL);
+            session_json_write_summary(&writer, &record);
+            json_writer_end_object(&writer);
         }
     }
     
-    cJSON_AddItemToObject(root, "sessions", sessions);
+    json_writer_end_array(&writer);
+    json_writer_end_object(&writer);
     
-    char *json_string = cJSON_PrintUnformatted(root);
-    cJSON_Delete(root);
+    if (!json_writer_finish(&writer)) {
+        // Headers are gone; the client sees a truncated body
+        ESP_LOGW(TAG, "Session list aborted after %lu bytes", (unsigned long)writer.total);
+        httpd_resp_send_chunk(req, NULL, 0);
+        return ESP_FAIL;
+    }
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+#define SESSION_SAMPLES_SUFFIX "/samples.bin"
+#define SESSION_PAGES_SUFFIX "/pages.bin"
+
+/**
+ * ?records=strokes asks for the stroke records
+ */
+static bool query_strokes(httpd_req_t *req) {
+    char query[64];
+    char value[16];
+    return httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+           httpd_query_key_value(query, "records", value, sizeof(value)) == ESP_OK &&
+           strcmp(value, "strokes") == 0;
+}
+
+/**
+ * Recording profile asked for with ?profile= (per-second samples if absent)
+ * @return false if the name is unknown
+ */
+static bool query_profile(httpd_req_t *req, recording_profile_t *profile) {
+    *profile = RECORDING_PROFILE_1HZ;
+    char query[64];
+    char name[16];
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) != ESP_OK ||
+        httpd_query_key_value(query, "profile", name, sizeof(name)) != ESP_OK) {
+        return true;
+    }
+    return session_detail_parse_profile(name, profile);
+}
+
+/**
+ * GET /api/sessions/{id}/samples.bin - Raw per-second samples
+ * GET /api/sessions/{id}/pages.bin - The same, compressed as stored
+ * Header + packed sample_data_t or sample_codec pages (see
+ * session_samples.h), with a strong ETag (If-None-Match -> 304) and single
+ * byte ranges (Range/If-Range -> 206) so interrupted downloads can resume.
+ * ?profile=10hz or ?profile=pulse returns the session's high-resolution
+ * records instead, ?records=strokes its stroke records.
+ */
+static esp_err_t api_session_samples_handler(httpd_req_t *req, bool pages) {
+    // Parse session ID from URI: /api/sessions/123/samples.bin?profile=10hz
+    const char *uri = req->uri;
+    const char *id_end = uri + strcspn(uri, "?") - strlen(pages ? SESSION_PAGES_SUFFIX : SESSION_SAMPLES_SUFFIX);
+    const char *id_start = id_end;
+    while (id_start > uri && *(id_start - 1) != '/') {
+        id_start--;
+    }
     
-    if (json_string == NULL) {
-        httpd_resp_send_500(req);
+    char id_str[16];
+    size_t id_len = id_end - id_start;
+    if (id_len == 0 || id_len >= sizeof(id_str)) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid session ID");
         return ESP_FAIL;
     }
+    memcpy(id_str, id_start, id_len);
+    id_str[id_len] = '\0';
+    for (const char *p = id_str; *p != '\0'; p++) {
+        if (*p < '0' || *p > '9') {
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid session ID format");
+            return ESP_FAIL;
+        }
+    }
+    
+    long session_id_long = strtol(id_str, NULL, 10);
+    if (session_id_long <= 0 || session_id_long > UINT32_MAX) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid session ID");
+        return ESP_FAIL;
+    }
+    uint32_t session_id = (uint32_t)session_id_long;
+    
+    recording_profile_t profile;
+    if (!query_profile(req, &profile)) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Unknown profile");
+        return ESP_FAIL;
+    }
+    
+    session_samples_doc_t doc;
+    if (query_strokes(req)) {
+        if (session_samples_open_strokes(session_id, pages, &doc) != ESP_OK) {
+            httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Session not found");
+            return ESP_FAIL;
+        }
+    } else if (session_samples_open(session_id, pages, profile, &doc) != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, profile == RECORDING_PROFILE_1HZ ?
+                            "Session not found" : "Session not recorded with this profile");
+        return ESP_FAIL;
+    }
+    
+    // Header values must stay valid until the response is sent
+    char etag[SESSION_SAMPLES_ETAG_LEN];
+    char content_range[48];
+    char request_hdr[96];
+    session_samples_etag(&doc, etag, sizeof(etag));
+    uint32_t size = session_samples_size(&doc);
     
-    httpd_resp_set_type(req, "application/json");
     httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
-    httpd_resp_sendstr(req, json_string);
+    httpd_resp_set_hdr(req, "Access-Control-Expose-Headers", "ETag, Content-Range, Accept-Ranges");
+    httpd_resp_set_hdr(req, "ETag", etag);
+    httpd_resp_set_hdr(req, "Accept-Ranges", "bytes");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
     
-    free(json_string);
-    return ESP_OK;
+    if (httpd_req_get_hdr_value_str(req, "If-None-Match", request_hdr, sizeof(request_hdr)) == ESP_OK &&
+        session_samples_etag_matches(request_hdr, etag)) {
+        httpd_resp_set_status(req, "304 Not Modified");
+        return httpd_resp_send(req, NULL, 0);
+    }
+    
+    // A Range only applies while the client's copy is still current (If-Range)
+    uint32_t first = 0;
+    uint32_t last = size - 1;
+    session_samples_range_t range = SESSION_SAMPLES_RANGE_NONE;
+    if (httpd_req_get_hdr_value_str(req, "Range", request_hdr, sizeof(request_hdr)) == ESP_OK) {
+        range = session_samples_parse_range(request_hdr, size, &first, &last);
+        char if_range[SESSION_SAMPLES_ETAG_LEN + 8];
+        if (range != SESSION_SAMPLES_RANGE_NONE &&
+            httpd_req_get_hdr_value_str(req, "If-Range", if_range, sizeof(if_range)) == ESP_OK &&
+            strcmp(if_range, etag) != 0) {
+            range = SESSION_SAMPLES_RANGE_NONE;
+            first = 0;
+            last = size - 1;
+        }
+    }
+    
+    if (range == SESSION_SAMPLES_RANGE_UNSATISFIABLE) {
+        snprintf(content_range, sizeof(content_range), "bytes */%lu", (unsigned long)size);
+        httpd_resp_set_hdr(req, "Content-Range", content_range);
+        httpd_resp_set_status(req, "416 Range Not Satisfiable");
+        return httpd_resp_send(req, NULL, 0);
+    }
+    if (range == SESSION_SAMPLES_RANGE_OK) {
+        snprintf(content_range, sizeof(content_range), "bytes %lu-%lu/%lu",
+                 (unsigned long)first, (unsigned long)last, (unsigned long)size);
+        httpd_resp_set_hdr(req, "Content-Range", content_range);
+        httpd_resp_set_status(req, "206 Partial Content");
+    }
+    httpd_resp_set_type(req, "application/octet-stream");
+    
+    // Stream the range in chunks straight from the session store
+    uint32_t offset = first;
+    while (offset <= last) {
+        uint32_t want = last - offset + 1;
+        if (want > sizeof(s_session_chunk_buf)) {
+            want = sizeof(s_session_chunk_buf);
+        }
+        uint32_t got = 0;
+        if (session_samples_read(&doc, offset, (uint8_t *)s_session_chunk_buf, want, &got) != ESP_OK ||
+            got == 0) {
+            // Stored samples are shorter than the record says; end the body
+            // early so the client sees a short transfer rather than padding
+            ESP_LOGW(TAG, "Session %lu samples unreadable at byte %lu",
+                     (unsigned long)session_id, (unsigned long)offset);
+            break;
+        }
+        if (httpd_resp_send_chunk(req, s_session_chunk_buf, got) != ESP_OK) {
+            return ESP_FAIL;
+        }
+        offset += got;
+    }
+    return httpd_resp_send_chunk(req, NULL, 0);
 }
 
 /**
@@ -775,11 +1241,24 @@ static esp_err_t api_sessions_list_handler(httpd_req_t *req) {
  * - heartRateSamples: [{time, bpm}]
  * - powerSamples: [{time, watts}]
  * - speedSamples: [{time, metersPerSecond}]
- * Also provides legacy format for internal UI: paceSamples[], hrSamples[], powerSamplesArray[]
+ * Streamed with chunked encoding, so full-length sessions are returned
+ * without building the document in memory.
  */
 static esp_err_t api_session_detail_handler(httpd_req_t *req) {
-    // Parse session ID from URI: /api/sessions/123
+    // /api/sessions/123/samples.bin and pages.bin share this wildcard route
+    // (their query string is not part of the suffix)
     const char *uri = req->uri;
+    size_t uri_len = strcspn(uri, "?");
+    size_t suffix_len = strlen(SESSION_SAMPLES_SUFFIX);
+    if (uri_len > suffix_len && strncmp(uri + uri_len - suffix_len, SESSION_SAMPLES_SUFFIX, suffix_len) == 0) {
+        return api_session_samples_handler(req, false);
+    }
+    suffix_len = strlen(SESSION_PAGES_SUFFIX);
+    if (uri_len > suffix_len && strncmp(uri + uri_len - suffix_len, SESSION_PAGES_SUFFIX, suffix_len) == 0) {
+        return api_session_samples_handler(req, true);
+    }
+    
+    // Parse session ID from URI: /api/sessions/123
     const char *id_start = strrchr(uri, '/');
     if (id_start == NULL || *(id_start + 1) == '\0') {
         httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid session ID");
@@ -809,94 +1288,23 @@ static esp_err_t api_session_detail_handler(httpd_req_t *req) {
         return ESP_FAIL;
     }
     
-    cJSON *root = cJSON_CreateObject();
-    cJSON_AddNumberToObject(root, "id", record.session_id);
-    cJSON_AddNumberToObject(root, "startTime", (double)record.start_timestamp);
-    cJSON_AddNumberToObject(root, "duration", record.duration_seconds);
-    cJSON_AddNumberToObject(root, "distance", record.total_distance_meters);
-    cJSON_AddNumberToObject(root, "strokes", record.stroke_count);
-    cJSON_AddNumberToObject(root, "calories", record.total_calories);
-    cJSON_AddNumberToObject(root, "avgPower", record.average_power_watts);
-    cJSON_AddNumberToObject(root, "avgPace", record.average_pace_sec_500m);
-    cJSON_AddNumberToObject(root, "dragFactor", record.drag_factor);
-    cJSON_AddNumberToObject(root, "avgHeartRate", record.average_heart_rate);
-    cJSON_AddNumberToObject(root, "maxHeartRate", record.max_heart_rate);
-    cJSON_AddBoolToObject(root, "synced", record.synced);
-    
-    // Sample arrays for companion app (Health Connect format with time/value objects)
-    cJSON *heartRateSamples = cJSON_CreateArray();
-    cJSON *powerSamples = cJSON_CreateArray();
-    cJSON *speedSamples = cJSON_CreateArray();
-    
-    // Load per-second sample data if available
-    if (record.sample_count > 0) {
-        // Allocate buffer for samples (limit to avoid memory issues)
-        uint32_t max_samples = record.sample_count;
-        if (max_samples > 3600) max_samples = 3600;  // Limit to 1 hour for JSON response
-        
-        sample_data_t *samples = malloc(max_samples * sizeof(sample_data_t));
-        if (samples != NULL) {
-            uint32_t actual_count = 0;
-            if (session_manager_get_samples(session_id, samples, max_samples, &actual_count) == ESP_OK && actual_count > 0) {
-                // start_timestamp is now Unix epoch milliseconds (when SNTP is synced)
-                // or milliseconds since boot (fallback when SNTP not available)
-                // The companion app receives this directly as the base time
-                int64_t base_time_ms = record.start_timestamp;  // Already in milliseconds
-                
-                for (uint32_t i = 0; i < actual_count; i++) {
-                    int64_t sample_time_ms = base_time_ms + (i * 1000);  // 1 second per sample
-                    
-                    // Convert velocity from cm/s to m/s
-                    float velocity_m_s = samples[i].velocity_cm_s / 100.0f;
-                    
-                    // Heart rate samples (Health Connect format)
-                    if (samples[i].heart_rate > 0) {
-                        cJSON *hrSample = cJSON_CreateObject();
-                        cJSON_AddNumberToObject(hrSample, "time", (double)sample_time_ms);
-                        cJSON_AddNumberToObject(hrSample, "bpm", samples[i].heart_rate);
-                        cJSON_AddItemToArray(heartRateSamples, hrSample);
-                    }
-                    
-                    // Power samples (Health Connect format)
-                    {
-                        cJSON *pwrSample = cJSON_CreateObject();
-                        cJSON_AddNumberToObject(pwrSample, "time", (double)sample_time_ms);
-                        cJSON_AddNumberToObject(pwrSample, "watts", samples[i].power_watts);
-                        cJSON_AddItemToArray(powerSamples, pwrSample);
-                    }
-                    
-                    // Speed samples (Health Connect format)
-                    {
-                        cJSON *spdSample = cJSON_CreateObject();
-                        cJSON_AddNumberToObject(spdSample, "time", (double)sample_time_ms);
-                        cJSON_AddNumberToObject(spdSample, "metersPerSecond", velocity_m_s);
-                        cJSON_AddItemToArray(speedSamples, spdSample);
-                    }
-                }
-            }
-            free(samples);
-        }
-    }
-    
-    // Add sample arrays (Health Connect format)
-    cJSON_AddItemToObject(root, "heartRateSamples", heartRateSamples);
-    cJSON_AddItemToObject(root, "powerSamples", powerSamples);
-    cJSON_AddItemToObject(root, "speedSamples", speedSamples);
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
     
-    char *json_string = cJSON_PrintUnformatted(root);
-    cJSON_Delete(root);
+    json_writer_t writer;
+    json_writer_init(&writer, s_session_chunk_buf, sizeof(s_session_chunk_buf), http_chunk_sink, req);
+    bool samples_ok = session_json_write_detail(&writer, &record, s_session_slice);
     
-    if (json_string == NULL) {
-        httpd_resp_send_500(req);
+    if (!json_writer_finish(&writer)) {
+        ESP_LOGW(TAG, "Session %lu detail aborted after %lu bytes",
+                 (unsigned long)session_id, (unsigned long)writer.total);
+        httpd_resp_send_chunk(req, NULL, 0);
         return ESP_FAIL;
     }
-    
-    httpd_resp_set_type(req, "application/json");
-    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
-    httpd_resp_sendstr(req, json_string);
-    
-    free(json_string);
-    return ESP_OK;
+    if (!samples_ok) {
+        ESP_LOGW(TAG, "Session %lu samples could not be read", (unsigned long)session_id);
+    }
+    return httpd_resp_send_chunk(req, NULL, 0);
 }
 
 /**
@@ -1070,6 +1478,8 @@ static esp_err_t workout_start_handler(httpd_req_t *req) {
     
     uint32_t session_id = session_manager_get_current_session_id();
     
+    metrics_calculator_begin_update();
+    
     // Check if we have an existing session that's paused - resume it instead of starting new
     if (session_id > 0 && g_metrics->is_paused) {
         // Resume existing paused session
@@ -1091,6 +1501,7 @@ static esp_err_t workout_start_handler(httpd_req_t *req) {
         g_metrics->is_paused = false;
         g_metrics->pause_start_time_us = 0;
         g_metrics->last_resume_time_us = now;  // Track when we resumed for auto-pause logic
+        metrics_calculator_end_update(g_metrics);
         
         cJSON *root = cJSON_CreateObject();
         cJSON_AddStringToObject(root, "status", "resumed");
@@ -1109,14 +1520,27 @@ static esp_err_t workout_start_handler(httpd_req_t *req) {
         return ESP_OK;
     }
     
-    // Start HR recording
-    hr_receiver_start_recording();
-    
     // Reset metrics for new workout
     metrics_calculator_reset(g_metrics);
     
     // Start a new session
-    session_manager_start_session(g_metrics);
+    esp_err_t ret = session_manager_start_session(g_metrics);
+    metrics_calculator_end_update(g_metrics);
+    
+    // The last session is still being stored: finish it here, outside the
+    // update lock, and try again
+    for (int attempt = 0; ret == ESP_ERR_NOT_FINISHED && attempt < WORKOUT_START_ATTEMPTS; attempt++) {
+        session_manager_flush();
+        metrics_calculator_begin_update();
+        metrics_calculator_reset(g_metrics);
+        ret = session_manager_start_session(g_metrics);
+        metrics_calculator_end_update(g_metrics);
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Workout start failed: %s", esp_err_to_name(ret));
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
     
     session_id = session_manager_get_current_session_id();
     
@@ -1124,6 +1548,19 @@ static esp_err_t workout_start_handler(httpd_req_t *req) {
     cJSON_AddStringToObject(root, "status", "started");
     cJSON_AddNumberToObject(root, "sessionId", session_id);
     
+    // What the session's recording profile costs, and a warning when a
+    // full-length session would not fit
+    recording_profile_t profile = session_manager_get_recording_profile();
+    recording_estimate_t estimate;
+    cJSON_AddStringToObject(root, "recordingProfile", session_detail_profile_name(profile));
+    if (session_manager_estimate_recording(profile, RECORDING_PLANNED_MINUTES, &estimate) == ESP_OK) {
+        cJSON_AddNumberToObject(root, "recordingMinutesFree", estimate.free_minutes);
+        if (!estimate.fits) {
+            cJSON_AddStringToObject(root, "recordingWarning", estimate.max_minutes < RECORDING_PLANNED_MINUTES ?
+                                    "Session exceeds storage" : "Older sessions will be dropped");
+        }
+    }
+    
     char *json_string = cJSON_PrintUnformatted(root);
     cJSON_Delete(root);
     
@@ -1146,6 +1583,8 @@ static esp_err_t workout_stop_handler(httpd_req_t *req) {
         return ESP_FAIL;
     }
     
+    metrics_calculator_begin_update();
+    
     // Clear any paused state before stopping
     if (g_metrics->is_paused) {
         int64_t now = esp_timer_get_time();
@@ -1157,27 +1596,42 @@ static esp_err_t workout_stop_handler(httpd_req_t *req) {
         g_metrics->pause_start_time_us = 0;
     }
     
-    // Stop HR recording
-    hr_receiver_stop_recording();
-    
     uint32_t session_id = session_manager_get_current_session_id();
     
     // End the session and save
     session_manager_end_session(g_metrics);
     
+    float distance_m = g_metrics->total_distance_meters;
+    uint32_t strokes = g_metrics->stroke_count;
+    uint32_t calories = g_metrics->total_calories;
+    metrics_calculator_end_update(g_metrics);
+    
+    // A raw trace covers at most one session; stopping it waits for the
+    // trace writer, so it runs after the update lock is released
+    if (trace_recorder_is_recording()) {
+        trace_recorder_stop();
+    }
+    
     cJSON *root = cJSON_CreateObject();
     cJSON_AddStringToObject(root, "status", "stopped");
     cJSON_AddNumberToObject(root, "sessionId", session_id);
-    cJSON_AddNumberToObject(root, "distance", g_metrics->total_distance_meters);
-    cJSON_AddNumberToObject(root, "strokes", g_metrics->stroke_count);
-    cJSON_AddNumberToObject(root, "calories", g_metrics->total_calories);
-    
-    uint8_t avg_hr, max_hr;
-    uint16_t hr_count;
-    hr_receiver_get_stats(&avg_hr, &max_hr, &hr_count);
-    cJSON_AddNumberToObject(root, "hrSamples", hr_count);
-    cJSON_AddNumberToObject(root, "avgHeartRate", avg_hr);
-    cJSON_AddNumberToObject(root, "maxHeartRate", max_hr);
+    cJSON_AddNumberToObject(root, "distance", distance_m);
+    cJSON_AddNumberToObject(root, "strokes", strokes);
+    cJSON_AddNumberToObject(root, "calories", calories);
+    
+    // Heart rate of the session's samples (kept until the next session starts)
+    session_series_stats_t hr_stats;
+    session_series_get_stats(&hr_stats);
+    cJSON_AddNumberToObject(root, "hrSamples", hr_stats.hr_samples);
+    cJSON_AddNumberToObject(root, "avgHeartRate", hr_stats.avg_hr);
+    cJSON_AddNumberToObject(root, "maxHeartRate", hr_stats.max_hr);
+    cJSON *zones = cJSON_CreateArray();
+    if (zones != NULL) {
+        for (int zone = 0; zone < HR_ZONE_COUNT; zone++) {
+            cJSON_AddItemToArray(zones, cJSON_CreateNumber(hr_stats.zone_seconds[zone]));
+        }
+        cJSON_AddItemToObject(root, "hrZoneSeconds", zones);
+    }
     
     char *json_string = cJSON_PrintUnformatted(root);
     cJSON_Delete(root);
@@ -1204,9 +1658,15 @@ static esp_err_t workout_pause_handler(httpd_req_t *req) {
     cJSON *root = cJSON_CreateObject();
     
     // Set paused state and record when pause started
-    if (!g_metrics->is_paused) {
+    metrics_calculator_begin_update();
+    bool was_paused = g_metrics->is_paused;
+    if (!was_paused) {
         g_metrics->is_paused = true;
         g_metrics->pause_start_time_us = esp_timer_get_time();
+    }
+    metrics_calculator_end_update(g_metrics);
+    
+    if (!was_paused) {
         cJSON_AddStringToObject(root, "status", "paused");
         cJSON_AddBoolToObject(root, "success", true);
         ESP_LOGI(TAG, "Workout paused via API");
@@ -1238,9 +1698,12 @@ static esp_err_t workout_resume_handler(httpd_req_t *req) {
     cJSON *root = cJSON_CreateObject();
     
     // Resume from paused state
-    if (g_metrics->is_paused) {
+    metrics_calculator_begin_update();
+    bool was_paused = g_metrics->is_paused;
+    int64_t paused_duration_us = 0;
+    if (was_paused) {
         int64_t now = esp_timer_get_time();
-        int64_t paused_duration_us = now - g_metrics->pause_start_time_us;
+        paused_duration_us = now - g_metrics->pause_start_time_us;
         // Prevent negative/overflow issues
         if (paused_duration_us > 0) {
             g_metrics->total_paused_time_ms += (uint32_t)(paused_duration_us / 1000);
@@ -1248,6 +1711,10 @@ static esp_err_t workout_resume_handler(httpd_req_t *req) {
         g_metrics->is_paused = false;
         g_metrics->pause_start_time_us = 0;
         g_metrics->last_resume_time_us = now;  // Track when we resumed for auto-pause logic
+    }
+    metrics_calculator_end_update(g_metrics);
+    
+    if (was_paused) {
         cJSON_AddStringToObject(root, "status", "resumed");
         cJSON_AddBoolToObject(root, "success", true);
         ESP_LOGI(TAG, "Workout resumed via API (was paused for %lu ms)", 
@@ -1270,34 +1737,59 @@ static esp_err_t workout_resume_handler(httpd_req_t *req) {
 
 /**
  * GET /live - Get live workout data
+ * Same body as /api/metrics, but 404 when no workout is in progress
  */
 static esp_err_t live_data_handler(httpd_req_t *req) {
-    if (g_metrics == NULL || !g_metrics->is_active) {
+    if (g_metrics == NULL) {
         httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "No workout in progress");
         return ESP_FAIL;
     }
     
-    cJSON *root = cJSON_CreateObject();
-    
-    cJSON_AddNumberToObject(root, "sessionId", session_manager_get_current_session_id());
-    cJSON_AddNumberToObject(root, "distance", g_metrics->total_distance_meters);
-    cJSON_AddNumberToObject(root, "strokes", g_metrics->stroke_count);
-    cJSON_AddNumberToObject(root, "duration", g_metrics->elapsed_time_ms / 1000);
-    cJSON_AddNumberToObject(root, "power", g_metrics->instantaneous_power_watts);
-    cJSON_AddNumberToObject(root, "pace", g_metrics->instantaneous_pace_sec_500m);
-    cJSON_AddNumberToObject(root, "strokeRate", g_metrics->stroke_rate_spm);
-    cJSON_AddNumberToObject(root, "heartRate", hr_receiver_get_current());
+    rowing_metrics_t snapshot;
+    metrics_calculator_get_snapshot(&snapshot);
+    if (!snapshot.is_active) {
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "No workout in progress");
+        return ESP_FAIL;
+    }
     
-    const char *phase = "idle";
-    if (g_metrics->current_phase == STROKE_PHASE_DRIVE) {
-        phase = "drive";
-    } else if (g_metrics->current_phase == STROKE_PHASE_RECOVERY) {
-        phase = "recovery";
+    metrics_frame_t *frame = metrics_frame_acquire();
+    if (frame == NULL) {
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
     }
-    cJSON_AddStringToObject(root, "phase", phase);
     
-    cJSON_AddNumberToObject(root, "avgPower", g_metrics->average_power_watts);
-    cJSON_AddNumberToObject(root, "avgPace", g_metrics->average_pace_sec_500m);
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+    httpd_resp_send(req, metrics_frame_json(frame), frame->json_len);
+    
+    metrics_frame_release(frame);
+    return ESP_OK;
+}
+
+// ============================================================================
+// Raw Pulse Trace Endpoints
+// ============================================================================
+
+// Chunk size used when streaming the trace partition
+#define TRACE_DOWNLOAD_CHUNK_SIZE 2048
+
+/**
+ * Send trace recorder status as JSON
+ */
+static esp_err_t send_trace_status(httpd_req_t *req) {
+    trace_recorder_status_t status;
+    trace_recorder_get_status(&status);
+    
+    cJSON *root = cJSON_CreateObject();
+    cJSON_AddBoolToObject(root, "recording", status.recording);
+    cJSON_AddBoolToObject(root, "available", status.available);
+    cJSON_AddBoolToObject(root, "finished", status.finished);
+    cJSON_AddNumberToObject(root, "events", status.event_count);
+    cJSON_AddNumberToObject(root, "bytes", status.data_bytes);
+    cJSON_AddNumberToObject(root, "dropped", status.dropped_events);
+    cJSON_AddNumberToObject(root, "capacity", status.capacity_bytes);
+    cJSON_AddNumberToObject(root, "fileSize", trace_recorder_get_size());
     
     char *json_string = cJSON_PrintUnformatted(root);
     cJSON_Delete(root);
@@ -1315,6 +1807,93 @@ static esp_err_t live_data_handler(httpd_req_t *req) {
     return ESP_OK;
 }
 
+/**
+ * GET /api/trace/status - Get trace recorder status
+ */
+static esp_err_t api_trace_status_handler(httpd_req_t *req) {
+    return send_trace_status(req);
+}
+
+/**
+ * POST /api/trace/start - Start recording a raw pulse trace
+ * Recording stops on POST /api/trace/stop or when the workout ends.
+ */
+static esp_err_t api_trace_start_handler(httpd_req_t *req) {
+    rowing_metrics_t snapshot;
+    metrics_calculator_get_snapshot(&snapshot);
+    esp_err_t ret = trace_recorder_start(&snapshot);
+    if (ret == ESP_ERR_INVALID_STATE && trace_recorder_is_recording()) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Trace already recording");
+        return ESP_FAIL;
+    }
+    if (ret != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Trace recording unavailable");
+        return ESP_FAIL;
+    }
+    
+    ESP_LOGI(TAG, "Trace recording started via API");
+    return send_trace_status(req);
+}
+
+/**
+ * POST /api/trace/stop - Stop recording and finalize the trace
+ */
+static esp_err_t api_trace_stop_handler(httpd_req_t *req) {
+    if (trace_recorder_stop() != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Trace not recording");
+        return ESP_FAIL;
+    }
+    
+    ESP_LOGI(TAG, "Trace recording stopped via API");
+    return send_trace_status(req);
+}
+
+/**
+ * GET /api/trace - Download the stored trace (binary, see trace_format.h)
+ */
+static esp_err_t api_trace_download_handler(httpd_req_t *req) {
+    uint32_t size = trace_recorder_get_size();
+    if (size == 0) {
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND,
+                            trace_recorder_is_recording() ? "Trace still recording" : "No trace stored");
+        return ESP_FAIL;
+    }
+    
+    uint8_t *chunk = malloc(TRACE_DOWNLOAD_CHUNK_SIZE);
+    if (chunk == NULL) {
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
+    
+    httpd_resp_set_type(req, "application/octet-stream");
+    httpd_resp_set_hdr(req, "Content-Disposition", "attachment; filename=\"trace.rwt\"");
+    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+    
+    esp_err_t ret = ESP_OK;
+    for (uint32_t offset = 0; offset < size && ret == ESP_OK; ) {
+        uint32_t len = size - offset;
+        if (len > TRACE_DOWNLOAD_CHUNK_SIZE) {
+            len = TRACE_DOWNLOAD_CHUNK_SIZE;
+        }
+        ret = trace_recorder_read(offset, chunk, len);
+        if (ret == ESP_OK) {
+            ret = httpd_resp_send_chunk(req, (const char *)chunk, len);
+        }
+        offset += len;
+    }
+    
+    free(chunk);
+    
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Trace download aborted: %s", esp_err_to_name(ret));
+        return ESP_FAIL;
+    }
+    
+    httpd_resp_send_chunk(req, NULL, 0);
+    ESP_LOGI(TAG, "Trace downloaded (%lu bytes)", (unsigned long)size);
+    return ESP_OK;
+}
+
 // ============================================================================
 // WiFi Captive Portal Endpoints
 // ============================================================================
@@ -1630,8 +2209,10 @@ static esp_err_t api_reboot_handler(httpd_req_t *req) {
     
     free(json_string);
     
-    // Schedule reboot after response is sent
+    // Schedule reboot after response is sent; flushed samples of a running
+    // session are recovered at boot
     vTaskDelay(pdMS_TO_TICKS(2000));
+    session_manager_flush();
     esp_restart();
     
     return ESP_OK;  // Won't reach here
@@ -1645,6 +2226,7 @@ static esp_err_t api_reboot_handler(httpd_req_t *req) {
 typedef struct {
     int fd;
     httpd_req_t *async_req;
+    stream_state_t stream;      // What the client has received
 } sse_client_t;
 
 // SSE client list
@@ -1687,6 +2269,7 @@ static bool sse_add_client(int fd, httpd_req_t *async_req) {
         if (g_sse_clients[i].fd < 0) {
             g_sse_clients[i].fd = fd;
             g_sse_clients[i].async_req = async_req;
+            memset(&g_sse_clients[i].stream, 0, sizeof(g_sse_clients[i].stream));
             ESP_LOGI(TAG, "SSE client added: fd=%d, slot=%d", fd, i);
             SSE_MUTEX_GIVE();
             return true;
@@ -1812,13 +2395,17 @@ static esp_err_t sse_handler(httpd_req_t *req) {
 
 /**
  * Add WebSocket client to list (thread-safe)
+ * @param binary Client negotiated the binary metrics subprotocol
  */
-static void ws_add_client(int fd) {
+static void ws_add_client(int fd, bool binary) {
     WS_MUTEX_TAKE();
     for (int i = 0; i < MAX_WS_CLIENTS; i++) {
         if (g_ws_fds[i] < 0) {
             g_ws_fds[i] = fd;
-            ESP_LOGI(TAG, "WebSocket client added: fd=%d", fd);
+            g_ws_binary[i] = binary;
+            g_ws_strokes[i] = false;
+            memset(&g_ws_state[i], 0, sizeof(g_ws_state[i]));
+            ESP_LOGI(TAG, "WebSocket client added: fd=%d (%s)", fd, binary ? "binary" : "JSON");
             WS_MUTEX_GIVE();
             return;
         }
@@ -1848,10 +2435,17 @@ static void ws_remove_client(int fd) {
  */
 static esp_err_t ws_handler(httpd_req_t *req) {
     if (req->method == HTTP_GET) {
-        // WebSocket handshake - add client to tracking list
+        // WebSocket handshake - add client to tracking list. httpd accepted
+        // the binary subprotocol if (and only if) the client asked for
+        // exactly that; anything else gets JSON text frames.
+        char subprotocol[32] = {0};
+        bool binary = httpd_req_get_hdr_value_str(req, "Sec-WebSocket-Protocol",
+                                                  subprotocol, sizeof(subprotocol)) == ESP_OK &&
+                      strcmp(subprotocol, METRICS_WS_SUBPROTOCOL) == 0;
+        
         int sock = httpd_req_to_sockfd(req);
         if (sock >= 0) {
-            ws_add_client(sock);
+            ws_add_client(sock, binary);
         }
         ESP_LOGI(TAG, "WebSocket handshake completed for fd=%d", sock);
         return ESP_OK;
@@ -1891,9 +2485,33 @@ static esp_err_t ws_handler(httpd_req_t *req) {
         ESP_LOGI(TAG, "Received WS text: %s", (char*)ws_pkt.payload);
         
         // Handle commands from client
-        if (strstr((char*)ws_pkt.payload, "reset") != NULL) {
+        if (strstr((char*)ws_pkt.payload, "keyframe") != NULL) {
+            // Client lost track of its state: send it a full frame next
+            int sock = httpd_req_to_sockfd(req);
+            WS_MUTEX_TAKE();
+            for (int i = 0; i < MAX_WS_CLIENTS; i++) {
+                if (g_ws_fds[i] == sock) {
+                    g_ws_state[i].keyframe_requested = true;
+                    break;
+                }
+            }
+            WS_MUTEX_GIVE();
+        } else if (strstr((char*)ws_pkt.payload, "strokes") != NULL) {
+            // Client wants a record of every stroke from now on
+            int sock = httpd_req_to_sockfd(req);
+            WS_MUTEX_TAKE();
+            for (int i = 0; i < MAX_WS_CLIENTS; i++) {
+                if (g_ws_fds[i] == sock) {
+                    g_ws_strokes[i] = true;
+                    break;
+                }
+            }
+            WS_MUTEX_GIVE();
+        } else if (strstr((char*)ws_pkt.payload, "reset") != NULL) {
             if (g_metrics != NULL) {
+                metrics_calculator_begin_update();
                 metrics_calculator_reset(g_metrics);
+                metrics_calculator_end_update(g_metrics);
             }
         }
     } else if (ws_pkt.type == HTTPD_WS_TYPE_CLOSE) {
@@ -2018,6 +2636,20 @@ static const httpd_uri_t uri_api_status = {
     .user_ctx = NULL
 };
 
+static const httpd_uri_t uri_api_heap = {
+    .uri = "/api/heap",
+    .method = HTTP_GET,
+    .handler = api_heap_handler,
+    .user_ctx = NULL
+};
+
+static const httpd_uri_t uri_api_recording = {
+    .uri = "/api/recording",
+    .method = HTTP_GET,
+    .handler = api_recording_handler,
+    .user_ctx = NULL
+};
+
 static const httpd_uri_t uri_api_reset = {
     .uri = "/api/reset",
     .method = HTTP_POST,
@@ -2082,7 +2714,8 @@ static const httpd_uri_t uri_ws = {
     .handler = ws_handler,
     .user_ctx = NULL,
     .is_websocket = true,
-    .handle_ws_control_frames = true
+    .handle_ws_control_frames = true,
+    .supported_subprotocol = METRICS_WS_SUBPROTOCOL
 };
 
 // Heart Rate endpoints
@@ -2180,6 +2813,35 @@ static const httpd_uri_t uri_live_data = {
     .user_ctx = NULL
 };
 
+// Raw pulse trace endpoints
+static const httpd_uri_t uri_api_trace = {
+    .uri = "/api/trace",
+    .method = HTTP_GET,
+    .handler = api_trace_download_handler,
+    .user_ctx = NULL
+};
+
+static const httpd_uri_t uri_api_trace_status = {
+    .uri = "/api/trace/status",
+    .method = HTTP_GET,
+    .handler = api_trace_status_handler,
+    .user_ctx = NULL
+};
+
+static const httpd_uri_t uri_api_trace_start = {
+    .uri = "/api/trace/start",
+    .method = HTTP_POST,
+    .handler = api_trace_start_handler,
+    .user_ctx = NULL
+};
+
+static const httpd_uri_t uri_api_trace_stop = {
+    .uri = "/api/trace/stop",
+    .method = HTTP_POST,
+    .handler = api_trace_stop_handler,
+    .user_ctx = NULL
+};
+
 // WiFi captive portal endpoints
 static const httpd_uri_t uri_api_wifi_scan = {
     .uri = "/api/wifi/scan",
@@ -2284,6 +2946,8 @@ esp_err_t web_server_start(rowing_metrics_t *metrics, config_t *config) {
     g_metrics = metrics;
     g_config = config;
     
+    metrics_frame_init();
+    
     // Reset WebSocket client list
     for (int i = 0; i < MAX_WS_CLIENTS; i++) {
         g_ws_fds[i] = -1;
@@ -2295,7 +2959,7 @@ esp_err_t web_server_start(rowing_metrics_t *metrics, config_t *config) {
     httpd_config_t http_config = HTTPD_DEFAULT_CONFIG();
     http_config.server_port = WEB_SERVER_PORT;
     http_config.max_open_sockets = 10;   // Max allowed is 13 minus 3 internal = 10 for app use
-    http_config.max_uri_handlers = 50;   // We have 42 handlers, set to 50 for headroom
+    http_config.max_uri_handlers = 50;   // We have 48 handlers, set to 50 for headroom
     // Enable LRU purging to clean up stale connections when socket limit is reached.
     // Active SSE/WebSocket connections with recent activity are protected from purging.
     http_config.lru_purge_enable = true;
@@ -2334,6 +2998,8 @@ esp_err_t web_server_start(rowing_metrics_t *metrics, config_t *config) {
     REGISTER_URI(uri_favicon);
     REGISTER_URI(uri_api_metrics);
     REGISTER_URI(uri_api_status);
+    REGISTER_URI(uri_api_heap);
+    REGISTER_URI(uri_api_recording);
     REGISTER_URI(uri_api_reset);
     REGISTER_URI(uri_api_calibrate_inertia_start);
     REGISTER_URI(uri_api_calibrate_inertia_status);
@@ -2364,6 +3030,12 @@ esp_err_t web_server_start(rowing_metrics_t *metrics, config_t *config) {
     REGISTER_URI(uri_workout_resume);
     REGISTER_URI(uri_live_data);
     
+    // Raw pulse trace endpoints
+    REGISTER_URI(uri_api_trace);
+    REGISTER_URI(uri_api_trace_status);
+    REGISTER_URI(uri_api_trace_start);
+    REGISTER_URI(uri_api_trace_stop);
+    
     // WiFi captive portal endpoints
     REGISTER_URI(uri_api_wifi_scan);
     REGISTER_URI(uri_api_wifi_connect);
@@ -2453,42 +3125,195 @@ static bool is_socket_valid(httpd_handle_t hd, int fd) {
     return true;
 }
 
+// Last broadcast frame, kept to diff the next one against, and the deltas
+// of the current broadcast (broadcast task only)
+static char s_prev_json[JSON_BUFFER_SIZE];
+static uint16_t s_prev_json_len = 0;
+static uint8_t s_prev_binary[METRICS_BINARY_SIZE];
+static uint32_t s_prev_sequence = 0;
+static bool s_prev_valid = false;
+static char s_delta_sse[METRICS_FRAME_SSE_PREFIX_LEN + JSON_BUFFER_SIZE + 3];
+static uint8_t s_delta_binary[METRICS_BINARY_DELTA_MAX];
+
+// Stroke records total of the last stroke broadcast (broadcast task only)
+static uint32_t s_stroke_sent = 0;
+static char s_stroke_json[STROKE_RECORD_JSON_SIZE];
+static uint8_t s_stroke_binary[STROKE_RECORD_BINARY_SIZE];
+
+// Outbound queue per client slot, reset when a new client takes the slot
+// (broadcast task only)
+static send_queue_t g_ws_queues[MAX_WS_CLIENTS];
+static send_queue_t g_sse_queues[MAX_SSE_CLIENTS];
+
+// Largest header of a server-to-client WebSocket frame with a 16-bit length
+#define WS_FRAME_HEADER_MAX 4
+
+typedef enum {
+    STREAM_SKIP = 0,        // Client already has this frame
+    STREAM_UNCHANGED,       // Nothing it shows changed; count the frame, send nothing
+    STREAM_DELTA,
+    STREAM_KEYFRAME
+} stream_send_t;
+
+/**
+ * Decide what a client gets for the current frame
+ * @param state Client state
+ * @param sequence Current frame's metrics sequence
+ * @param delta_len Delta against the previous broadcast in the client's
+ *        format (-1 = none, 0 = nothing changed)
+ */
+static stream_send_t stream_plan(const stream_state_t *state, uint32_t sequence, int delta_len) {
+    if (state->synced && state->last_sequence == sequence) {
+        return STREAM_SKIP;
+    }
+    if (!state->synced || delta_len < 0 || state->last_sequence != s_prev_sequence ||
+        state->frames_since_key + 1 >= METRICS_KEYFRAME_INTERVAL) {
+        return STREAM_KEYFRAME;
+    }
+    return delta_len == 0 ? STREAM_UNCHANGED : STREAM_DELTA;
+}
+
 /**
- * Broadcast metrics to all connected WebSocket clients
- * Thread-safe with proper error handling
+ * Record that a client now has the current frame
  */
-esp_err_t web_server_broadcast_metrics(const rowing_metrics_t *metrics) {
-    if (g_server == NULL || metrics == NULL) {
+static void stream_advance(stream_state_t *state, uint32_t sequence, stream_send_t sent) {
+    if (sent == STREAM_SKIP) {
+        return;
+    }
+    state->frames_since_key = sent == STREAM_KEYFRAME ? 0 : state->frames_since_key + 1;
+    state->last_sequence = sequence;
+    state->synced = true;
+}
+
+typedef enum {
+    STREAM_CLIENT_OK = 0,
+    STREAM_CLIENT_DEAD,     // Socket failed
+    STREAM_CLIENT_EVICT     // Persistently behind the stream
+} stream_client_t;
+
+// Per-broadcast totals over all clients
+typedef struct {
+    uint32_t bytes_in_flight;
+    uint32_t frames_dropped;
+} stream_totals_t;
+
+/**
+ * Header of an unmasked, final server-to-client WebSocket frame
+ * Metrics frames are written by the broadcast task into the client's
+ * queue rather than with httpd_ws_send_frame_async(), which blocks until
+ * the socket took the whole frame.
+ * @return Header length
+ */
+static size_t ws_frame_header(uint8_t *header, bool binary, size_t len) {
+    header[0] = 0x80 | (binary ? HTTPD_WS_TYPE_BINARY : HTTPD_WS_TYPE_TEXT);
+    if (len < 126) {
+        header[1] = (uint8_t)len;
+        return 2;
+    }
+    header[1] = 126;
+    header[2] = (uint8_t)(len >> 8);
+    header[3] = (uint8_t)len;
+    return 4;
+}
+
+/**
+ * Deliver the current frame to one client without blocking
+ * Writes what is still queued from earlier broadcasts, queues the message
+ * the plan calls for and writes as much as the socket takes. A message that
+ * does not fit is dropped and the client gets a keyframe of the latest
+ * state once its queue has room.
+ * @param payload Message to queue (NULL for SKIP / UNCHANGED)
+ */
+static stream_client_t stream_client(send_queue_t *queue, int fd, stream_state_t *state,
+                                     uint32_t sequence, stream_send_t plan,
+                                     const void *header, size_t header_len,
+                                     const void *payload, size_t payload_len,
+                                     stream_totals_t *totals) {
+    // A new client in the slot (even one that got the same fd) starts
+    // with an empty queue
+    if (!state->queued || queue->fd != fd) {
+        send_queue_reset(queue, fd);
+        state->queued = true;
+    }
+    if (send_queue_flush(queue) < 0) {
+        return STREAM_CLIENT_DEAD;
+    }
+    
+    if (payload == NULL) {
+        stream_advance(state, sequence, plan);
+    } else if (send_queue_push(queue, header, header_len, payload, payload_len)) {
+        stream_advance(state, sequence, plan);
+        if (send_queue_flush(queue) < 0) {
+            return STREAM_CLIENT_DEAD;
+        }
+    } else {
+        state->synced = false;
+        totals->frames_dropped++;
+    }
+    
+    totals->bytes_in_flight += (uint32_t)send_queue_pending(queue);
+    return send_queue_end_broadcast(queue, STREAM_STALL_EVICT_BROADCASTS) ?
+           STREAM_CLIENT_EVICT : STREAM_CLIENT_OK;
+}
+
+/**
+ * Broadcast metrics to all connected WebSocket and SSE clients
+ * Each client gets a keyframe, the fields changed since the frame it has,
+ * or nothing, through its own bounded queue; a slow client never holds up
+ * the others. Thread-safe with proper error handling.
+ */
+esp_err_t web_server_broadcast_metrics(void) {
+    if (g_server == NULL) {
         return ESP_ERR_INVALID_STATE;
     }
     
-    // Build JSON
-    char buffer[JSON_BUFFER_SIZE];
-    int len = metrics_calculator_to_json(metrics, buffer, sizeof(buffer));
-    if (len <= 0) {
+    // Encoded once; every client below is sent the same bytes
+    metrics_frame_t *frame = metrics_frame_acquire();
+    if (frame == NULL) {
         return ESP_FAIL;
     }
+    uint32_t sequence = frame->sequence;
     
-    // Prepare WebSocket frame
-    httpd_ws_frame_t ws_pkt;
-    memset(&ws_pkt, 0, sizeof(httpd_ws_frame_t));
-    ws_pkt.payload = (uint8_t*)buffer;
-    ws_pkt.len = len;
-    ws_pkt.type = HTTPD_WS_TYPE_TEXT;
-    ws_pkt.final = true;
+    // Deltas against the previous broadcast, computed once for all clients
+    int json_delta_len = -1;
+    int binary_delta_len = -1;
+    if (s_prev_valid && s_prev_sequence != sequence) {
+        json_delta_len = metrics_delta_json(s_prev_json, s_prev_json_len,
+                                            metrics_frame_json(frame), frame->json_len,
+                                            s_delta_sse + METRICS_FRAME_SSE_PREFIX_LEN, JSON_BUFFER_SIZE);
+        binary_delta_len = (int)metrics_delta_binary(s_prev_binary, frame->binary, s_delta_binary);
+    }
+    if (json_delta_len > 0) {
+        memcpy(s_delta_sse, "data: ", METRICS_FRAME_SSE_PREFIX_LEN);
+        memcpy(s_delta_sse + METRICS_FRAME_SSE_PREFIX_LEN + json_delta_len, "\n\n", 3);
+    }
+    
+    size_t json_delta_size = json_delta_len > 0 ? (size_t)json_delta_len : 0;
+    size_t binary_delta_size = binary_delta_len > 0 ? (size_t)binary_delta_len : 0;
     
     // Take a snapshot of current clients under mutex
     int fds_to_send[MAX_WS_CLIENTS];
+    bool binary_to_send[MAX_WS_CLIENTS];
+    stream_state_t states[MAX_WS_CLIENTS];
     WS_MUTEX_TAKE();
     for (int i = 0; i < MAX_WS_CLIENTS; i++) {
         fds_to_send[i] = g_ws_fds[i];
+        binary_to_send[i] = g_ws_binary[i];
+        states[i] = g_ws_state[i];
+        if (states[i].keyframe_requested) {
+            states[i].synced = false;
+            g_ws_state[i].keyframe_requested = false;
+        }
     }
     WS_MUTEX_GIVE();
     
-    // Send to all clients (outside mutex to avoid blocking)
+    // Queue and write to all clients (outside mutex; never blocks)
     int sent_count = 0;
     int dead_fds[MAX_WS_CLIENTS];
     int dead_count = 0;
+    int evict_fds[MAX_WS_CLIENTS + MAX_SSE_CLIENTS];
+    int evict_count = 0;
+    stream_totals_t totals = {0};
     
     for (int i = 0; i < MAX_WS_CLIENTS; i++) {
         int fd = fds_to_send[i];
@@ -2500,50 +3325,74 @@ esp_err_t web_server_broadcast_metrics(const rowing_metrics_t *metrics) {
                 continue;
             }
             
-            // Try async send
-            esp_err_t ret = httpd_ws_send_frame_async(g_server, fd, &ws_pkt);
-            if (ret == ESP_OK) {
-                sent_count++;
-            } else if (ret == ESP_ERR_INVALID_ARG) {
-                // Socket closed or invalid
-                ESP_LOGD(TAG, "Socket fd %d invalid for async send", fd);
+            bool binary = binary_to_send[i];
+            stream_send_t plan = stream_plan(&states[i], sequence, binary ? binary_delta_len : json_delta_len);
+            
+            const void *payload = NULL;
+            size_t payload_len = 0;
+            if (plan == STREAM_KEYFRAME) {
+                payload = binary ? (const void *)frame->binary : (const void *)metrics_frame_json(frame);
+                payload_len = binary ? sizeof(frame->binary) : frame->json_len;
+            } else if (plan == STREAM_DELTA) {
+                payload = binary ? (const void *)s_delta_binary :
+                                   (const void *)(s_delta_sse + METRICS_FRAME_SSE_PREFIX_LEN);
+                payload_len = binary ? binary_delta_size : json_delta_size;
+            }
+            uint8_t header[WS_FRAME_HEADER_MAX];
+            size_t header_len = payload != NULL ? ws_frame_header(header, binary, payload_len) : 0;
+            
+            stream_client_t result = stream_client(&g_ws_queues[i], fd, &states[i], sequence, plan,
+                                                   header, header_len, payload, payload_len, &totals);
+            if (result == STREAM_CLIENT_DEAD) {
+                ESP_LOGD(TAG, "Send failed for fd %d: errno %d", fd, errno);
+                dead_fds[dead_count++] = fd;
+            } else if (result == STREAM_CLIENT_EVICT) {
+                ESP_LOGW(TAG, "Evicting slow WebSocket client fd=%d (%u bytes queued)",
+                         fd, (unsigned)send_queue_pending(&g_ws_queues[i]));
+                evict_fds[evict_count++] = fd;
                 dead_fds[dead_count++] = fd;
             } else {
-                // Other error - log but don't remove yet (might be temporary)
-                ESP_LOGD(TAG, "Failed to send to fd %d: %s (will retry)", fd, esp_err_to_name(ret));
+                sent_count++;
             }
         }
     }
     
-    // Remove dead clients under mutex
-    if (dead_count > 0) {
-        WS_MUTEX_TAKE();
-        for (int d = 0; d < dead_count; d++) {
-            for (int i = 0; i < MAX_WS_CLIENTS; i++) {
-                if (g_ws_fds[i] == dead_fds[d]) {
-                    g_ws_fds[i] = -1;
-                    ESP_LOGI(TAG, "Removed dead WebSocket client: fd=%d", dead_fds[d]);
-                    break;
-                }
+    // Store client states (unless the slot changed hands meanwhile) and
+    // remove dead clients under mutex
+    WS_MUTEX_TAKE();
+    for (int i = 0; i < MAX_WS_CLIENTS; i++) {
+        if (fds_to_send[i] >= 0 && g_ws_fds[i] == fds_to_send[i]) {
+            g_ws_state[i].synced = states[i].synced;
+            g_ws_state[i].frames_since_key = states[i].frames_since_key;
+            g_ws_state[i].last_sequence = states[i].last_sequence;
+            g_ws_state[i].queued = states[i].queued;
+        }
+    }
+    for (int d = 0; d < dead_count; d++) {
+        for (int i = 0; i < MAX_WS_CLIENTS; i++) {
+            if (g_ws_fds[i] == dead_fds[d]) {
+                g_ws_fds[i] = -1;
+                ESP_LOGI(TAG, "Removed dead WebSocket client: fd=%d", dead_fds[d]);
+                break;
             }
         }
-        WS_MUTEX_GIVE();
     }
+    WS_MUTEX_GIVE();
     
     // Also broadcast to SSE clients
-    // SSE format: "data: <json>\n\n"
-    char sse_buffer[JSON_BUFFER_SIZE + 16];
-    int sse_len = snprintf(sse_buffer, sizeof(sse_buffer), "data: %s\n\n", buffer);
+    // SSE format: "data: <json>\n\n" (already framed)
     
-    // Take a snapshot of SSE client fds
+    // Take a snapshot of SSE clients
     int sse_fds_to_send[MAX_SSE_CLIENTS];
+    stream_state_t sse_states[MAX_SSE_CLIENTS];
     SSE_MUTEX_TAKE();
     for (int i = 0; i < MAX_SSE_CLIENTS; i++) {
         sse_fds_to_send[i] = g_sse_clients[i].fd;
+        sse_states[i] = g_sse_clients[i].stream;
     }
     SSE_MUTEX_GIVE();
     
-    // Send to all SSE clients
+    // Queue and write to all SSE clients
     int sse_dead_fds[MAX_SSE_CLIENTS];
     int sse_dead_count = 0;
     
@@ -2557,24 +3406,144 @@ esp_err_t web_server_broadcast_metrics(const rowing_metrics_t *metrics) {
                 continue;
             }
             
-            // Send SSE data directly via socket
-            int written = send(fd, sse_buffer, sse_len, MSG_DONTWAIT);
-            if (written < 0) {
-                if (errno != EAGAIN && errno != EWOULDBLOCK) {
-                    ESP_LOGD(TAG, "SSE send failed for fd %d: errno %d", fd, errno);
-                    sse_dead_fds[sse_dead_count++] = fd;
-                }
+            stream_send_t plan = stream_plan(&sse_states[i], sequence, json_delta_len);
+            const char *data = NULL;
+            size_t data_len = 0;
+            if (plan == STREAM_KEYFRAME) {
+                data = frame->sse;
+                data_len = frame->sse_len;
+            } else if (plan == STREAM_DELTA) {
+                data = s_delta_sse;
+                data_len = METRICS_FRAME_SSE_PREFIX_LEN + json_delta_size + 2;
+            }
+            
+            stream_client_t result = stream_client(&g_sse_queues[i], fd, &sse_states[i], sequence, plan,
+                                                   NULL, 0, data, data_len, &totals);
+            if (result == STREAM_CLIENT_DEAD) {
+                ESP_LOGD(TAG, "SSE send failed for fd %d: errno %d", fd, errno);
+                sse_dead_fds[sse_dead_count++] = fd;
+            } else if (result == STREAM_CLIENT_EVICT) {
+                ESP_LOGW(TAG, "Evicting slow SSE client fd=%d (%u bytes queued)",
+                         fd, (unsigned)send_queue_pending(&g_sse_queues[i]));
+                evict_fds[evict_count++] = fd;
+                sse_dead_fds[sse_dead_count++] = fd;
             } else {
                 sent_count++;
             }
         }
     }
     
+    SSE_MUTEX_TAKE();
+    for (int i = 0; i < MAX_SSE_CLIENTS; i++) {
+        if (sse_fds_to_send[i] >= 0 && g_sse_clients[i].fd == sse_fds_to_send[i]) {
+            g_sse_clients[i].stream = sse_states[i];
+        }
+    }
+    SSE_MUTEX_GIVE();
+    
+    // Next broadcast is diffed against this one
+    if (!s_prev_valid || s_prev_sequence != sequence) {
+        memcpy(s_prev_json, metrics_frame_json(frame), frame->json_len);
+        s_prev_json_len = frame->json_len;
+        memcpy(s_prev_binary, frame->binary, sizeof(s_prev_binary));
+        s_prev_sequence = sequence;
+        s_prev_valid = true;
+    }
+    
+    metrics_frame_release(frame);
+    
     // Remove dead SSE clients (this also completes async requests)
     for (int d = 0; d < sse_dead_count; d++) {
         sse_remove_client(sse_dead_fds[d]);
     }
     
+    // Close evicted connections (the close callback forgets them again)
+    for (int e = 0; e < evict_count; e++) {
+        httpd_sess_trigger_close(g_server, evict_fds[e]);
+    }
+    
+    WS_MUTEX_TAKE();
+    g_stream_stats.frames_dropped += totals.frames_dropped;
+    g_stream_stats.clients_evicted += (uint32_t)evict_count;
+    g_stream_stats.bytes_in_flight = totals.bytes_in_flight;
+    WS_MUTEX_GIVE();
+    
+    return (sent_count > 0) ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+/**
+ * Push the latest stroke record to subscribed WebSocket clients
+ * Queued behind the client's metrics frames; a record that does not fit is
+ * dropped (the next stroke brings a new one). Dead clients are left for
+ * the next metrics broadcast to remove.
+ */
+esp_err_t web_server_broadcast_stroke(void) {
+    if (g_server == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    
+    stroke_record_t record;
+    uint32_t total = stroke_record_latest(&record);
+    if (total == 0 || total == s_stroke_sent) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    s_stroke_sent = total;
+    
+    int json_len = stroke_record_to_json(&record, s_stroke_json, sizeof(s_stroke_json));
+    size_t binary_len = stroke_record_to_binary(&record, s_stroke_binary);
+    
+    // Take a snapshot of subscribed clients under mutex
+    int fds_to_send[MAX_WS_CLIENTS];
+    bool binary_to_send[MAX_WS_CLIENTS];
+    bool queued[MAX_WS_CLIENTS];
+    WS_MUTEX_TAKE();
+    for (int i = 0; i < MAX_WS_CLIENTS; i++) {
+        fds_to_send[i] = g_ws_strokes[i] ? g_ws_fds[i] : -1;
+        binary_to_send[i] = g_ws_binary[i];
+        queued[i] = g_ws_state[i].queued;
+    }
+    WS_MUTEX_GIVE();
+    
+    int sent_count = 0;
+    uint32_t dropped = 0;
+    for (int i = 0; i < MAX_WS_CLIENTS; i++) {
+        int fd = fds_to_send[i];
+        if (fd < 0 || !is_socket_valid(g_server, fd)) {
+            continue;
+        }
+        bool binary = binary_to_send[i];
+        if (!binary && json_len < 0) {
+            continue;
+        }
+        
+        // Same queue as the client's metrics, so a new client's is reset first
+        send_queue_t *queue = &g_ws_queues[i];
+        if (!queued[i] || queue->fd != fd) {
+            send_queue_reset(queue, fd);
+            queued[i] = true;
+        }
+        
+        const void *payload = binary ? (const void *)s_stroke_binary : (const void *)s_stroke_json;
+        size_t payload_len = binary ? binary_len : (size_t)json_len;
+        uint8_t header[WS_FRAME_HEADER_MAX];
+        size_t header_len = ws_frame_header(header, binary, payload_len);
+        if (send_queue_push(queue, header, header_len, payload, payload_len)) {
+            send_queue_flush(queue);
+            sent_count++;
+        } else {
+            dropped++;
+        }
+    }
+    
+    WS_MUTEX_TAKE();
+    for (int i = 0; i < MAX_WS_CLIENTS; i++) {
+        if (fds_to_send[i] >= 0 && g_ws_fds[i] == fds_to_send[i]) {
+            g_ws_state[i].queued = queued[i];
+        }
+    }
+    g_stream_stats.frames_dropped += dropped;
+    WS_MUTEX_GIVE();
+    
     return (sent_count > 0) ? ESP_OK : ESP_ERR_NOT_FOUND;
 }
 
@@ -42,11 +42,18 @@ void web_server_stop(void);
 httpd_handle_t web_server_get_handle(void);
 
 /**
- * Broadcast metrics to all connected WebSocket clients
- * @param metrics Pointer to current metrics
+ * Broadcast the latest published metrics to all WebSocket and SSE clients
+ * The JSON is encoded once (metrics_frame) and shared by every client.
  * @return ESP_OK on success
  */
-esp_err_t web_server_broadcast_metrics(const rowing_metrics_t *metrics);
+esp_err_t web_server_broadcast_metrics(void);
+
+/**
+ * Push the latest stroke record (stroke_record.h) to WebSocket clients that
+ * subscribed with the "strokes" command; does nothing if it was already sent
+ * @return ESP_OK if at least one client was sent it
+ */
+esp_err_t web_server_broadcast_stroke(void);
 
 /**
  * Check if any WebSocket clients are connected